@@ -0,0 +1,348 @@
+/* ambig.c: AMBIGUOUS AREA SCANNING
+ *
+ * $Id$
+ * Copyright (c) 2026 Ravenbrook Limited.  See end of file for license.
+ *
+ * .purpose: Scans areas of ambiguous references, such as thread
+ * stacks and registers, more quickly than the client's area scanner
+ * would.  See <design/trace#.scan.ambig>.
+ *
+ * .known: This only applies to the area scanners provided by the MPS
+ * (mps_scan_area and friends in <code/scan.c>), whose behaviour is
+ * known.  Any other area scanner is called as usual.
+ *
+ * .filter: Each word that passes the scanner's tag test contributes
+ * its zone to the unfixed summary, exactly as MPS_FIX1 would.  It is
+ * then passed through two filters: the range filter rejects words
+ * that aren't in any of the arena's chunk ranges (see
+ * <design/arena#.chunk.range>), and the zone filter rejects words
+ * that aren't in the white set.  Only the survivors are passed to
+ * _mps_fix2.  The filters don't change the outcome of scanning,
+ * because _mps_fix2 ignores ambiguous references outside the arena's
+ * chunks, and MPS_FIX1 would have rejected words outside the white
+ * set.
+ */
+
+#include "mpm.h"
+
+SRCID(ambig, "$Id$");
+
+
+/* Tag tests applied by the known area scanners */
+
+enum {
+  AmbigTestALL,                 /* mps_scan_area, mps_scan_area_masked */
+  AmbigTestTAGGED,              /* mps_scan_area_tagged */
+  AmbigTestTAGGED_OR_ZERO       /* mps_scan_area_tagged_or_zero */
+};
+
+
+/* ambigInRange -- is word in one of the arena's chunk ranges? */
+
+#define ambigInRange(arena, word) \
+  ((arena)->chunkRangeCount > 0 \
+   && (Word)(arena)->chunkRange[0].base <= (word) \
+   && (word) < (Word)(arena)->chunkRange[(arena)->chunkRangeCount - 1].limit \
+   && ambigInRanges(arena, word))
+
+static Bool ambigInRanges(Arena arena, Word word)
+{
+  Index i;
+  for (i = 0; i < arena->chunkRangeCount; ++i) {
+    if (word < (Word)arena->chunkRange[i].base)
+      return FALSE;
+    if (word < (Word)arena->chunkRange[i].limit)
+      return TRUE;
+  }
+  return FALSE;
+}
+
+
+/* AMBIG_TEST -- does the word pass the scanner's tag test? */
+
+#define AMBIG_TEST(test, tagBits, pattern) \
+  ((test) == AmbigTestALL \
+   || (tagBits) == (pattern) \
+   || ((test) == AmbigTestTAGGED_OR_ZERO && (tagBits) == 0))
+
+
+/* ambigFix -- fix a word that survived the filters */
+
+static Res ambigFix(ScanState ss, Word ref)
+{
+  mps_addr_t addr = (mps_addr_t)ref;
+  Res res = _mps_fix2(&ss->ss_s, &addr);
+  /* Ambiguous references are never updated. */
+  AVER(addr == (mps_addr_t)ref);
+  return res;
+}
+
+
+/* ambigScanScalar -- scan area of ambiguous references one at a time */
+
+static Res ambigScanScalar(ScanState ss, Word *base, Word *limit,
+                           unsigned test, Word mask, Word pattern)
+{
+  Arena arena = ss->arena;
+  Shift zoneShift = ScanStateZoneShift(ss);
+  ZoneSet white = ScanStateWhite(ss);
+  RefSet summary = ScanStateUnfixedSummary(ss);
+  Word *p;
+  Res res = ResOK;
+
+  for (p = base; p < limit; ++p) {
+    Word word = *p;
+    Word tagBits = word & mask;
+    Word ref, zoneBit;
+    if (!AMBIG_TEST(test, tagBits, pattern))
+      continue;
+    ref = word ^ tagBits;
+    zoneBit = (Word)1 << ((ref >> zoneShift) & (MPS_WORD_WIDTH - 1));
+    summary |= zoneBit;
+    if (!ambigInRange(arena, ref))
+      continue;
+    STATISTIC(++ss->ambigRangeCount);
+    if ((white & zoneBit) == 0)
+      continue;
+    STATISTIC(++ss->ambigZoneCount);
+    res = ambigFix(ss, ref);
+    if (res != ResOK)
+      break;
+  }
+
+  ScanStateSetUnfixedSummary(ss, summary);
+  return res;
+}
+
+
+/* Vector range filter
+ *
+ * .simd: On x86-64 with GCC or Clang, if the processor supports AVX2,
+ * the tag test, zone computation and both filters are applied to four
+ * words at a time.  AVX2 has only signed 64-bit comparisons, so the
+ * words and the chunk range bounds are offset by the sign bit, which
+ * turns unsigned comparisons into signed ones.  The AVX2 code is
+ * compiled with the "target" attribute so that the rest of the MPS
+ * can run on any x86-64 processor.
+ */
+
+#if defined(MPS_ARCH_I6) && !defined(CONFIG_PF_ANSI) \
+    && ((defined(__GNUC__) && !defined(__clang__) \
+         && (__GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 9))) \
+        || (defined(__clang__) \
+            && (__clang_major__ > 3 \
+                || (__clang_major__ == 3 && __clang_minor__ >= 8))))
+
+#define AMBIG_SIMD
+
+#include <cpuid.h>
+#include <immintrin.h>
+
+/* The intrinsics take signed 64-bit integers. */
+__extension__ typedef long long AmbigInt64;
+
+/* Whether the AVX2 code can be used: 0 for unknown, 1 for no, 2 for
+   yes.  The race to set this is harmless. */
+static int ambigAVX2 = 0;
+
+static Bool ambigHasAVX2(void)
+{
+  unsigned eax, ebx, ecx, edx;
+
+  if (ambigAVX2 == 0) {
+    ambigAVX2 = 1;
+    /* See <code/scan.c#.simd.dispatch>. */
+    if (__get_cpuid(1, &eax, &ebx, &ecx, &edx)
+        && (ecx & bit_OSXSAVE) != 0 && (ecx & bit_AVX) != 0)
+    {
+      unsigned xcr0Lo, xcr0Hi;
+      __asm__ __volatile__ ("xgetbv" : "=a" (xcr0Lo), "=d" (xcr0Hi) : "c" (0));
+      UNUSED(xcr0Hi);
+      if ((xcr0Lo & 6) == 6 && __get_cpuid_max(0, NULL) >= 7) {
+        __cpuid_count(7, 0, eax, ebx, ecx, edx);
+        if ((ebx & bit_AVX2) != 0)
+          ambigAVX2 = 2;
+      }
+    }
+  }
+  return ambigAVX2 == 2;
+}
+
+
+/* ambigBitCount -- number of bits set in a four-bit lane mask */
+
+static const unsigned char ambigBitCount[16] = {
+  0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4
+};
+
+
+__attribute__((target("avx2")))
+static Res ambigScanAVX2(ScanState ss, Word *base, Word *limit,
+                         unsigned test, Word mask, Word pattern)
+{
+  Arena arena = ss->arena;
+  Word *p = base;
+  Word *vlimit = base + ((limit - base) & ~(ptrdiff_t)3);
+  const __m256i vsign = _mm256_set1_epi64x((AmbigInt64)((Word)1 << (MPS_WORD_WIDTH - 1)));
+  const __m256i vmask = _mm256_set1_epi64x((AmbigInt64)mask);
+  const __m256i vpattern = _mm256_set1_epi64x((AmbigInt64)pattern);
+  const __m256i vwhite = _mm256_set1_epi64x((AmbigInt64)ScanStateWhite(ss));
+  const __m256i vzero = _mm256_setzero_si256();
+  const __m256i vone = _mm256_set1_epi64x(1);
+  const __m256i vzonemask = _mm256_set1_epi64x(MPS_WORD_WIDTH - 1);
+  const __m128i vzs = _mm_cvtsi64_si128((AmbigInt64)ScanStateZoneShift(ss));
+  __m256i vbase[ChunkRangeSIZE], vlimitRange[ChunkRangeSIZE];
+  __m256i vsummary = vzero;
+  Word summary[4];
+  Count ranges = arena->chunkRangeCount;
+  Index i;
+  Res res = ResOK;
+
+  for (i = 0; i < ranges; ++i) {
+    vbase[i] = _mm256_xor_si256(vsign, _mm256_set1_epi64x(
+      (AmbigInt64)arena->chunkRange[i].base));
+    vlimitRange[i] = _mm256_xor_si256(vsign, _mm256_set1_epi64x(
+      (AmbigInt64)arena->chunkRange[i].limit));
+  }
+
+  while (p < vlimit) {
+    __m256i words = _mm256_loadu_si256((const __m256i *)p);
+    __m256i tags = _mm256_and_si256(words, vmask);
+    __m256i refs = _mm256_xor_si256(words, tags);
+    __m256i signedRefs = _mm256_xor_si256(refs, vsign);
+    __m256i pass, zones, bits, inRange = vzero;
+    int rangeLanes, zoneLanes;
+
+    switch (test) {
+    case AmbigTestALL:
+      pass = _mm256_cmpeq_epi64(vzero, vzero);
+      break;
+    case AmbigTestTAGGED:
+      pass = _mm256_cmpeq_epi64(tags, vpattern);
+      break;
+    default:
+      pass = _mm256_or_si256(_mm256_cmpeq_epi64(tags, vpattern),
+                             _mm256_cmpeq_epi64(tags, vzero));
+      break;
+    }
+
+    zones = _mm256_and_si256(_mm256_srl_epi64(refs, vzs), vzonemask);
+    bits = _mm256_and_si256(_mm256_sllv_epi64(vone, zones), pass);
+    vsummary = _mm256_or_si256(vsummary, bits);
+
+    /* Range filter: base <= ref < limit for some range. */
+    for (i = 0; i < ranges; ++i)
+      inRange = _mm256_or_si256(inRange, _mm256_andnot_si256(
+        _mm256_cmpgt_epi64(vbase[i], signedRefs),
+        _mm256_cmpgt_epi64(vlimitRange[i], signedRefs)));
+    inRange = _mm256_and_si256(inRange, pass);
+    rangeLanes = _mm256_movemask_pd(_mm256_castsi256_pd(inRange));
+
+    if (rangeLanes != 0) {
+      /* Zone filter */
+      __m256i black = _mm256_cmpeq_epi64(_mm256_and_si256(bits, vwhite), vzero);
+      zoneLanes = rangeLanes
+        & ~_mm256_movemask_pd(_mm256_castsi256_pd(black));
+      STATISTIC(ss->ambigRangeCount += ambigBitCount[rangeLanes]);
+      STATISTIC(ss->ambigZoneCount += ambigBitCount[zoneLanes]);
+      for (i = 0; i < 4; ++i)
+        if ((zoneLanes & (1 << i)) != 0) {
+          Word word = p[i];
+          res = ambigFix(ss, word ^ (word & mask));
+          if (res != ResOK)
+            goto done;
+        }
+    }
+    p += 4;
+  }
+
+done:
+  _mm256_storeu_si256((__m256i *)summary, vsummary);
+  ScanStateSetUnfixedSummary(ss, ScanStateUnfixedSummary(ss)
+                             | summary[0] | summary[1]
+                             | summary[2] | summary[3]);
+  if (res != ResOK)
+    return res;
+  return ambigScanScalar(ss, p, limit, test, mask, pattern);
+}
+
+#endif /* AMBIG_SIMD */
+
+
+/* AmbigScanArea -- scan area of ambiguous references
+ *
+ * See .known and .filter.
+ */
+
+Res AmbigScanArea(ScanState ss, Word *base, Word *limit,
+                  mps_area_scan_t scan_area, void *closure)
+{
+  unsigned test;
+  Word mask, pattern;
+  Res res;
+
+  AVERT(ScanState, ss);
+  AVER(ss->rank == RankAMBIG);
+  AVER(base < limit);
+
+  if (scan_area == mps_scan_area) {
+    test = AmbigTestALL;
+    mask = 0;
+    pattern = 0;
+  } else if (scan_area == mps_scan_area_masked) {
+    test = AmbigTestALL;
+    mask = ((mps_scan_tag_t)closure)->mask;
+    pattern = 0;
+  } else if (scan_area == mps_scan_area_tagged) {
+    test = AmbigTestTAGGED;
+    mask = ((mps_scan_tag_t)closure)->mask;
+    pattern = ((mps_scan_tag_t)closure)->pattern;
+  } else if (scan_area == mps_scan_area_tagged_or_zero) {
+    test = AmbigTestTAGGED_OR_ZERO;
+    mask = ((mps_scan_tag_t)closure)->mask;
+    pattern = ((mps_scan_tag_t)closure)->pattern;
+  } else {
+    return scan_area(&ss->ss_s, base, limit, closure);
+  }
+
+  STATISTIC(ss->ambigWordCount += (Count)(limit - base));
+
+#if defined(AMBIG_SIMD)
+  if (ambigHasAVX2())
+    res = ambigScanAVX2(ss, base, limit, test, mask, pattern);
+  else
+#endif
+    res = ambigScanScalar(ss, base, limit, test, mask, pattern);
+
+  return res;
+}
+
+
+/* C. COPYRIGHT AND LICENSE
+ *
+ * Copyright (C) 2026 Ravenbrook Limited <https://www.ravenbrook.com/>.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+ * IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
@@ -16,7 +16,9 @@
 #include "mps.h"
 #include "mpslib.h"
 
-#include <stdio.h> /* fflush, printf, putchar */
+#include <stdio.h> /* fflush, fprintf, printf, putchar, stderr */
+#include <stdlib.h> /* EXIT_FAILURE, strtoul */
+#include <string.h> /* strcmp, strncmp */
 
 
 /* These values have been tuned in the hope of getting one dynamic collection. */
@@ -30,6 +32,7 @@
 #define collectionsCOUNT  37
 #define rampSIZE          9
 #define initTestFREQ      6000
+#define concurrentFREQ    8
 
 /* testChain -- generation parameters for the test */
 
@@ -42,12 +45,15 @@ static mps_gen_param_s testChain[genCOUNT] = {
 
 
 static mps_arena_t arena;
+static mps_wb_t wb;
 static mps_ap_t ap;
 static mps_addr_t exactRoots[exactRootsCOUNT];
 static mps_addr_t ambigRoots[ambigRootsCOUNT];
 static size_t scale;            /* Overall scale factor. */
+static size_t extendBy;         /* Pool segment size, or 0 for default. */
 static unsigned long nCollsStart;
 static unsigned long nCollsDone;
+static unsigned long nCollsConcurrent; /* started while another running */
 
 
 /* report -- report statistics from any messages */
@@ -62,6 +68,8 @@ static void report(void)
     cdie(mps_message_get(&message, arena, type), "message get");
 
     if (type == mps_message_type_gc_start()) {
+      if (nCollsStart > nCollsDone)
+        nCollsConcurrent += 1;
       nCollsStart += 1;
       printf("\n{\n  Collection %lu started.  Because:\n", nCollsStart);
       printf("    %s\n", mps_message_gc_start_why(arena, message));
@@ -170,8 +178,18 @@ static void test(mps_pool_class_t pool_class, size_t roots_count)
   die(dylan_fmt(&format, arena), "fmt_create");
   die(mps_chain_create(&chain, arena, genCOUNT, testChain), "chain_create");
 
-  die(mps_pool_create(&pool, arena, pool_class, format, chain),
-      "pool_create(amc)");
+  MPS_ARGS_BEGIN(args) {
+    MPS_ARGS_ADD(args, MPS_KEY_FORMAT, format);
+    MPS_ARGS_ADD(args, MPS_KEY_CHAIN, chain);
+    if (extendBy != 0) {
+      /* Large segments of small objects, which a read barrier hit
+         can scan page by page. */
+      MPS_ARGS_ADD(args, MPS_KEY_EXTEND_BY, extendBy);
+      MPS_ARGS_ADD(args, MPS_KEY_LARGE_SIZE, extendBy * 2);
+    }
+    die(mps_pool_create_k(&pool, arena, pool_class, args),
+        "pool_create(amc)");
+  } MPS_ARGS_END(args);
 
   die(mps_ap_create(&ap, pool, mps_rank_exact()), "BufferCreate");
   die(mps_ap_create(&busy_ap, pool, mps_rank_exact()), "BufferCreate 2");
@@ -257,6 +275,13 @@ static void test(mps_pool_class_t pool_class, size_t roots_count)
         printf("walked %lu objects.\n", count2);
         Insist(count1 == count2);
       }
+      if (collections % concurrentFREQ == concurrentFREQ / 2) {
+        /* Start an incremental collection of the world, so that the */
+        /* nursery fills up while it is running and gets collected by */
+        /* a concurrent trace.  <design/trace#.multi> */
+        mps_arena_pause_time_set(arena, 0.0);
+        die(mps_arena_start_collect(arena), "start_collect");
+      }
       if (collections == rampSwitch) {
         int begin_ramp = !ramping
           || /* Every other time, switch back immediately. */ (collections & 1);
@@ -291,8 +316,8 @@ static void test(mps_pool_class_t pool_class, size_t roots_count)
         cdie(dylan_check(exactRoots[i]), "dying root check");
       exactRoots[i] = make(roots_count);
       if (exactRoots[(exactRootsCOUNT-1) - i] != objNULL)
-        dylan_write(exactRoots[(exactRootsCOUNT-1) - i],
-                    exactRoots, exactRootsCOUNT);
+        dylan_write_wb(wb, exactRoots[(exactRootsCOUNT-1) - i],
+                       exactRoots, exactRootsCOUNT);
     } else {
       i = (r >> 1) % ambigRootsCOUNT;
       ambigRoots[(ambigRootsCOUNT-1) - i] = make(roots_count);
@@ -324,23 +349,97 @@ static void test(mps_pool_class_t pool_class, size_t roots_count)
   mps_arena_release(arena);
 }
 
+/* main -- run the test
+ *
+ * Without options, the test runs the arena in its default
+ * configuration.  Each option turns on one optional feature, so that
+ * a failure can be attributed to it.  The remaining argument, if any,
+ * is the random seed.
+ */
+
+#define OPTION_WORKERS   "--trace-workers="
+#define OPTION_EXTEND_BY "--extend-by="
+
 int main(int argc, char *argv[])
 {
   size_t i, grainSize;
+  size_t workers = 1;
+  unsigned greyOrder = MPS_GREY_ORDER_LIFO;
+  mps_bool_t collectorThread = FALSE, alias = FALSE, uffd = FALSE;
+  mps_bool_t cardMarking = FALSE;
+  char *program = argv[0];
   mps_thr_t thread;
 
+  extendBy = 0;
+  while (argc > 1 && argv[1][0] == '-') {
+    const char *option = argv[1];
+    if (strncmp(option, OPTION_WORKERS, sizeof OPTION_WORKERS - 1) == 0)
+      workers = strtoul(option + sizeof OPTION_WORKERS - 1, NULL, 10);
+    else if (strcmp(option, "--grey-address") == 0)
+      greyOrder = MPS_GREY_ORDER_ADDRESS;
+    else if (strcmp(option, "--collector-thread") == 0)
+      collectorThread = TRUE;
+    else if (strcmp(option, "--alias") == 0)
+      alias = TRUE;
+    else if (strcmp(option, "--uffd") == 0)
+      uffd = TRUE;
+    else if (strcmp(option, "--card-marking") == 0)
+      cardMarking = TRUE;
+    else if (strncmp(option, OPTION_EXTEND_BY,
+                     sizeof OPTION_EXTEND_BY - 1) == 0)
+      extendBy = strtoul(option + sizeof OPTION_EXTEND_BY - 1, NULL, 10);
+    else {
+      /* This is printed in parts to keep within the 509 character
+         limit for string literals in portable standard C. */
+      fprintf(stderr,
+              "Usage: %s [option...] [seed]\n"
+              "Options:\n"
+              "  --trace-workers=n\n"
+              "    Scan with n collector worker threads (default 1)\n"
+              "  --grey-address\n"
+              "    Scan grey segments in address order\n"
+              "  --collector-thread\n"
+              "    Do the collection work on a collector thread\n",
+              program);
+      fprintf(stderr,
+              "  --alias\n"
+              "    Copy and scan through a collector alias of the heap\n"
+              "  --uffd\n"
+              "    Set the write barrier with userfaultfd (Linux only)\n"
+              "  --card-marking\n"
+              "    Use a card marking write barrier\n"
+              "  --extend-by=n\n"
+              "    Make AMC segments of n bytes, scanned page by page\n");
+      return EXIT_FAILURE;
+    }
+    --argc;
+    ++argv;
+  }
+  argv[0] = program;
   testlib_init(argc, argv);
 
   scale = (size_t)1 << (rnd() % 6);
   for (i = 0; i < genCOUNT; ++i) testChain[i].mps_capacity *= scale;
   grainSize = rnd_grain(scale * testArenaSIZE);
-  printf("Picked scale=%lu grainSize=%lu\n", (unsigned long)scale, (unsigned long)grainSize);
+  printf("Picked scale=%lu grainSize=%lu workers=%lu greyOrder=%u"
+         " collectorThread=%d alias=%d uffd=%d cardMarking=%d"
+         " extendBy=%lu\n",
+         (unsigned long)scale, (unsigned long)grainSize,
+         (unsigned long)workers, greyOrder, collectorThread, alias, uffd,
+         cardMarking, (unsigned long)extendBy);
 
   MPS_ARGS_BEGIN(args) {
     MPS_ARGS_ADD(args, MPS_KEY_ARENA_SIZE, scale * testArenaSIZE);
     MPS_ARGS_ADD(args, MPS_KEY_ARENA_GRAIN_SIZE, grainSize);
+    MPS_ARGS_ADD(args, MPS_KEY_TRACE_WORKERS, workers);
+    MPS_ARGS_ADD(args, MPS_KEY_TRACE_GREY_ORDER, greyOrder);
+    MPS_ARGS_ADD(args, MPS_KEY_COLLECTOR_THREAD, collectorThread);
+    MPS_ARGS_ADD(args, MPS_KEY_VMIX_ALIAS, alias);
+    MPS_ARGS_ADD(args, MPS_KEY_VMIX_UFFD, uffd);
+    MPS_ARGS_ADD(args, MPS_KEY_ARENA_CARD_MARKING, cardMarking);
     die(mps_arena_create_k(&arena, mps_arena_class_vm(), args), "arena_create");
   } MPS_ARGS_END(args);
+  wb = mps_arena_write_barrier(arena);
   mps_message_type_enable(arena, mps_message_type_gc());
   mps_message_type_enable(arena, mps_message_type_gc_start());
   die(mps_thread_reg(&thread, arena), "thread_reg");
@@ -350,6 +449,12 @@ int main(int argc, char *argv[])
   report();
   mps_arena_destroy(arena);
 
+  printf("%lu collections started while another was running.\n",
+         nCollsConcurrent);
+  /* A nursery collection must start while another is running.
+     <design/trace#.multi> */
+  Insist(nCollsConcurrent > 0);
+
   printf("%s: Conclusion: Failed to find any defects.\n", argv[0]);
   return 0;
 }
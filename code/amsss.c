@@ -18,7 +18,9 @@
 #include "mps.h"
 #include "mpm.h"
 
-#include <stdio.h> /* fflush, printf */
+#include <stdio.h> /* fflush, fprintf, printf, stderr */
+#include <stdlib.h> /* EXIT_FAILURE, strtoul */
+#include <string.h> /* strcmp, strncmp */
 
 
 #define exactRootsCOUNT 50
@@ -31,7 +33,10 @@
 #define testArenaSIZE   ((size_t)1<<20)
 #define initTestFREQ    3000
 #define splatTestFREQ   6000
-static mps_gen_param_s testChain[1] = { { 160, 0.90 } };
+#define testPAUSE       0.0001  /* short enough for traces to overlap */
+#define genCOUNT        2
+static mps_gen_param_s testChain[genCOUNT] = {
+  { 160, 0.90 }, { 320, 0.45 } };
 
 
 static mps_arena_t arena;
@@ -39,6 +44,7 @@ static mps_ap_t ap;
 static mps_addr_t exactRoots[exactRootsCOUNT];
 static mps_addr_t ambigRoots[ambigRootsCOUNT];
 static size_t totalSize = 0;
+static unsigned long nCollsConcurrent = 0; /* started while another running */
 
 
 /* report - report statistics from any messages */
@@ -55,6 +61,8 @@ static void report(void)
     cdie(mps_message_get(&message, arena, type), "message get");
 
     if (type == mps_message_type_gc_start()) {
+      if (nStart > nComplete)
+        nCollsConcurrent += 1;
       printf("\nCollection start %d.  Because:\n", ++nStart);
       printf("%s\n", mps_message_gc_start_why(arena, message));
 
@@ -152,6 +160,10 @@ static void test_pool(mps_pool_class_t pool_class, mps_arg_s args[],
       for(i = 0; i < exactRootsCOUNT; ++i)
         cdie(exactRoots[i] == objNULL || dylan_check(exactRoots[i]),
              "all roots check");
+      /* Start an incremental collection of the world, so that the */
+      /* nursery fills up while it is running and gets collected by */
+      /* a concurrent trace.  <design/trace#.multi> */
+      die(mps_arena_start_collect(arena), "start_collect");
     }
 
     r = (size_t)rnd();
@@ -161,8 +173,9 @@ static void test_pool(mps_pool_class_t pool_class, mps_arg_s args[],
         cdie(dylan_check(exactRoots[i]), "dying root check");
       exactRoots[i] = make();
       if (exactRoots[(exactRootsCOUNT-1) - i] != objNULL)
-        dylan_write(exactRoots[(exactRootsCOUNT-1) - i],
-                    exactRoots, exactRootsCOUNT);
+        dylan_write_wb(mps_arena_write_barrier(arena),
+                       exactRoots[(exactRootsCOUNT-1) - i],
+                       exactRoots, exactRootsCOUNT);
     } else {
       i = (r >> 1) % ambigRootsCOUNT;
       ambigRoots[(ambigRootsCOUNT-1) - i] = make();
@@ -195,18 +208,51 @@ static void test_pool(mps_pool_class_t pool_class, mps_arg_s args[],
 }
 
 
+#define OPTION_WORKERS "--trace-workers="
+
 int main(int argc, char *argv[])
 {
   int i;
+  size_t workers = 1;
+  mps_bool_t cardMarking = FALSE;
+  char *program = argv[0];
   mps_thr_t thread;
   mps_fmt_t format;
   mps_chain_t chain;
 
+  /* Options turn on optional features; see <code/amcss.c#main>. */
+  while (argc > 1 && argv[1][0] == '-') {
+    const char *option = argv[1];
+    if (strncmp(option, OPTION_WORKERS, sizeof OPTION_WORKERS - 1) == 0)
+      workers = strtoul(option + sizeof OPTION_WORKERS - 1, NULL, 10);
+    else if (strcmp(option, "--card-marking") == 0)
+      cardMarking = TRUE;
+    else {
+      fprintf(stderr,
+              "Usage: %s [option...] [seed]\n"
+              "Options:\n"
+              "  --trace-workers=n\n"
+              "    Scan with n collector worker threads (default 1)\n"
+              "  --card-marking\n"
+              "    Use a card marking write barrier\n",
+              program);
+      return EXIT_FAILURE;
+    }
+    --argc;
+    ++argv;
+  }
+  argv[0] = program;
   testlib_init(argc, argv);
 
+  printf("Picked workers=%lu cardMarking=%d\n", (unsigned long)workers,
+         cardMarking);
+
   MPS_ARGS_BEGIN(args) {
     MPS_ARGS_ADD(args, MPS_KEY_ARENA_SIZE, testArenaSIZE);
     MPS_ARGS_ADD(args, MPS_KEY_ARENA_GRAIN_SIZE, rnd_grain(testArenaSIZE));
+    MPS_ARGS_ADD(args, MPS_KEY_TRACE_WORKERS, workers);
+    MPS_ARGS_ADD(args, MPS_KEY_ARENA_CARD_MARKING, cardMarking);
+    MPS_ARGS_ADD(args, MPS_KEY_PAUSE_TIME, testPAUSE);
     die(mps_arena_create_k(&arena, mps_arena_class_vm(), args), "arena_create");
   } MPS_ARGS_END(args);
 
@@ -214,7 +260,7 @@ int main(int argc, char *argv[])
   mps_message_type_enable(arena, mps_message_type_gc());
   die(mps_thread_reg(&thread, arena), "thread_reg");
   die(mps_fmt_create_A(&format, arena, dylan_fmt_A()), "fmt_create");
-  die(mps_chain_create(&chain, arena, 1, testChain), "chain_create");
+  die(mps_chain_create(&chain, arena, genCOUNT, testChain), "chain_create");
 
   for (i = 0; i < 8; i++) {
     int debug = i % 2;
@@ -240,6 +286,12 @@ int main(int argc, char *argv[])
   mps_thread_dereg(thread);
   mps_arena_destroy(arena);
 
+  /* A nursery collection must start while another is running.
+     <design/trace#.multi> */
+  printf("\n%lu collections started while another was running.\n",
+         nCollsConcurrent);
+  Insist(nCollsConcurrent > 0);
+
   printf("%s: Conclusion: Failed to find any defects.\n", argv[0]);
   return 0;
 }
@@ -193,6 +193,11 @@ Bool ArenaCheck(Arena arena)
   CHECKL(0.0 <= arena->spare);
   CHECKL(arena->spare <= 1.0);
   CHECKL(0.0 <= arena->pauseTime);
+  CHECKL(1 <= arena->traceWorkers);
+  CHECKL(arena->traceWorkers <= TRACE_WORKERS_MAX);
+  CHECKL(arena->greyOrder < GreyOrderLIMIT);
+  CHECKL(BoolCheck(arena->collectorThread));
+  CHECKL(arena->background == NULL || arena->collectorThread);
 
   CHECKL(arena->zoneShift == ZoneShiftUNSET
          || ShiftCheck(arena->zoneShift));
@@ -215,6 +220,11 @@ Bool ArenaCheck(Arena arena)
   /* Can't use CHECKD_NOSIG because TreeEMPTY is NULL. */
   CHECKL(TreeCheck(ArenaChunkTree(arena)));
   /* TODO: check that the chunkRing and chunkTree have identical members */
+  CHECKL(arena->chunkMapCount <= ChunkMapSIZE);
+  CHECKL(ShiftCheck(arena->chunkMapShift));
+  CHECKL(arena->chunkMapShift < MPS_WORD_WIDTH);
+  /* Could check that the chunk map agrees with the chunk ring, but not O(1). */
+  CHECKL(arena->chunkRangeCount <= ChunkRangeSIZE);
   /* nothing to check for chunkSerial */
 
   CHECKL(LocusCheck(arena));
@@ -225,6 +235,13 @@ Bool ArenaCheck(Arena arena)
 
   CHECKL(BoolCheck(arena->zoned));
 
+  CHECKL(BoolCheck(arena->cardMarking));
+  CHECKL(ShiftCheck(arena->cardShift));
+  CHECKL(arena->cardShift <= CARD_SHIFT);
+  CHECKL(((Size)1 << arena->cardShift) <= arena->grainSize);
+  CHECKL(arena->wbStruct._arena == arena);
+  CHECKL(arena->wbStruct._count == 0 || arena->cardMarking);
+
   return TRUE;
 }
 
@@ -238,6 +255,10 @@ static Res ArenaAbsInit(Arena arena, Size grainSize, ArgList args)
   Size commitLimit = ARENA_DEFAULT_COMMIT_LIMIT;
   double spare = ARENA_SPARE_DEFAULT;
   double pauseTime = ARENA_DEFAULT_PAUSE_TIME;
+  Count traceWorkers = TRACE_WORKERS_DEFAULT;
+  GreyOrder greyOrder = TRACE_GREY_ORDER_DEFAULT;
+  Bool collectorThread = ARENA_DEFAULT_COLLECTOR_THREAD;
+  Bool cardMarking = ARENA_DEFAULT_CARD_MARKING;
   mps_arg_s arg;
 
   AVER(arena != NULL);
@@ -258,6 +279,19 @@ static Res ArenaAbsInit(Arena arena, Size grainSize, ArgList args)
     spare = arg.val.d;
   if (ArgPick(&arg, args, MPS_KEY_PAUSE_TIME))
     pauseTime = arg.val.d;
+  if (ArgPick(&arg, args, MPS_KEY_TRACE_WORKERS))
+    traceWorkers = arg.val.count;
+  /* Make it easier to write portable programs by clamping. */
+  if (traceWorkers < 1)
+    traceWorkers = 1;
+  if (traceWorkers > TRACE_WORKERS_MAX)
+    traceWorkers = TRACE_WORKERS_MAX;
+  if (ArgPick(&arg, args, MPS_KEY_TRACE_GREY_ORDER))
+    greyOrder = arg.val.u;
+  if (ArgPick(&arg, args, MPS_KEY_COLLECTOR_THREAD))
+    collectorThread = arg.val.b;
+  if (ArgPick(&arg, args, MPS_KEY_ARENA_CARD_MARKING))
+    cardMarking = arg.val.b;
 
   /* Superclass init */
   InstInit(CouldBeA(Inst, arena));
@@ -268,6 +302,11 @@ static Res ArenaAbsInit(Arena arena, Size grainSize, ArgList args)
   arena->spareCommitted = (Size)0;
   arena->spare = spare;
   arena->pauseTime = pauseTime;
+  arena->traceWorkers = traceWorkers;
+  arena->greyOrder = greyOrder;
+  arena->traceWork = NULL;
+  arena->collectorThread = collectorThread;
+  arena->background = NULL;
   arena->grainSize = grainSize;
   /* zoneShift must be overridden by arena class init */
   arena->zoneShift = ZoneShiftUNSET;
@@ -277,10 +316,19 @@ static Res ArenaAbsInit(Arena arena, Size grainSize, ArgList args)
   arena->hasFreeLand = FALSE;
   arena->freeZones = ZoneSetUNIV;
   arena->zoned = zoned;
+  arena->cardMarking = cardMarking;
+  arena->cardShift = SizeLog2(grainSize);
+  if (arena->cardShift > CARD_SHIFT)
+    arena->cardShift = CARD_SHIFT;
+  ArenaCardsInit(arena, NULL);
 
   arena->primary = NULL;
   RingInit(ArenaChunkRing(arena));
   arena->chunkTree = TreeEMPTY;
+  arena->chunkMapBase = (Addr)0;
+  arena->chunkMapShift = SizeLog2(grainSize);
+  arena->chunkMapCount = 0;
+  arena->chunkRangeCount = 0;
   arena->chunkSerial = (Serial)0;
 
   LocusInit(arena);
@@ -322,13 +370,16 @@ failGlobalsInit:
 
 /* VM keys are defined here even though the code they apply to might
  * not be linked.  For example, MPS_KEY_VMW3_TOP_DOWN only applies to
- * vmw3.c.  The reason is that we want these keywords to be optional
+ * vmw3.c, and MPS_KEY_VMIX_ALIAS and MPS_KEY_VMIX_UFFD only to vmix.c
+ * on Linux.  The reason is that we want these keywords to be optional
  * even on the wrong platform, so that clients can write simple portable
  * code.  They should be free to pass MPS_KEY_VMW3_TOP_DOWN on other
  * platforms, knowing that it has no effect.  To do that, the key must
  * exist on all platforms. */
 
 ARG_DEFINE_KEY(VMW3_TOP_DOWN, Bool);
+ARG_DEFINE_KEY(VMIX_ALIAS, Bool);
+ARG_DEFINE_KEY(VMIX_UFFD, Bool);
 
 
 /* ArenaCreate -- create the arena and call initializers */
@@ -336,9 +387,13 @@ ARG_DEFINE_KEY(VMW3_TOP_DOWN, Bool);
 ARG_DEFINE_KEY(ARENA_GRAIN_SIZE, Size);
 ARG_DEFINE_KEY(ARENA_SIZE, Size);
 ARG_DEFINE_KEY(ARENA_ZONED, Bool);
+ARG_DEFINE_KEY(ARENA_CARD_MARKING, Bool);
 ARG_DEFINE_KEY(COMMIT_LIMIT, Size);
 ARG_DEFINE_KEY(SPARE_COMMIT_LIMIT, Size);
 ARG_DEFINE_KEY(PAUSE_TIME, double);
+ARG_DEFINE_KEY(TRACE_WORKERS, Count);
+ARG_DEFINE_KEY(TRACE_GREY_ORDER, GreyOrder);
+ARG_DEFINE_KEY(COLLECTOR_THREAD, Bool);
 
 static Res arenaFreeLandInit(Arena arena)
 {
@@ -572,6 +627,11 @@ static Res ArenaAbsDescribe(Inst inst, mps_lib_FILE *stream, Count depth)
                "hasFreeLand      $S\n", WriteFYesNo(arena->hasFreeLand),
                "freeZones        $B\n", (WriteFB)arena->freeZones,
                "zoned            $S\n", WriteFYesNo(arena->zoned),
+               "traceWorkers     $U\n", (WriteFU)arena->traceWorkers,
+               "greyOrder        $U\n", (WriteFU)arena->greyOrder,
+               "collectorThread  $S\n", WriteFYesNo(arena->collectorThread),
+               "cardMarking      $S\n", WriteFYesNo(arena->cardMarking),
+               "cardShift        $U\n", (WriteFU)arena->cardShift,
                NULL);
   if (res != ResOK)
     return res;
@@ -732,9 +792,177 @@ Res ControlDescribe(Arena arena, mps_lib_FILE *stream, Count depth)
 }
 
 
-/* ArenaChunkInsert -- insert chunk into arena's chunk tree and ring,
- * update the total reserved address space, and set the primary chunk
- * if not already set.
+/* arenaChunkMapAdd -- add chunk to the chunk map entries it overlaps
+ *
+ * The chunk must lie within the address space covered by the map.
+ * See <design/arena#.chunk.map>.
+ */
+
+static void arenaChunkMapAdd(Arena arena, Chunk chunk)
+{
+  Index i, first, last;
+
+  first = AddrOffset(arena->chunkMapBase, chunk->base)
+    >> arena->chunkMapShift;
+  last = AddrOffset(arena->chunkMapBase, AddrSub(chunk->limit, 1))
+    >> arena->chunkMapShift;
+  AVER(first <= last);
+  AVER(last < arena->chunkMapCount);
+
+  for (i = first; i <= last; ++i) {
+    ChunkMapEntryStruct *entry = &arena->chunkMap[i];
+    if (entry->ambiguous) {
+      NOOP;
+    } else if (entry->lo == NULL) {
+      entry->lo = chunk;
+    } else if (entry->hi == NULL) {
+      if (chunk->base < entry->lo->base) {
+        entry->hi = entry->lo;
+        entry->lo = chunk;
+      } else {
+        entry->hi = chunk;
+      }
+    } else {
+      entry->lo = NULL;
+      entry->hi = NULL;
+      entry->ambiguous = TRUE;
+    }
+  }
+}
+
+
+/* arenaChunkMapRebuild -- rebuild the chunk map from the chunk ring
+ *
+ * Chooses the smallest entry size such that the map covers all the
+ * chunks in the ring (apart from omit, if not NULL), and adds them.
+ * See <design/arena#.chunk.map>.
+ */
+
+static void arenaChunkMapRebuild(Arena arena, Chunk omit)
+{
+  Ring node, next;
+  Addr base = (Addr)0, limit = (Addr)0, mapBase;
+  Bool found = FALSE;
+  Shift shift;
+  Index i;
+
+  RING_FOR(node, ArenaChunkRing(arena), next) {
+    Chunk chunk = RING_ELT(Chunk, arenaRing, node);
+    if (chunk != omit) {
+      if (!found || chunk->base < base)
+        base = chunk->base;
+      if (!found || chunk->limit > limit)
+        limit = chunk->limit;
+      found = TRUE;
+    }
+  }
+
+  for (i = 0; i < arena->chunkMapCount; ++i) {
+    arena->chunkMap[i].lo = NULL;
+    arena->chunkMap[i].hi = NULL;
+    arena->chunkMap[i].ambiguous = FALSE;
+  }
+
+  if (!found) {
+    arena->chunkMapCount = 0;
+    return;
+  }
+
+  shift = SizeLog2(ArenaGrainSize(arena));
+  for (;;) {
+    mapBase = AddrAlignDown(base, (Align)1 << shift);
+    if ((AddrOffset(mapBase, AddrSub(limit, 1)) >> shift) < ChunkMapSIZE)
+      break;
+    ++shift;
+    AVER(shift < MPS_WORD_WIDTH);
+  }
+
+  arena->chunkMapBase = mapBase;
+  arena->chunkMapShift = shift;
+  arena->chunkMapCount = (AddrOffset(mapBase, AddrSub(limit, 1)) >> shift) + 1;
+  for (i = 0; i < arena->chunkMapCount; ++i) {
+    arena->chunkMap[i].lo = NULL;
+    arena->chunkMap[i].hi = NULL;
+    arena->chunkMap[i].ambiguous = FALSE;
+  }
+
+  RING_FOR(node, ArenaChunkRing(arena), next) {
+    Chunk chunk = RING_ELT(Chunk, arenaRing, node);
+    if (chunk != omit)
+      arenaChunkMapAdd(arena, chunk);
+  }
+}
+
+
+/* arenaChunkRangeAdd -- add chunk to the table of chunk ranges
+ *
+ * Inserts the chunk's address range into the sorted table, merging it
+ * with a neighbouring range if they are contiguous.  If the table
+ * overflows, merges the two ranges with the smallest gap between
+ * them.  See <design/arena#.chunk.range>.
+ */
+
+static void arenaChunkRangeAdd(Arena arena, Chunk chunk)
+{
+  ChunkRangeStruct range[ChunkRangeSIZE + 1];
+  Count count = arena->chunkRangeCount;
+  Index i, j;
+
+  for (i = 0; i < count && arena->chunkRange[i].base < chunk->base; ++i)
+    range[i] = arena->chunkRange[i];
+  range[i].base = chunk->base;
+  range[i].limit = chunk->limit;
+  for (j = i; j < count; ++j)
+    range[j + 1] = arena->chunkRange[j];
+  ++count;
+
+  /* Merge contiguous ranges, and then the closest ranges until the
+     table fits. */
+  for (;;) {
+    Index best = 0;
+    Size bestGap = 0;
+    for (i = 0; i + 1 < count; ++i) {
+      Size gap = AddrOffset(range[i].limit, range[i + 1].base);
+      if (i == 0 || gap < bestGap) {
+        best = i;
+        bestGap = gap;
+      }
+    }
+    if (count <= 1 || (bestGap > 0 && count <= ChunkRangeSIZE))
+      break;
+    range[best].limit = range[best + 1].limit;
+    for (j = best + 1; j + 1 < count; ++j)
+      range[j] = range[j + 1];
+    --count;
+  }
+
+  for (i = 0; i < count; ++i)
+    arena->chunkRange[i] = range[i];
+  arena->chunkRangeCount = count;
+}
+
+
+/* arenaChunkRangeRebuild -- rebuild the table of chunk ranges
+ *
+ * Adds all the chunks in the ring, apart from omit, if not NULL.
+ */
+
+static void arenaChunkRangeRebuild(Arena arena, Chunk omit)
+{
+  Ring node, next;
+
+  arena->chunkRangeCount = 0;
+  RING_FOR(node, ArenaChunkRing(arena), next) {
+    Chunk chunk = RING_ELT(Chunk, arenaRing, node);
+    if (chunk != omit)
+      arenaChunkRangeAdd(arena, chunk);
+  }
+}
+
+
+/* ArenaChunkInsert -- insert chunk into arena's chunk tree, ring and
+ * maps, update the total reserved address space, and set the primary
+ * chunk if not already set.
  */
 
 void ArenaChunkInsert(Arena arena, Chunk chunk)
@@ -754,18 +982,32 @@ void ArenaChunkInsert(Arena arena, Chunk chunk)
   arena->chunkTree = updatedTree;
   RingAppend(ArenaChunkRing(arena), &chunk->arenaRing);
 
+  /* If the chunk is within the address space covered by the chunk
+     map, add it, otherwise the map needs to cover more address space. */
+  if (arena->chunkMapCount > 0
+      && arena->chunkMapBase <= chunk->base
+      && (AddrOffset(arena->chunkMapBase, AddrSub(chunk->limit, 1))
+          >> arena->chunkMapShift) < arena->chunkMapCount)
+    arenaChunkMapAdd(arena, chunk);
+  else
+    arenaChunkMapRebuild(arena, NULL);
+  arenaChunkRangeAdd(arena, chunk);
+  ArenaAccessMapAdd(arena, NULL, chunk->base, chunk->limit);
+
   arena->reserved += ChunkReserved(chunk);
 
   /* As part of the bootstrap, the first created chunk becomes the primary
      chunk.  This step allows ArenaFreeLandInsert to allocate pages. */
-  if (arena->primary == NULL)
+  if (arena->primary == NULL) {
     arena->primary = chunk;
+    ArenaCardsInit(arena, chunk);
+  }
 }
 
 
 /* ArenaChunkRemoved -- chunk was removed from the arena and is being
- * finished, so update the total reserved address space, and unset the
- * primary chunk if necessary.
+ * finished, so remove it from the chunk maps, update the total reserved
+ * address space, and unset the primary chunk if necessary.
  */
 
 void ArenaChunkRemoved(Arena arena, Chunk chunk)
@@ -775,6 +1017,11 @@ void ArenaChunkRemoved(Arena arena, Chunk chunk)
   AVERT(Arena, arena);
   AVERT(Chunk, chunk);
 
+  /* The chunk is still in the ring, so it must be omitted. */
+  arenaChunkMapRebuild(arena, chunk);
+  arenaChunkRangeRebuild(arena, chunk);
+  ArenaAccessMapRemove(arena, NULL, chunk->base, chunk->limit);
+
   size = ChunkReserved(chunk);
   AVER(arena->reserved >= size);
   arena->reserved -= size;
@@ -784,6 +1031,7 @@ void ArenaChunkRemoved(Arena arena, Chunk chunk)
     AVER(RingIsSingle(ArenaChunkRing(arena)));
     AVER(arena->reserved == 0);
     arena->primary = NULL;
+    ArenaCardsInit(arena, NULL);
   }
 }
 
@@ -1090,8 +1338,15 @@ Res ArenaAlloc(Addr *baseReturn, LocusPref pref, Size size, Pool pool)
   AVER(SizeIsArenaGrains(size, arena));
 
   res = PolicyAlloc(&tract, arena, pref, size, pool);
-  if (res != ResOK)
-    goto allocFail;
+  if (res != ResOK) {
+    /* Segments that are waiting to be reclaimed may be holding the
+     * memory we need. <design/trace#.reclaim.lazy.alloc> */
+    if (!TraceReclaimFinish(arena))
+      goto allocFail;
+    res = PolicyAlloc(&tract, arena, pref, size, pool);
+    if (res != ResOK)
+      goto allocFail;
+  }
 
   base = TractBase(tract);
 
@@ -411,6 +411,9 @@ static Res VMChunkInit(Chunk chunk, BootBlock boot)
                   chunk->pages,
                   saMapped, saPages, VMChunkVM(vmChunk));
 
+  /* <design/vm#.alias> */
+  chunk->alias = VMAlias(VMChunkVM(vmChunk));
+
   return ResOK;
 
   /* .no-clean: No clean-ups needed for boot, as we will discard the chunk. */
@@ -527,6 +530,7 @@ static void vmArenaTrivContracted(Arena arena, Addr base, Size size)
  */
 static Res vmArenaChunkSize(Size *chunkSizeReturn, VMArena vmArena, Size size)
 {
+  Arena arena;
   Size grainSize;               /* Arena grain size. */
   Shift grainShift;             /* The corresponding Shift. */
   Count pages;                  /* Number of usable pages in chunk. */
@@ -539,7 +543,8 @@ static Res vmArenaChunkSize(Size *chunkSizeReturn, VMArena vmArena, Size size)
   AVERT(VMArena, vmArena);
   AVER(size > 0);
 
-  grainSize = ArenaGrainSize(MustBeA(AbstractArena, vmArena));
+  arena = MustBeA(AbstractArena, vmArena);
+  grainSize = ArenaGrainSize(arena);
   grainShift = SizeLog2(grainSize);
 
   overhead = 0;
@@ -554,6 +559,15 @@ static Res vmArenaChunkSize(Size *chunkSizeReturn, VMArena vmArena, Size size)
     pages = chunkSize >> grainShift;
     overhead += SizeAlignUp(BTSize(pages), MPS_PF_ALIGN);
 
+    /* See <code/tract.c#overhead.cards> and
+       <code/tract.c#overhead.card-summary>. */
+    if (ArenaCardMarking(arena)) {
+      overhead += SizeAlignUp(chunkSize >> ArenaCardShift(arena),
+                              MPS_PF_ALIGN);
+      overhead += SizeAlignUp((chunkSize >> ArenaCardShift(arena))
+                              * sizeof(RefSet), MPS_PF_ALIGN);
+    }
+
     /* See .overhead.sa-mapped. */
     overhead += SizeAlignUp(BTSize(pages), MPS_PF_ALIGN);
 
@@ -108,6 +108,12 @@ Bool ArgCheckRank(Arg arg)
   return TRUE;
 }
 
+Bool ArgCheckGreyOrder(Arg arg)
+{
+  CHECKL(arg->val.u < GreyOrderLIMIT);
+  return TRUE;
+}
+
 Bool ArgCheckdouble(Arg arg)
 {
   /* Don't call isfinite() here because it's not in C89, and because
@@ -26,9 +26,17 @@
 #define TABLE_SLOTS 49
 #define ITERATIONS 5000
 #define CHATTER 100
+#define collectFREQ 500
+#define testPAUSE 0.0001  /* short enough for traces to overlap */
+#define genCOUNT 2
+static mps_gen_param_s testChain[genCOUNT] = {
+  { 32, 0.90 }, { 64, 0.45 } };
 
 
 static mps_word_t bogus_class;
+static unsigned long nCollsStart;
+static unsigned long nCollsDone;
+static unsigned long nCollsConcurrent; /* started while another running */
 
 #define UNINIT 0x041412ED
 
@@ -77,6 +85,30 @@ static void initialise_wrapper(mps_word_t *wrapper)
 }
 
 
+/* report -- count collections from any messages */
+
+static void report(mps_arena_t arena)
+{
+  mps_message_type_t type;
+
+  while(mps_message_queue_type(&type, arena)) {
+    mps_message_t message;
+
+    cdie(mps_message_get(&message, arena, type), "message get");
+    if (type == mps_message_type_gc_start()) {
+      if (nCollsStart > nCollsDone)
+        nCollsConcurrent += 1;
+      nCollsStart += 1;
+    } else if (type == mps_message_type_gc()) {
+      nCollsDone += 1;
+    } else {
+      cdie(0, "unknown message type");
+    }
+    mps_message_discard(arena, message);
+  }
+}
+
+
 /* alloc_string  - create a dylan string object
  *
  * create a dylan string object (byte vector) whose contents
@@ -251,10 +283,18 @@ static void test(mps_arena_t arena,
     for(i = 0; i < TABLE_SLOTS; ++i) {
       (void)alloc_string("spong", leafap);
     }
+    if (j % collectFREQ == 0) {
+      report(arena);
+      /* Start an incremental collection of the world, so that the */
+      /* nursery fills up while it is running and gets collected by */
+      /* a concurrent trace.  <design/trace#.multi> */
+      die(mps_arena_start_collect(arena), "start_collect");
+    }
   }
 
   die(mps_arena_collect(arena), "mps_arena_collect");
   mps_arena_release(arena);
+  report(arena);
 
   for(i = 0; i < TABLE_SLOTS; ++i) {
     if (tables.preserve[i] == 0) {
@@ -296,6 +336,7 @@ static void setup(struct guff_s *guff)
   mps_pool_t tablepool;
   mps_fmt_t dylanfmt;
   mps_fmt_t dylanweakfmt;
+  mps_chain_t chain;
   mps_ap_t leafap, exactap, weakap, bogusap;
   mps_root_t stack;
   mps_thr_t thr;
@@ -309,14 +350,21 @@ static void setup(struct guff_s *guff)
       "Format Create\n");
   die(mps_fmt_create_A(&dylanweakfmt, arena, dylan_fmt_A_weak()),
       "Format Create (weak)\n");
+  die(mps_chain_create(&chain, arena, genCOUNT, testChain),
+      "Chain Create\n");
   MPS_ARGS_BEGIN(args) {
     MPS_ARGS_ADD(args, MPS_KEY_FORMAT, dylanfmt);
+    MPS_ARGS_ADD(args, MPS_KEY_CHAIN, chain);
     die(mps_pool_create_k(&leafpool, arena, mps_class_lo(), args),
         "Leaf Pool Create\n");
   } MPS_ARGS_END(args);
-  die(mps_pool_create(&tablepool, arena, mps_class_awl(), dylanweakfmt,
-                      dylan_weak_dependent),
-      "Table Pool Create\n");
+  MPS_ARGS_BEGIN(args) {
+    MPS_ARGS_ADD(args, MPS_KEY_FORMAT, dylanweakfmt);
+    MPS_ARGS_ADD(args, MPS_KEY_CHAIN, chain);
+    MPS_ARGS_ADD(args, MPS_KEY_AWL_FIND_DEPENDENT, dylan_weak_dependent);
+    die(mps_pool_create_k(&tablepool, arena, mps_class_awl(), args),
+        "Table Pool Create\n");
+  } MPS_ARGS_END(args);
   die(mps_ap_create(&leafap, leafpool, mps_rank_exact()),
       "Leaf AP Create\n");
   die(mps_ap_create(&exactap, tablepool, mps_rank_exact()),
@@ -334,6 +382,7 @@ static void setup(struct guff_s *guff)
   mps_ap_destroy(leafap);
   mps_pool_destroy(tablepool);
   mps_pool_destroy(leafpool);
+  mps_chain_destroy(chain);
   mps_fmt_destroy(dylanweakfmt);
   mps_fmt_destroy(dylanfmt);
   mps_root_destroy(stack);
@@ -352,8 +401,14 @@ int main(int argc, char *argv[])
   initialise_wrapper(string_wrapper);
   initialise_wrapper(table_wrapper);
 
-  die(mps_arena_create(&arena, mps_arena_class_vm(), testArenaSIZE),
-      "arena_create\n");
+  MPS_ARGS_BEGIN(args) {
+    MPS_ARGS_ADD(args, MPS_KEY_ARENA_SIZE, testArenaSIZE);
+    MPS_ARGS_ADD(args, MPS_KEY_PAUSE_TIME, testPAUSE);
+    die(mps_arena_create_k(&arena, mps_arena_class_vm(), args),
+        "arena_create\n");
+  } MPS_ARGS_END(args);
+  mps_message_type_enable(arena, mps_message_type_gc_start());
+  mps_message_type_enable(arena, mps_message_type_gc());
   die(mps_thread_reg(&thread, arena), "thread_reg");
   guff.arena = arena;
   guff.thr = thread;
@@ -361,6 +416,12 @@ int main(int argc, char *argv[])
   mps_thread_dereg(thread);
   mps_arena_destroy(arena);
 
+  /* A nursery collection must start while another is running.
+     <design/trace#.multi> */
+  printf("%lu collections started while another was running.\n",
+         nCollsConcurrent);
+  Insist(nCollsConcurrent > 0);
+
   printf("%s: Conclusion: Failed to find any defects.\n", argv[0]);
   return 0;
 }
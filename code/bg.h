@@ -0,0 +1,98 @@
+/* bg.h: COLLECTOR BACKGROUND THREAD
+ *
+ * $Id$
+ * Copyright (c) 2026 Ravenbrook Limited.  See end of file for license.
+ *
+ * .purpose: Provides a thread owned by the MPS, which does the
+ * tracing work that would otherwise be done by the mutator in
+ * ArenaPoll.  See <design/arena#.poll.background>.
+ *
+ * .fallback: On platforms without an implementation, the background
+ * has no thread, BackgroundRunning returns FALSE, and the mutator
+ * does the work in ArenaPoll as usual.
+ */
+
+#ifndef bg_h
+#define bg_h
+
+#include "mpmtypes.h"
+
+
+#define BackgroundSig   ((Sig)0x519BAC6D) /* SIGnature BACkGrounD */
+
+
+/* BackgroundCreate -- create a background thread
+ *
+ * Creates a thread for the arena that calls method(closure) each
+ * time it is woken.  Returns ResRESOURCE if the operating system
+ * could not create the thread.
+ */
+
+extern Res BackgroundCreate(Background *backgroundReturn, Arena arena,
+                            BackgroundMethod method, void *closure);
+
+
+/* BackgroundStop -- stop the thread and wait for it to exit
+ *
+ * This must be called without holding the arena lock, because the
+ * method may be waiting to claim it.  After this, BackgroundRunning
+ * returns FALSE.
+ */
+
+extern void BackgroundStop(Background background);
+
+
+/* BackgroundDestroy -- destroy a stopped background */
+
+extern void BackgroundDestroy(Background background);
+
+
+extern Bool BackgroundCheck(Background background);
+
+
+/* BackgroundRunning -- is there a thread to wake? */
+
+extern Bool BackgroundRunning(Background background);
+
+
+/* BackgroundWake -- ask the thread to call the method
+ *
+ * If the thread is already running the method, it will call it again
+ * when it returns.  Wakes that arrive while the thread is busy are
+ * merged into one.
+ */
+
+extern void BackgroundWake(Background background);
+
+
+#endif /* bg_h */
+
+
+/* C. COPYRIGHT AND LICENSE
+ *
+ * Copyright (C) 2026 Ravenbrook Limited <https://www.ravenbrook.com/>.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+ * IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
@@ -0,0 +1,111 @@
+/* bgan.c: ANSI COLLECTOR BACKGROUND THREAD
+ *
+ * $Id$
+ * Copyright (c) 2026 Ravenbrook Limited.  See end of file for license.
+ *
+ * .purpose: This is a trivial implementation of the background
+ * thread for platforms without one.  It has no thread, so the
+ * mutator does all the tracing work.  See <code/bg.h#.fallback>.
+ */
+
+#include "mpm.h"
+
+SRCID(bgan, "$Id$");
+
+
+typedef struct BackgroundStruct { /* ANSI fake background thread */
+  Sig sig;                      /* design.mps.sig.field */
+  Arena arena;                  /* owning arena */
+} BackgroundStruct;
+
+
+Bool BackgroundCheck(Background background)
+{
+  CHECKS(Background, background);
+  CHECKU(Arena, background->arena);
+  return TRUE;
+}
+
+
+Res BackgroundCreate(Background *backgroundReturn, Arena arena,
+                     BackgroundMethod method, void *closure)
+{
+  Background background;
+  void *p;
+  Res res;
+
+  AVER(backgroundReturn != NULL);
+  AVERT(Arena, arena);
+  AVER(FUNCHECK(method));
+  /* closure is arbitrary and can't be checked */
+
+  res = ControlAlloc(&p, arena, sizeof(BackgroundStruct));
+  if (res != ResOK)
+    return res;
+  background = p;
+
+  background->arena = arena;
+  background->sig = BackgroundSig;
+  AVERT(Background, background);
+
+  *backgroundReturn = background;
+  return ResOK;
+}
+
+
+void BackgroundStop(Background background)
+{
+  AVERT(Background, background);
+}
+
+
+void BackgroundDestroy(Background background)
+{
+  AVERT(Background, background);
+  background->sig = SigInvalid;
+  ControlFree(background->arena, background, sizeof(BackgroundStruct));
+}
+
+
+Bool BackgroundRunning(Background background)
+{
+  AVERT(Background, background);
+  return FALSE;
+}
+
+
+void BackgroundWake(Background background)
+{
+  AVERT(Background, background);
+  NOTREACHED;
+}
+
+
+/* C. COPYRIGHT AND LICENSE
+ *
+ * Copyright (C) 2026 Ravenbrook Limited <https://www.ravenbrook.com/>.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+ * IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
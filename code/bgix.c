@@ -0,0 +1,265 @@
+/* bgix.c: COLLECTOR BACKGROUND THREAD FOR POSIX SYSTEMS
+ *
+ * $Id$
+ * Copyright (c) 2026 Ravenbrook Limited.  See end of file for license.
+ *
+ * .purpose: A POSIX thread that does the tracing work for an arena.
+ * See <design/arena#.poll.background>.
+ *
+ * .design: The thread waits on a condition variable for the woken
+ * flag to be set.  It clears the flag before calling the method, so
+ * that a wake that arrives while the method is running causes
+ * another call.  All fields below the mutex in BackgroundStruct are
+ * only accessed while holding the mutex.
+ *
+ * .lock: The thread never holds the mutex while calling the method,
+ * so BackgroundWake can be called while holding the arena lock
+ * without risk of deadlock.
+ *
+ * .signals: The thread is created with all asynchronous signals
+ * blocked, so that signals directed at the process are delivered to
+ * the client's threads.  The thread is not registered with any arena,
+ * so the thread manager never tries to suspend it.  Compare
+ * <code/wkix.c#.signals>.
+ *
+ * .fork: After fork() only the forking thread exists in the child,
+ * so BackgroundRunning returns FALSE in the child and the mutator does
+ * the tracing work.
+ */
+
+#include "mpm.h"
+
+#if !defined(MPS_OS_FR) && !defined(MPS_OS_LI) && !defined(MPS_OS_XC)
+#error "bgix.c is specific to MPS_OS_FR, MPS_OS_LI or MPS_OS_XC"
+#endif
+
+#include <pthread.h>
+#include <signal.h> /* see .feature.li in config.h */
+#include <sys/types.h> /* pid_t */
+#include <unistd.h> /* getpid */
+
+SRCID(bgix, "$Id$");
+
+
+typedef struct BackgroundStruct {
+  Sig sig;                      /* design.mps.sig.field */
+  Arena arena;                  /* owning arena */
+  BackgroundMethod method;      /* method to call when woken */
+  void *closure;                /* closure argument for method */
+  pthread_t id;                 /* the background thread */
+  pid_t pid;                    /* process that created the thread */
+  Bool stopped;                 /* thread has been joined */
+  pthread_mutex_t mut;          /* protects the fields below */
+  pthread_cond_t wake;          /* signalled when woken is set */
+  Bool woken;                   /* method should be called */
+  Bool stopping;                /* thread should exit */
+} BackgroundStruct;
+
+
+Bool BackgroundCheck(Background background)
+{
+  CHECKS(Background, background);
+  CHECKU(Arena, background->arena);
+  CHECKL(FUNCHECK(background->method));
+  CHECKL(BoolCheck(background->stopped));
+  return TRUE;
+}
+
+
+/* backgroundMain -- thread start routine */
+
+static void *backgroundMain(void *p)
+{
+  Background background = p;
+  int status;
+
+  status = pthread_mutex_lock(&background->mut);
+  AVER(status == 0);
+  for (;;) {
+    while (!background->woken && !background->stopping) {
+      status = pthread_cond_wait(&background->wake, &background->mut);
+      AVER(status == 0);
+    }
+    if (background->stopping)
+      break;
+    background->woken = FALSE;
+    status = pthread_mutex_unlock(&background->mut);
+    AVER(status == 0);
+
+    (*background->method)(background->closure); /* .lock */
+
+    status = pthread_mutex_lock(&background->mut);
+    AVER(status == 0);
+  }
+  status = pthread_mutex_unlock(&background->mut);
+  AVER(status == 0);
+  return NULL;
+}
+
+
+Res BackgroundCreate(Background *backgroundReturn, Arena arena,
+                     BackgroundMethod method, void *closure)
+{
+  Background background;
+  sigset_t blocked, old;
+  void *p;
+  Res res;
+  int status;
+
+  AVER(backgroundReturn != NULL);
+  AVERT(Arena, arena);
+  AVER(FUNCHECK(method));
+  /* closure is arbitrary and can't be checked */
+
+  res = ControlAlloc(&p, arena, sizeof(BackgroundStruct));
+  if (res != ResOK)
+    goto failAlloc;
+  background = p;
+
+  background->arena = arena;
+  background->method = method;
+  background->closure = closure;
+  background->pid = getpid();
+  background->stopped = FALSE;
+  background->woken = FALSE;
+  background->stopping = FALSE;
+  status = pthread_mutex_init(&background->mut, NULL);
+  AVER(status == 0);
+  status = pthread_cond_init(&background->wake, NULL);
+  AVER(status == 0);
+
+  background->sig = BackgroundSig;
+  AVERT(Background, background);
+
+  /* .signals */
+  status = sigfillset(&blocked);
+  AVER(status == 0);
+  status = sigdelset(&blocked, SIGSEGV);
+  AVER(status == 0);
+  status = sigdelset(&blocked, SIGBUS);
+  AVER(status == 0);
+  status = sigdelset(&blocked, SIGILL);
+  AVER(status == 0);
+  status = sigdelset(&blocked, SIGFPE);
+  AVER(status == 0);
+  status = pthread_sigmask(SIG_SETMASK, &blocked, &old);
+  AVER(status == 0);
+  status = pthread_create(&background->id, NULL, backgroundMain, background);
+  if (status != 0)
+    res = ResRESOURCE;
+  status = pthread_sigmask(SIG_SETMASK, &old, NULL);
+  AVER(status == 0);
+  if (res != ResOK)
+    goto failCreate;
+
+  *backgroundReturn = background;
+  return ResOK;
+
+failCreate:
+  background->sig = SigInvalid;
+  (void)pthread_cond_destroy(&background->wake);
+  (void)pthread_mutex_destroy(&background->mut);
+  ControlFree(arena, background, sizeof(BackgroundStruct));
+failAlloc:
+  return res;
+}
+
+
+void BackgroundStop(Background background)
+{
+  int status;
+
+  AVERT(Background, background);
+
+  if (background->stopped)
+    return;
+  background->stopped = TRUE;
+
+  /* .fork: In a child process there is no thread to stop. */
+  if (background->pid != getpid())
+    return;
+
+  status = pthread_mutex_lock(&background->mut);
+  AVER(status == 0);
+  background->stopping = TRUE;
+  status = pthread_cond_signal(&background->wake);
+  AVER(status == 0);
+  status = pthread_mutex_unlock(&background->mut);
+  AVER(status == 0);
+
+  status = pthread_join(background->id, NULL);
+  AVER(status == 0);
+}
+
+
+void BackgroundDestroy(Background background)
+{
+  AVERT(Background, background);
+  AVER(background->stopped);
+
+  /* .fork: In a child process the mutex and condition variable can't
+     be relied upon. */
+  if (background->pid == getpid()) {
+    (void)pthread_cond_destroy(&background->wake);
+    (void)pthread_mutex_destroy(&background->mut);
+  }
+
+  background->sig = SigInvalid;
+  ControlFree(background->arena, background, sizeof(BackgroundStruct));
+}
+
+
+Bool BackgroundRunning(Background background)
+{
+  AVERT(Background, background);
+  return !background->stopped && background->pid == getpid(); /* .fork */
+}
+
+
+void BackgroundWake(Background background)
+{
+  int status;
+
+  AVERT(Background, background);
+  AVER(BackgroundRunning(background));
+
+  status = pthread_mutex_lock(&background->mut);
+  AVER(status == 0);
+  if (!background->woken) {
+    background->woken = TRUE;
+    status = pthread_cond_signal(&background->wake);
+    AVER(status == 0);
+  }
+  status = pthread_mutex_unlock(&background->mut);
+  AVER(status == 0);
+}
+
+
+/* C. COPYRIGHT AND LICENSE
+ *
+ * Copyright (C) 2026 Ravenbrook Limited <https://www.ravenbrook.com/>.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+ * IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
@@ -0,0 +1,229 @@
+/* bgss.c: COLLECTOR THREAD STRESS TEST
+ *
+ * $Id$
+ * Copyright (c) 2026 Ravenbrook Limited.  See end of file for license.
+ *
+ * The arena is created with MPS_KEY_COLLECTOR_THREAD, and a single
+ * mutator thread allocates in an AMC pool.  The thread is registered,
+ * but its registers and stack are not a root, as in a program whose
+ * collections would otherwise happen only when it calls the MPS.  So
+ * the collector thread must not flip while the mutator is running
+ * outside the MPS.  Between allocations, the mutator holds a
+ * reference to an object only in a local variable while it checks the
+ * object repeatedly without calling the MPS, and then checks that the
+ * object has not moved.  See <design/arena#.poll.background.start>.
+ */
+
+#include "fmtdy.h"
+#include "fmtdytst.h"
+#include "testlib.h"
+#include "mpslib.h"
+#include "mpscamc.h"
+#include "mpsavm.h"
+
+#include <stdio.h> /* fflush, printf, putchar */
+
+
+#define testArenaSIZE     ((size_t)1000*1024)
+#define gen1SIZE          ((size_t)20)
+#define gen2SIZE          ((size_t)85)
+#define avLEN             3
+#define exactRootsCOUNT   180
+#define genCOUNT          2
+#define collectionsCOUNT  37
+#define allocCOUNT        100
+#define holdCOUNT         1000
+#define testPAUSE         0.0001 /* short, so the thread works often */
+
+/* testChain -- generation parameters for the test */
+
+static mps_gen_param_s testChain[genCOUNT] = {
+  { gen1SIZE, 0.85 }, { gen2SIZE, 0.45 } };
+
+
+/* objNULL needs to be odd so that it's ignored in exactRoots. */
+#define objNULL           ((mps_addr_t)MPS_WORD_CONST(0xDECEA5ED))
+
+
+static mps_arena_t arena;
+static mps_ap_t ap;
+static mps_addr_t exactRoots[exactRootsCOUNT];
+static unsigned long nCollsStart;
+static unsigned long nCollsDone;
+
+
+/* report -- count collections from any messages */
+
+static void report(void)
+{
+  mps_message_type_t type;
+
+  while (mps_message_queue_type(&type, arena)) {
+    mps_message_t message;
+
+    cdie(mps_message_get(&message, arena, type), "message get");
+    if (type == mps_message_type_gc_start()) {
+      nCollsStart += 1;
+    } else if (type == mps_message_type_gc()) {
+      nCollsDone += 1;
+      putchar('.');
+      (void)fflush(stdout);
+    } else {
+      cdie(0, "unknown message type");
+    }
+    mps_message_discard(arena, message);
+  }
+}
+
+
+/* make -- create one new object */
+
+static mps_addr_t make(void)
+{
+  size_t length = rnd() % avLEN;
+  size_t size = (length+2) * sizeof(mps_word_t);
+  mps_addr_t p;
+  mps_res_t res;
+
+  do {
+    MPS_RESERVE_BLOCK(res, p, ap, size);
+    if (res)
+      die(res, "MPS_RESERVE_BLOCK");
+    res = dylan_init(p, size, exactRoots, exactRootsCOUNT);
+    if (res)
+      die(res, "dylan_init");
+  } while (!mps_commit(ap, p, size));
+
+  return p;
+}
+
+
+/* hold -- keep a reference outside the roots, and check it
+ *
+ * The reference is kept in a volatile local, so that the compiler
+ * can't reload it from the root.  If the collector thread flipped
+ * while it was held, the object may have moved, and the root updated
+ * without it.
+ */
+
+static void hold(size_t i)
+{
+  mps_addr_t volatile held = exactRoots[i];
+  mps_addr_t volatile *root = &exactRoots[i];
+  size_t j;
+
+  if (held == objNULL)
+    return;
+  for (j = 0; j < holdCOUNT; ++j)
+    cdie(dylan_check(held), "held object check");
+  Insist(held == *root);
+}
+
+
+/* test -- the body of the test */
+
+static void test(void)
+{
+  mps_fmt_t format;
+  mps_chain_t chain;
+  mps_root_t exactRoot;
+  mps_pool_t pool;
+  unsigned long held = 0;
+  size_t i;
+
+  die(dylan_fmt(&format, arena), "fmt_create");
+  die(mps_chain_create(&chain, arena, genCOUNT, testChain), "chain_create");
+  die(mps_pool_create(&pool, arena, mps_class_amc(), format, chain),
+      "pool_create(amc)");
+  die(mps_ap_create(&ap, pool, mps_rank_exact()), "ap_create");
+
+  for (i = 0; i < exactRootsCOUNT; ++i)
+    exactRoots[i] = objNULL;
+  die(mps_root_create_table_masked(&exactRoot, arena,
+                                   mps_rank_exact(), (mps_rm_t)0,
+                                   &exactRoots[0], exactRootsCOUNT,
+                                   (mps_word_t)1),
+      "root_create_table(exact)");
+
+  while (nCollsDone < collectionsCOUNT) {
+    for (i = 0; i < allocCOUNT; ++i) {
+      size_t r = (size_t)rnd();
+      if (r & 1) {
+        exactRoots[(r >> 1) % exactRootsCOUNT] = make();
+      } else {
+        size_t j = (r >> 1) % exactRootsCOUNT;
+        if (exactRoots[j] != objNULL)
+          dylan_write(exactRoots[j], exactRoots, exactRootsCOUNT);
+      }
+    }
+    hold(rnd() % exactRootsCOUNT);
+    ++held;
+    report();
+  }
+
+  printf("\n%lu collections, %lu references held.\n", nCollsDone, held);
+
+  mps_arena_park(arena);
+  mps_ap_destroy(ap);
+  mps_root_destroy(exactRoot);
+  mps_pool_destroy(pool);
+  mps_chain_destroy(chain);
+  mps_fmt_destroy(format);
+  mps_arena_release(arena);
+}
+
+
+int main(int argc, char *argv[])
+{
+  mps_thr_t thread;
+
+  testlib_init(argc, argv);
+
+  MPS_ARGS_BEGIN(args) {
+    MPS_ARGS_ADD(args, MPS_KEY_ARENA_SIZE, testArenaSIZE);
+    MPS_ARGS_ADD(args, MPS_KEY_COLLECTOR_THREAD, TRUE);
+    MPS_ARGS_ADD(args, MPS_KEY_PAUSE_TIME, testPAUSE);
+    die(mps_arena_create_k(&arena, mps_arena_class_vm(), args),
+        "arena_create");
+  } MPS_ARGS_END(args);
+  mps_message_type_enable(arena, mps_message_type_gc());
+  mps_message_type_enable(arena, mps_message_type_gc_start());
+  die(mps_thread_reg(&thread, arena), "thread_reg");
+  test();
+  report();
+  mps_thread_dereg(thread);
+  mps_arena_destroy(arena);
+
+  printf("%s: Conclusion: Failed to find any defects.\n", argv[0]);
+  return 0;
+}
+
+
+/* C. COPYRIGHT AND LICENSE
+ *
+ * Copyright (C) 2026 Ravenbrook Limited <https://www.ravenbrook.com/>.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+ * IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
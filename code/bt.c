@@ -59,6 +59,36 @@ SRCID(bt, "$Id$");
 #define BTBitIndex(index) ((index) & (MPS_WORD_WIDTH - 1))
 
 
+/* BTWordCountSet -- count the set bits in a word
+ *
+ * GCC and Clang have a builtin that compiles to a single instruction
+ * where the target has one.  Otherwise, add up the bits in parallel
+ * within the word: in pairs, then nibbles, then bytes, and finally
+ * sum the bytes with a multiplication.  <design/bt#.fun.count-res-range>
+ */
+
+#if defined(MPS_BUILD_GC) || defined(MPS_BUILD_LL)
+
+#define BTWordCountSet(word) \
+  ((Count)__builtin_popcountl((unsigned long)(word)))
+
+#else
+
+static Count BTWordCountSet(Word word)
+{
+  const Word m1 = ~(Word)0 / 3;     /* 0x55...55 */
+  const Word m2 = ~(Word)0 / 5;     /* 0x33...33 */
+  const Word m4 = ~(Word)0 / 17;    /* 0x0F...0F */
+  const Word h1 = ~(Word)0 / 255;   /* 0x01...01 */
+  word -= (word >> 1) & m1;
+  word = (word & m2) + ((word >> 2) & m2);
+  word = (word + (word >> 4)) & m4;
+  return (Count)((word * h1) >> (MPS_WORD_WIDTH - 8));
+}
+
+#endif
+
+
 /* BTIsSmallRange -- test range size
  *
  * Predicate to determine whether a range is sufficiently small
@@ -1017,23 +1047,50 @@ void BTCopyOffsetRange(BT fromBT, BT toBT,
 }
 
 
-/* BTCountResRange -- count number of reset bits in a range */
+/* BTCountResRange -- count number of reset bits in a range
+ *
+ * <design/bt#.fun.count-res-range>
+ */
 
 Count BTCountResRange(BT bt, Index base, Index limit)
 {
   Count c = 0;
-  Index bit;
 
   AVERT(BT, bt);
   AVER(base < limit);
 
-  for (bit = base; bit < limit; ++bit)
-    if (!BTGet(bt, bit))
-      ++c;
+#define SINGLE_COUNT_RES_RANGE(i) \
+  if (!BTGet(bt, (i))) ++c
+#define BITS_COUNT_RES_RANGE(i,base,limit) \
+  c += BTWordCountSet(~bt[(i)] & BTMask((base),(limit)))
+#define WORD_COUNT_RES_RANGE(i) \
+  c += BTWordCountSet(~bt[(i)])
+
+  ACT_ON_RANGE(base, limit, SINGLE_COUNT_RES_RANGE,
+               BITS_COUNT_RES_RANGE, WORD_COUNT_RES_RANGE);
   return c;
 }
 
 
+/* BTFindSetBit -- find the lowest set bit in a range
+ *
+ * <design/bt#.fun.find-set-bit>
+ */
+
+Bool BTFindSetBit(Index *indexReturn, BT bt,
+                  Index searchBase, Index searchLimit)
+{
+  Bool found;
+
+  AVER(indexReturn != NULL);
+  AVERT(BT, bt);
+  AVER(searchBase < searchLimit);
+
+  BTFindSet(&found, indexReturn, bt, searchBase, searchLimit);
+  return found;
+}
+
+
 /* C. COPYRIGHT AND LICENSE
  *
  * Copyright (C) 2001-2020 Ravenbrook Limited <https://www.ravenbrook.com/>.
@@ -70,6 +70,8 @@ extern void BTCopyOffsetRange(BT fromBT, BT toBT,
                               Index toBase, Index toLimit);
 
 extern Count BTCountResRange(BT bt, Index base, Index limit);
+extern Bool BTFindSetBit(Index *indexReturn, BT bt,
+                         Index searchBase, Index searchLimit);
 
 
 #endif /* bt_h */
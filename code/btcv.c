@@ -6,7 +6,8 @@
  * .readership: MPS developers
  *
  * .coverage: Direct coverage of BTFind*ResRange*, BTRangesSame,
- * BTISResRange, BTIsSetRange, BTCopyRange, BTCopyOffsetRange.
+ * BTISResRange, BTIsSetRange, BTCopyRange, BTCopyOffsetRange,
+ * BTCountResRange, BTFindSetBit.
  * Reasonable coverage of BTCopyInvertRange, BTResRange,
  * BTSetRange, BTRes, BTSet, BTCreate, BTDestroy.
  */
@@ -506,6 +507,57 @@ static void btCopyTests(BT bt1, BT bt2, Count btSize,
 }
 
 
+/* btCountTests -- Test BTCountResRange & BTFindSetBit
+ *
+ * Compare them with the answers got by looking at one bit at a time,
+ * in a table with a set bit near each of the base and limit of the
+ * range in question, and in one with every third bit set.
+ */
+
+static void btCountCheck(BT bt, Index base, Index limit)
+{
+  Index i, found;
+  Count count = 0;
+  Bool isSet = FALSE;
+  Index first = limit;
+
+  for (i = base; i < limit; ++i) {
+    if (BTGet(bt, i)) {
+      if (!isSet)
+        first = i;
+      isSet = TRUE;
+    } else {
+      ++count;
+    }
+  }
+  cdie(BTCountResRange(bt, base, limit) == count, "BTCountResRange");
+  cdie(BTFindSetBit(&found, bt, base, limit) == isSet, "BTFindSetBit");
+  cdie(!isSet || found == first, "BTFindSetBit index");
+}
+
+static void btCountTests(BT bt, Count btSize, Index base, Index limit)
+{
+  Index minBase, maxLimit, b, l, i;
+
+  minBase = base > 0 ? base - 1 : 0;
+  maxLimit = limit < btSize ? limit + 1 : btSize;
+
+  for (b = minBase; b <= base+1; b++) {
+    for (l = maxLimit; l >= limit-1; l--) {
+      BTResRange(bt, 0, btSize);
+      BTSet(bt, b);
+      BTSet(bt, l - 1);
+      btCountCheck(bt, base, limit);
+    }
+  }
+
+  BTResRange(bt, 0, btSize);
+  btCountCheck(bt, base, limit);
+  for (i = 0; i < btSize; i += 3)
+    BTSet(bt, i);
+  btCountCheck(bt, base, limit);
+}
+
 
 /* btTests --  Do all the tests
  */
@@ -523,6 +575,9 @@ static void btTests(BT btlo, BT bthi, Count btSize)
       /* Perform Copy*Range tests over those subranges */
       btCopyTests(btlo, bthi, btSize, base, limit);
 
+      /* Perform Count and FindSetBit tests over those subranges */
+      btCountTests(btlo, btSize, base, limit);
+
       /* Perform FindResRange tests with different lengths */
       btFindRangeTests(btlo, bthi, btSize, base, limit, 1);
       btFindRangeTests(btlo, bthi, btSize, base, limit, 2);
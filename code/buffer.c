@@ -668,6 +668,27 @@ Bool BufferCommit(Buffer buffer, Addr p, Size size)
 }
 
 
+/* BufferRetract -- abandon memory previously reserved
+ *
+ * Undoes a reserve that has not been committed, so that the memory
+ * will be reserved again.  Only the owner of the buffer may do this,
+ * and not for the mutator, which may not call into the MPS between
+ * reserve and commit.  */
+
+void BufferRetract(Buffer buffer, Addr p, Size size)
+{
+  AVERT(Buffer, buffer);
+  AVER(!BufferIsMutator(buffer));
+  AVER(size > 0);
+  AVER(SizeIsAligned(size, BufferPool(buffer)->alignment));
+  AVER(!BufferIsReady(buffer));
+  AVER(p == buffer->ap_s.init);
+  AVER(AddrAdd(buffer->ap_s.init, size) == buffer->ap_s.alloc);
+
+  buffer->ap_s.alloc = p;
+}
+
+
 /* BufferTrip -- act on a trapped buffer
  *
  * Called from BufferCommit (and its equivalents) when invoked on a
@@ -0,0 +1,510 @@
+/* card.c: CARD MARKING WRITE BARRIER
+ *
+ * $Id$
+ * Copyright (c) 2026 Ravenbrook Limited.  See end of file for license.
+ *
+ * .intro: In an arena created with MPS_KEY_ARENA_CARD_MARKING, the
+ * MPS never raises the write barrier on a segment.  Instead the client
+ * calls mps_write_barrier or MPS_WB after it stores a reference into
+ * an object, which marks the card containing the stored-to address as
+ * dirty.  A segment's summary then covers only its clean cards, and
+ * the collector folds the dirty cards into the summary when it needs
+ * it.  See <design/write-barrier#.card>.
+ *
+ * .table: Each chunk has a card table in its overhead, with one byte
+ * for each card in the chunk.  Cards are no larger than arena grains,
+ * so every card belongs to at most one segment.
+ *
+ * .summary: Each chunk also has a card summary for each card: a
+ * reference set that includes the zones of the references in the
+ * clean card.  Scans use them to skip objects that can't refer to the
+ * white set.  See <design/write-barrier#.card.summary>.
+ */
+
+#include "mpm.h"
+
+SRCID(card, "$Id$");
+
+
+/* ArenaCardsInit -- set up the client's descriptor for the cards
+ *
+ * .wb: The descriptor lets MPS_WB and mps_write_barrier mark cards
+ * without claiming the arena lock.  It covers only the primary chunk,
+ * because that lasts as long as the arena, so its card table can't go
+ * away under a client thread.  Marks in other chunks take the slow
+ * path through mps_write_barrier, which claims the arena lock, so a
+ * client that marks cards often should create the arena big enough
+ * for its heap.  If primary is NULL, or the arena doesn't have card
+ * marking, the descriptor covers no cards.
+ * <design/write-barrier#.card.mark>
+ *
+ * This is called during arena initialization, so it can't check the
+ * arena.
+ */
+
+void ArenaCardsInit(Arena arena, Chunk primary)
+{
+  mps_wb_s *wb;
+
+  AVER(arena != NULL);
+
+  wb = ArenaWB(arena);
+  wb->_arena = arena;
+  wb->_shift = ArenaCardShift(arena);
+  if (primary != NULL && ChunkCardTable(primary) != NULL) {
+    wb->_base = (Word)primary->base;
+    wb->_count = ChunkCards(primary);
+    wb->_cards = ChunkCardTable(primary);
+  } else {
+    wb->_base = 0;
+    wb->_count = 0;
+    wb->_cards = NULL;
+  }
+}
+
+
+/* ArenaCardMark -- mark the card containing an address as dirty
+ *
+ * This is the slow path of mps_write_barrier, for addresses that the
+ * descriptor doesn't cover, so it must be called with the arena lock
+ * held.  Addresses that aren't in the arena are ignored, as are all
+ * addresses if the arena doesn't have card marking.
+ */
+
+void ArenaCardMark(Arena arena, Addr addr)
+{
+  Chunk chunk;
+
+  AVERT(Arena, arena);
+  /* addr is arbitrary */
+
+  if (ArenaCardMarking(arena) && ChunkOfAddr(&chunk, arena, addr)) {
+    Index i = AddrOffset(chunk->base, addr) >> ArenaCardShift(arena);
+    AVER(i < ChunkCards(chunk));
+    chunk->cardTable[i] = CardDIRTY;
+  }
+}
+
+
+/* ChunkCardsNextDirtySeg -- find the next segment with a dirty card
+ *
+ * Searches chunk's card table from card *cardIO for a dirty card in a
+ * segment.  If it finds one, sets *segReturn to the segment, sets
+ * *cardIO to the first card after it, and returns TRUE.  Otherwise
+ * returns FALSE.  Runs of clean cards are skipped a word at a time,
+ * so this costs a read of the card table, not a visit to each
+ * segment.  Dirty cards that aren't in a segment (the client may mark
+ * memory that has been freed) are cleaned on the way.
+ * <design/write-barrier#.card.flip>
+ */
+
+Bool ChunkCardsNextDirtySeg(Seg *segReturn, Index *cardIO, Chunk chunk)
+{
+  Arena arena;
+  Byte *cards;
+  Count count;
+  Shift shift;
+  Index i;
+
+  AVER(segReturn != NULL);
+  AVER(cardIO != NULL);
+  AVERT(Chunk, chunk);
+
+  arena = ChunkArena(chunk);
+  AVER(ArenaCardMarking(arena));
+  shift = ArenaCardShift(arena);
+  cards = ChunkCardTable(chunk);
+  count = ChunkCards(chunk);
+  i = *cardIO;
+  while (i < count) {
+    Seg seg;
+    if (WordIsAligned((Word)&cards[i], sizeof(Word))) {
+      while (i + sizeof(Word) <= count && *(Word *)&cards[i] == 0)
+        i += sizeof(Word);
+      if (i >= count)
+        break;
+    }
+    if (cards[i] == CardCLEAN) {
+      ++i;
+    } else if (SegOfAddr(&seg, arena,
+                         AddrAdd(chunk->base, (Size)i << shift))) {
+      *segReturn = seg;
+      *cardIO = AddrOffset(chunk->base, SegLimit(seg)) >> shift;
+      return TRUE;
+    } else {
+      cards[i] = CardCLEAN;
+      ++i;
+    }
+  }
+  *cardIO = count;
+  return FALSE;
+}
+
+
+/* segCards -- find the cards of a segment
+ *
+ * Returns the index of the first card of seg in its chunk's card
+ * table and card summaries, sets *chunkReturn to the chunk, and sets
+ * *countReturn to the number of cards.
+ */
+
+static Index segCards(Chunk *chunkReturn, Count *countReturn, Seg seg)
+{
+  Arena arena;
+  Chunk chunk;
+  Shift shift;
+  Bool b;
+
+  AVER(chunkReturn != NULL);
+  AVER(countReturn != NULL);
+  AVERT(Seg, seg);
+
+  arena = PoolArena(SegPool(seg));
+  AVER(ArenaCardMarking(arena));
+  shift = ArenaCardShift(arena);
+  b = ChunkOfAddr(&chunk, arena, SegBase(seg));
+  AVER(b);
+  AVER(ChunkCardTable(chunk) != NULL);
+
+  *chunkReturn = chunk;
+  *countReturn = SegSize(seg) >> shift;
+  return AddrOffset(chunk->base, SegBase(seg)) >> shift;
+}
+
+
+/* SegCardsSummary -- clean a segment's dirty cards and summarize them
+ *
+ * If any of seg's cards are dirty, cleans them, sets *summaryReturn
+ * to the union of the zones of every word in them, and returns TRUE.
+ * Otherwise returns FALSE.  Every word is treated as if it might be a
+ * reference, so the summary may be larger than a scan would find, but
+ * it doesn't need the object format, and it costs a read of the dirty
+ * cards rather than a scan of the whole segment.  The zones of each
+ * dirty card are added to its card summary too.
+ * <design/write-barrier#.card.refine>
+ */
+
+Bool SegCardsSummary(RefSet *summaryReturn, Seg seg)
+{
+  Arena arena;
+  Chunk chunk;
+  Byte *cards;
+  RefSet *summaries;
+  Count count;
+  Index i;
+  Shift shift;
+  RefSet summary = RefSetEMPTY;
+  Bool dirty = FALSE;
+  Size alias = 0;
+
+  AVER(summaryReturn != NULL);
+  AVERT(Seg, seg);
+
+  arena = PoolArena(SegPool(seg));
+  shift = ArenaCardShift(arena);
+  i = segCards(&chunk, &count, seg);
+  cards = &chunk->cardTable[i];
+  summaries = &chunk->cardSummary[i];
+  for (i = 0; i < count; ++i) {
+    if (cards[i] != CardCLEAN) {
+      if (!dirty) {
+        /* The MPS only reads the words, so it can use the collector
+           alias <design/shield#.alias>. */
+        alias = ShieldExposeAlias(arena, seg);
+        dirty = TRUE;
+      }
+      /* .clean.order: Clean the card before reading it, so that a
+         store the read misses leaves the card dirty. */
+      cards[i] = CardCLEAN;
+      MEMORY_BARRIER();
+      if (summary != RefSetUNIV || summaries[i] != RefSetUNIV) {
+        Addr base = AddrAdd(SegBase(seg), (Size)i << shift);
+        Word *p = (Word *)AddrAlias(base, alias);
+        Word *limit = (Word *)AddrAlias(AddrAdd(base, (Size)1 << shift),
+                                        alias);
+        RefSet cardSummary = RefSetEMPTY;
+        for (; p < limit; ++p)
+          cardSummary = RefSetAdd(arena, cardSummary, (Addr)*p);
+        summary = RefSetUnion(summary, cardSummary);
+        summaries[i] = RefSetUnion(summaries[i], cardSummary);
+      }
+    }
+  }
+  if (dirty)
+    ShieldCoverAlias(arena, seg, alias);
+
+  *summaryReturn = summary;
+  return dirty;
+}
+
+
+/* SegCardsClear -- clean a segment's cards
+ *
+ * Returns TRUE if any of them were dirty.  The caller is about to
+ * scan the whole segment, which will find the references in the dirty
+ * cards, so their card summaries are forgotten until the scan
+ * computes them afresh.  See .clean.order and
+ * <design/write-barrier#.card.scan>.
+ */
+
+Bool SegCardsClear(Seg seg)
+{
+  Chunk chunk;
+  Byte *cards;
+  RefSet *summaries;
+  Count count;
+  Index i;
+  Bool dirty = FALSE;
+
+  AVERT(Seg, seg);
+
+  i = segCards(&chunk, &count, seg);
+  cards = &chunk->cardTable[i];
+  summaries = &chunk->cardSummary[i];
+  for (i = 0; i < count; ++i) {
+    if (cards[i] != CardCLEAN) {
+      cards[i] = CardCLEAN;
+      summaries[i] = RefSetUNIV;
+      dirty = TRUE;
+    }
+  }
+  if (dirty)
+    MEMORY_BARRIER();
+
+  return dirty;
+}
+
+
+/* SegCardsForget -- forget the card summaries of part of a segment
+ *
+ * Sets the card summary of every card that overlaps [base, limit) in
+ * seg to RefSetUNIV, for when the MPS can't know what references the
+ * client will put there.  <design/write-barrier#.card.summary.forget>
+ */
+
+void SegCardsForget(Seg seg, Addr base, Addr limit)
+{
+  Chunk chunk;
+  Count count;
+  Index i, first, last;
+  Shift shift;
+
+  AVERT(Seg, seg);
+  AVER(SegBase(seg) <= base);
+  AVER(base <= limit);
+  AVER(limit <= SegLimit(seg));
+
+  if (base == limit)
+    return;
+  shift = ArenaCardShift(PoolArena(SegPool(seg)));
+  i = segCards(&chunk, &count, seg);
+  first = i + (AddrOffset(SegBase(seg), base) >> shift);
+  last = i + ((AddrOffset(SegBase(seg), limit) - 1) >> shift);
+  for (i = first; i <= last; ++i)
+    chunk->cardSummary[i] = RefSetUNIV;
+}
+
+
+/* SegCardsAdd -- add a reference to the summary of its card
+ *
+ * For when the MPS changes a reference at addr in seg other than by
+ * scanning it, as TraceScanSingleRef does.
+ */
+
+void SegCardsAdd(Seg seg, Addr addr, Ref ref)
+{
+  Arena arena;
+  Chunk chunk;
+  Count count;
+  Index i;
+
+  AVERT(Seg, seg);
+  AVER(SegBase(seg) <= addr);
+  AVER(addr < SegLimit(seg));
+
+  arena = PoolArena(SegPool(seg));
+  i = segCards(&chunk, &count, seg)
+    + (AddrOffset(SegBase(seg), addr) >> ArenaCardShift(arena));
+  chunk->cardSummary[i] = RefSetAdd(arena, chunk->cardSummary[i], ref);
+}
+
+
+/* ScanStateCardsInit -- prepare to scan a segment card by card
+ *
+ * .pass: While ss scans seg, TraceScanFormat passes each area to
+ * ScanStateCardsScan, which rebuilds the summaries of the cards that
+ * the area overlaps.  Pools scan areas in address order, so the
+ * summaries below ss->cardNext have been rebuilt by this scan, and
+ * the summaries at and above it are as they were before.  The old
+ * summary of card ss->cardNext - 1, which may be shared by the next
+ * area, is kept in ss->cardLast.  ScanStateCardsFinish finishes the
+ * pass.  <design/write-barrier#.card.summary.scan>
+ */
+
+void ScanStateCardsInit(ScanState ss, Seg seg, Size headerSize)
+{
+  Chunk chunk;
+  Count count;
+  Index i;
+
+  AVERT(ScanState, ss);
+  AVERT(Seg, seg);
+
+  ss->cardSeg = NULL;
+  if (ArenaCardMarking(PoolArena(SegPool(seg)))
+      && SegRankSet(seg) != RankSetEMPTY)
+  {
+    i = segCards(&chunk, &count, seg);
+    ss->cardSeg = seg;
+    ss->cardSummary = &chunk->cardSummary[i];
+    ss->cardCount = count;
+    ss->cardHeaderSize = headerSize;
+    ss->cardFirst = count;
+    ss->cardNext = 0;
+    ss->cardLast = RefSetUNIV;
+  }
+}
+
+
+/* scanStateCardOld -- summary of a card before this scan */
+
+static RefSet scanStateCardOld(ScanState ss, Index i)
+{
+  if (i >= ss->cardNext)
+    return ss->cardSummary[i];
+  else if (i + 1 == ss->cardNext)
+    return ss->cardLast;
+  else
+    return RefSetUNIV; /* pool scanned out of order */
+}
+
+
+/* ScanStateCardsScan -- scan a formatted area, skipping it if it can
+ *
+ * If the card summaries of the cards that [base, limit) overlaps
+ * don't intersect the white set, the area can't refer to it, so skip
+ * the area.  Otherwise scan it, and add the summary of the area after
+ * fixing to those card summaries.  See .pass.
+ */
+
+Res ScanStateCardsScan(ScanState ss, Addr base, Addr limit)
+{
+  Shift shift;
+  Addr segBase;
+  RefSet old, summary, fixed, unfixed;
+  Index i, first, last;
+  Bool skip;
+  Res res = ResOK;
+
+  AVER(ss->cardSeg != NULL);
+
+  shift = ArenaCardShift(ss->arena);
+  segBase = SegBase(ss->cardSeg);
+  first = AddrOffset(segBase, AddrSub(base, ss->cardHeaderSize)) >> shift;
+  last = (AddrOffset(segBase, AddrSub(limit, ss->cardHeaderSize)) - 1)
+         >> shift;
+  AVER(first <= last);
+  AVER(last < ss->cardCount);
+
+  old = RefSetEMPTY;
+  for (i = first; i <= last; ++i)
+    old = RefSetUnion(old, scanStateCardOld(ss, i));
+
+  skip = ZoneSetInter(old, ScanStateWhite(ss)) == ZoneSetEMPTY;
+  if (skip) {
+    ss->fixedSummary = RefSetUnion(ss->fixedSummary, old);
+    STATISTIC(++ss->cardSkipCount);
+    STATISTIC(ss->cardSkipSize += AddrOffset(base, limit));
+    summary = RefSetEMPTY; /* the old summaries remain */
+  } else {
+    /* Find the summary of this area alone. */
+    fixed = ss->fixedSummary;
+    unfixed = ScanStateUnfixedSummary(ss);
+    ss->fixedSummary = RefSetEMPTY;
+    ScanStateSetUnfixedSummary(ss, RefSetEMPTY);
+    ss->scannedSize += AddrOffset(base, limit);
+    res = ss->formatScan(&ss->ss_s, base, limit);
+    summary = ScanStateSummary(ss);
+    ss->fixedSummary = RefSetUnion(fixed, ss->fixedSummary);
+    ScanStateSetUnfixedSummary(ss, RefSetUnion(unfixed,
+                                               ScanStateUnfixedSummary(ss)));
+  }
+
+  for (i = first; i <= last; ++i) {
+    if (i < ss->cardNext) {
+      /* Another area shares this card. */
+      if (skip)
+        ss->cardSummary[i] = RefSetUnion(ss->cardSummary[i],
+                                         scanStateCardOld(ss, i));
+      ss->cardSummary[i] = RefSetUnion(ss->cardSummary[i], summary);
+    } else {
+      if (i == last)
+        ss->cardLast = ss->cardSummary[i];
+      if (!skip)
+        ss->cardSummary[i] = summary;
+    }
+  }
+  if (first < ss->cardFirst)
+    ss->cardFirst = first;
+  if (last >= ss->cardNext)
+    ss->cardNext = last + 1;
+
+  return res;
+}
+
+
+/* ScanStateCardsFinish -- finish a scan card by card
+ *
+ * wasTotal is TRUE if the pool scanned every object in the segment.
+ * If it didn't, a rebuilt card summary may be missing the references
+ * of objects that weren't scanned, so forget the rebuilt summaries.
+ * Objects in the segment's buffer weren't scanned either, and the
+ * client may still be initializing them.  See .pass.
+ */
+
+void ScanStateCardsFinish(ScanState ss, Bool wasTotal)
+{
+  Seg seg = ss->cardSeg;
+  Buffer buffer;
+  Index i;
+
+  AVER(seg != NULL);
+  AVERT(Bool, wasTotal);
+
+  if (!wasTotal)
+    for (i = ss->cardFirst; i < ss->cardNext; ++i)
+      ss->cardSummary[i] = RefSetUNIV;
+  if (SegBuffer(&buffer, seg))
+    SegCardsForget(seg, BufferScanLimit(buffer), BufferLimit(buffer));
+  ss->cardSeg = NULL;
+}
+
+
+/* C. COPYRIGHT AND LICENSE
+ *
+ * Copyright (C) 2026 Ravenbrook Limited <https://www.ravenbrook.com/>.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+ * IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
@@ -339,6 +339,26 @@
 #define LIKELY(exp) ((exp) != 0)
 #endif
 
+/* MEMORY_BARRIER -- order memory accesses
+ *
+ * Use to order the memory accesses before the barrier with respect to
+ * those after it, for data that is read without a lock.  MSVC only
+ * targets IA-32 and x86-64, which don't reorder loads with loads or
+ * stores with stores, so a compiler barrier is enough there.  See
+ * <https://gcc.gnu.org/onlinedocs/gcc/_005f_005fsync-Builtins.html>
+ * and <https://docs.microsoft.com/en-us/cpp/intrinsics/readwritebarrier>.
+ */
+
+#if defined(MPS_BUILD_GC) || defined(MPS_BUILD_LL)
+#define MEMORY_BARRIER() __sync_synchronize()
+#elif defined(MPS_BUILD_MV)
+void _ReadWriteBarrier(void);
+#pragma intrinsic(_ReadWriteBarrier)
+#define MEMORY_BARRIER() _ReadWriteBarrier()
+#else
+#define MEMORY_BARRIER() NOOP
+#endif
+
 
 /* Buffer Configuration -- see <code/buffer.c> */
 
@@ -364,6 +384,13 @@
 /* AMC treats objects larger than or equal to this as "Large" */
 #define AMC_LARGE_SIZE_DEFAULT ((Size)32768)
 #define AMC_EXTEND_BY_DEFAULT  ((Size)8192)
+/* AMC promotes a segment in place, rather than copying its objects,
+ * if it expects at least this fraction of it to survive.
+ * <design/poolamc#.promote.dense> */
+#define AMC_PROMOTE_LIVE 0.9
+/* A collector worker copies objects this size or larger without
+ * holding the fix lock.  <design/poolamc#.fix.parallel> */
+#define AMC_COPY_UNLOCKED_SIZE ((Size)256)
 
 
 /* Pool AMS Configuration -- see <code/poolams.c> */
@@ -372,6 +399,18 @@
 #define AMS_GEN_DEFAULT       0
 
 
+/* Pool AMR Configuration -- see <code/poolamr.c> */
+
+/* AMR allocates segments at least this large.  <design/poolamr#.seg> */
+#define AMR_SEG_SIZE          ((Size)32768)
+/* AMR only refills buffers from whole free lines of this size.
+ * <design/poolamr#.line> */
+#define AMR_LINE_SIZE         ((Size)256)
+/* AMR evacuates the objects from a segment with holes in it if at
+ * least this fraction of it is free.  <design/poolamr#.evacuate> */
+#define AMR_EVACUATE_FREE     0.5
+
+
 /* Pool AWL Configuration -- see <code/poolawl.c> */
 
 #define AWL_GEN_DEFAULT       0
@@ -420,6 +459,12 @@
 
 #define ArenaPollALLOCTIME (65536.0)
 
+/* ArenaPollBACKLOG is how far (in bytes of allocation) the collector
+ * thread may fall behind before the mutator does the tracing work
+ * itself.  See <design/arena#.poll.background.backlog>. */
+
+#define ArenaPollBACKLOG (16 * ArenaPollALLOCTIME)
+
 /* .client.seg-size: ARENA_CLIENT_GRAIN_SIZE is the minimum size, in
  * bytes, of a grain in the client arena. It's set at 8192 with no
  * particular justification. */
@@ -439,6 +484,24 @@
 
 #define ARENA_DEFAULT_ZONED     TRUE
 
+/* ARENA_DEFAULT_COLLECTOR_THREAD is whether the arena has a thread
+ * that does the tracing work, if MPS_KEY_COLLECTOR_THREAD is not
+ * given.  See <design/arena#.poll.background>. */
+
+#define ARENA_DEFAULT_COLLECTOR_THREAD FALSE
+
+/* ARENA_DEFAULT_CARD_MARKING is whether the arena keeps its remembered
+ * set with a software write barrier, if MPS_KEY_ARENA_CARD_MARKING is
+ * not given.  See <design/write-barrier#.card>. */
+
+#define ARENA_DEFAULT_CARD_MARKING FALSE
+
+/* CARD_SHIFT is log2 of the size of a card in an arena with card
+ * marking, unless the arena grain is smaller, in which case cards are
+ * grains.  See <design/write-barrier#.card.size>. */
+
+#define CARD_SHIFT ((Shift)9)
+
 /* ARENA_MINIMUM_COLLECTABLE_SIZE is the minimum size (in bytes) of
  * collectable memory that might be considered worthwhile to run a
  * full garbage collection. */
@@ -488,6 +551,28 @@
 
 #define VM_ARENA_SIZE_DEFAULT ((Size)1 << 28)
 
+/* ChunkMapSIZE is the number of entries in the arena's chunk map,
+ * which divides the address space spanned by the arena's chunks into
+ * this many equal parts.  See <design/arena#.chunk.map>. */
+
+#define ChunkMapSIZE ((Count)512)
+
+/* ChunkRangeSIZE is the maximum number of entries in the arena's
+ * sorted table of chunk address ranges, which ambiguous scanning uses
+ * to reject words that can't point into the arena.  If there are more
+ * chunks than this, the closest ranges are merged.  See
+ * <design/arena#.chunk.range>. */
+
+#define ChunkRangeSIZE ((Count)8)
+
+/* AccessMapSIZE is the maximum number of entries in the process-wide
+ * table of address ranges that ArenaAccess uses to find the arena or
+ * root that owns a fault.  If there are more chunks and protectable
+ * roots than this, faults are dispatched by searching the arenas.
+ * See <design/arena#.access.map>. */
+
+#define AccessMapSIZE ((Count)1024)
+
 
 /* Locus configuration -- see <code/locus.c> */
 
@@ -532,6 +617,7 @@
  * prmcix.h    stack_t, siginfo_t        <signal.h>    _XOPEN_SOURCE
  * prmclii3.c  REG_EAX etc.              <ucontext.h>  _GNU_SOURCE
  * prmclii6.c  REG_RAX etc.              <ucontext.h>  _GNU_SOURCE
+ * protli.c    syscall                   <unistd.h>    _GNU_SOURCE
  * pthrdext.c  sigaction etc.            <signal.h>    _XOPEN_SOURCE
  * vmix.c      MAP_ANON                  <sys/mman.h>  _GNU_SOURCE
  *
@@ -637,14 +723,65 @@
 #define PTHREADEXT_SIGRESUME SIGXCPU
 #endif
 
+/* ThreadSafepointTIMEOUT -- how long, in microseconds, to wait for a
+ * cooperative thread to stop at its safepoint before suspending it
+ * with a signal <design/thread-manager#.coop.timeout>
+ */
+#define ThreadSafepointTIMEOUT 100L
+
 #endif
 
 
-/* Tracer Configuration -- see <code/trace.c> */
+/* Tracer Configuration -- see <code/trace.c>
+ *
+ * TraceLIMIT is the number of traces that can run at once.  A second
+ * trace can collect younger generations while a longer trace of the
+ * older generations is in progress.  See <design/trace#.multi>.
+ */
 
-#define TraceLIMIT ((size_t)1)
+#define TraceLIMIT ((size_t)2)
 /* I count 4 function calls to scan, 10 to copy. */
 #define TraceCopyScanRATIO (1.5)
+/* Fraction of the condemned size that the policy assumes a trace will
+ * have to scan, when it sets the trace's rate of work.  See
+ * <code/policy.c>. */
+#define TraceWorkFACTOR (0.25)
+
+/* TRACE_WORKERS_DEFAULT is the default number of threads that scan
+ * segments during a trace, including the thread doing the collection.
+ * TRACE_WORKERS_MAX is the most that the MPS will create.  See
+ * <design/trace#.parallel> and MPS_KEY_TRACE_WORKERS in the manual. */
+
+#define TRACE_WORKERS_DEFAULT ((Count)1)
+#define TRACE_WORKERS_MAX ((Count)64)
+
+/* TRACE_GREY_ORDER_DEFAULT is the order in which grey segments are
+ * scanned if MPS_KEY_TRACE_GREY_ORDER is not given.  Scanning the most
+ * recently greyed segment first preserves some locality of copying.
+ * See <design/trace#.grey.order>. */
+
+#define TRACE_GREY_ORDER_DEFAULT GreyOrderLIFO
+
+/* TraceBatchPerWORKER is the number of segments that each worker is
+ * given to scan, on average, in each parallel batch.  Larger batches
+ * amortize the cost of waking the workers, but make the collector's
+ * pauses longer.  See <design/trace#.parallel.batch>. */
+
+#define TraceBatchPerWORKER ((Count)4)
+
+/* ScanStateSegCacheSIZE is the number of segments remembered by each
+ * scan state, so that _mps_fix2 can skip the chunk and page table
+ * lookup for references to recently fixed segments.  See
+ * <design/trace#.fix.cache>. */
+
+#define ScanStateSegCacheSIZE ((Index)4)
+
+/* TraceSnapCacheSIZE is the number of forwarded objects remembered by
+ * each trace, so that references to them can be snapped out without
+ * exposing the old copy.  It must be a power of two.  See
+ * <design/trace#.fix.snap>. */
+
+#define TraceSnapCacheSIZE ((Index)64)
 
 
 /* Events
@@ -723,6 +860,30 @@
 #define WB_DEFER_HIT   1  /* boring scans after barrier hit */
 
 
+/* Hot segments
+ *
+ * A segment whose barrier the mutator hits SEG_ACCESS_HOT times
+ * between flips is scanned eagerly and keeps its write barrier
+ * lowered until the next flip.  <design/write-barrier#.hot>.
+ * ArenaHotGreyLENGTH is the number of hot segments that can wait for
+ * an eager scan.
+ */
+
+#define SEG_ACCESS_BITS     2  /* bitfield width for hit count */
+#define SEG_ACCESS_HOT      2  /* hits between flips to be hot */
+#define ArenaHotGreyLENGTH  8  /* hot segments awaiting a scan */
+
+
+/* Page scanning
+ *
+ * A read barrier hit on a segment of at least SEG_PAGE_SCAN_GRAINS
+ * arena grains scans only the objects on the page that the mutator
+ * read, if the segment class can.  <design/write-barrier#.page>.
+ */
+
+#define SEG_PAGE_SCAN_GRAINS 8  /* smallest segment to scan by page */
+
+
 /* Apple Hardened Runtime
  *
  * The MAYBE_HARDENED_RUNTIME macro is true if Apple's "Hardened
@@ -0,0 +1,278 @@
+/* coopth.c: COOPERATIVE THREAD STRESS TEST AND BENCHMARK
+ *
+ * $Id$
+ * Copyright (c) 2026 Ravenbrook Limited.  See end of file for license.
+ *
+ * Several threads allocate in an AMC pool, first registered with
+ * mps_thread_reg (so that they are suspended by the thread manager)
+ * and then with mps_thread_reg_cooperative (so that they stop at
+ * their safepoints). Each thread keeps an object referenced only
+ * from its stack or registers across safepoints and native calls,
+ * and checks it afterwards. The elapsed time for each registration
+ * mode is reported. See <design/thread-manager#.coop>.
+ */
+
+#include "fmtdy.h"
+#include "fmtdytst.h"
+#include "testlib.h"
+#include "testthr.h"
+#include "mpslib.h"
+#include "mpscamc.h"
+#include "mpsavm.h"
+
+#include <stdio.h> /* fflush, printf, putchar */
+#include <time.h> /* clock_gettime, CLOCK_MONOTONIC */
+
+
+#define testArenaSIZE     ((size_t)16<<20)
+#define gen1SIZE          ((size_t)150)
+#define gen2SIZE          ((size_t)170)
+#define avLEN             3
+#define rootsCOUNT        180
+#define genCOUNT          2
+#define kidsCOUNT         8
+#define churnCOUNT        200000
+#define nativeFREQ        1000
+#define nativeSPIN        10000
+
+/* testChain -- generation parameters for the test */
+
+static mps_gen_param_s testChain[genCOUNT] = {
+  { gen1SIZE, 0.85 }, { gen2SIZE, 0.45 } };
+
+
+/* objNULL needs to be odd so that it's ignored in the roots. */
+#define objNULL           ((mps_addr_t)MPS_WORD_CONST(0xDECEA5ED))
+
+
+static mps_arena_t arena;
+
+
+/* now -- elapsed time in seconds */
+
+static double now(void)
+{
+#ifdef MPS_OS_W3
+  LARGE_INTEGER count, frequency;
+  QueryPerformanceCounter(&count);
+  QueryPerformanceFrequency(&frequency);
+  return (double)count.QuadPart / (double)frequency.QuadPart;
+#else
+  struct timespec ts;
+  int status = clock_gettime(CLOCK_MONOTONIC, &ts);
+  Insist(status == 0);
+  return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+#endif
+}
+
+
+/* make -- create one new object */
+
+static mps_addr_t make(mps_ap_t ap, mps_addr_t *roots)
+{
+  size_t length = rnd() % (2*avLEN);
+  size_t size = (length+2) * sizeof(mps_word_t);
+  mps_addr_t p;
+  mps_res_t res;
+
+  do {
+    MPS_RESERVE_BLOCK(res, p, ap, size);
+    if (res)
+      die(res, "MPS_RESERVE_BLOCK");
+    res = dylan_init(p, size, roots, rootsCOUNT);
+    if (res)
+      die(res, "dylan_init");
+  } while(!mps_commit(ap, p, size));
+
+  return p;
+}
+
+
+/* kid_s -- state of one allocating thread */
+
+typedef struct kid_s {
+  testthr_t thread;
+  mps_pool_t pool;
+  mps_bool_t cooperative;
+  mps_addr_t roots[rootsCOUNT];
+  unsigned long spins;
+} kid_s, *kid_t;
+
+
+/* spin -- do some work that doesn't use the heap */
+
+static void *spin(void *p)
+{
+  kid_t kid = p;
+  volatile unsigned long spins = 0;
+  size_t i;
+  for (i = 0; i < nativeSPIN; ++i)
+    ++spins;
+  kid->spins += spins;
+  return p;
+}
+
+
+static void *kid_thread(void *arg)
+{
+  void *marker = &marker;
+  kid_t kid = arg;
+  mps_thr_t thread;
+  mps_safepoint_t safepoint;
+  mps_root_t reg_root, table_root;
+  mps_ap_t ap;
+  mps_addr_t obj;
+  size_t i;
+
+  if (kid->cooperative)
+    die(mps_thread_reg_cooperative(&thread, arena), "thread_reg_cooperative");
+  else
+    die(mps_thread_reg(&thread, arena), "thread_reg");
+  safepoint = mps_thread_safepoint(thread);
+  die(mps_root_create_thread(&reg_root, arena, thread, marker),
+      "root_create");
+  for (i = 0; i < rootsCOUNT; ++i)
+    kid->roots[i] = objNULL;
+  die(mps_root_create_table(&table_root, arena, mps_rank_exact(),
+                            (mps_rm_t)0, kid->roots, rootsCOUNT),
+      "root_create_table");
+  die(mps_ap_create(&ap, kid->pool, mps_rank_exact()), "ap_create");
+
+  /* obj is only referenced from this thread's stack or registers. */
+  obj = make(ap, kid->roots);
+  for (i = 0; i < churnCOUNT; ++i) {
+    size_t r = (size_t)rnd();
+    size_t j = r % rootsCOUNT;
+    kid->roots[j] = make(ap, kid->roots);
+    if (kid->roots[rootsCOUNT - 1 - j] != objNULL)
+      dylan_write(kid->roots[rootsCOUNT - 1 - j], kid->roots, rootsCOUNT);
+    mps_safepoint(safepoint);
+    if (i % nativeFREQ == 0) {
+      cdie(dylan_check(obj), "stack object check");
+      cdie(mps_thread_native(thread, spin, kid) == kid, "thread_native");
+      cdie(dylan_check(obj), "stack object check after native");
+      obj = make(ap, kid->roots);
+    }
+  }
+
+  mps_ap_destroy(ap);
+  mps_root_destroy(table_root);
+  mps_root_destroy(reg_root);
+  mps_thread_dereg(thread);
+
+  return NULL;
+}
+
+
+/* join -- wait for the kids to finish, which doesn't use the heap */
+
+static void *join(void *p)
+{
+  kid_s *kids = p;
+  size_t i;
+  for (i = 0; i < kidsCOUNT; ++i)
+    testthr_join(&kids[i].thread, NULL);
+  return p;
+}
+
+
+/* test -- run the workload with one registration mode */
+
+static double test(mps_bool_t cooperative)
+{
+  static kid_s kids[kidsCOUNT];
+  mps_fmt_t format;
+  mps_chain_t chain;
+  mps_pool_t pool;
+  mps_thr_t thread;
+  mps_root_t reg_root;
+  void *marker = &marker;
+  double begin, end;
+  size_t i;
+
+  MPS_ARGS_BEGIN(args) {
+    MPS_ARGS_ADD(args, MPS_KEY_ARENA_SIZE, testArenaSIZE);
+    die(mps_arena_create_k(&arena, mps_arena_class_vm(), args), "arena_create");
+  } MPS_ARGS_END(args);
+  die(dylan_fmt(&format, arena), "fmt_create");
+  die(mps_chain_create(&chain, arena, genCOUNT, testChain), "chain_create");
+  die(mps_pool_create(&pool, arena, mps_class_amc(), format, chain),
+      "pool_create(amc)");
+
+  if (cooperative)
+    die(mps_thread_reg_cooperative(&thread, arena), "thread_reg_cooperative");
+  else
+    die(mps_thread_reg(&thread, arena), "thread_reg");
+  die(mps_root_create_thread(&reg_root, arena, thread, marker),
+      "root_create");
+
+  begin = now();
+  for (i = 0; i < kidsCOUNT; ++i) {
+    kids[i].pool = pool;
+    kids[i].cooperative = cooperative;
+    kids[i].spins = 0;
+    testthr_create(&kids[i].thread, kid_thread, &kids[i]);
+  }
+  cdie(mps_thread_native(thread, join, kids) == kids, "thread_native");
+  end = now();
+
+  for (i = 0; i < kidsCOUNT; ++i)
+    Insist(kids[i].spins == (churnCOUNT + nativeFREQ - 1) / nativeFREQ
+           * nativeSPIN);
+
+  printf("%s: %lu collections, %.3f s\n",
+         cooperative ? "cooperative" : "suspended",
+         (unsigned long)mps_collections(arena), end - begin);
+
+  mps_arena_park(arena);
+  mps_root_destroy(reg_root);
+  mps_thread_dereg(thread);
+  mps_pool_destroy(pool);
+  mps_chain_destroy(chain);
+  mps_fmt_destroy(format);
+  mps_arena_destroy(arena);
+
+  return end - begin;
+}
+
+
+int main(int argc, char *argv[])
+{
+  testlib_init(argc, argv);
+
+  (void)test(FALSE);
+  (void)test(TRUE);
+
+  printf("%s: Conclusion: Failed to find any defects.\n", argv[0]);
+  return 0;
+}
+
+
+/* C. COPYRIGHT AND LICENSE
+ *
+ * Copyright (C) 2026 Ravenbrook Limited <https://www.ravenbrook.com/>.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+ * IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
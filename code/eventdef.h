@@ -36,8 +36,8 @@
  */
 
 #define EVENT_VERSION_MAJOR  ((unsigned)2)
-#define EVENT_VERSION_MEDIAN ((unsigned)0)
-#define EVENT_VERSION_MINOR  ((unsigned)0)
+#define EVENT_VERSION_MEDIAN ((unsigned)2)
+#define EVENT_VERSION_MINOR  ((unsigned)2)
 
 
 /* EVENT_LIST -- list of event types and general properties
@@ -61,7 +61,7 @@
  */
 
 #define EventNameMAX ((size_t)19)
-#define EventCodeMAX ((EventCode)0x005c)
+#define EventCodeMAX ((EventCode)0x0063)
 
 #define EVENT_LIST(EVENT, X) \
   /*       0123456789012345678 <- don't exceed without changing EventNameMAX */ \
@@ -156,7 +156,14 @@
   EVENT(X, VMFinish           , 0x0059,  TRUE, Arena) \
   EVENT(X, VMInit             , 0x005a,  TRUE, Arena) \
   EVENT(X, VMMap              , 0x005b,  TRUE, Seg) \
-  EVENT(X, VMUnmap            , 0x005c,  TRUE, Seg)
+  EVENT(X, VMUnmap            , 0x005c,  TRUE, Seg) \
+  EVENT(X, TraceStatWorker    , 0x005d,  TRUE, Trace) \
+  EVENT(X, RootStatAmbig      , 0x005e,  TRUE, Seg) /* see .kind.abuse */ \
+  EVENT(X, TraceStatGrey      , 0x005f,  TRUE, Trace) \
+  EVENT(X, ArenaSuspend       , 0x0060,  TRUE, Arena) \
+  EVENT(X, ShieldStat         , 0x0061,  TRUE, Arena) \
+  EVENT(X, TraceStatCard      , 0x0062,  TRUE, Trace) \
+  EVENT(X, BarrierStat        , 0x0063,  TRUE, Arena)
 
 
 /* Remember to update EventNameMAX and EventCodeMAX above!
@@ -258,10 +265,22 @@
   PARAM(X,  0, P, arena, "the arena") \
   PARAM(X,  1, D, spare, "spare committed fraction")
 
+#define EVENT_ArenaSuspend_PARAMS(PARAM, X) \
+  PARAM(X,  0, P, arena, "the arena") \
+  PARAM(X,  1, W, threadCount, "number of threads registered") \
+  PARAM(X,  2, W, clock, "mps_clock() ticks spent suspending them")
+
 #define EVENT_ArenaUseFreeZone_PARAMS(PARAM, X) \
   PARAM(X,  0, P, arena, "the arena") \
   PARAM(X,  1, W, zoneSet, "zones that aren't free any longer")
 
+#define EVENT_BarrierStat_PARAMS(PARAM, X) \
+  PARAM(X,  0, P, arena, "the arena") \
+  PARAM(X,  1, W, hotSegCount, "segments found to be hot") \
+  PARAM(X,  2, W, hotScanCount, "eager scans of hot segments") \
+  PARAM(X,  3, W, hotRaiseCount, "write barriers left lowered") \
+  PARAM(X,  4, W, pageScanCount, "read barrier hits scanned by page")
+
 #define EVENT_BufferCommit_PARAMS(PARAM, X) \
   PARAM(X,  0, P, buffer, "the buffer") \
   PARAM(X,  1, A, p, "committed object") \
@@ -452,6 +471,12 @@
   PARAM(X,  1, W, ts, "scanning for this set of traces") \
   PARAM(X,  2, W, summary, "summary after scan")
 
+#define EVENT_RootStatAmbig_PARAMS(PARAM, X) \
+  PARAM(X,  0, P, root, "the ambiguous root") \
+  PARAM(X,  1, W, wordCount, "words scanned") \
+  PARAM(X,  2, W, rangeCount, "words in a chunk range") \
+  PARAM(X,  3, W, zoneCount, "words in a chunk range and a white zone")
+
 #define EVENT_SegAlloc_PARAMS(PARAM, X) \
   PARAM(X,  0, P, arena, "the arena") \
   PARAM(X,  1, P, seg, "new segment") \
@@ -504,6 +529,11 @@
   PARAM(X,  2, P, segHi, "new high segment") \
   PARAM(X,  3, A, at, "split address")
 
+#define EVENT_ShieldStat_PARAMS(PARAM, X) \
+  PARAM(X,  0, P, arena, "the arena") \
+  PARAM(X,  1, W, protCount, "protection changes made by the shield") \
+  PARAM(X,  2, W, aliasCount, "exposes through the collector alias")
+
 #define EVENT_TraceAccess_PARAMS(PARAM, X) \
   PARAM(X,  0, P, arena, "the arena") \
   PARAM(X,  1, P, seg, "segment accessed") \
@@ -604,24 +634,40 @@
   PARAM(X,  7, W, white, "white reference set") \
   PARAM(X,  8, W, quantumWork, "tracing work to be done in each poll")
 
+#define EVENT_TraceStatCard_PARAMS(PARAM, X) \
+  PARAM(X,  0, P, trace, "the trace") \
+  PARAM(X,  1, P, arena, "trace's arena") \
+  PARAM(X,  2, W, skipCount, "areas skipped by card summaries") \
+  PARAM(X,  3, W, skipSize, "bytes skipped by card summaries")
+
 #define EVENT_TraceStatFix_PARAMS(PARAM, X) \
   PARAM(X,  0, P, trace, "the trace") \
   PARAM(X,  1, P, arena, "trace's arena") \
   PARAM(X,  2, W, fixRefCount, "references which pass zone check") \
   PARAM(X,  3, W, segRefCount, "references which refer to segments") \
   PARAM(X,  4, W, whiteSegRefCount, "references which refer to white segments") \
-  PARAM(X,  5, W, nailCount, "segments nailed by ambiguous references") \
-  PARAM(X,  6, W, snapCount, "references snapped to forwarded objects") \
-  PARAM(X,  7, W, forwardedCount, "objects preserved by moving") \
-  PARAM(X,  8, W, forwardedSize, "bytes preserved by moving") \
-  PARAM(X,  9, W, preservedInPlaceCount, "objects preserved in place") \
-  PARAM(X, 10, W, preservedInPlaceSize, "bytes preserved in place")
+  PARAM(X,  5, W, segCacheHitCount, "segment references found in scan state cache") \
+  PARAM(X,  6, W, nailCount, "segments nailed by ambiguous references") \
+  PARAM(X,  7, W, snapCount, "references snapped to forwarded objects") \
+  PARAM(X,  8, W, snapCacheHitCount, "snapped references found in trace's snap-out cache") \
+  PARAM(X,  9, W, forwardedCount, "objects preserved by moving") \
+  PARAM(X, 10, W, forwardedSize, "bytes preserved by moving") \
+  PARAM(X, 11, W, preservedInPlaceCount, "objects preserved in place") \
+  PARAM(X, 12, W, preservedInPlaceSize, "bytes preserved in place")
+
+#define EVENT_TraceStatGrey_PARAMS(PARAM, X) \
+  PARAM(X,  0, P, trace, "the trace") \
+  PARAM(X,  1, P, arena, "trace's arena") \
+  PARAM(X,  2, W, findCount, "number of searches for a grey segment") \
+  PARAM(X,  3, W, findClock, "mps_clock() ticks spent searching")
 
 #define EVENT_TraceStatReclaim_PARAMS(PARAM, X) \
   PARAM(X,  0, P, trace, "the trace") \
   PARAM(X,  1, P, arena, "trace's arena") \
   PARAM(X,  2, W, reclaimCount, "segments reclaimed") \
-  PARAM(X,  3, W, reclaimSize, "bytes reclaimed")
+  PARAM(X,  3, W, reclaimSize, "bytes reclaimed") \
+  PARAM(X,  4, W, promoteCount, "segments promoted in place") \
+  PARAM(X,  5, W, promoteSize, "bytes promoted in place")
 
 #define EVENT_TraceStatScan_PARAMS(PARAM, X) \
   PARAM(X,  0, P, trace, "the trace") \
@@ -639,6 +685,14 @@
   PARAM(X, 12, W, greySegMax, "maximum number of grey segments") \
   PARAM(X, 13, W, pointlessScanCount, "pointless segment scans")
 
+#define EVENT_TraceStatWorker_PARAMS(PARAM, X) \
+  PARAM(X,  0, P, trace, "the trace") \
+  PARAM(X,  1, P, arena, "trace's arena") \
+  PARAM(X,  2, W, worker, "index of collector worker") \
+  PARAM(X,  3, W, segScanCount, "segments scanned by this worker") \
+  PARAM(X,  4, W, segScanSize, "bytes scanned by this worker") \
+  PARAM(X,  5, W, scanClock, "mps_clock() ticks spent scanning")
+
 #define EVENT_VMArenaExtendDone_PARAMS(PARAM, X) \
   PARAM(X,  0, W, chunkSize, "request succeeded for chunkSize bytes") \
   PARAM(X,  1, W, reserved, "new VMArenaReserved")
@@ -150,6 +150,15 @@ mps_res_t make_dylan_vector(mps_word_t *v, mps_ap_t ap, size_t slots)
 
 
 void dylan_write(mps_addr_t addr, mps_addr_t *refs, size_t nr_refs)
+{
+  dylan_write_wb(NULL, addr, refs, nr_refs);
+}
+
+
+/* dylan_write_wb -- as dylan_write, marking cards if wb is not NULL */
+
+void dylan_write_wb(mps_wb_t wb, mps_addr_t addr,
+                    mps_addr_t *refs, size_t nr_refs)
 {
   mps_word_t *p = (mps_word_t *)addr;
   mps_word_t t = p[1] >> 2;
@@ -161,8 +170,10 @@ void dylan_write(mps_addr_t addr, mps_addr_t *refs, size_t nr_refs)
 
     if(r & 1)
       p[i] = ((r & ~(mps_word_t)3) | 1); /* random int */
-    else
+    else if(wb == NULL)
       p[i] = (mps_word_t)refs[(r >> 1) % nr_refs]; /* random ptr */
+    else
+      MPS_WB_STORE(wb, (mps_addr_t *)&p[i], refs[(r >> 1) % nr_refs]);
   }
 }
 
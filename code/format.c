@@ -203,6 +203,18 @@ Arena FormatArena(Format format)
 }
 
 
+/* FormatIsMoving -- can a pool move objects in this format?
+ *
+ * True if the client supplied the methods that forward objects.  */
+
+Bool FormatIsMoving(Format format)
+{
+  AVERT(Format, format);
+  return format->move != FMT_FWD_DEFAULT
+    && format->isMoved != FMT_ISFWD_DEFAULT;
+}
+
+
 /* FormatDescribe -- describe a format */
 
 Res FormatDescribe(Format format, mps_lib_FILE *stream, Count depth)
@@ -19,9 +19,11 @@
 #include <getopt.h>
 #endif
 
+#include <math.h> /* log, pow */
 #include <stdio.h> /* fprintf, printf, putchars, sscanf, stderr, stdout */
-#include <stdlib.h> /* alloca, exit, EXIT_FAILURE, EXIT_SUCCESS, strtoul */
-#include <time.h> /* clock, CLOCKS_PER_SEC */
+#include <stdlib.h> /* alloca, exit, EXIT_FAILURE, EXIT_SUCCESS, free, realloc, strtoul */
+#include <string.h> /* memset */
+#include <time.h> /* clock, clock_gettime, CLOCKS_PER_SEC */
 
 #define RESMUST(expr) \
   do { \
@@ -53,29 +55,223 @@ static unsigned ngen = 0;         /* number of generations specified */
 static mps_gen_param_s gen[genLIMIT]; /* generation parameters */
 static size_t arena_size = 256ul * 1024 * 1024; /* arena size */
 static size_t arena_grain_size = 1; /* arena grain size */
+static size_t arena_extend = 0;   /* arena growth increment, 0 for default */
 static unsigned pinleaf = FALSE;  /* are leaf objects pinned at start */
 static mps_bool_t zoned = TRUE;   /* arena allocates using zones */
 static double pause_time = ARENA_DEFAULT_PAUSE_TIME; /* maximum pause time */
 static double spare = ARENA_SPARE_DEFAULT; /* spare commit fraction */
+static size_t workers = TRACE_WORKERS_DEFAULT; /* collector workers */
+static unsigned grey_order = MPS_GREY_ORDER_LIFO; /* grey scanning order */
+static mps_bool_t concurrent = FALSE; /* collect world each pass */
+static unsigned long ncollstart;  /* collections started */
+static unsigned long ncolldone;   /* collections finished */
+static unsigned long ncollconcurrent; /* started while another running */
+static mps_bool_t collector_thread = FALSE; /* arena has collector thread */
+static mps_bool_t latency = FALSE; /* measure allocation latency */
+static mps_bool_t uffd = FALSE;   /* write barrier using userfaultfd */
+static double window = 0.1;       /* utilisation window in seconds */
+static double pause_threshold = 0.0001; /* shortest gap that is a pause */
+
+/* Allocation latency is recorded in a histogram with LATENCY_STEPS
+ * buckets per doubling, starting at one nanosecond. */
+#define LATENCY_STEPS 4
+#define LATENCY_BUCKETS (LATENCY_STEPS * 40)
+
+typedef struct latency_s {
+  unsigned long hist[LATENCY_BUCKETS]; /* allocations by latency */
+  double max;                     /* longest allocation, in seconds */
+  double *paused;                 /* seconds paused in each window */
+  size_t nwindows;                /* windows in which thread ran */
+} latency_s;
+
+static double origin;             /* time when benchmark started */
+static latency_s total;           /* merged from all threads */
+static size_t *active;            /* threads running in each window */
 
 typedef struct gcthread_s *gcthread_t;
 
 typedef void *(*gcthread_fn_t)(gcthread_t thread);
 
 struct gcthread_s {
+    unsigned index;
     testthr_t thread;
     mps_thr_t mps_thread;
     mps_root_t reg_root;
     mps_ap_t ap;
     gcthread_fn_t fn;
+    double last;                  /* when last allocation returned */
+    latency_s latency;
 };
 
 typedef mps_word_t obj_t;
 
-static obj_t mkvector(mps_ap_t ap, size_t n)
+
+/* now -- elapsed time in seconds
+ *
+ * This is wall-clock time, not processor time, so that it includes
+ * the time the thread spends waiting for the collector.
+ */
+
+static double now(void)
+{
+#ifdef MPS_OS_W3
+  LARGE_INTEGER count, frequency;
+  QueryPerformanceCounter(&count);
+  QueryPerformanceFrequency(&frequency);
+  return (double)count.QuadPart / (double)frequency.QuadPart - origin;
+#else
+  struct timespec ts;
+  int status = clock_gettime(CLOCK_MONOTONIC, &ts);
+  Insist(status == 0);
+  return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9 - origin;
+#endif
+}
+
+
+/* record -- record the latency of an allocation
+ *
+ * begin and end are the times the allocation started and returned.
+ * If the thread made no progress for pause_threshold seconds before
+ * the allocation returned (either because the allocation itself was
+ * slow, or because the thread was suspended by the collector), then
+ * that time counts as a pause when computing mutator utilisation.
+ */
+
+static void record(gcthread_t thread, double begin, double end)
+{
+  latency_s *l = &thread->latency;
+  double gap = end - thread->last;
+  double ns = (end - begin) * 1e9;
+  size_t b = ns < 1.0 ? 0 : (size_t)(log(ns) / log(2.0) * LATENCY_STEPS);
+  size_t w;
+
+  if (b >= LATENCY_BUCKETS)
+    b = LATENCY_BUCKETS - 1;
+  ++l->hist[b];
+  if (end - begin > l->max)
+    l->max = end - begin;
+
+  w = (size_t)(end / window);
+  if (w >= l->nwindows) {
+    size_t i;
+    l->paused = realloc(l->paused, (w + 1) * sizeof l->paused[0]);
+    Insist(l->paused != NULL);
+    for (i = l->nwindows; i <= w; ++i)
+      l->paused[i] = 0.0;
+    l->nwindows = w + 1;
+  }
+  if (gap >= pause_threshold) {
+    /* Share the pause among the windows it overlaps. */
+    size_t i;
+    for (i = (size_t)(thread->last / window); i <= w; ++i) {
+      double base = (double)i * window, limit = base + window;
+      if (base < thread->last)
+        base = thread->last;
+      if (limit > end)
+        limit = end;
+      if (limit > base)
+        l->paused[i] += limit - base;
+    }
+  }
+  thread->last = end;
+}
+
+/* merge -- merge a thread's latency records into the total */
+
+static void merge(gcthread_t thread)
+{
+  latency_s *l = &thread->latency;
+  size_t i;
+
+  for (i = 0; i < LATENCY_BUCKETS; ++i)
+    total.hist[i] += l->hist[i];
+  if (l->max > total.max)
+    total.max = l->max;
+  if (l->nwindows > total.nwindows) {
+    total.paused = realloc(total.paused,
+                           l->nwindows * sizeof total.paused[0]);
+    active = realloc(active, l->nwindows * sizeof active[0]);
+    Insist(total.paused != NULL && active != NULL);
+    for (i = total.nwindows; i < l->nwindows; ++i) {
+      total.paused[i] = 0.0;
+      active[i] = 0;
+    }
+    total.nwindows = l->nwindows;
+  }
+  for (i = 0; i < l->nwindows; ++i) {
+    total.paused[i] += l->paused[i];
+    ++active[i];
+  }
+  free(l->paused);
+}
+
+
+/* percentile -- latency below which a fraction p of allocations fall
+ *
+ * This is the upper limit of the histogram bucket, so it may
+ * overestimate by up to a quarter of a doubling.
+ */
+
+static double percentile(double p)
+{
+  unsigned long n = 0, k = 0;
+  size_t b;
+
+  for (b = 0; b < LATENCY_BUCKETS; ++b)
+    n += total.hist[b];
+  for (b = 0; b < LATENCY_BUCKETS; ++b) {
+    k += total.hist[b];
+    if ((double)k >= p * (double)n)
+      break;
+  }
+  return pow(2.0, (double)(b + 1) / LATENCY_STEPS) * 1e-9;
+}
+
+
+/* report -- print allocation latency and mutator utilisation
+ *
+ * The utilisation of a window is the fraction of the time that the
+ * running threads were not paused.  The last window is incomplete
+ * and is omitted.
+ */
+
+static void report(const char *name)
+{
+  size_t i, n;
+  double min = 1.0;
+
+  printf("%s: latency p50 %gus p99 %gus p99.9 %gus max %gus\n", name,
+         percentile(0.5) * 1e6, percentile(0.99) * 1e6,
+         percentile(0.999) * 1e6, total.max * 1e6);
+  n = total.nwindows > 1 ? total.nwindows - 1 : total.nwindows;
+  printf("%s: utilisation per %gs:", name, window);
+  for (i = 0; i < n; ++i) {
+    double u = 1.0 - total.paused[i] / ((double)active[i] * window);
+    if (u < 0.0)
+      u = 0.0;
+    if (u < min)
+      min = u;
+    printf(" %.2f", u);
+  }
+  printf("\n%s: minimum utilisation %.2f\n", name, min);
+
+  free(total.paused);
+  free(active);
+  memset(&total, 0, sizeof total);
+  active = NULL;
+}
+
+
+static obj_t mkvector(gcthread_t thread, size_t n)
 {
   mps_word_t v;
-  RESMUST(make_dylan_vector(&v, ap, n));
+  if (latency) {
+    double begin = now();
+    RESMUST(make_dylan_vector(&v, thread->ap, n));
+    record(thread, begin, now());
+  } else {
+    RESMUST(make_dylan_vector(&v, thread->ap, n));
+  }
   return v;
 }
 
@@ -90,15 +286,15 @@ static void aset(obj_t v, size_t i, obj_t val)
 }
 
 /* mktree - make a tree of nodes with depth d. */
-static obj_t mktree(mps_ap_t ap, unsigned d, obj_t leaf)
+static obj_t mktree(gcthread_t thread, unsigned d, obj_t leaf)
 {
   obj_t tree;
   size_t i;
   if (d <= 0)
     return leaf;
-  tree = mkvector(ap, width);
+  tree = mkvector(thread, width);
   for (i = 0; i < width; ++i) {
-    aset(tree, i, mktree(ap, d - 1, leaf));
+    aset(tree, i, mktree(thread, d - 1, leaf));
   }
   return tree;
 }
@@ -120,7 +316,7 @@ static obj_t random_subtree(obj_t tree, unsigned levels)
  * NOTE: Changing preuse will dramatically change how much work
  * is done.  In particular, if preuse==1, the old tree is returned
  * unchanged. */
-static obj_t new_tree(mps_ap_t ap, obj_t oldtree, unsigned d)
+static obj_t new_tree(gcthread_t thread, obj_t oldtree, unsigned d)
 {
   obj_t subtree;
   size_t i;
@@ -129,9 +325,9 @@ static obj_t new_tree(mps_ap_t ap, obj_t oldtree, unsigned d)
   } else {
     if (d == 0)
       return objNULL;
-    subtree = mkvector(ap, width);
+    subtree = mkvector(thread, width);
     for (i = 0; i < width; ++i) {
-      aset(subtree, i, new_tree(ap, oldtree, d - 1));
+      aset(subtree, i, new_tree(thread, oldtree, d - 1));
     }
   }
   return subtree;
@@ -140,22 +336,22 @@ static obj_t new_tree(mps_ap_t ap, obj_t oldtree, unsigned d)
 /* Update tree to be identical tree but with nodes reallocated
  * with probability pupdate.  This avoids writing to vector slots
  * if unecessary. */
-static obj_t update_tree(mps_ap_t ap, obj_t oldtree, unsigned d)
+static obj_t update_tree(gcthread_t thread, obj_t oldtree, unsigned d)
 {
   obj_t tree;
   size_t i;
   if (oldtree == objNULL || d == 0)
     return oldtree;
   if (rnd_double() < pupdate) {
-    tree = mkvector(ap, width);
+    tree = mkvector(thread, width);
     for (i = 0; i < width; ++i) {
-      aset(tree, i, update_tree(ap, aref(oldtree, i), d - 1));
+      aset(tree, i, update_tree(thread, aref(oldtree, i), d - 1));
     }
   } else {
     tree = oldtree;
     for (i = 0; i < width; ++i) {
       obj_t oldsubtree = aref(oldtree, i);
-      obj_t subtree = update_tree(ap, oldsubtree, d - 1);
+      obj_t subtree = update_tree(thread, oldsubtree, d - 1);
       if (subtree != oldsubtree) {
         aset(tree, i, subtree);
       }
@@ -164,18 +360,46 @@ static obj_t update_tree(mps_ap_t ap, obj_t oldtree, unsigned d)
   return tree;
 }
 
+/* collections -- count collections from the GC messages
+ *
+ * Counts the collections that started while another collection was
+ * running.  See <design/trace#.multi>.
+ */
+
+static void collections(void)
+{
+  mps_message_type_t type;
+
+  while (mps_message_queue_type(&type, arena)) {
+    mps_message_t message;
+    if (!mps_message_get(&message, arena, type))
+      break;
+    if (type == mps_message_type_gc_start()) {
+      if (ncollstart > ncolldone)
+        ++ncollconcurrent;
+      ++ncollstart;
+    } else if (type == mps_message_type_gc()) {
+      ++ncolldone;
+    }
+    mps_message_discard(arena, message);
+  }
+}
+
 static void *gc_tree(gcthread_t thread)
 {
   unsigned i, j;
-  mps_ap_t ap = thread->ap;
-  obj_t leaf = pinleaf ? mktree(ap, 1, objNULL) : objNULL;
+  obj_t leaf = pinleaf ? mktree(thread, 1, objNULL) : objNULL;
   for (i = 0; i < niter; ++i) {
-    obj_t tree = mktree(ap, depth, leaf);
+    obj_t tree = mktree(thread, depth, leaf);
     for (j = 0 ; j < npass; ++j) {
+      if (concurrent && thread->index == 0) {
+        collections();
+        RESMUST(mps_arena_start_collect(arena));
+      }
       if (preuse < 1.0)
-        tree = new_tree(ap, tree, depth);
+        tree = new_tree(thread, tree, depth);
       if (pupdate > 0.0)
-        tree = update_tree(ap, tree, depth);
+        tree = update_tree(thread, tree, depth);
     }
   }
   return NULL;
@@ -190,6 +414,9 @@ static void *start(void *p)
   RESMUST(mps_root_create_thread(&thread->reg_root, arena,
                                  thread->mps_thread, &marker));
   RESMUST(mps_ap_create_k(&thread->ap, pool, mps_args_none));
+  memset(&thread->latency, 0, sizeof thread->latency);
+  if (latency)
+    thread->last = now();
   thread->fn(thread);
   mps_ap_destroy(thread->ap);
   mps_root_destroy(thread->reg_root);
@@ -204,20 +431,25 @@ static void weave(gcthread_fn_t fn)
 
   for (t = 0; t < nthreads; ++t) {
     gcthread_t thread = &threads[t];
+    thread->index = t;
     thread->fn = fn;
     testthr_create(&thread->thread, start, thread);
   }
 
-  for (t = 0; t < nthreads; ++t)
+  for (t = 0; t < nthreads; ++t) {
     testthr_join(&threads[t].thread, NULL);
+    merge(&threads[t]);
+  }
 }
 
 static void weave1(gcthread_fn_t fn)
 {
   gcthread_t thread = alloca(sizeof(thread[0]));
 
+  thread->index = 0;
   thread->fn = fn;
   start(thread);
+  merge(thread);
 }
 
 
@@ -225,6 +457,10 @@ static void watch(gcthread_fn_t fn, const char *name)
 {
   clock_t begin, end;
 
+  if (latency) {
+    origin = 0.0;
+    origin = now();
+  }
   begin = clock();
   if (nthreads == 1)
     weave1(fn);
@@ -233,6 +469,13 @@ static void watch(gcthread_fn_t fn, const char *name)
   end = clock();
 
   printf("%s: %g\n", name, (double)(end - begin) / CLOCKS_PER_SEC);
+  if (concurrent) {
+    collections();
+    printf("%s: %lu collections, %lu concurrent\n", name, ncollstart,
+           ncollconcurrent);
+  }
+  if (latency)
+    report(name);
 }
 
 
@@ -248,8 +491,19 @@ static void arena_setup(gcthread_fn_t fn,
     MPS_ARGS_ADD(args, MPS_KEY_ARENA_ZONED, zoned);
     MPS_ARGS_ADD(args, MPS_KEY_PAUSE_TIME, pause_time);
     MPS_ARGS_ADD(args, MPS_KEY_SPARE, spare);
+    MPS_ARGS_ADD(args, MPS_KEY_TRACE_WORKERS, workers);
+    MPS_ARGS_ADD(args, MPS_KEY_TRACE_GREY_ORDER, grey_order);
+    MPS_ARGS_ADD(args, MPS_KEY_COLLECTOR_THREAD, collector_thread);
+    MPS_ARGS_ADD(args, MPS_KEY_VMIX_UFFD, uffd);
     RESMUST(mps_arena_create_k(&arena, mps_arena_class_vm(), args));
   } MPS_ARGS_END(args);
+  if (arena_extend > 0)
+    RESMUST(mps_arena_vm_growth(arena, arena_extend, arena_extend));
+  if (concurrent) {
+    mps_message_type_enable(arena, mps_message_type_gc_start());
+    mps_message_type_enable(arena, mps_message_type_gc());
+    ncollstart = ncolldone = ncollconcurrent = 0;
+  }
   RESMUST(dylan_fmt(&format, arena));
   /* Make wrappers now to avoid race condition. */
   /* dylan_make_wrappers() uses malloc. */
@@ -282,6 +536,7 @@ static struct option longopts[] = {
   {"gen",              required_argument, NULL, 'g'},
   {"arena-size",       required_argument, NULL, 'm'},
   {"arena-grain-size", required_argument, NULL, 'a'},
+  {"arena-extend",     required_argument, NULL, 'e'},
   {"width",            required_argument, NULL, 'w'},
   {"depth",            required_argument, NULL, 'd'},
   {"preuse",           required_argument, NULL, 'r'},
@@ -291,6 +546,13 @@ static struct option longopts[] = {
   {"arena-unzoned",    no_argument,       NULL, 'z'},
   {"pause-time",       required_argument, NULL, 'P'},
   {"spare",            required_argument, NULL, 'S'},
+  {"trace-workers",    required_argument, NULL, 'W'},
+  {"grey-address",     no_argument,       NULL, 'G'},
+  {"concurrent",       no_argument,       NULL, 'c'},
+  {"collector-thread", no_argument,       NULL, 'B'},
+  {"latency",          no_argument,       NULL, 'L'},
+  {"window",           required_argument, NULL, 'U'},
+  {"uffd",             no_argument,       NULL, 'F'},
   {NULL,               0,                 NULL, 0  }
 };
 
@@ -302,6 +564,7 @@ static struct {
 } pools[] = {
   {"amc", gc_tree, mps_class_amc},
   {"ams", gc_tree, mps_class_ams},
+  {"amr", gc_tree, mps_class_amr},
   {"awl", gc_tree, mps_class_awl},
 };
 
@@ -316,7 +579,7 @@ int main(int argc, char *argv[])
 
   seed = rnd_seed();
 
-  while ((ch = getopt_long(argc, argv, "ht:i:p:g:m:a:w:d:r:u:lx:zP:S:",
+  while ((ch = getopt_long(argc, argv, "ht:i:p:g:m:a:e:w:d:r:u:lx:zP:S:W:GcBLU:F",
                            longopts, NULL)) != -1)
     switch (ch) {
     case 't':
@@ -385,6 +648,20 @@ int main(int argc, char *argv[])
         }
       }
       break;
+    case 'e': {
+        char *p;
+        arena_extend = (unsigned)strtoul(optarg, &p, 10);
+        switch(toupper(*p)) {
+        case 'G': arena_extend <<= 30; break;
+        case 'M': arena_extend <<= 20; break;
+        case 'K': arena_extend <<= 10; break;
+        case '\0': break;
+        default:
+          fprintf(stderr, "Bad arena extension size %s\n", optarg);
+          return EXIT_FAILURE;
+        }
+      }
+      break;
     case 'w':
       width = (size_t)strtoul(optarg, NULL, 10);
       break;
@@ -413,6 +690,27 @@ int main(int argc, char *argv[])
     case 'S':
       spare = strtod(optarg, NULL);
       break;
+    case 'W':
+      workers = (size_t)strtoul(optarg, NULL, 10);
+      break;
+    case 'G':
+      grey_order = MPS_GREY_ORDER_ADDRESS;
+      break;
+    case 'c':
+      concurrent = TRUE;
+      break;
+    case 'B':
+      collector_thread = TRUE;
+      break;
+    case 'L':
+      latency = TRUE;
+      break;
+    case 'U':
+      window = strtod(optarg, NULL);
+      break;
+    case 'F':
+      uffd = TRUE;
+      break;
     default:
       /* This is printed in parts to keep within the 509 character
          limit for string literals in portable standard C. */
@@ -423,6 +721,8 @@ int main(int argc, char *argv[])
               "    Initial size of arena (default %lu)\n"
               "  -a n, --arena-grain-size=n[KMG]?\n"
               "    Arena grain size (default %lu)\n"
+              "  -e n, --arena-extend=n[KMG]?\n"
+              "    Size of chunks added to arena (default: arena size)\n"
               "  -t n, --nthreads=n\n"
               "    Launch n threads each running the test (default %u)\n"
               "  -i n, --niter=n\n"
@@ -462,12 +762,32 @@ int main(int argc, char *argv[])
               "    Maximum pause time in seconds (default %f)\n"
               "  -S f, --spare\n"
               "    Maximum spare committed fraction (default %f)\n"
+              "  -W n, --trace-workers=n\n"
+              "    Scan with n collector worker threads (default %lu)\n"
+              "  -G, --grey-address\n"
+              "    Scan grey segments in address order\n"
+              "  -c, --concurrent\n"
+              "    Collect the world each pass, concurrently with\n"
+              "    collections of the nursery (use a small pause time)\n",
+              pause_time,
+              spare,
+              (unsigned long)workers);
+      fprintf(stderr,
+              "  -B, --collector-thread\n"
+              "    Do the collection work on a collector thread\n"
+              "  -L, --latency\n"
+              "    Report allocation latency and mutator utilisation\n"
+              "  -U t, --window=t\n"
+              "    Mutator utilisation window in seconds (default %g)\n"
+              "  -F, --uffd\n"
+              "    Set the write barrier with userfaultfd (Linux only)\n",
+              window);
+      fprintf(stderr,
               "Tests:\n"
               "  amc   pool class AMC\n"
               "  ams   pool class AMS\n"
-              "  awl   pool class AWL\n",
-              pause_time,
-              spare);
+              "  amr   pool class AMR\n"
+              "  awl   pool class AWL\n");
       return EXIT_FAILURE;
     }
   argc -= optind;
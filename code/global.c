@@ -12,7 +12,8 @@
  *
  * .static: Static data is used in ArenaAccess (in order to find the
  * appropriate arena) and GlobalsInit.  It's checked in GlobalsCheck.
- * <design/arena#.static>.
+ * <design/arena#.static>.  The access map (.access.map) is also
+ * static, and is read without a lock.
  *
  * .non-mod: The Globals structure has many fields which properly belong
  * to other modules <code/mpmst.h>; GlobalsInit contains code which
@@ -37,13 +38,51 @@ static RingStruct arenaRing;       /* <design/arena#.static.ring> */
 static Serial arenaSerial;         /* <design/arena#.static.serial> */
 
 
+/* AccessMapStruct -- map from address to arena and root
+ *
+ * .access.map: A table of the address ranges of all chunks and
+ * protectable roots in all arenas, sorted by address, so that
+ * ArenaAccess can find the owner of a fault without claiming the
+ * arena ring lock or walking the arenas and their roots.  The
+ * entries don't overlap.  <design/arena#.access.map>.
+ *
+ * .access.map.epoch: The map is updated while holding the global
+ * recursive lock, which may be claimed while an arena lock is held
+ * <design/thread-safety#.sol.deadlock>.  The epoch is odd while an
+ * update is in progress.  A reader notes the epoch before reading the
+ * map, and discards what it read if the epoch has changed since.
+ *
+ * .access.map.missing: A range that overlaps another range, or that
+ * doesn't fit in the table, is counted as missing instead.  While any
+ * range is missing, ArenaAccess searches the arenas as before.
+ */
+
+typedef struct AccessMapEntryStruct {
+  Addr base;                    /* base of range */
+  Addr limit;                   /* limit of range */
+  Arena arena;                  /* arena owning range */
+  Root root;                    /* root owning range, or NULL for chunk */
+} AccessMapEntryStruct, *AccessMapEntry;
+
+typedef struct AccessMapStruct {
+  volatile Word epoch;          /* odd while updating, .access.map.epoch */
+  Count count;                  /* number of entries in use */
+  Count missing;                /* ranges not in table, .access.map.missing */
+  AccessMapEntryStruct entry[AccessMapSIZE]; /* sorted by base */
+} AccessMapStruct;
+
+static AccessMapStruct accessMap;
+
+
 /* arenaClaimRingLock, arenaReleaseRingLock -- lock/release the arena ring
  *
  * <design/arena#.static.ring.lock>.  */
 
 static void arenaClaimRingLock(void)
 {
-  LockClaimGlobal();  /* claim the global lock to protect arenaRing */
+  /* claim the global lock to protect arenaRing
+     <design/thread-manager#.coop.lock> */
+  ThreadLockClaimGlobal();
 }
 
 static void arenaReleaseRingLock(void)
@@ -58,9 +97,12 @@ static void arenaReleaseRingLock(void)
 
 void GlobalsClaimAll(void)
 {
-  LockClaimGlobalRecursive();
+  /* The recursive global lock is claimed last, because it may be
+     claimed while an arena lock is held, for example to update the
+     access map <design/thread-safety#.sol.deadlock>. */
   arenaClaimRingLock();
   GlobalsArenaMap(ArenaEnter);
+  LockClaimGlobalRecursive();
 }
 
 /* GlobalsReleaseAll -- release all MPS locks. GlobalsClaimAll must
@@ -68,9 +110,9 @@ void GlobalsClaimAll(void)
 
 void GlobalsReleaseAll(void)
 {
+  LockReleaseGlobalRecursive();
   GlobalsArenaMap(ArenaLeave);
   arenaReleaseRingLock();
-  LockReleaseGlobalRecursive();
 }
 
 /* arenaReinitLock -- reinitialize the lock for an arena */
@@ -162,11 +204,11 @@ Bool GlobalsCheck(Globals arenaGlobals)
   Arena arena;
   TraceId ti;
   Trace trace;
-  Rank rank;
 
   CHECKS(Globals, arenaGlobals);
   arena = GlobalsArena(arenaGlobals);
   CHECKL(arena->serial < arenaSerial);
+  CHECKL(accessMap.count <= AccessMapSIZE);
   CHECKD_NOSIG(Ring, &arenaGlobals->globalRing);
 
   CHECKL(MPSVersion() == arenaGlobals->mpsVersionString);
@@ -207,6 +249,7 @@ Bool GlobalsCheck(Globals arenaGlobals)
   CHECKL(TraceSetCheck(arena->busyTraces));
   CHECKL(TraceSetCheck(arena->flippedTraces));
   CHECKL(TraceSetSuper(arena->busyTraces, arena->flippedTraces));
+  CHECKL(arena->hotGreyCount <= ArenaHotGreyLENGTH);
 
   TRACE_SET_ITER(ti, trace, TraceSetUNIV, arena)
     /* <design/arena#.trace> */
@@ -220,8 +263,6 @@ Bool GlobalsCheck(Globals arenaGlobals)
     CHECKL(TraceIdMessagesCheck(arena, ti));
   TRACE_SET_ITER_END(ti, trace, TraceSetUNIV, arena);
 
-  for(rank = RankMIN; rank < RankLIMIT; ++rank)
-    CHECKD_NOSIG(Ring, &arena->greyRing[rank]);
   CHECKD_NOSIG(Ring, &arena->chainRing);
 
   CHECKL(arena->tracedWork >= 0.0);
@@ -256,7 +297,6 @@ Bool GlobalsCheck(Globals arenaGlobals)
 Res GlobalsInit(Globals arenaGlobals)
 {
   Arena arena;
-  Rank rank;
   TraceId ti;
 
   /* This is one of the first things that happens, */
@@ -323,6 +363,13 @@ Res GlobalsInit(Globals arenaGlobals)
   arena->finalPool = NULL;
   arena->busyTraces = TraceSetEMPTY;    /* <code/trace.c> */
   arena->flippedTraces = TraceSetEMPTY; /* <code/trace.c> */
+  arena->segCacheSerial = (Serial)0;    /* <design/trace#.fix.cache> */
+  arena->flipSerial = (Serial)0;        /* <design/write-barrier#.hot> */
+  arena->hotGreyCount = (Count)0;
+  STATISTIC(arena->hotSegCount = 0);
+  STATISTIC(arena->hotScanCount = 0);
+  STATISTIC(arena->hotRaiseCount = 0);
+  STATISTIC(arena->pageScanCount = 0);
   arena->tracedWork = 0.0;
   arena->tracedTime = 0.0;
   arena->lastWorldCollect = ClockNow();
@@ -338,8 +385,6 @@ Res GlobalsInit(Globals arenaGlobals)
     arena->tMessage[ti] = NULL;
   }
 
-  for(rank = RankMIN; rank < RankLIMIT; ++rank)
-    RingInit(&arena->greyRing[rank]);
   RingInit(&arena->chainRing);
 
   HistoryInit(ArenaHistory(arena));
@@ -356,6 +401,9 @@ Res GlobalsInit(Globals arenaGlobals)
 }
 
 
+static void arenaBackground(void *closure);
+
+
 /* GlobalsCompleteCreate -- complete creating the globals of the arena
  *
  * This is like the final initializations in a Create method, except
@@ -417,10 +465,34 @@ Res GlobalsCompleteCreate(Globals arenaGlobals)
     }
   }
 
+  /* Create the collector worker threads, if requested.
+     <design/trace#.parallel.workers> */
+  if (arena->traceWorkers > 1) {
+    res = TraceWorkCreate(&arena->traceWork, arena, arena->traceWorkers);
+    if (res != ResOK)
+      goto failTraceWorkCreate;
+  }
+
+  /* Create the collector thread, if requested.
+     <design/arena#.poll.background> */
+  if (arena->collectorThread) {
+    res = BackgroundCreate(&arena->background, arena, arenaBackground, arena);
+    if (res != ResOK)
+      goto failBackgroundCreate;
+  }
+
   arenaAnnounce(arena);
 
   return ResOK;
 
+failBackgroundCreate:
+  if (arena->traceWork != NULL) {
+    TraceWorkDestroy(arena->traceWork);
+    arena->traceWork = NULL;
+  }
+failTraceWorkCreate:
+  ChainDestroy(arenaGlobals->defaultChain);
+  arenaGlobals->defaultChain = NULL;
 failChainCreate:
   return res;
 }
@@ -431,7 +503,6 @@ failChainCreate:
 void GlobalsFinish(Globals arenaGlobals)
 {
   Arena arena;
-  Rank rank;
 
   arena = GlobalsArena(arenaGlobals);
   AVERT(Globals, arenaGlobals);
@@ -445,8 +516,6 @@ void GlobalsFinish(Globals arenaGlobals)
   RingFinish(&arena->messageRing);
   RingFinish(&arena->threadRing);
   RingFinish(&arena->deadRing);
-  for(rank = RankMIN; rank < RankLIMIT; ++rank)
-    RingFinish(&arena->greyRing[rank]);
   RingFinish(&arenaGlobals->rootRing);
   RingFinish(&arenaGlobals->poolRing);
   RingFinish(&arenaGlobals->globalRing);
@@ -463,7 +532,6 @@ void GlobalsPrepareToDestroy(Globals arenaGlobals)
   TraceId ti;
   Trace trace;
   Chain defaultChain;
-  Rank rank;
 
   AVERT(Globals, arenaGlobals);
 
@@ -475,6 +543,17 @@ void GlobalsPrepareToDestroy(Globals arenaGlobals)
 
   arenaDenounce(arena);
 
+  /* The collector thread was stopped by ArenaBackgroundStop. */
+  if (arena->background != NULL) {
+    BackgroundDestroy(arena->background);
+    arena->background = NULL;
+  }
+
+  if (arena->traceWork != NULL) {
+    TraceWorkDestroy(arena->traceWork);
+    arena->traceWork = NULL;
+  }
+
   defaultChain = arenaGlobals->defaultChain;
   arenaGlobals->defaultChain = NULL;
   ChainDestroy(defaultChain);
@@ -540,8 +619,6 @@ void GlobalsPrepareToDestroy(Globals arenaGlobals)
   AVER(RingIsSingle(&arena->threadRing)); /* <design/check/#.common> */
   AVER(RingIsSingle(&arena->deadRing));
   AVER(RingIsSingle(&arenaGlobals->rootRing)); /* <design/check/#.common> */
-  for(rank = RankMIN; rank < RankLIMIT; ++rank)
-    AVER(RingIsSingle(&arena->greyRing[rank]));
   AVER(RingLength(&arenaGlobals->poolRing) == arenaGlobals->systemPools); /* <design/check/#.common> */
 }
 
@@ -573,7 +650,8 @@ void ArenaEnterLock(Arena arena, Bool recursive)
   if(recursive) {
     LockClaimRecursive(lock);
   } else {
-    LockClaim(lock);
+    /* <design/thread-manager#.coop.lock> */
+    ThreadLockClaim(arena, lock);
   }
   AVERT(Arena, arena); /* can't AVERT it until we've got the lock */
   if(recursive) {
@@ -632,67 +710,251 @@ Bool ArenaBusy(Arena arena)
 }
 
 
+/* accessMapFind -- find the entry whose range contains addr
+ *
+ * Returns the index of the first entry whose limit is above addr,
+ * which is count if there isn't one.
+ */
+
+static Index accessMapFind(Count count, Addr addr)
+{
+  Index lo = 0, hi = count;
+  while (lo < hi) {
+    Index mid = lo + (hi - lo) / 2;
+    if (accessMap.entry[mid].limit <= addr)
+      lo = mid + 1;
+    else
+      hi = mid;
+  }
+  return lo;
+}
+
+
+/* accessMapLookup -- look up the owner of an address without a lock
+ *
+ * If the map is complete and wasn't updated during the lookup, set
+ * *arenaReturn and *rootReturn to the arena and root owning addr (or
+ * NULL if there is none) and return TRUE.  Otherwise return FALSE.
+ * See .access.map.epoch.
+ */
+
+static Bool accessMapLookup(Arena *arenaReturn, Root *rootReturn,
+                            Addr addr)
+{
+  Word epoch;
+  Count count;
+  Index i;
+  Arena arena = NULL;
+  Root root = NULL;
+
+  epoch = accessMap.epoch;
+  MEMORY_BARRIER();
+  count = accessMap.count;
+  if ((epoch & 1) != 0 || accessMap.missing > 0 || count > AccessMapSIZE)
+    return FALSE;
+
+  i = accessMapFind(count, addr);
+  if (i < count && accessMap.entry[i].base <= addr) {
+    arena = accessMap.entry[i].arena;
+    root = accessMap.entry[i].root;
+  }
+
+  MEMORY_BARRIER();
+  if (accessMap.epoch != epoch)
+    return FALSE;
+
+  *arenaReturn = arena;
+  *rootReturn = root;
+  return TRUE;
+}
+
+
+/* accessMapUpdateBegin, accessMapUpdateEnd -- bracket an update */
+
+static void accessMapUpdateBegin(void)
+{
+  LockClaimGlobalRecursive();
+  AVER((accessMap.epoch & 1) == 0);
+  ++accessMap.epoch;
+  MEMORY_BARRIER();
+}
+
+static void accessMapUpdateEnd(void)
+{
+  MEMORY_BARRIER();
+  ++accessMap.epoch;
+  AVER((accessMap.epoch & 1) == 0);
+  LockReleaseGlobalRecursive();
+}
+
+
+/* ArenaAccessMapAdd -- add the range of a chunk or root to the map
+ *
+ * root is NULL for a chunk.  The caller must hold the arena lock.
+ */
+
+void ArenaAccessMapAdd(Arena arena, Root root, Addr base, Addr limit)
+{
+  Index i, j;
+
+  AVERT(Arena, arena);
+  AVER(root == NULL || RootArena(root) == arena);
+  AVER(base < limit);
+
+  accessMapUpdateBegin();
+  i = accessMapFind(accessMap.count, base);
+  if (accessMap.count == AccessMapSIZE
+      || (i < accessMap.count && accessMap.entry[i].base < limit)) {
+    ++accessMap.missing; /* .access.map.missing */
+  } else {
+    for (j = accessMap.count; j > i; --j)
+      accessMap.entry[j] = accessMap.entry[j - 1];
+    accessMap.entry[i].base = base;
+    accessMap.entry[i].limit = limit;
+    accessMap.entry[i].arena = arena;
+    accessMap.entry[i].root = root;
+    ++accessMap.count;
+  }
+  accessMapUpdateEnd();
+}
+
+
+/* ArenaAccessMapRemove -- remove the range of a chunk or root from the map
+ *
+ * The arguments must be the same as those passed to ArenaAccessMapAdd.
+ * The caller must hold the arena lock.
+ */
+
+void ArenaAccessMapRemove(Arena arena, Root root, Addr base, Addr limit)
+{
+  Index i;
+
+  AVERT(Arena, arena);
+  AVER(base < limit);
+
+  accessMapUpdateBegin();
+  i = accessMapFind(accessMap.count, base);
+  if (i < accessMap.count
+      && accessMap.entry[i].base == base
+      && accessMap.entry[i].limit == limit
+      && accessMap.entry[i].arena == arena
+      && accessMap.entry[i].root == root) {
+    --accessMap.count;
+    for (; i < accessMap.count; ++i)
+      accessMap.entry[i] = accessMap.entry[i + 1];
+  } else {
+    AVER(accessMap.missing > 0); /* .access.map.missing */
+    --accessMap.missing;
+  }
+  accessMapUpdateEnd();
+}
+
+
+/* arenaAccess -- deal with an access fault in one arena
+ *
+ * Returns TRUE if the fault was in a segment or root belonging to the
+ * arena, FALSE otherwise.  If ringLocked is TRUE, the arena ring lock
+ * is released once the owner of the fault has been found.
+ */
+
+static Bool arenaAccess(Arena arena, Addr addr, AccessSet mode,
+                        MutatorContext context, Bool ringLocked)
+{
+  Seg seg;
+  Root root;
+  Arena owner;
+  Res res;
+
+  ArenaEnter(arena);     /* <design/arena#.lock.arena> */
+  EVENT3(ArenaAccessBegin, arena, addr, mode);
+
+  /* @@@@ The code below assumes that Roots and Segs are disjoint. */
+  /* It will fall over (in TraceSegAccess probably) if there is a */
+  /* protected root on a segment. */
+  /* It is possible to overcome this restriction. */
+  if (SegOfAddr(&seg, arena, addr)) {
+    if (ringLocked)
+      arenaReleaseRingLock();
+    /* An access in a different thread (or even in the same thread,
+     * via a signal or exception handler) may have already caused
+     * the protection to be cleared. This avoids calling TraceAccess
+     * on protection that has already been cleared on a separate
+     * thread. */
+    mode &= SegPM(seg);
+    if (mode != AccessSetEMPTY) {
+      res = SegAccess(seg, arena, addr, mode, context);
+      AVER(res == ResOK); /* Mutator can't continue unless this succeeds */
+    } else {
+      /* Protection was already cleared, for example by another thread
+         or a fault in a nested exception handler: nothing to do now. */
+    }
+    EVENT1(ArenaAccessEnd, arena);
+    ArenaLeave(arena);
+    return TRUE;
+  }
+
+  /* .access.root: The arena lock prevents the arena's roots from being
+     created or destroyed, so a root found in the map is still alive. */
+  if (accessMapLookup(&owner, &root, addr)) {
+    if (owner != arena)
+      root = NULL;
+  } else if (!RootOfAddr(&root, arena, addr)) {
+    root = NULL;
+  }
+  if (root != NULL) {
+    if (ringLocked)
+      arenaReleaseRingLock();
+    mode &= RootPM(root);
+    if (mode != AccessSetEMPTY)
+      RootAccess(root, mode);
+    EVENT1(ArenaAccessEnd, arena);
+    ArenaLeave(arena);
+    return TRUE;
+  }
+
+  /* No segment or root was found at the address: this must mean
+   * that activity in another thread (or even in the same thread,
+   * via a signal or exception handler) caused the segment or root
+   * to go away. So there's nothing to do now. */
+  EVENT1(ArenaAccessEnd, arena);
+  ArenaLeave(arena);
+  return FALSE;
+}
+
+
 /* ArenaAccess -- deal with an access fault
  *
  * This is called when a protected address is accessed.  The mode
  * corresponds to which mode flags need to be cleared in order for the
- * access to continue.  */
+ * access to continue.
+ *
+ * .access.fast: The owner of the fault is looked up in the access map
+ * without claiming the arena ring lock.  The arena can't be destroyed
+ * before it is entered, because it is a client error to destroy an
+ * arena while another thread is accessing its memory.  If the map is
+ * incomplete or is being updated, the arenas are searched as before.
+ * <design/arena#.access.map>.
+ */
 
 Bool ArenaAccess(Addr addr, AccessSet mode, MutatorContext context)
 {
-  Seg seg;
   Ring node, nextNode;
-  Res res;
+  Arena arena;
+  Root root;
+
+  if (accessMapLookup(&arena, &root, addr)) { /* .access.fast */
+    if (arena == NULL)
+      return FALSE;
+    return arenaAccess(arena, addr, mode, context, FALSE);
+  }
 
   arenaClaimRingLock();    /* <design/arena#.lock.ring> */
   AVERT(Ring, &arenaRing);
 
   RING_FOR(node, &arenaRing, nextNode) {
     Globals arenaGlobals = RING_ELT(Globals, globalRing, node);
-    Arena arena = GlobalsArena(arenaGlobals);
-    Root root;
-
-    ArenaEnter(arena);     /* <design/arena#.lock.arena> */
-    EVENT3(ArenaAccessBegin, arena, addr, mode);
-
-    /* @@@@ The code below assumes that Roots and Segs are disjoint. */
-    /* It will fall over (in TraceSegAccess probably) if there is a */
-    /* protected root on a segment. */
-    /* It is possible to overcome this restriction. */
-    if (SegOfAddr(&seg, arena, addr)) {
-      arenaReleaseRingLock();
-      /* An access in a different thread (or even in the same thread,
-       * via a signal or exception handler) may have already caused
-       * the protection to be cleared. This avoids calling TraceAccess
-       * on protection that has already been cleared on a separate
-       * thread. */
-      mode &= SegPM(seg);
-      if (mode != AccessSetEMPTY) {
-        res = SegAccess(seg, arena, addr, mode, context);
-        AVER(res == ResOK); /* Mutator can't continue unless this succeeds */
-      } else {
-        /* Protection was already cleared, for example by another thread
-           or a fault in a nested exception handler: nothing to do now. */
-      }
-      EVENT1(ArenaAccessEnd, arena);
-      ArenaLeave(arena);
+    if (arenaAccess(GlobalsArena(arenaGlobals), addr, mode, context, TRUE))
       return TRUE;
-    } else if (RootOfAddr(&root, arena, addr)) {
-      arenaReleaseRingLock();
-      mode &= RootPM(root);
-      if (mode != AccessSetEMPTY)
-        RootAccess(root, mode);
-      EVENT1(ArenaAccessEnd, arena);
-      ArenaLeave(arena);
-      return TRUE;
-    } else {
-      /* No segment or root was found at the address: this must mean
-       * that activity in another thread (or even in the same thread,
-       * via a signal or exception handler) caused the segment or root
-       * to go away. So there's nothing to do now. */
-      EVENT1(ArenaAccessEnd, arena);
-      ArenaLeave(arena);
-    }
   }
 
   arenaReleaseRingLock();
@@ -714,15 +976,19 @@ Bool ArenaAccess(Addr addr, AccessSet mode, MutatorContext context)
  *
  * @@@@ Perhaps this should be based on a process table rather than a
  * series of manual steps for looking around.  This might be worthwhile
- * if we introduce background activities other than tracing.  */
+ * if we introduce background activities other than tracing.
+ *
+ * If the arena has a collector thread, ArenaPoll starts a trace if one
+ * is due, then wakes the thread and returns without doing any other
+ * work, unless the thread has fallen too far behind.
+ * <design/arena#.poll.background> */
+
+static void arenaPollStart(Globals globals);
+static void arenaPollWork(Globals globals, Bool startAllowed);
 
 void (ArenaPoll)(Globals globals)
 {
   Arena arena;
-  Clock start;
-  Bool worldCollected = FALSE;
-  Bool moreWork, workWasDone = FALSE;
-  Work tracedWork;
 
   AVERT(Globals, globals);
 
@@ -734,6 +1000,66 @@ void (ArenaPoll)(Globals globals)
   if (!PolicyPoll(arena))
     return;
 
+  if (arena->background != NULL
+      && BackgroundRunning(arena->background)
+      && !ArenaEmergency(arena)
+      && globals->fillMutatorSize < globals->pollThreshold + ArenaPollBACKLOG)
+  {
+    arenaPollStart(globals);
+    BackgroundWake(arena->background);
+    return;
+  }
+
+  arenaPollWork(globals, TRUE);
+}
+
+
+/* arenaPollStart -- start a trace on the mutator's thread
+ *
+ * .poll.start: Starting a trace flips, which makes the mutator black
+ * by scanning its roots.  A thread that isn't a root (for example,
+ * the only thread of a program whose collections otherwise happen
+ * only when it calls the MPS) may hold references in its registers at
+ * any point outside the MPS, so the flip must happen here and not on
+ * the collector thread.  <design/arena#.poll.background.start>
+ */
+
+static void arenaPollStart(Globals globals)
+{
+  Arena arena;
+  Clock start;
+  Bool worldCollected;
+
+  AVERT(Globals, globals);
+  AVER(!globals->insidePoll);
+  arena = GlobalsArena(globals);
+
+  globals->insidePoll = TRUE;
+  start = ClockNow();
+  if (TracePollStart(&worldCollected, globals, TRUE))
+    ArenaAccumulateTime(arena, start, ClockNow());
+  globals->insidePoll = FALSE;
+}
+
+
+/* arenaPollWork -- do the tracing work that is due
+ *
+ * If startAllowed is FALSE, only advance the traces that are already
+ * running.  See .poll.start.
+ */
+
+static void arenaPollWork(Globals globals, Bool startAllowed)
+{
+  Arena arena;
+  Clock start;
+  Bool worldCollected = FALSE;
+  Bool moreWork, workWasDone = FALSE;
+  Work tracedWork;
+
+  AVERT(Globals, globals);
+  AVER(!globals->insidePoll);
+  arena = GlobalsArena(globals);
+
   globals->insidePoll = TRUE;
 
   /* fillMutatorSize has advanced; call TracePoll enough to catch up. */
@@ -743,7 +1069,7 @@ void (ArenaPoll)(Globals globals)
 
   do {
     moreWork = TracePoll(&tracedWork, &worldCollected, globals,
-                         !worldCollected);
+                         !worldCollected, startAllowed);
     if (moreWork) {
       workWasDone = TRUE;
     }
@@ -760,6 +1086,49 @@ void (ArenaPoll)(Globals globals)
 }
 
 
+/* arenaBackground -- do tracing work on the collector thread
+ *
+ * Does the work that ArenaPoll would have done, except for starting
+ * traces (see .poll.start), leaving the arena after each pause so that
+ * the mutator can run, until no more work is due.
+ * <design/arena#.poll.background>
+ */
+
+static void arenaBackground(void *closure)
+{
+  Arena arena = closure;
+  Bool again;
+
+  do {
+    Globals globals;
+    ArenaEnter(arena);
+    globals = ArenaGlobals(arena);
+    again = FALSE;
+    if (!globals->clamped && !globals->insidePoll && PolicyPoll(arena)) {
+      STACK_CONTEXT_BEGIN(arena) {
+        arenaPollWork(globals, FALSE);
+      } STACK_CONTEXT_END(arena);
+      again = PolicyPoll(arena);
+    }
+    ArenaLeave(arena);
+  } while (again);
+}
+
+
+/* ArenaBackgroundStop -- stop the collector thread
+ *
+ * Called before entering the arena to destroy it, because the
+ * collector thread may be waiting to enter the arena.
+ */
+
+void ArenaBackgroundStop(Arena arena)
+{
+  AVER(TESTT(Arena, arena));
+  if (arena->background != NULL)
+    BackgroundStop(arena->background);
+}
+
+
 /* ArenaStep -- use idle time for collection work */
 
 Bool ArenaStep(Globals globals, double interval, double multiplier)
@@ -785,9 +1154,9 @@ Bool ArenaStep(Globals globals, double interval, double multiplier)
   /* loop while there is work to do and time on the clock. */
   do {
     Trace trace;
-    if (arena->busyTraces != TraceSetEMPTY) {
-      trace = ArenaTrace(arena, (TraceId)0);
-    } else {
+    TraceId ti;
+    TraceSet busy = arena->busyTraces;
+    if (busy == TraceSetEMPTY) {
       /* No traces are running: consider collecting the world. */
       if (PolicyShouldCollectWorld(arena, (double)(availableEnd - now), now,
                                    clocks_per_sec))
@@ -803,10 +1172,16 @@ Bool ArenaStep(Globals globals, double interval, double multiplier)
         if (!PolicyStartTrace(&trace, &worldCollected, arena, FALSE))
           break;
       }
+      busy = TraceSetSingle(trace);
     }
-    TraceAdvance(trace);
-    if (trace->state == TraceFINISHED)
-      TraceDestroyFinished(trace);
+    /* Advance every busy trace, so that a nursery trace running
+       alongside an older one isn't starved of idle time.
+       <design/trace#.multi.policy> */
+    TRACE_SET_ITER(ti, trace, busy, arena)
+      TraceAdvance(trace);
+      if (trace->state == TraceFINISHED)
+        TraceDestroyFinished(trace);
+    TRACE_SET_ITER_END(ti, trace, busy, arena);
     workWasDone = TRUE;
     now = ClockNow();
   } while (now < intervalEnd);
@@ -888,6 +1263,10 @@ Ref ArenaPeekSeg(Arena arena, Seg seg, Ref *p)
 {
   Ref ref;
   Rank rank;
+  TraceSet grey;
+  TraceId ti;
+  Trace trace;
+  Size alias;
 
   AVERT(Arena, arena);
   AVERT(Seg, seg);
@@ -909,17 +1288,19 @@ Ref ArenaPeekSeg(Arena arena, Seg seg, Ref *p)
   /* If the segment isn't grey it doesn't need scanning, and in fact it
      would be wrong to even ask what rank to scan it at, since there might
      not be any traces running. */
-  if (TraceSetInter(SegGrey(seg), arena->flippedTraces) != TraceSetEMPTY) {
-    rank = TraceRankForAccess(arena, seg);
-    TraceScanSingleRef(arena->flippedTraces, rank, arena, seg, p);
-  }
+  grey = TraceSetInter(SegGrey(seg), arena->flippedTraces);
+  TRACE_SET_ITER(ti, trace, grey, arena)
+    rank = TraceRankForAccess(trace, seg);
+    TraceScanSingleRef(TraceSetSingle(trace), rank, arena, seg, p);
+  TRACE_SET_ITER_END(ti, trace, grey, arena);
 
   /* We don't need to update the Seg Summary as in PoolSingleAccess
    * because we are not changing it after it has been scanned. */
 
-  ShieldExpose(arena, seg);
-  ref = *p;
-  ShieldCover(arena, seg);
+  /* <design/shield#.alias> */
+  alias = ShieldExposeAlias(arena, seg);
+  ref = *(Ref *)AddrAlias(p, alias);
+  ShieldCoverAlias(arena, seg, alias);
   return ref;
 }
 
@@ -944,6 +1325,7 @@ void ArenaPoke(Arena arena, Ref *p, Ref ref)
 void ArenaPokeSeg(Arena arena, Seg seg, Ref *p, Ref ref)
 {
   RefSet summary;
+  Size alias;
 
   AVERT(Arena, arena);
   AVERT(Seg, seg);
@@ -953,12 +1335,13 @@ void ArenaPokeSeg(Arena arena, Seg seg, Ref *p, Ref ref)
   /* TODO: Consider checking p's alignment using seg->pool->alignment */
   /* ref is arbitrary and can't be checked */
 
-  ShieldExpose(arena, seg);
-  *p = ref;
+  /* <design/shield#.alias> */
+  alias = ShieldExposeAlias(arena, seg);
+  *(Ref *)AddrAlias(p, alias) = ref;
   summary = SegSummary(seg);
   summary = RefSetAdd(arena, summary, (Addr)ref);
   SegSetSummary(seg, summary);
-  ShieldCover(arena, seg);
+  ShieldCoverAlias(arena, seg, alias);
 }
 
 /* ArenaRead -- like ArenaPeek, but reference known to be owned by arena */
@@ -1029,6 +1412,14 @@ Res GlobalsDescribe(Globals arenaGlobals, mps_lib_FILE *stream, Count depth)
                "threadSerial $U\n", (WriteFU)arena->threadSerial,
                "busyTraces    $B\n", (WriteFB)arena->busyTraces,
                "flippedTraces $B\n", (WriteFB)arena->flippedTraces,
+               STATISTIC_WRITE("hotSegCount $U\n",
+                               (WriteFU)arena->hotSegCount)
+               STATISTIC_WRITE("hotScanCount $U\n",
+                               (WriteFU)arena->hotScanCount)
+               STATISTIC_WRITE("hotRaiseCount $U\n",
+                               (WriteFU)arena->hotRaiseCount)
+               STATISTIC_WRITE("pageScanCount $U\n",
+                               (WriteFU)arena->pageScanCount)
                NULL);
   if (res != ResOK)
     return res;
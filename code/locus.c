@@ -459,6 +459,31 @@ GenDesc ChainGen(Chain chain, Index gen)
 }
 
 
+/* genDescIsNursery -- could a nursery collection condemn this generation?
+ *
+ * Return TRUE if the generation is the first generation of a chain
+ * with at least two generations, which policyStartNursery may condemn
+ * while other traces are running.  Objects must never be promoted
+ * into such a generation, since it would be the running traces'
+ * to-space.  See <design/trace#.multi.policy>.
+ *
+ * This walks the arena's chains, so PoolGenInit calls it once and
+ * caches the result: a generation never moves between chains.
+ */
+
+static Bool genDescIsNursery(Arena arena, GenDesc gen)
+{
+  Ring node, nextNode;
+
+  RING_FOR(node, &arena->chainRing, nextNode) {
+    Chain chain = RING_ELT(Chain, chainRing, node);
+    if (chain->genCount >= 2 && gen == &chain->gens[0])
+      return TRUE;
+  }
+  return FALSE;
+}
+
+
 /* ChainDeferral -- time until next ephemeral GC for this chain */
 
 double ChainDeferral(Chain chain)
@@ -526,6 +551,7 @@ Res PoolGenInit(PoolGen pgen, GenDesc gen, Pool pool)
 
   pgen->pool = pool;
   pgen->gen = gen;
+  pgen->isNursery = genDescIsNursery(PoolArena(pool), gen);
   RingInit(&pgen->genRing);
   pgen->segs = 0;
   pgen->totalSize = 0;
@@ -571,6 +597,7 @@ Bool PoolGenCheck(PoolGen pgen)
   CHECKU(Pool, pgen->pool);
   CHECKU(GenDesc, pgen->gen);
   CHECKD_NOSIG(Ring, &pgen->genRing);
+  CHECKL(BoolCheck(pgen->isNursery));
   CHECKL((pgen->totalSize == 0) == (pgen->segs == 0));
   CHECKL(pgen->totalSize >= pgen->segs * ArenaGrainSize(PoolArena(pgen->pool)));
   CHECKL(pgen->totalSize == pgen->freeSize + pgen->bufferedSize
@@ -590,6 +617,27 @@ static void PoolGenAccountForAlloc(PoolGen pgen, Size size)
 }
 
 
+/* genDescAttachSeg -- attach a segment to a generation */
+
+static void genDescAttachSeg(GenDesc gen, Arena arena, Seg seg)
+{
+  ZoneSet zones, moreZones;
+
+  RingAppend(&gen->segRing, &SegGCSeg(seg)->genRing);
+
+  zones = gen->zones;
+  moreZones = ZoneSetUnion(zones, ZoneSetOfSeg(arena, seg));
+  gen->zones = moreZones;
+
+  if (!ZoneSetSuper(zones, moreZones)) {
+    /* Tracking the whole zoneset for each generation gives more
+     * understandable telemetry than just reporting the added
+     * zones. */
+    EVENT3(GenZoneSet, arena, gen, moreZones);
+  }
+}
+
+
 /* PoolGenAlloc -- allocate a segment in a pool generation
  *
  * Allocate a segment belong to klass (which must be GCSegClass or a
@@ -602,7 +650,6 @@ Res PoolGenAlloc(Seg *segReturn, PoolGen pgen, SegClass klass, Size size,
   LocusPrefStruct pref;
   Res res;
   Seg seg;
-  ZoneSet zones, moreZones;
   Arena arena;
   GenDesc gen;
 
@@ -615,27 +662,16 @@ Res PoolGenAlloc(Seg *segReturn, PoolGen pgen, SegClass klass, Size size,
 
   arena = PoolArena(pgen->pool);
   gen = pgen->gen;
-  zones = gen->zones;
 
   LocusPrefInit(&pref);
   pref.high = FALSE;
-  pref.zones = zones;
+  pref.zones = gen->zones;
   pref.avoid = ZoneSetBlacklist(arena);
   res = SegAlloc(&seg, klass, &pref, size, pgen->pool, args);
   if (res != ResOK)
     return res;
 
-  RingAppend(&gen->segRing, &SegGCSeg(seg)->genRing);
-
-  moreZones = ZoneSetUnion(zones, ZoneSetOfSeg(arena, seg));
-  gen->zones = moreZones;
-
-  if (!ZoneSetSuper(zones, moreZones)) {
-    /* Tracking the whole zoneset for each generation gives more
-     * understandable telemetry than just reporting the added
-     * zones. */
-    EVENT3(GenZoneSet, arena, gen, moreZones);
-  }
+  genDescAttachSeg(gen, arena, seg);
 
   PoolGenAccountForAlloc(pgen, SegSize(seg));
 
@@ -831,6 +867,56 @@ void PoolGenFree(PoolGen pgen, Seg seg, Size freeSize, Size oldSize,
 }
 
 
+/* PoolGenPromote -- move a segment to another generation in place
+ *
+ * Call this when a collection has preserved the objects in a segment
+ * without moving them, and the segment is to join the generation that
+ * those objects would have been moved to.  The segment must be
+ * accounted as old in the generation it is leaving; it is accounted
+ * as new in the generation it joins, as its objects would be if they
+ * had been moved there.  The deferred flag is as for
+ * PoolGenAccountForEmpty.
+ *
+ * <design/strategy#.accounting.op.promote>
+ */
+
+void PoolGenPromote(PoolGen to, PoolGen from, Seg seg, Bool deferred)
+{
+  Size size;
+
+  AVERT(PoolGen, to);
+  AVERT(PoolGen, from);
+  AVER(to != from);
+  AVER(to->pool == from->pool);
+  AVER(!PoolGenIsNursery(to)); /* <design/trace#.multi.policy> */
+  AVERT(Seg, seg);
+  AVER(SegPool(seg) == from->pool);
+  AVERT(Bool, deferred);
+
+  size = SegSize(seg);
+  AVER(from->totalSize >= size);
+  from->totalSize -= size;
+  AVER(from->segs > 0);
+  -- from->segs;
+  if (deferred) {
+    AVER(from->oldDeferredSize >= size);
+    from->oldDeferredSize -= size;
+  } else {
+    AVER(from->oldSize >= size);
+    from->oldSize -= size;
+  }
+  RingRemove(&SegGCSeg(seg)->genRing);
+
+  genDescAttachSeg(to->gen, PoolArena(to->pool), seg);
+  to->totalSize += size;
+  ++ to->segs;
+  if (deferred)
+    to->newDeferredSize += size;
+  else
+    to->newSize += size;
+}
+
+
 /* PoolGenDescribe -- describe a PoolGen */
 
 Res PoolGenDescribe(PoolGen pgen, mps_lib_FILE *stream, Count depth)
@@ -61,6 +61,7 @@ typedef struct PoolGenStruct {
   Sig sig;            /* design.mps.sig.field */
   Pool pool;          /* pool this belongs to */
   GenDesc gen;        /* generation this belongs to */
+  Bool isNursery;     /* see <code/locus.c#genDescIsNursery> */
   /* link in ring of all PoolGen's in this GenDesc (locus) */
   RingStruct genRing;
 
@@ -116,6 +117,7 @@ extern Res PoolGenAlloc(Seg *segReturn, PoolGen pgen, SegClass klass,
                         Size size, ArgList args);
 extern void PoolGenFree(PoolGen pgen, Seg seg, Size freeSize, Size oldSize,
                         Size newSize, Bool deferred);
+extern void PoolGenPromote(PoolGen to, PoolGen from, Seg seg, Bool deferred);
 extern void PoolGenAccountForFill(PoolGen pgen, Size size);
 extern void PoolGenAccountForEmpty(PoolGen pgen, Size used, Size unused, Bool deferred);
 extern void PoolGenAccountForAge(PoolGen pgen, Size wasBuffered, Size wasNew, Bool deferred);
@@ -124,6 +126,7 @@ extern void PoolGenUndefer(PoolGen pgen, Size oldSize, Size newSize);
 extern void PoolGenAccountForSegSplit(PoolGen pgen);
 extern void PoolGenAccountForSegMerge(PoolGen pgen);
 extern Res PoolGenDescribe(PoolGen gen, mps_lib_FILE *stream, Count depth);
+#define PoolGenIsNursery(pgen) RVALUE((pgen)->isNursery)
 
 #endif /* locus_h */
 
@@ -93,6 +93,8 @@ Bool MPMCheck(void)
   CHECKL(WB_DEFER_INIT  <= ((1ul << WB_DEFER_BITS) - 1));
   CHECKL(WB_DEFER_DELAY <= ((1ul << WB_DEFER_BITS) - 1));
   CHECKL(WB_DEFER_HIT   <= ((1ul << WB_DEFER_BITS) - 1));
+  CHECKL(SEG_ACCESS_HOT >= 1);
+  CHECKL(SEG_ACCESS_HOT <= ((1ul << SEG_ACCESS_BITS) - 1));
 
   return TRUE;
 }
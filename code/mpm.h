@@ -28,6 +28,8 @@
 #include "prot.h"
 #include "sp.h"
 #include "th.h"
+#include "wk.h"
+#include "bg.h"
 #include "ss.h"
 #include "mpslib.h"
 #include "ring.h"
@@ -90,6 +92,11 @@ extern Word (WordAlignDown)(Word word, Align align);
 #define AddrOffset(b, l) \
   ((Size)(PointerOffset((void *)(b), (void *)(l))))
 
+/* AddrAlias, AddrUnalias -- translate to and from the collector alias
+ * <design/vm#.alias>.  The offset may wrap, so use Word arithmetic. */
+#define AddrAlias(p, alias) ((Addr)((Word)(p) + (Word)(alias)))
+#define AddrUnalias(p, alias) ((Addr)((Word)(p) - (Word)(alias)))
+
 extern Addr (AddrAlignDown)(Addr addr, Align align);
 #define AddrAlignDown(p, a) ((Addr)WordAlignDown((Word)(p), a))
 
@@ -372,6 +379,13 @@ extern void ScanStateUpdateSummary(ScanState ss, Seg seg, Bool wasTotal);
 #define ScanStateSetWhite(ss, zs)          ((void)((ss)->ss_s._w = (zs)))
 #define ScanStateSetUnfixedSummary(ss, rs) ((void)((ss)->ss_s._ufs = (rs)))
 
+/* ScanStateSnapCache -- snap-out cache entry that may remember ref
+ *
+ * Only valid if ss->snapCache is not NULL.  See
+ * <design/trace#.fix.snap>. */
+#define ScanStateSnapCache(ss, ref) \
+  (&(ss)->snapCache[((Word)(ref) / sizeof(Word)) & (TraceSnapCacheSIZE - 1)])
+
 extern Bool TraceIdCheck(TraceId id);
 extern Bool TraceSetCheck(TraceSet ts);
 extern Bool TraceCheck(Trace trace);
@@ -384,13 +398,28 @@ extern Res TraceAddWhite(Trace trace, Seg seg);
 extern void TraceCondemnStart(Trace trace);
 extern Res TraceCondemnEnd(double *mortalityReturn, Trace trace);
 extern Res TraceStart(Trace trace, double mortality, double finishingTime);
+extern Bool TracePollStart(Bool *collectWorldReturn, Globals globals,
+                           Bool collectWorldAllowed);
 extern Bool TracePoll(Work *workReturn, Bool *collectWorldReturn,
-                      Globals globals, Bool collectWorldAllowed);
+                      Globals globals, Bool collectWorldAllowed,
+                      Bool startAllowed);
 
-extern Rank TraceRankForAccess(Arena arena, Seg seg);
+extern Rank TraceRankForAccess(Trace trace, Seg seg);
 extern void TraceSegAccess(Arena arena, Seg seg, AccessSet mode);
+extern void TraceSegPageAccess(Arena arena, Seg seg, Addr addr,
+                               AccessSet mode);
+extern void TraceNoteHotGrey(Arena arena, Seg seg);
+extern Bool TraceSegReclaim(Arena arena, Seg seg);
+extern Bool TraceReclaimFinish(Arena arena);
+
+extern Res TraceWorkCreate(TraceWork *traceWorkReturn, Arena arena,
+                           Count workers);
+extern void TraceWorkDestroy(TraceWork tw);
+extern Bool TraceWorkCheck(TraceWork tw);
 
 extern void TraceAdvance(Trace trace);
+extern void TraceGreyInsert(Trace trace, GreyLink link, Rank rank);
+extern void TraceGreyRemove(Trace trace, GreyLink link);
 extern Res TraceStartCollectAll(Trace *traceReturn, Arena arena, TraceStartWhy why);
 extern Res TraceDescribe(Trace trace, mps_lib_FILE *stream, Count depth);
 
@@ -462,6 +491,12 @@ extern void TraceScanSingleRef(TraceSet ts, Rank rank, Arena arena,
                                Seg seg, Ref *refIO);
 
 
+/* Ambiguous area scanning -- see <code/ambig.c> */
+
+extern Res AmbigScanArea(ScanState ss, Word *base, Word *limit,
+                         mps_area_scan_t scan_area, void *closure);
+
+
 /* Arena Interface -- see <code/arena.c> */
 
 DECLARE_CLASS(Inst, ArenaClass, InstClass);
@@ -474,6 +509,9 @@ extern void ArenaDestroy(Arena arena);
 extern Res ArenaDescribe(Arena arena, mps_lib_FILE *stream, Count depth);
 extern Res ArenaDescribeTracts(Arena arena, mps_lib_FILE *stream, Count depth);
 extern Bool ArenaAccess(Addr addr, AccessSet mode, MutatorContext context);
+extern void ArenaAccessMapAdd(Arena arena, Root root, Addr base, Addr limit);
+extern void ArenaAccessMapRemove(Arena arena, Root root,
+                                 Addr base, Addr limit);
 extern Res ArenaFreeLandInsert(Arena arena, Addr base, Addr limit);
 extern Res ArenaFreeLandDelete(Arena arena, Addr base, Addr limit);
 
@@ -498,12 +536,14 @@ extern void GlobalsReinitializeAll(void);
 #define ArenaZoneShift(arena)   ((arena)->zoneShift)
 #define ArenaStripeSize(arena)  ((Size)1 << ArenaZoneShift(arena))
 #define ArenaGrainSize(arena)   ((arena)->grainSize)
-#define ArenaGreyRing(arena, rank) (&(arena)->greyRing[rank])
 #define ArenaPoolRing(arena) (&ArenaGlobals(arena)->poolRing)
 #define ArenaChunkTree(arena) RVALUE((arena)->chunkTree)
 #define ArenaChunkRing(arena)   (&(arena)->chunkRing)
 #define ArenaShield(arena)      (&(arena)->shieldStruct)
 #define ArenaHistory(arena)     (&(arena)->historyStruct)
+#define ArenaCardMarking(arena) RVALUE((arena)->cardMarking)
+#define ArenaCardShift(arena)   RVALUE((arena)->cardShift)
+#define ArenaWB(arena)          (&(arena)->wbStruct)
 
 extern Bool ArenaGrainSizeCheck(Size size);
 #define AddrArenaGrainUp(addr, arena) AddrAlignUp(addr, ArenaGrainSize(arena))
@@ -518,6 +558,7 @@ extern void ArenaLeaveLock(Arena arena, Bool recursive);
 extern void ArenaEnter(Arena arena);
 extern void ArenaLeave(Arena arena);
 extern void (ArenaPoll)(Globals globals);
+extern void ArenaBackgroundStop(Arena arena);
 
 #if defined(SHIELD)
 #elif defined(SHIELD_NONE)
@@ -661,18 +702,24 @@ extern Res SegWholeAccess(Seg seg, Arena arena, Addr addr,
                           AccessSet mode, MutatorContext context);
 extern Res SegSingleAccess(Seg seg, Arena arena, Addr addr,
                            AccessSet mode, MutatorContext context);
+extern Res SegPageAccess(Seg seg, Arena arena, Addr addr,
+                         AccessSet mode, MutatorContext context);
 extern Res SegWhiten(Seg seg, Trace trace);
 extern void SegGreyen(Seg seg, Trace trace);
 extern void SegBlacken(Seg seg, TraceSet traceSet);
 extern Res SegScan(Bool *totalReturn, Seg seg, ScanState ss);
+extern Res SegScanUnlogged(Bool *totalReturn, Seg seg, ScanState ss);
+extern Res SegScanArea(Addr *baseIO, Addr *limitIO, Seg seg, ScanState ss);
 extern Res SegFix(Seg seg, ScanState ss, Addr *refIO);
 extern Res SegFixEmergency(Seg seg, ScanState ss, Addr *refIO);
-extern void SegReclaim(Seg seg, Trace trace);
+extern Bool SegReclaim(Seg seg, Trace trace);
 extern void SegWalk(Seg seg, Format format, FormattedObjectsVisitor f,
                     void *v, size_t s);
 extern Res SegAbsDescribe(Inst seg, mps_lib_FILE *stream, Count depth);
 extern Res SegDescribe(Seg seg, mps_lib_FILE *stream, Count depth);
 extern void SegSetSummary(Seg seg, RefSet summary);
+extern void SegSetFixFast(Seg seg, SegFixFast fixFast, BT marks);
+extern Bool SegIsHot(Seg seg);
 extern Bool SegHasBuffer(Seg seg);
 extern Bool SegBuffer(Buffer *bufferReturn, Seg seg);
 extern void SegSetBuffer(Seg seg, Buffer buffer);
@@ -706,12 +753,15 @@ extern Addr (SegLimit)(Seg seg);
 #define SegGrey(seg)            RVALUE((TraceSet)(seg)->grey)
 #define SegWhite(seg)           RVALUE((TraceSet)(seg)->white)
 #define SegNailed(seg)          RVALUE((TraceSet)(seg)->nailed)
+#define SegFixFast(seg)         RVALUE((SegFixFast)(seg)->fixFast)
 #define SegPoolRing(seg)        (&(seg)->poolRing)
 #define SegOfPoolRing(node)     RING_ELT(Seg, poolRing, (node))
-#define SegOfGreyRing(node)     (&(RING_ELT(GCSeg, greyRing, (node)) \
-                                   ->segStruct))
+#define SegGreyLink(seg, ti)    (&((GCSeg)(seg))->greyLink[ti])
+#define GreyLinkOfRing(node)    RING_ELT(GreyLink, ring, (node))
+#define GreyLinkOfTree(tree)    TREE_ELT(GreyLink, treeStruct, (tree))
 
 #define SegSummary(seg)         (((GCSeg)(seg))->summary)
+#define SegFixMarks(seg)        (((GCSeg)(seg))->fixMarks)
 
 #define SegSetPM(seg, mode)     ((void)((seg)->pm = BS_BITFIELD(Access, (mode))))
 #define SegSetSM(seg, mode)     ((void)((seg)->sm = BS_BITFIELD(Access, (mode))))
@@ -750,6 +800,7 @@ extern Bool BufferCommit(Buffer buffer, Addr p, Size size);
    BufferAP(buffer)->limit != 0 || BufferTrip(buffer, p, size))
 
 extern Bool BufferTrip(Buffer buffer, Addr p, Size size);
+extern void BufferRetract(Buffer buffer, Addr p, Size size);
 extern void BufferFinish(Buffer buffer);
 extern Bool BufferIsReset(Buffer buffer);
 extern Bool BufferIsReady(Buffer buffer);
@@ -814,6 +865,7 @@ extern Bool FormatCheck(Format format);
 extern Res FormatCreate(Format *formatReturn, Arena arena, ArgList args);
 extern void FormatDestroy(Format format);
 extern Arena FormatArena(Format format);
+extern Bool FormatIsMoving(Format format);
 extern Res FormatDescribe(Format format, mps_lib_FILE *stream, Count depth);
 extern mps_res_t FormatNoScan(mps_ss_t mps_ss, mps_addr_t base, mps_addr_t limit);
 
@@ -882,10 +934,14 @@ extern Res ShieldDescribe(Shield shield, mps_lib_FILE *stream, Count depth);
 extern void ShieldDestroyQueue(Shield shield, Arena arena);
 extern void (ShieldRaise)(Arena arena, Seg seg, AccessSet mode);
 extern void (ShieldLower)(Arena arena, Seg seg, AccessSet mode);
+extern void (ShieldLowerRange)(Arena arena, Seg seg, Addr base,
+                               Addr limit, AccessSet mode);
 extern void (ShieldEnter)(Arena arena);
 extern void (ShieldLeave)(Arena arena);
 extern void (ShieldExpose)(Arena arena, Seg seg);
 extern void (ShieldCover)(Arena arena, Seg seg);
+extern Size (ShieldExposeAlias)(Arena arena, Seg seg);
+extern void (ShieldCoverAlias)(Arena arena, Seg seg, Size alias);
 extern void (ShieldHold)(Arena arena);
 extern void (ShieldRelease)(Arena arena);
 extern void (ShieldFlush)(Arena arena);
@@ -897,12 +953,19 @@ extern void (ShieldFlush)(Arena arena);
   BEGIN UNUSED(arena); UNUSED(seg); UNUSED(mode); END
 #define ShieldLower(arena, seg, mode) \
   BEGIN UNUSED(arena); UNUSED(seg); UNUSED(mode); END
+#define ShieldLowerRange(arena, seg, base, limit, mode) \
+  BEGIN UNUSED(arena); UNUSED(seg); UNUSED(base); UNUSED(limit); \
+    UNUSED(mode); END
 #define ShieldEnter(arena) BEGIN UNUSED(arena); END
 #define ShieldLeave(arena) AVER(arena->busyTraces == TraceSetEMPTY)
 #define ShieldExpose(arena, seg)  \
   BEGIN UNUSED(arena); UNUSED(seg); END
 #define ShieldCover(arena, seg) \
   BEGIN UNUSED(arena); UNUSED(seg); END
+#define ShieldExposeAlias(arena, seg) \
+  (UNUSED(arena), UNUSED(seg), (Size)0)
+#define ShieldCoverAlias(arena, seg, alias) \
+  BEGIN UNUSED(arena); UNUSED(seg); UNUSED(alias); END
 #define ShieldHold(arena) BEGIN UNUSED(arena); END
 #define ShieldRelease(arena) BEGIN UNUSED(arena); END
 #define ShieldFlush(arena) BEGIN UNUSED(arena); END
@@ -911,6 +974,25 @@ extern void (ShieldFlush)(Arena arena);
 #endif  /* SHIELD */
 
 
+/* Card Marking -- see <code/card.c> */
+
+/* .card.value: Keep CardDIRTY in sync with MPS_WB in <code/mps.h>. */
+#define CardCLEAN ((Byte)0)
+#define CardDIRTY ((Byte)1)
+
+extern void ArenaCardsInit(Arena arena, Chunk primary);
+extern void ArenaCardMark(Arena arena, Addr addr);
+extern Bool ChunkCardsNextDirtySeg(Seg *segReturn, Index *cardIO,
+                                   Chunk chunk);
+extern Bool SegCardsSummary(RefSet *summaryReturn, Seg seg);
+extern Bool SegCardsClear(Seg seg);
+extern void SegCardsForget(Seg seg, Addr base, Addr limit);
+extern void SegCardsAdd(Seg seg, Addr addr, Ref ref);
+extern void ScanStateCardsInit(ScanState ss, Seg seg, Size headerSize);
+extern Res ScanStateCardsScan(ScanState ss, Addr base, Addr limit);
+extern void ScanStateCardsFinish(ScanState ss, Bool wasTotal);
+
+
 /* Location Dependency -- see <code/ld.c> */
 
 extern void HistoryInit(History history);
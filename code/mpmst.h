@@ -94,6 +94,8 @@ typedef struct mps_pool_s {     /* generic structure */
   Align alignment;              /* alignment for grains */
   Shift alignShift;             /* log2(alignment) */
   Format format;                /* format or NULL */
+  STATISTIC_DECL(Count readFaultCount) /* read faults on segments */
+  STATISTIC_DECL(Count writeFaultCount) /* write faults on segments */
 } PoolStruct;
 
 
@@ -202,6 +204,7 @@ typedef struct SegClassStruct {
   SegGreyenMethod greyen;       /* greyen non-white objects */
   SegBlackenMethod blacken;     /* blacken grey objects without scanning */
   SegScanMethod scan;           /* find references during tracing */
+  SegScanAreaMethod scanArea;   /* scan objects overlapping an area */
   SegFixMethod fix;             /* referent reachable during tracing */
   SegFixMethod fixEmergency;    /* as fix, no failure allowed */
   SegReclaimMethod reclaim;     /* reclaim dead objects after tracing */
@@ -223,15 +226,19 @@ typedef struct SegStruct {      /* segment structure */
   Tract firstTract;             /* first tract of segment */
   RingStruct poolRing;          /* link in list of segs in pool */
   Addr limit;                   /* limit of segment */
+  Serial accessSerial;          /* arena->flipSerial of accessCount */
+  unsigned accessCount : SEG_ACCESS_BITS; /* <design/write-barrier#.hot> */
   unsigned depth : ShieldDepthWIDTH; /* see <design/shield#.def.depth> */
   BOOLFIELD(queued);            /* in shield queue? */
   AccessSet pm : AccessLIMIT;   /* protection mode, <code/shield.c> */
   AccessSet sm : AccessLIMIT;   /* shield mode, <code/shield.c> */
+  AccessSet lowered : AccessLIMIT; /* modes lowered on some pages */
   TraceSet grey : TraceLIMIT;   /* traces for which seg is grey */
   TraceSet white : TraceLIMIT;  /* traces for which seg is white */
   TraceSet nailed : TraceLIMIT; /* traces for which seg has nailed objects */
   RankSet rankSet : RankLIMIT;  /* ranks of references in this seg */
   unsigned defer : WB_DEFER_BITS; /* defer write barrier for this many scans */
+  SegFixFast fixFast : SegFixFastWIDTH; /* <design/trace#.fix.fast> */
 } SegStruct;
 
 
@@ -242,12 +249,20 @@ typedef struct SegStruct {      /* segment structure */
 
 #define GCSegSig      ((Sig)0x5199C5E9) /* SIGnature GC SEG  */
 
+typedef struct GreyLinkStruct { /* link in a trace's grey queue */
+  RingStruct ring;              /* link in trace->greyRing[rank] */
+  TreeStruct treeStruct;        /* node in trace->greyTree[rank] */
+  Seg seg;                      /* segment containing this link */
+  Rank rank;                    /* rank of queue, if grey for trace */
+} GreyLinkStruct;
+
 typedef struct GCSegStruct {    /* GC segment structure */
   SegStruct segStruct;          /* superclass fields must come first */
-  RingStruct greyRing;          /* link in list of grey segs */
+  GreyLinkStruct greyLink[TraceLIMIT]; /* <design/trace#.grey.queue> */
   RefSet summary;               /* summary of references out of seg */
   Buffer buffer;                /* non-NULL if seg is buffered */
   RingStruct genRing;           /* link in list of segs in gen */
+  BT fixMarks;                  /* <design/trace#.fix.fast>, or NULL */
   Sig sig;                      /* design.mps.sig.field.end.outer */
 } GCSegStruct;
 
@@ -368,6 +383,30 @@ typedef struct mps_fmt_s {
 } FormatStruct;
 
 
+/* ScanStateSegCacheStruct -- segment lookup cache entry
+ *
+ * See <design/trace#.fix.cache>.  An empty entry has base == limit.
+ */
+
+typedef struct ScanStateSegCacheStruct {
+  Addr base;                    /* base of segment */
+  Addr limit;                   /* limit of segment */
+  Seg seg;                      /* the segment */
+  Bool white;                   /* white for any of the scan state's traces? */
+} ScanStateSegCacheStruct;
+
+
+/* TraceSnapCacheStruct -- snap-out cache entry
+ *
+ * See <design/trace#.fix.snap>.  An empty entry has from == 0.
+ */
+
+typedef struct TraceSnapCacheStruct {
+  Ref from;                     /* reference to a forwarded object */
+  Ref to;                       /* where it was forwarded to */
+} TraceSnapCacheStruct;
+
+
 /* ScanState
  *
  * .ss: See <code/trace.c>.
@@ -413,12 +452,32 @@ typedef struct ScanStateStruct {
   STATISTIC_DECL(Count fixRefCount) /* refs which pass zone check */
   STATISTIC_DECL(Count segRefCount) /* refs which refer to segs */
   STATISTIC_DECL(Count whiteSegRefCount) /* refs which refer to white segs */
+  STATISTIC_DECL(Count segCacheHitCount) /* seg refs found in segCache */
   STATISTIC_DECL(Count nailCount) /* segments nailed by ambig refs */
   STATISTIC_DECL(Count snapCount) /* refs snapped to forwarded objs */
+  STATISTIC_DECL(Count snapCacheHitCount) /* ... found in snapCache */
   STATISTIC_DECL(Count forwardedCount) /* objects preserved by moving */
   STATISTIC_DECL(Count preservedInPlaceCount) /* objects preserved in place */
   STATISTIC_DECL(Size copiedSize) /* bytes copied */
+  STATISTIC_DECL(Count ambigWordCount) /* ambiguous words scanned */
+  STATISTIC_DECL(Count ambigRangeCount) /* ... in a chunk range */
+  STATISTIC_DECL(Count ambigZoneCount) /* ... and in a white zone */
   Size scannedSize;             /* bytes scanned */
+  Seg cardSeg;                  /* seg scanned card by card, or NULL */
+  RefSet *cardSummary;          /* card summaries of cardSeg */
+  Count cardCount;              /* number of cards in cardSeg */
+  Size cardHeaderSize;          /* format header size of cardSeg's pool */
+  Index cardFirst;              /* lowest card rebuilt by this scan */
+  Index cardNext;               /* cards below this rebuilt by this scan */
+  RefSet cardLast;              /* old summary of card cardNext - 1 */
+  STATISTIC_DECL(Count cardSkipCount) /* areas skipped by card summaries */
+  STATISTIC_DECL(Size cardSkipSize) /* bytes skipped by card summaries */
+  Lock fixLock;                 /* <design/trace#.parallel.fix>, or NULL */
+  Index worker;                 /* <design/trace#.parallel.forward> */
+  Serial segCacheSerial;        /* arena->segCacheSerial when cache valid */
+  Index segCacheNext;           /* next cache entry to replace */
+  ScanStateSegCacheStruct segCache[ScanStateSegCacheSIZE];
+  TraceSnapCache snapCache;     /* <design/trace#.fix.snap>, or NULL */
 } ScanStateStruct;
 
 
@@ -439,27 +498,40 @@ typedef struct TraceStruct {
   SegFixMethod fix;             /* fix method to apply to references */
   void *fixClosure;             /* see .ss.fix-closure */
   RingStruct genRing;           /* ring of generations condemned for trace */
+  Ring reclaimGen;              /* generation being reclaimed, or NULL */
+  RingStruct reclaimCursor;     /* position of reclaim in its segRing */
+  Size reclaimWork;             /* total size of reclaimed segments */
   STATISTIC_DECL(Size preTraceArenaReserved) /* ArenaReserved before this trace */
   Size condemned;               /* condemned bytes */
   Size notCondemned;            /* collectable but not condemned */
   Size foundation;              /* initial grey set size */
   Work quantumWork;             /* tracing work to be done in each poll */
+  Size reclaimQuantum;          /* size of segments to reclaim each poll */
   STATISTIC_DECL(Count greySegCount) /* number of grey segments */
   STATISTIC_DECL(Count greySegMax) /* maximum number of grey segments */
+  GreyOrder greyOrder;          /* order of grey queues */
+  RingStruct greyRing[RankLIMIT]; /* LIFO grey queues for each rank */
+  SplayTreeStruct greyTree[RankLIMIT]; /* address-ordered grey queues */
+  STATISTIC_DECL(Count greyFindCount) /* number of calls to traceFindGrey */
+  STATISTIC_DECL(Clock greyFindClock) /* time spent in traceFindGrey */
   STATISTIC_DECL(Count rootScanCount) /* number of roots scanned */
   Count rootScanSize;           /* total size of scanned roots */
   STATISTIC_DECL(Size rootCopiedSize) /* bytes copied by scanning roots */
   STATISTIC_DECL(Count segScanCount) /* number of segments scanned */
   Count segScanSize;            /* total size of scanned segments */
   STATISTIC_DECL(Size segCopiedSize) /* bytes copied by scanning segments */
+  STATISTIC_DECL(Count cardSkipCount) /* areas skipped by card summaries */
+  STATISTIC_DECL(Size cardSkipSize) /* bytes skipped by card summaries */
   STATISTIC_DECL(Count singleScanCount) /* number of single refs scanned */
   STATISTIC_DECL(Count singleScanSize) /* total size of single refs scanned */
   STATISTIC_DECL(Size singleCopiedSize) /* bytes copied by scanning single refs */
   STATISTIC_DECL(Count fixRefCount) /* refs which pass zone check */
   STATISTIC_DECL(Count segRefCount) /* refs which refer to segments */
   STATISTIC_DECL(Count whiteSegRefCount) /* refs which refer to white segs */
+  STATISTIC_DECL(Count segCacheHitCount) /* seg refs found in segCache */
   STATISTIC_DECL(Count nailCount) /* segments nailed by ambiguous refs */
   STATISTIC_DECL(Count snapCount) /* refs snapped to forwarded objects */
+  STATISTIC_DECL(Count snapCacheHitCount) /* ... found in snapCache */
   STATISTIC_DECL(Count readBarrierHitCount) /* read barrier faults */
   STATISTIC_DECL(Count pointlessScanCount) /* pointless segment scans */
   STATISTIC_DECL(Count forwardedCount) /* objects preserved by moving */
@@ -468,6 +540,9 @@ typedef struct TraceStruct {
   Size preservedInPlaceSize;    /* bytes preserved in place */
   STATISTIC_DECL(Count reclaimCount) /* segments reclaimed */
   STATISTIC_DECL(Count reclaimSize) /* bytes reclaimed */
+  STATISTIC_DECL(Count promoteCount) /* segments promoted in place */
+  STATISTIC_DECL(Size promoteSize) /* bytes promoted in place */
+  TraceSnapCacheStruct snapCache[TraceSnapCacheSIZE]; /* <design/trace#.fix.snap> */
 } TraceStruct;
 
 
@@ -680,6 +755,8 @@ typedef struct ShieldStruct {
   Count unsynced;    /* number of unsynced segments */
   Count holds;       /* number of holds */
   SortStruct sortStruct; /* workspace for queue sort */
+  STATISTIC_DECL(Count protCount) /* calls to ProtSet */
+  STATISTIC_DECL(Count aliasCount) /* exposes through the alias */
 } ShieldStruct;
 
 
@@ -727,6 +804,32 @@ typedef struct MVFFStruct {     /* MVFF pool outer structure */
 } MVFFStruct;
 
 
+/* ChunkMapEntryStruct -- entry in the arena's chunk map
+ *
+ * See <design/arena#.chunk.map>.  If one chunk overlaps the entry's
+ * address range, it is lo and hi is NULL.  If two chunks overlap it,
+ * lo is the lower and hi the higher.
+ */
+
+typedef struct ChunkMapEntryStruct {
+  Chunk lo;                     /* lower chunk overlapping entry, or NULL */
+  Chunk hi;                     /* higher chunk overlapping entry, or NULL */
+  Bool ambiguous;               /* more than two chunks overlap entry? */
+} ChunkMapEntryStruct;
+
+
+/* ChunkRangeStruct -- entry in the arena's table of chunk ranges
+ *
+ * See <design/arena#.chunk.range>.  The union of the ranges in the
+ * table includes every chunk in the arena.
+ */
+
+typedef struct ChunkRangeStruct {
+  Addr base;                    /* base of lowest chunk in range */
+  Addr limit;                   /* limit of highest chunk in range */
+} ChunkRangeStruct;
+
+
 /* ArenaStruct -- generic arena
  *
  * See <code/arena.c>.
@@ -760,6 +863,12 @@ typedef struct mps_arena_s {
   Chunk primary;                /* the primary chunk */
   RingStruct chunkRing;         /* all the chunks, in a ring for iteration */
   Tree chunkTree;               /* all the chunks, in a tree for fast lookup */
+  Addr chunkMapBase;            /* <design/arena#.chunk.map> */
+  Shift chunkMapShift;          /* log2 of address space per map entry */
+  Count chunkMapCount;          /* number of map entries in use */
+  ChunkMapEntryStruct chunkMap[ChunkMapSIZE]; /* map from address to chunk */
+  Count chunkRangeCount;        /* <design/arena#.chunk.range> */
+  ChunkRangeStruct chunkRange[ChunkRangeSIZE]; /* sorted chunk ranges */
   Serial chunkSerial;           /* next chunk number */
 
   Bool hasFreeLand;              /* Is freeLand available? */
@@ -768,6 +877,11 @@ typedef struct mps_arena_s {
   ZoneSet freeZones;            /* zones not yet allocated */
   Bool zoned;                   /* use zoned allocation? */
 
+  /* card marking fields <code/card.c> */
+  Bool cardMarking;             /* <design/write-barrier#.card> */
+  Shift cardShift;              /* log2 of card size */
+  mps_wb_s wbStruct;            /* <design/write-barrier#.card.mark> */
+
   /* locus fields <code/locus.c> */
   GenDescStruct topGen;         /* generation descriptor for dynamic gen */
   Serial genSerial;             /* serial of next generation */
@@ -797,6 +911,19 @@ typedef struct mps_arena_s {
   TraceSet flippedTraces;       /* set of running and flipped traces */
   TraceStruct trace[TraceLIMIT]; /* trace structures.  See
                                    <design/trace#.instance.limit> */
+  Count traceWorkers;           /* <design/trace#.parallel.workers> */
+  GreyOrder greyOrder;          /* <design/trace#.grey.order> */
+  TraceWork traceWork;          /* parallel scanning state, or NULL */
+  Bool collectorThread;         /* <design/arena#.poll.background> */
+  Background background;        /* collector thread, or NULL */
+  Serial segCacheSerial;        /* <design/trace#.fix.cache.invalid> */
+  Serial flipSerial;            /* number of flips <design/write-barrier#.hot> */
+  Count hotGreyCount;           /* entries in hotGrey */
+  Addr hotGrey[ArenaHotGreyLENGTH]; /* <design/write-barrier#.hot.read> */
+  STATISTIC_DECL(Count hotSegCount) /* segments found to be hot */
+  STATISTIC_DECL(Count hotScanCount) /* eager scans of hot segments */
+  STATISTIC_DECL(Count hotRaiseCount) /* write barriers left lowered */
+  STATISTIC_DECL(Count pageScanCount) /* read barrier hits scanned by page */
 
   /* trace ancillary fields <code/traceanc.c> */
   TraceStartMessage tsMessage[TraceLIMIT];  /* <design/message-gc> */
@@ -807,7 +934,6 @@ typedef struct mps_arena_s {
   double tracedTime;
   Clock lastWorldCollect;
 
-  RingStruct greyRing[RankLIMIT]; /* ring of grey segments at each rank */
   RingStruct chainRing;         /* ring of chains */
 
   struct HistoryStruct historyStruct;
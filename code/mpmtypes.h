@@ -61,6 +61,8 @@ typedef unsigned TraceId;               /* <design/type#.traceid> */
 typedef unsigned TraceSet;              /* <design/type#.traceset> */
 typedef unsigned TraceState;            /* <design/type#.tracestate> */
 typedef unsigned TraceStartWhy;         /* <design/type#.tracestartwhy> */
+typedef unsigned GreyOrder;             /* <design/trace#.grey.order> */
+typedef unsigned SegFixFast;            /* <design/trace#.fix.fast> */
 typedef unsigned AccessSet;             /* <design/type#.access-set> */
 typedef unsigned Attr;                  /* <design/type#.attr> */
 typedef unsigned RootVar;               /* <design/type#.rootvar> */
@@ -73,11 +75,15 @@ typedef struct BufferClassStruct *BufferClass; /* <design/buffer> */
 typedef unsigned BufferMode;            /* <design/buffer> */
 typedef struct mps_fmt_s *Format;       /* <design/format> */
 typedef struct LockStruct *Lock;        /* <code/lock.c>* */
+typedef struct WorkersStruct *Workers;  /* <code/wk.h> */
+typedef struct BackgroundStruct *Background; /* <code/bg.h> */
 typedef struct mps_pool_s *Pool;        /* <design/pool> */
 typedef Pool AbstractPool;
 typedef struct mps_pool_class_s *PoolClass;  /* <code/poolclas.c> */
 typedef struct TraceStruct *Trace;      /* <design/trace> */
 typedef struct ScanStateStruct *ScanState; /* <design/trace> */
+typedef struct TraceSnapCacheStruct *TraceSnapCache; /* <design/trace#.fix.snap> */
+typedef struct TraceWorkStruct *TraceWork; /* <design/trace#.parallel> */
 typedef struct mps_chain_s *Chain;      /* <design/trace> */
 typedef struct TractStruct *Tract;      /* <design/arena> */
 typedef struct ChunkStruct *Chunk;      /* <code/tract.c> */
@@ -85,6 +91,7 @@ typedef struct ChunkCacheEntryStruct *ChunkCacheEntry; /* <code/tract.c> */
 typedef union PageUnion *Page;          /* <code/tract.c> */
 typedef struct SegStruct *Seg;          /* <code/seg.c> */
 typedef struct GCSegStruct *GCSeg;      /* <code/seg.c> */
+typedef struct GreyLinkStruct *GreyLink; /* <design/trace#.grey.queue> */
 typedef struct SegClassStruct *SegClass; /* <code/seg.c> */
 typedef struct LocusPrefStruct *LocusPref; /* <design/locus>, <code/locus.c> */
 typedef unsigned LocusPrefKind;         /* <design/locus>, <code/locus.c> */
@@ -140,6 +147,16 @@ typedef void (*ArenaVMContractedCallback)(Arena arena, Addr base, Size size);
 typedef Res (*TraceFixMethod)(ScanState ss, Ref *refIO);
 
 
+/* WorkersMethod -- see <code/wk.h> */
+
+typedef void (*WorkersMethod)(void *closure, Index worker);
+
+
+/* BackgroundMethod -- see <code/bg.h> */
+
+typedef void (*BackgroundMethod)(void *closure);
+
+
 /* Heap Walker */
 
 /* This type is used by the PoolClass method Walk */
@@ -177,8 +194,10 @@ typedef Res (*SegWhitenMethod)(Seg seg, Trace trace);
 typedef void (*SegGreyenMethod)(Seg seg, Trace trace);
 typedef void (*SegBlackenMethod)(Seg seg, TraceSet traceSet);
 typedef Res (*SegScanMethod)(Bool *totalReturn, Seg seg, ScanState ss);
+typedef Res (*SegScanAreaMethod)(Addr *baseIO, Addr *limitIO,
+                                 Seg seg, ScanState ss);
 typedef Res (*SegFixMethod)(Seg seg, ScanState ss, Ref *refIO);
-typedef void (*SegReclaimMethod)(Seg seg, Trace trace);
+typedef Bool (*SegReclaimMethod)(Seg seg, Trace trace);
 typedef void (*SegWalkMethod)(Seg seg, Format format, FormattedObjectsVisitor f,
                               void *v, size_t s);
 
@@ -282,7 +301,8 @@ typedef Res (*LandFindInZonesMethod)(Bool *foundReturn, Range rangeReturn, Range
 #define RankSetUNIV     ((RankSet)((1u << RankLIMIT) - 1))
 #define AttrGC          ((Attr)(1<<0))
 #define AttrMOVINGGC    ((Attr)(1<<1))
-#define AttrMASK        (AttrGC | AttrMOVINGGC)
+#define AttrPARSCAN     ((Attr)(1<<2))
+#define AttrMASK        (AttrGC | AttrMOVINGGC | AttrPARSCAN)
 
 
 /* Locus preferences */
@@ -358,6 +378,34 @@ enum {
 };
 
 
+/* GreyOrder -- order in which grey segments are scanned
+ *
+ * These must match MPS_GREY_ORDER_* in <code/mps.h>.  See
+ * <design/trace#.grey.order>.
+ */
+
+enum {
+  GreyOrderLIFO,                /* most recently greyed first */
+  GreyOrderADDRESS,             /* lowest address first */
+  GreyOrderLIMIT
+};
+
+
+/* SegFixFast -- how _mps_fix2 may fix a reference to a segment
+ *
+ * See <design/trace#.fix.fast>.
+ */
+
+enum {
+  SegFixFastNONE,               /* always call the fix method */
+  SegFixFastMARK,               /* preserved if set in SegFixMarks */
+  SegFixFastSNAP,               /* look in the trace's snap-out cache */
+  SegFixFastLIMIT
+};
+
+#define SegFixFastWIDTH 2       /* bits to hold SegFixFast in a bitfield */
+
+
 /* TraceStart reasons: the trigger that caused a trace to start. */
 /* Make these specific trigger names, not broad categories; */
 /* and if a new trigger is added, add a new reason. */
@@ -45,6 +45,7 @@
 #include "trace.c"
 #include "traceanc.c"
 #include "scan.c"
+#include "ambig.c"
 #include "root.c"
 #include "seg.c"
 #include "format.c"
@@ -53,6 +54,7 @@
 #include "bt.c"
 #include "ring.c"
 #include "shield.c"
+#include "card.c"
 #include "ld.c"
 #include "event.c"
 #include "sac.c"
@@ -86,6 +88,7 @@
 
 #include "poolamc.c"
 #include "poolams.c"
+#include "poolamr.c"
 #include "poolawl.c"
 #include "poollo.c"
 #include "poolsnc.c"
@@ -104,6 +107,8 @@
 #if defined(PLATFORM_ANSI)
 
 #include "lockan.c"     /* generic locks */
+#include "wkan.c"       /* generic worker threads */
+#include "bgan.c"       /* generic background thread */
 #include "than.c"       /* generic threads manager */
 #include "vman.c"       /* malloc-based pseudo memory mapping */
 #include "protan.c"     /* generic memory protection */
@@ -116,6 +121,8 @@
 #elif defined(MPS_PF_XCA6LL)
 
 #include "lockix.c"     /* Posix locks */
+#include "wkix.c"       /* Posix worker threads */
+#include "bgix.c"       /* Posix background thread */
 #include "thxc.c"       /* macOS Mach threading */
 #include "vmix.c"       /* Posix virtual memory */
 #include "protix.c"     /* Posix protection */
@@ -130,6 +137,8 @@
 #elif defined(MPS_PF_XCI3LL) || defined(MPS_PF_XCI3GC)
 
 #include "lockix.c"     /* Posix locks */
+#include "wkix.c"       /* Posix worker threads */
+#include "bgix.c"       /* Posix background thread */
 #include "thxc.c"       /* macOS Mach threading */
 #include "vmix.c"       /* Posix virtual memory */
 #include "protix.c"     /* Posix protection */
@@ -144,6 +153,8 @@
 #elif defined(MPS_PF_XCI6LL) || defined(MPS_PF_XCI6GC)
 
 #include "lockix.c"     /* Posix locks */
+#include "wkix.c"       /* Posix worker threads */
+#include "bgix.c"       /* Posix background thread */
 #include "thxc.c"       /* macOS Mach threading */
 #include "vmix.c"       /* Posix virtual memory */
 #include "protix.c"     /* Posix protection */
@@ -158,6 +169,8 @@
 #elif defined(MPS_PF_FRI3GC) || defined(MPS_PF_FRI3LL)
 
 #include "lockix.c"     /* Posix locks */
+#include "wkix.c"       /* Posix worker threads */
+#include "bgix.c"       /* Posix background thread */
 #include "thix.c"       /* Posix threading */
 #include "pthrdext.c"   /* Posix thread extensions */
 #include "vmix.c"       /* Posix virtual memory */
@@ -173,6 +186,8 @@
 #elif defined(MPS_PF_FRI6GC) || defined(MPS_PF_FRI6LL)
 
 #include "lockix.c"     /* Posix locks */
+#include "wkix.c"       /* Posix worker threads */
+#include "bgix.c"       /* Posix background thread */
 #include "thix.c"       /* Posix threading */
 #include "pthrdext.c"   /* Posix thread extensions */
 #include "vmix.c"       /* Posix virtual memory */
@@ -188,11 +203,14 @@
 #elif defined(MPS_PF_LIA6GC) || defined(MPS_PF_LIA6LL)
 
 #include "lockix.c"     /* Posix locks */
+#include "wkix.c"       /* Posix worker threads */
+#include "bgix.c"       /* Posix background thread */
 #include "thix.c"       /* Posix threading */
 #include "pthrdext.c"   /* Posix thread extensions */
 #include "vmix.c"       /* Posix virtual memory */
 #include "protix.c"     /* Posix protection */
 #include "protsgix.c"   /* Posix signal handling */
+#include "protli.c"     /* Linux userfaultfd protection */
 #include "prmcanan.c"   /* generic architecture mutator context */
 #include "prmcix.c"     /* Posix mutator context */
 #include "prmclia6.c"   /* x86-64 for Linux mutator context */
@@ -203,11 +221,14 @@
 #elif defined(MPS_PF_LII3GC)
 
 #include "lockix.c"     /* Posix locks */
+#include "wkix.c"       /* Posix worker threads */
+#include "bgix.c"       /* Posix background thread */
 #include "thix.c"       /* Posix threading */
 #include "pthrdext.c"   /* Posix thread extensions */
 #include "vmix.c"       /* Posix virtual memory */
 #include "protix.c"     /* Posix protection */
 #include "protsgix.c"   /* Posix signal handling */
+#include "protli.c"     /* Linux userfaultfd protection */
 #include "prmci3.c"     /* IA-32 mutator context */
 #include "prmcix.c"     /* Posix mutator context */
 #include "prmclii3.c"   /* IA-32 for Linux mutator context */
@@ -218,11 +239,14 @@
 #elif defined(MPS_PF_LII6GC) || defined(MPS_PF_LII6LL)
 
 #include "lockix.c"     /* Posix locks */
+#include "wkix.c"       /* Posix worker threads */
+#include "bgix.c"       /* Posix background thread */
 #include "thix.c"       /* Posix threading */
 #include "pthrdext.c"   /* Posix thread extensions */
 #include "vmix.c"       /* Posix virtual memory */
 #include "protix.c"     /* Posix protection */
 #include "protsgix.c"   /* Posix signal handling */
+#include "protli.c"     /* Linux userfaultfd protection */
 #include "prmci6.c"     /* x86-64 mutator context */
 #include "prmcix.c"     /* Posix mutator context */
 #include "prmclii6.c"   /* x86-64 for Linux mutator context */
@@ -233,6 +257,8 @@
 #elif defined(MPS_PF_W3I3MV) || defined(MPS_PF_W3I3PC)
 
 #include "lockw3.c"     /* Windows locks */
+#include "wkan.c"       /* generic worker threads */
+#include "bgan.c"       /* generic background thread */
 #include "thw3.c"       /* Windows threading */
 #include "vmw3.c"       /* Windows virtual memory */
 #include "protw3.c"     /* Windows protection */
@@ -247,6 +273,8 @@
 #elif defined(MPS_PF_W3I6MV) || defined(MPS_PF_W3I6PC)
 
 #include "lockw3.c"     /* Windows locks */
+#include "wkan.c"       /* generic worker threads */
+#include "bgan.c"       /* generic background thread */
 #include "thw3.c"       /* Windows threading */
 #include "vmw3.c"       /* Windows virtual memory */
 #include "protw3.c"     /* Windows protection */
@@ -54,8 +54,11 @@ typedef struct mps_root_s   *mps_root_t;   /* root */
 typedef struct mps_pool_class_s  *mps_pool_class_t;  /* pool class */
 typedef mps_pool_class_t mps_class_t;      /* deprecated alias */
 typedef struct mps_thr_s    *mps_thr_t;    /* thread registration */
+typedef struct mps_safepoint_s
+  *mps_safepoint_t;                        /* thread safepoint */
 typedef struct mps_ap_s     *mps_ap_t;     /* allocation point */
 typedef struct mps_ld_s     *mps_ld_t;     /* location dependency */
+typedef struct mps_wb_s     *mps_wb_t;     /* write barrier */
 typedef struct mps_ss_s     *mps_ss_t;     /* scan state */
 typedef struct mps_message_s
   *mps_message_t;                          /* message */
@@ -120,6 +123,7 @@ typedef mps_addr_t (*mps_fmt_isfwd_t)(mps_addr_t);
 typedef mps_bool_t (*mps_fmt_ispinned_t)(mps_addr_t);
 typedef void (*mps_fmt_pad_t)(mps_addr_t, size_t);
 typedef mps_addr_t (*mps_fmt_class_t)(mps_addr_t);
+typedef void *(*mps_native_fn_t)(void *);
 
 /* Callbacks indicating that the arena has extended or contracted.
  * These are used to register chunks with RtlInstallFunctionTableCallback
@@ -180,6 +184,9 @@ extern const struct mps_key_s _mps_key_ARENA_SIZE;
 extern const struct mps_key_s _mps_key_ARENA_ZONED;
 #define MPS_KEY_ARENA_ZONED     (&_mps_key_ARENA_ZONED)
 #define MPS_KEY_ARENA_ZONED_FIELD b
+extern const struct mps_key_s _mps_key_ARENA_CARD_MARKING;
+#define MPS_KEY_ARENA_CARD_MARKING (&_mps_key_ARENA_CARD_MARKING)
+#define MPS_KEY_ARENA_CARD_MARKING_FIELD b
 extern const struct mps_key_s _mps_key_arena_extended;
 #define MPS_KEY_ARENA_EXTENDED (&_mps_key_arena_extended)
 #define MPS_KEY_ARENA_EXTENDED_FIELD fun
@@ -207,6 +214,15 @@ extern const struct mps_key_s _mps_key_SPARE_COMMIT_LIMIT;
 extern const struct mps_key_s _mps_key_PAUSE_TIME;
 #define MPS_KEY_PAUSE_TIME      (&_mps_key_PAUSE_TIME)
 #define MPS_KEY_PAUSE_TIME_FIELD d
+extern const struct mps_key_s _mps_key_TRACE_WORKERS;
+#define MPS_KEY_TRACE_WORKERS   (&_mps_key_TRACE_WORKERS)
+#define MPS_KEY_TRACE_WORKERS_FIELD count
+extern const struct mps_key_s _mps_key_TRACE_GREY_ORDER;
+#define MPS_KEY_TRACE_GREY_ORDER (&_mps_key_TRACE_GREY_ORDER)
+#define MPS_KEY_TRACE_GREY_ORDER_FIELD u
+extern const struct mps_key_s _mps_key_COLLECTOR_THREAD;
+#define MPS_KEY_COLLECTOR_THREAD (&_mps_key_COLLECTOR_THREAD)
+#define MPS_KEY_COLLECTOR_THREAD_FIELD b
 
 extern const struct mps_key_s _mps_key_EXTEND_BY;
 #define MPS_KEY_EXTEND_BY       (&_mps_key_EXTEND_BY)
@@ -236,6 +252,12 @@ extern const struct mps_key_s _mps_key_INTERIOR;
 extern const struct mps_key_s _mps_key_VMW3_TOP_DOWN;
 #define MPS_KEY_VMW3_TOP_DOWN   (&_mps_key_VMW3_TOP_DOWN)
 #define MPS_KEY_VMW3_TOP_DOWN_FIELD b
+extern const struct mps_key_s _mps_key_VMIX_ALIAS;
+#define MPS_KEY_VMIX_ALIAS      (&_mps_key_VMIX_ALIAS)
+#define MPS_KEY_VMIX_ALIAS_FIELD b
+extern const struct mps_key_s _mps_key_VMIX_UFFD;
+#define MPS_KEY_VMIX_UFFD       (&_mps_key_VMIX_UFFD)
+#define MPS_KEY_VMIX_UFFD_FIELD b
 
 extern const struct mps_key_s _mps_key_FMT_ALIGN;
 #define MPS_KEY_FMT_ALIGN   (&_mps_key_FMT_ALIGN)
@@ -336,6 +358,13 @@ extern mps_rank_t mps_rank_weak(void);
 #define MPS_RM_PROT_INNER (((mps_rm_t)1<<1))
 
 
+/* Grey Orders */
+/* Keep in sync with GreyOrder in <code/mpmtypes.h> */
+
+#define MPS_GREY_ORDER_LIFO    0
+#define MPS_GREY_ORDER_ADDRESS 1
+
+
 /* Allocation Point */
 
 typedef struct mps_ap_s {       /* allocation point descriptor */
@@ -345,6 +374,14 @@ typedef struct mps_ap_s {       /* allocation point descriptor */
 } mps_ap_s;
 
 
+/* Thread Safepoint */
+/* .safepoint: Keep in sync with <code/thix.c#coop.poll>. */
+
+typedef struct mps_safepoint_s { /* thread safepoint descriptor */
+  volatile mps_word_t _stop;     /* non-zero if the thread must park */
+} mps_safepoint_s;
+
+
 /* Segregated-fit Allocation Caches */
 /* .sac: Keep in sync with <code/sac.h>. */
 
@@ -383,6 +420,18 @@ typedef struct mps_ld_s {       /* location dependency descriptor */
 } mps_ld_s;
 
 
+/* Write Barrier */
+/* .wb: Keep in sync with <code/card.c#wb>. */
+
+typedef struct mps_wb_s {       /* write barrier descriptor */
+  mps_arena_t _arena;           /* arena the descriptor belongs to */
+  mps_word_t _base;             /* base of memory covered by _cards */
+  mps_word_t _count;            /* number of cards, or zero */
+  mps_word_t _shift;            /* log2 of card size */
+  unsigned char volatile *_cards; /* card table */
+} mps_wb_s;
+
+
 /* Scan State */
 /* .ss: See also <code/mpmst.h#ss>. */
 
@@ -668,6 +717,41 @@ extern void mps_sac_empty(mps_sac_t, mps_addr_t, size_t);
    (_mps_ap)->limit != 0 || mps_ap_trip(_mps_ap, _p, _size))
 
 
+/* Safepoint Macro */
+/* .safepoint.poll: Keep in sync with <code/thix.c#coop.poll>. */
+
+#define mps_safepoint(_mps_sp) \
+  ((_mps_sp)->_stop ? (mps_safepoint)(_mps_sp) : (void)0)
+
+
+/* Write Barrier Macro */
+/* .wb.mark: Keep in sync with <code/mpsi.c#wb.mark>. */
+
+#define MPS_WB(_mps_wb, _mps_addr) \
+  MPS_BEGIN \
+    mps_word_t _mps_i = ((mps_word_t)(_mps_addr) - (_mps_wb)->_base) \
+                        >> (_mps_wb)->_shift; \
+    if (_mps_i < (_mps_wb)->_count) \
+      (_mps_wb)->_cards[_mps_i] = 1; \
+    else \
+      mps_write_barrier((_mps_wb)->_arena, _mps_addr); \
+  MPS_END
+
+/* .wb.store: The card is marked before and after the store, so that a
+ * collection that starts between the store and a mark can't miss it.
+ * The store is volatile so that the compiler keeps it between the
+ * marks.  See <design/write-barrier#.card.race>. */
+
+#define MPS_WB_STORE(_mps_wb, _mps_slot, _mps_ref) \
+  MPS_BEGIN \
+    mps_addr_t *_mps_s = (_mps_slot); \
+    mps_addr_t volatile *_mps_v = _mps_s; \
+    MPS_WB(_mps_wb, _mps_s); \
+    *_mps_v = (_mps_ref); \
+    MPS_WB(_mps_wb, _mps_s); \
+  MPS_END
+
+
 /* Root Creation and Destruction */
 
 extern mps_res_t mps_root_create(mps_root_t *, mps_arena_t, mps_rank_t,
@@ -717,7 +801,11 @@ extern mps_res_t mps_stack_scan_ambig(mps_ss_t, mps_thr_t,
 /* Thread Registration */
 
 extern mps_res_t mps_thread_reg(mps_thr_t *, mps_arena_t);
+extern mps_res_t mps_thread_reg_cooperative(mps_thr_t *, mps_arena_t);
 extern void mps_thread_dereg(mps_thr_t);
+extern mps_safepoint_t mps_thread_safepoint(mps_thr_t);
+extern void (mps_safepoint)(mps_safepoint_t);
+extern void *mps_thread_native(mps_thr_t, mps_native_fn_t, void *);
 
 
 /* Location Dependency */
@@ -728,6 +816,12 @@ extern void mps_ld_merge(mps_ld_t, mps_arena_t, mps_ld_t);
 extern mps_bool_t mps_ld_isstale(mps_ld_t, mps_arena_t, mps_addr_t);
 extern mps_bool_t mps_ld_isstale_any(mps_ld_t, mps_arena_t);
 
+
+/* Write Barrier */
+
+extern mps_wb_t mps_arena_write_barrier(mps_arena_t);
+extern void mps_write_barrier(mps_arena_t, mps_addr_t);
+
 extern mps_word_t mps_collections(mps_arena_t);
 
 
@@ -102,6 +102,10 @@ static Bool mpsi_check(void)
   /* out to external. */
   CHECKL(COMPATTYPE(mps_clock_t, Clock));
 
+  /* Grey orders are passed in keyword arguments as unsigned. */
+  CHECKL(MPS_GREY_ORDER_LIFO == GreyOrderLIFO);
+  CHECKL(MPS_GREY_ORDER_ADDRESS == GreyOrderADDRESS);
+
   return TRUE;
 }
 
@@ -386,6 +390,7 @@ mps_res_t mps_arena_create_k(mps_arena_t *mps_arena_o,
 
 void mps_arena_destroy(mps_arena_t arena)
 {
+  ArenaBackgroundStop(arena);
   ArenaEnter(arena);
   ArenaDestroy(arena);
 }
@@ -1623,7 +1628,27 @@ mps_res_t mps_thread_reg(mps_thr_t *mps_thr_o, mps_arena_t arena)
   AVER(mps_thr_o != NULL);
   AVERT(Arena, arena);
 
-  res = ThreadRegister(&thread, arena);
+  res = ThreadRegister(&thread, arena, FALSE);
+
+  ArenaLeave(arena);
+
+  if (res != ResOK)
+    return (mps_res_t)res;
+  *mps_thr_o = (mps_thr_t)thread;
+  return MPS_RES_OK;
+}
+
+mps_res_t mps_thread_reg_cooperative(mps_thr_t *mps_thr_o, mps_arena_t arena)
+{
+  Thread thread;
+  Res res;
+
+  ArenaEnter(arena);
+
+  AVER(mps_thr_o != NULL);
+  AVERT(Arena, arena);
+
+  res = ThreadRegister(&thread, arena, TRUE);
 
   ArenaLeave(arena);
 
@@ -1647,6 +1672,35 @@ void mps_thread_dereg(mps_thr_t thread)
   ArenaLeave(arena);
 }
 
+
+/* mps_thread_safepoint, mps_safepoint, mps_thread_native -- cooperative
+ * threads
+ *
+ * These don't enter the arena: a thread parks at its safepoint while
+ * another thread holds the arena lock.
+ * <design/thread-manager#.coop>.
+ */
+
+mps_safepoint_t mps_thread_safepoint(mps_thr_t thread)
+{
+  AVER(ThreadCheckSimple(thread));
+  return ThreadSafepoint(thread);
+}
+
+void (mps_safepoint)(mps_safepoint_t safepoint)
+{
+  AVER(safepoint != NULL);
+  if (safepoint->_stop)
+    ThreadPark(safepoint);
+}
+
+void *mps_thread_native(mps_thr_t thread, mps_native_fn_t fn, void *p)
+{
+  AVER(ThreadCheckSimple(thread));
+  AVER(FUNCHECK(fn));
+  return ThreadNative(thread, fn, p);
+}
+
 void mps_ld_reset(mps_ld_t ld, mps_arena_t arena)
 {
   ArenaEnter(arena);
@@ -1705,6 +1759,38 @@ mps_word_t mps_collections(mps_arena_t arena)
 }
 
 
+/* mps_arena_write_barrier, mps_write_barrier -- card marking
+ *
+ * These don't claim the arena lock unless the address is outside the
+ * memory covered by the descriptor.  <design/write-barrier#.card.mark>.
+ */
+
+mps_wb_t mps_arena_write_barrier(mps_arena_t arena)
+{
+  AVER(TESTT(Arena, arena));
+  return ArenaWB(arena);
+}
+
+void mps_write_barrier(mps_arena_t arena, mps_addr_t addr)
+{
+  mps_wb_t wb;
+  Word i;
+
+  AVER(TESTT(Arena, arena));
+
+  /* .wb.mark: Keep in sync with MPS_WB in <code/mps.h#wb.mark>. */
+  wb = ArenaWB(arena);
+  i = ((Word)addr - wb->_base) >> wb->_shift;
+  if (i < wb->_count) {
+    wb->_cards[i] = CardDIRTY;
+  } else if (ArenaCardMarking(arena)) {
+    ArenaEnter(arena);
+    ArenaCardMark(arena, (Addr)addr);
+    ArenaLeave(arena);
+  }
+}
+
+
 /* mps_finalize -- register for finalization */
 
 mps_res_t mps_finalize(mps_arena_t arena, mps_addr_t *refref)
@@ -248,6 +248,69 @@ static Res policyCondemnChain(double *mortalityReturn, Chain chain, Trace trace)
 }
 
 
+/* policyStartNursery -- consider starting a nursery trace
+ *
+ * Called when some traces are running.  Find the chain whose nursery
+ * generation is most over capacity and start a trace that condemns
+ * just that generation (that is, the segments that were allocated
+ * since the running traces condemned it).  A running trace may fix
+ * references to its to-space, which is in older generations, so only
+ * chains with at least two generations are considered, and only
+ * their nursery is condemned.  See <design/trace#.multi.policy>.
+ */
+
+static Bool policyStartNursery(Trace *traceReturn, Arena arena)
+{
+  Ring node, nextNode;
+  double firstTime = 0.0;
+  Chain firstChain = NULL;
+  GenDesc gen;
+  double mortality;
+  Trace trace;
+  Res res;
+
+  AVER(traceReturn != NULL);
+  AVERT(Arena, arena);
+  AVER(arena->busyTraces != TraceSetEMPTY);
+  AVER(arena->busyTraces != TraceSetUNIV);
+
+  RING_FOR(node, &arena->chainRing, nextNode) {
+    Chain chain = RING_ELT(Chain, chainRing, node);
+    double time;
+
+    AVERT(Chain, chain);
+    if (chain->genCount < 2)
+      continue;
+    gen = &chain->gens[0];
+    AVERT(GenDesc, gen);
+    time = (double)gen->capacity - (double)GenDescNewSize(gen);
+    if (time < firstTime) {
+      firstTime = time; firstChain = chain;
+    }
+  }
+  if (firstChain == NULL)
+    return FALSE;
+
+  res = TraceCreate(&trace, arena, TraceStartWhyCHAIN_GEN0CAP);
+  AVER(res == ResOK); /* succeeds because busyTraces isn't TraceSetUNIV */
+  gen = &firstChain->gens[0];
+  TraceCondemnStart(trace);
+  GenDescStartTrace(gen, trace);
+  EVENT5(ChainCondemnAuto, arena, firstChain, trace, 0,
+         firstChain->genCount);
+  res = TraceCondemnEnd(&mortality, trace);
+  if (res != ResOK || TraceIsEmpty(trace)) {
+    TraceDestroyInit(trace);
+    return FALSE;
+  }
+  res = TraceStart(trace, mortality,
+                   (double)trace->condemned * TraceWorkFACTOR);
+  AVER(res == ResOK);
+  *traceReturn = trace;
+  return TRUE;
+}
+
+
 /* PolicyStartTrace -- consider starting a trace
  *
  * If collectWorldAllowed is TRUE, consider starting a collection of
@@ -259,6 +322,9 @@ static Res policyCondemnChain(double *mortalityReturn, Chain chain, Trace trace)
  *
  * If a trace was started, update *traceReturn and return TRUE.
  * Otherwise, leave *traceReturn unchanged and return FALSE.
+ *
+ * If some traces are already running, consider only starting a
+ * collection of a nursery generation: see policyStartNursery.
  */
 
 Bool PolicyStartTrace(Trace *traceReturn, Bool *collectWorldReturn,
@@ -266,7 +332,6 @@ Bool PolicyStartTrace(Trace *traceReturn, Bool *collectWorldReturn,
 {
   Res res;
   Trace trace;
-  double TraceWorkFactor = 0.25;
   /* Fix the mortality of the world to avoid runaway feedback between the
      dynamic criterion and the mortality of the arena's top generation,
      leading to all traces collecting the world. This is a (hopefully)
@@ -276,6 +341,12 @@ Bool PolicyStartTrace(Trace *traceReturn, Bool *collectWorldReturn,
   AVER(traceReturn != NULL);
   AVERT(Arena, arena);
 
+  if (arena->busyTraces != TraceSetEMPTY) {
+    /* Can't collect the world or a whole chain while collecting. */
+    AVER(!collectWorldAllowed);
+    return policyStartNursery(traceReturn, arena);
+  }
+
   if (collectWorldAllowed) {
     Size sFoundation, sCondemned, sSurvivors, sConsTrace;
     double tTracePerScan; /* tTrace/cScan */
@@ -288,10 +359,10 @@ Bool PolicyStartTrace(Trace *traceReturn, Bool *collectWorldReturn,
     sSurvivors = (Size)((double)sCondemned * (1 - TraceWorldMortality));
     tTracePerScan = (double)sFoundation
       + ((double)sSurvivors * (1 + TraceCopyScanRATIO));
-    AVER(TraceWorkFactor >= 0);
-    AVER((double)sSurvivors + tTracePerScan * TraceWorkFactor
+    AVER(TraceWorkFACTOR >= 0);
+    AVER((double)sSurvivors + tTracePerScan * TraceWorkFACTOR
          <= (double)SizeMAX);
-    sConsTrace = (Size)((double)sSurvivors + tTracePerScan * TraceWorkFactor);
+    sConsTrace = (Size)((double)sSurvivors + tTracePerScan * TraceWorkFACTOR);
     dynamicDeferral = (double)ArenaAvail(arena) - (double)sConsTrace;
 
     if (dynamicDeferral < 0.0) {
@@ -333,7 +404,7 @@ Bool PolicyStartTrace(Trace *traceReturn, Bool *collectWorldReturn,
       if (TraceIsEmpty(trace))
         goto nothingCondemned;
       res = TraceStart(trace, mortality,
-                       (double)trace->condemned * TraceWorkFactor);
+                       (double)trace->condemned * TraceWorkFACTOR);
       /* We don't expect normal GC traces to fail to start. */
       AVER(res == ResOK);
       *traceReturn = trace;
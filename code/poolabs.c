@@ -89,6 +89,8 @@ Res PoolAbsInit(Pool pool, Arena arena, PoolClass klass, ArgList args)
   pool->alignment = MPS_PF_ALIGN;
   pool->alignShift = SizeLog2(pool->alignment);
   pool->format = NULL;
+  STATISTIC(pool->readFaultCount = (Count)0);
+  STATISTIC(pool->writeFaultCount = (Count)0);
 
   if (ArgPick(&arg, args, MPS_KEY_FORMAT)) {
     Format format = arg.val.format;
@@ -340,6 +342,10 @@ Res PoolAbsDescribe(Inst inst, mps_lib_FILE *stream, Count depth)
                (WriteFP)pool->arena, (WriteFU)pool->arena->serial,
                "alignment $W\n", (WriteFW)pool->alignment,
                "alignShift $W\n", (WriteFW)pool->alignShift,
+               STATISTIC_WRITE("readFaultCount $U\n",
+                               (WriteFU)pool->readFaultCount)
+               STATISTIC_WRITE("writeFaultCount $U\n",
+                               (WriteFU)pool->writeFaultCount)
                NULL);
   if (res != ResOK)
     return res;
@@ -26,7 +26,9 @@ typedef Bool (*amcPinnedFunction)(AMC amc, Nailboard board, Addr base, Addr limi
 static void amcSegBufferEmpty(Seg seg, Buffer buffer);
 static Res amcSegWhiten(Seg seg, Trace trace);
 static Res amcSegScan(Bool *totalReturn, Seg seg, ScanState ss);
-static void amcSegReclaim(Seg seg, Trace trace);
+static Res amcSegScanArea(Addr *baseIO, Addr *limitIO,
+                          Seg seg, ScanState ss);
+static Bool amcSegReclaim(Seg seg, Trace trace);
 static Bool amcSegHasNailboard(Seg seg);
 static Nailboard amcSegNailboard(Seg seg);
 static Bool AMCCheck(AMC amc);
@@ -55,7 +57,8 @@ DECLARE_CLASS(Seg, amcSeg, MutatorSeg);
 typedef struct amcGenStruct {
   PoolGenStruct pgen;
   RingStruct amcRing;           /* link in list of gens in pool */
-  Buffer forward;               /* forwarding buffer */
+  Count forwardCount;           /* number of forwarding buffers */
+  Buffer *forward;              /* forwarding buffer for each worker */
   Sig sig;                      /* design.mps.sig.field.end.outer */
 } amcGenStruct;
 
@@ -99,6 +102,15 @@ enum {
  * collection via TracePoll), and by hash array allocations (where we
  * don't want the allocation to provoke a collection that makes the
  * location dependency stale immediately).
+ *
+ * .seg.promote: The "promote" flag is TRUE if the segment is condemned
+ * for a trace that marks its objects in place (in the nailboard),
+ * rather than copying them, and then moves the segment to the next
+ * generation.  <design/poolamc#.promote>
+ *
+ * .seg.live: The "liveSize" field is the size of the objects that
+ * survived the last time the segment was promoted, or zero if it has
+ * never been promoted.
  */
 
 typedef struct amcSegStruct *amcSeg;
@@ -113,6 +125,8 @@ typedef struct amcSegStruct {
   BOOLFIELD(accountedAsBuffered); /* .seg.accounted-as-buffered */
   BOOLFIELD(old);           /* .seg.old */
   BOOLFIELD(deferred);      /* .seg.deferred */
+  BOOLFIELD(promote);       /* .seg.promote */
+  Size liveSize;            /* .seg.live */
   Sig sig;                  /* design.mps.sig.field.end.outer */
 } amcSegStruct;
 
@@ -130,6 +144,12 @@ static Bool amcSegCheck(amcSeg amcseg)
   /* CHECKL(BoolCheck(amcseg->accountedAsBuffered)); <design/type#.bool.bitfield.check> */
   /* CHECKL(BoolCheck(amcseg->old)); <design/type#.bool.bitfield.check> */
   /* CHECKL(BoolCheck(amcseg->deferred)); <design/type#.bool.bitfield.check> */
+  /* CHECKL(BoolCheck(amcseg->promote)); <design/type#.bool.bitfield.check> */
+  if (amcseg->promote) {
+    CHECKL(amcseg->board != NULL);
+    CHECKL(SegWhite(MustBeA(Seg, amcseg)) != TraceSetEMPTY);
+  }
+  CHECKL(amcseg->liveSize <= SegSize(MustBeA(Seg, amcseg)));
   return TRUE;
 }
 
@@ -160,6 +180,9 @@ static Res AMCSegInit(Seg seg, Pool pool, Addr base, Size size, ArgList args)
   amcseg->accountedAsBuffered = FALSE;
   amcseg->old = FALSE;
   amcseg->deferred = FALSE;
+  amcseg->promote = FALSE;
+  amcseg->liveSize = 0;
+  SegSetFixFast(seg, SegFixFastSNAP, NULL); /* see .fix.snap */
 
   SetClassOfPoly(seg, CLASS(amcSeg));
   amcseg->sig = amcSegSig;
@@ -360,7 +383,9 @@ DEFINE_CLASS(Seg, amcSeg, klass)
   klass->init = AMCSegInit;
   klass->bufferEmpty = amcSegBufferEmpty;
   klass->whiten = amcSegWhiten;
+  klass->access = SegPageAccess;
   klass->scan = amcSegScan;
+  klass->scanArea = amcSegScanArea;
   klass->fix = amcSegFix;
   klass->fixEmergency = amcSegFixEmergency;
   klass->reclaim = amcSegReclaim;
@@ -437,7 +462,9 @@ static Bool amcGenCheck(amcGen gen)
   CHECKD(PoolGen, &gen->pgen);
   amc = amcGenAMC(gen);
   CHECKU(AMC, amc);
-  CHECKD(Buffer, gen->forward);
+  CHECKL(gen->forwardCount == PoolArena(amcGenPool(gen))->traceWorkers);
+  CHECKL(gen->forward != NULL);
+  CHECKD(Buffer, gen->forward[0]);
   CHECKD_NOSIG(Ring, &gen->amcRing);
 
   return TRUE;
@@ -490,8 +517,12 @@ static amcGen amcBufGen(Buffer buffer)
 static void amcBufSetGen(Buffer buffer, amcGen gen)
 {
   amcBuf amcbuf = MustBeA(amcBuf, buffer);
-  if (gen != NULL)
+  if (gen != NULL) {
     AVERT(amcGen, gen);
+    /* Objects are never forwarded into a nursery. */
+    /* <design/trace#.multi.policy> */
+    AVER(BufferIsMutator(buffer) || !PoolGenIsNursery(&gen->pgen));
+  }
   amcbuf->gen = gen;
 }
 
@@ -560,33 +591,48 @@ DEFINE_CLASS(Buffer, amcBuf, klass)
 }
 
 
-/* amcGenCreate -- create a generation */
+/* amcGenCreate -- create a generation
+ *
+ * The generation has a forwarding buffer for each collector worker.
+ * <design/poolamc#.fix.parallel>
+ */
 
 static Res amcGenCreate(amcGen *genReturn, AMC amc, GenDesc gen)
 {
   Pool pool = MustBeA(AbstractPool, amc);
   Arena arena;
-  Buffer buffer;
+  Buffer *forward;
+  Count forwardCount;
   amcGen amcgen;
+  Index i;
   Res res;
   void *p;
 
   arena = pool->arena;
+  forwardCount = arena->traceWorkers;
 
   res = ControlAlloc(&p, arena, sizeof(amcGenStruct));
   if(res != ResOK)
     goto failControlAlloc;
   amcgen = (amcGen)p;
 
-  res = BufferCreate(&buffer, CLASS(amcBuf), pool, FALSE, argsNone);
+  res = ControlAlloc(&p, arena, forwardCount * sizeof(Buffer));
   if(res != ResOK)
-    goto failBufferCreate;
+    goto failForwardAlloc;
+  forward = p;
+
+  for (i = 0; i < forwardCount; ++i) {
+    res = BufferCreate(&forward[i], CLASS(amcBuf), pool, FALSE, argsNone);
+    if(res != ResOK)
+      goto failBufferCreate;
+  }
 
   res = PoolGenInit(&amcgen->pgen, gen, pool);
   if(res != ResOK)
     goto failGenInit;
   RingInit(&amcgen->amcRing);
-  amcgen->forward = buffer;
+  amcgen->forwardCount = forwardCount;
+  amcgen->forward = forward;
   amcgen->sig = amcGenSig;
 
   AVERT(amcGen, amcgen);
@@ -597,9 +643,14 @@ static Res amcGenCreate(amcGen *genReturn, AMC amc, GenDesc gen)
   return ResOK;
 
 failGenInit:
-  BufferDestroy(buffer);
 failBufferCreate:
-  ControlFree(arena, p, sizeof(amcGenStruct));
+  while (i > 0) {
+    --i;
+    BufferDestroy(forward[i]);
+  }
+  ControlFree(arena, forward, forwardCount * sizeof(Buffer));
+failForwardAlloc:
+  ControlFree(arena, amcgen, sizeof(amcGenStruct));
 failControlAlloc:
   return res;
 }
@@ -610,6 +661,7 @@ failControlAlloc:
 static void amcGenDestroy(amcGen gen)
 {
   Arena arena;
+  Index i;
 
   AVERT(amcGen, gen);
 
@@ -618,15 +670,50 @@ static void amcGenDestroy(amcGen gen)
   RingRemove(&gen->amcRing);
   RingFinish(&gen->amcRing);
   PoolGenFinish(&gen->pgen);
-  BufferDestroy(gen->forward);
+  for (i = 0; i < gen->forwardCount; ++i)
+    BufferDestroy(gen->forward[i]);
+  ControlFree(arena, gen->forward, gen->forwardCount * sizeof(Buffer));
   ControlFree(arena, gen, sizeof(amcGenStruct));
 }
 
 
+/* amcGenSetForwardGen -- set the generation that gen forwards into */
+
+static void amcGenSetForwardGen(amcGen gen, amcGen forwardGen)
+{
+  Index i;
+  for (i = 0; i < gen->forwardCount; ++i)
+    amcBufSetGen(gen->forward[i], forwardGen);
+}
+
+
+/* amcGenDetachForward -- detach the forwarding buffers of gen */
+
+static void amcGenDetachForward(amcGen gen, Pool pool)
+{
+  Index i;
+  for (i = 0; i < gen->forwardCount; ++i)
+    BufferDetach(gen->forward[i], pool);
+}
+
+
+/* amcGenIsForward -- is buffer a forwarding buffer of gen? */
+
+static Bool amcGenIsForward(amcGen gen, Buffer buffer)
+{
+  Index i;
+  for (i = 0; i < gen->forwardCount; ++i)
+    if (gen->forward[i] == buffer)
+      return TRUE;
+  return FALSE;
+}
+
+
 /* amcGenDescribe -- describe an AMC generation */
 
 static Res amcGenDescribe(amcGen gen, mps_lib_FILE *stream, Count depth)
 {
+  Index i;
   Res res;
 
   if(!TESTT(amcGen, gen))
@@ -635,11 +722,17 @@ static Res amcGenDescribe(amcGen gen, mps_lib_FILE *stream, Count depth)
     return ResFAIL;
 
   res = WriteF(stream, depth,
-               "amcGen $P {\n", (WriteFP)gen,
-               "  buffer $P\n", (WriteFP)gen->forward, NULL);
+               "amcGen $P {\n", (WriteFP)gen, NULL);
   if (res != ResOK)
     return res;
 
+  for (i = 0; i < gen->forwardCount; ++i) {
+    res = WriteF(stream, depth + 2,
+                 "buffer $P\n", (WriteFP)gen->forward[i], NULL);
+    if (res != ResOK)
+      return res;
+  }
+
   res = PoolGenDescribe(&gen->pgen, stream, depth + 2);
   if (res != ResOK)
     return res;
@@ -807,10 +900,10 @@ static Res amcInitComm(Pool pool, Arena arena, PoolClass klass,
     }
     /* Set up forwarding buffers. */
     for(i = 0; i < genCount; ++i) {
-      amcBufSetGen(amc->gen[i]->forward, amc->gen[i+1]);
+      amcGenSetForwardGen(amc->gen[i], amc->gen[i+1]);
     }
     /* Dynamic gen forwards to itself. */
-    amcBufSetGen(amc->gen[genCount]->forward, amc->gen[genCount]);
+    amcGenSetForwardGen(amc->gen[genCount], amc->gen[genCount]);
   }
   amc->nursery = amc->gen[0];
   amc->rampGen = amc->gen[genCount-1]; /* last ephemeral gen */
@@ -871,7 +964,7 @@ static void AMCFinish(Inst inst)
   /* buffers by this time. */
   RING_FOR(node, &amc->genRing, nextNode) {
     amcGen gen = RING_ELT(amcGen, amcRing, node);
-    BufferDetach(gen->forward, pool);
+    amcGenDetachForward(gen, pool);
   }
 
   ring = PoolSegRing(pool);
@@ -893,7 +986,7 @@ static void AMCFinish(Inst inst)
   ring = &amc->genRing;
   RING_FOR(node, ring, nextNode) {
     amcGen gen = RING_ELT(amcGen, amcRing, node);
-    amcBufSetGen(gen->forward, NULL);
+    amcGenSetForwardGen(gen, NULL);
   }
   RING_FOR(node, ring, nextNode) {
     amcGen gen = RING_ELT(amcGen, amcRing, node);
@@ -960,7 +1053,7 @@ static Res AMCBufferFill(Addr *baseReturn, Addr *limitReturn,
   /* If ramping, or if the buffer is intended for allocating hash
    * table arrays, defer the size accounting. */
   if ((amc->rampMode == RampRAMPING
-       && buffer == amc->rampGen->forward
+       && amcGenIsForward(amc->rampGen, buffer)
        && gen == amc->rampGen)
       || amcbuf->forHashArrays)
   {
@@ -1138,10 +1231,34 @@ static PoolGen amcSegPoolGen(Pool pool, Seg seg)
 }
 
 
+/* amcSegIsDense -- is most of the segment expected to survive?
+ *
+ * Uses the size that survived the last time the segment was promoted,
+ * if it has been, and otherwise the mortality of its generation.
+ * <design/poolamc#.promote.dense>
+ */
+
+static Bool amcSegIsDense(Seg seg)
+{
+  amcSeg amcseg = MustBeA(amcSeg, seg);
+  double live;
+
+  if (amcseg->liveSize > 0)
+    live = (double)amcseg->liveSize / (double)SegSize(seg);
+  else
+    live = 1.0 - amcseg->gen->pgen.gen->mortality;
+  return live >= AMC_PROMOTE_LIVE;
+}
+
+
 /* amcSegWhiten -- condemn the segment for the trace
  *
  * If the segment has a mutator buffer on it, we nail the buffer,
  * because we can't scan or reclaim uncommitted buffers.
+ *
+ * If the segment is dense, we give it a nailboard and nail it, so
+ * that its objects are marked in place rather than copied, and it is
+ * promoted when it is reclaimed.  <design/poolamc#.promote>
  */
 static Res amcSegWhiten(Seg seg, Trace trace)
 {
@@ -1235,19 +1352,32 @@ static Res amcSegWhiten(Seg seg, Trace trace)
   SegSetWhite(seg, TraceSetAdd(SegWhite(seg), trace));
   GenDescCondemned(gen->pgen.gen, trace, condemned + SegSize(seg));
 
+  /* Ramp segments aren't promoted, as their accounting is deferred. */
+  if (!SegHasBuffer(seg)
+      && SegNailed(seg) == TraceSetEMPTY
+      && !amcseg->deferred
+      && amcSegIsDense(seg)
+      && amcSegCreateNailboard(seg) == ResOK)
+  {
+    SegSetNailed(seg, TraceSetSingle(trace));
+    amcseg->promote = TRUE;
+  }
+
   /* Ensure we are forwarding into the right generation. */
 
   /* see <design/poolamc#.gen.ramp> */
-  /* This switching needs to be more complex for multiple traces. */
-  AVER(TraceSetIsSingle(PoolArena(pool)->busyTraces));
-  if(amc->rampMode == RampBEGIN && gen == amc->rampGen) {
-    BufferDetach(gen->forward, pool);
-    amcBufSetGen(gen->forward, gen);
-    amc->rampMode = RampRAMPING;
-  } else if(amc->rampMode == RampFINISH && gen == amc->rampGen) {
-    BufferDetach(gen->forward, pool);
-    amcBufSetGen(gen->forward, amc->afterRampGen);
-    amc->rampMode = RampCOLLECTING;
+  /* Only switch when this is the only trace, so that the ramp states */
+  /* aren't shared between traces.  <design/poolamc#.ramp.multi> */
+  if (TraceSetIsSingle(PoolArena(pool)->busyTraces)) {
+    if(amc->rampMode == RampBEGIN && gen == amc->rampGen) {
+      amcGenDetachForward(gen, pool);
+      amcGenSetForwardGen(gen, gen);
+      amc->rampMode = RampRAMPING;
+    } else if(amc->rampMode == RampFINISH && gen == amc->rampGen) {
+      amcGenDetachForward(gen, pool);
+      amcGenSetForwardGen(gen, amc->afterRampGen);
+      amc->rampMode = RampCOLLECTING;
+    }
   }
 
   return ResOK;
@@ -1299,8 +1429,8 @@ static Res amcSegScanNailedRange(Bool *totalReturn, Bool *moreReturn,
  * *moreReturn is set to FALSE only if there are no more objects
  * on the segment that need scanning (which is normally the case).
  * It is set to TRUE if scanning had to be abandoned early on, and
- * also if during emergency fixing any new marks got added to the
- * nailboard.
+ * also if during emergency fixing, or while scanning a promoted
+ * segment, any new marks got added to the nailboard.
  */
 static Res amcSegScanNailedOnce(Bool *totalReturn, Bool *moreReturn,
                                 ScanState ss, Seg seg, AMC amc)
@@ -1362,7 +1492,11 @@ static Res amcSegScanNailed(Bool *totalReturn, ScanState ss, Pool pool,
   if(loops > 1) {
     RefSet refset;
 
-    AVER(ArenaEmergency(PoolArena(pool)));
+    /* Only emergency fixing or a promoted segment marking objects
+     * in itself can add nails during a scan.  See
+     * <design/poolamc#.promote.scan>. */
+    AVER(ArenaEmergency(PoolArena(pool))
+         || MustBeA(amcSeg, seg)->promote);
 
     /* Looped: fixed refs (from 1st pass) were seen by MPS_FIX1
      * (in later passes), so the "ss.unfixedSummary" is _not_
@@ -1375,7 +1509,8 @@ static Res amcSegScanNailed(Bool *totalReturn, ScanState ss, Pool pool,
 
     refset = ScanStateSummary(ss);
 
-    /* A rare event, which might prompt a rare defect to appear. */
+    /* A rare event (except when promoting), which might prompt a
+     * rare defect to appear. */
     EVENT6(AMCScanNailed, loops, SegSummary(seg), ScanStateWhite(ss),
            ScanStateUnfixedSummary(ss), ss->fixedSummary, refset);
 
@@ -1449,6 +1584,65 @@ static Res amcSegScan(Bool *totalReturn, Seg seg, ScanState ss)
 }
 
 
+/* amcSegScanArea -- scan the objects that overlap an area
+ *
+ * The objects in a segment are contiguous from its base, so skip
+ * objects from the base to find the first one that overlaps the area,
+ * and scan from there to the first object boundary at or after the
+ * limit of the area.  A large segment holds a single object, so there
+ * is no part of it to scan, and nor is there if the area turns out to
+ * cover every object.  <design/write-barrier#.page>
+ */
+
+static Res amcSegScanArea(Addr *baseIO, Addr *limitIO,
+                          Seg seg, ScanState ss)
+{
+  Pool pool = SegPool(seg);
+  AMC amc = MustBeA(AMCZPool, pool);
+  Format format;
+  Addr base, limit, segLimit, object, nextObject;
+  Res res;
+
+  AVER(baseIO != NULL);
+  AVER(limitIO != NULL);
+  AVERT(Seg, seg);
+  AVERT(ScanState, ss);
+
+  if (SegSize(seg) >= amc->largeSize || amcSegHasNailboard(seg))
+    return ResUNIMPL;
+
+  format = pool->format;
+  base = AddrAdd(*baseIO, format->headerSize);
+  limit = AddrAdd(*limitIO, format->headerSize);
+  segLimit = AddrAdd(SegLimit(seg), format->headerSize);
+
+  object = AddrAdd(SegBase(seg), format->headerSize);
+  for (;;) {
+    nextObject = (*format->skip)(object);
+    AVER(nextObject > object);
+    if (nextObject > base)
+      break;
+    object = nextObject;
+  }
+  while (nextObject < limit)
+    nextObject = (*format->skip)(nextObject);
+  AVER(nextObject <= segLimit);
+
+  /* If that's every object in the segment, scan the segment whole. */
+  if (object == AddrAdd(SegBase(seg), format->headerSize)
+      && nextObject == segLimit)
+    return ResUNIMPL;
+
+  res = TraceScanFormat(ss, object, nextObject);
+  if (res != ResOK)
+    return res;
+
+  *baseIO = AddrSub(object, format->headerSize);
+  *limitIO = AddrSub(nextObject, format->headerSize);
+  return ResOK;
+}
+
+
 /* amcSegFixInPlace -- fix a reference without moving the object
  *
  * Usually this function is used for ambiguous references, but during
@@ -1546,6 +1740,9 @@ static Res amcSegFix(Seg seg, ScanState ss, Ref *refIO)
   amcGen gen;          /* generation of old copy of object */
   TraceSet grey;       /* greyness of object being relocated */
   Seg toSeg;           /* segment to which object is being relocated */
+  Size toAlias;        /* offset of toSeg's collector alias, or 0 */
+  TraceSet nailed;     /* nailing of seg when the copy was claimed */
+  Bool lost;           /* another worker forwarded the object first */
   TraceId ti;
   Trace trace;
 
@@ -1615,6 +1812,8 @@ static Res amcSegFix(Seg seg, ScanState ss, Ref *refIO)
     amcSegFixInPlace(seg, ss, refIO);
     return ResOK;
   }
+
+claim:
   newRef = (*format->isMoved)(ref);  /* .exposed.seg */
 
   if(newRef == (Addr)0) {
@@ -1645,21 +1844,36 @@ static Res amcSegFix(Seg seg, ScanState ss, Ref *refIO)
 
     ss->wasMarked = FALSE; /* <design/fix#.was-marked.not> */
 
-    /* Get the forwarding buffer from the object's generation. */
+    /* A segment being promoted is marked, not copied. */
+    /* <design/poolamc#.promote> */
+    if (MustBeA_CRITICAL(amcSeg, seg)->promote) {
+      amcSegFixInPlace(seg, ss, refIO);
+      res = ResOK;
+      goto returnRes;
+    }
+
+    /* Get this worker's forwarding buffer from the object's */
+    /* generation.  <design/poolamc#.fix.parallel> */
     gen = amcSegGen(seg);
-    buffer = gen->forward;
+    AVER_CRITICAL(ss->worker < gen->forwardCount);
+    buffer = gen->forward[ss->worker];
     AVER_CRITICAL(buffer != NULL);
 
     length = AddrOffset(ref, clientQ);  /* .exposed.seg */
-    STATISTIC(++ss->forwardedCount);
+    nailed = SegNailed(seg);
+    lost = FALSE;
     do {
       res = BUFFER_RESERVE(&newBase, buffer, length);
       if (res != ResOK)
         goto returnRes;
       newRef = AddrAdd(newBase, headerSize);
 
+      /* .exposed.alias: The copy is the only access to toSeg, and */
+      /* it's made by the MPS rather than by a format method, so it */
+      /* can go through the collector alias, without changing toSeg's */
+      /* protection.  See <design/shield#.alias>. */
       toSeg = BufferSeg(buffer);
-      ShieldExpose(arena, toSeg);
+      toAlias = ShieldExposeAlias(arena, toSeg);
 
       /* Since we're moving an object from one segment to another, */
       /* union the greyness and the summaries together. */
@@ -1672,12 +1886,33 @@ static Res amcSegFix(Seg seg, ScanState ss, Ref *refIO)
       }
       SegSetGrey(toSeg, TraceSetUnion(SegGrey(toSeg), grey));
 
-      /* <design/trace#.fix.copy> */
-      (void)AddrCopy(newBase, base, length);  /* .exposed.seg */
+      /* .fix.parallel: A collector worker copies a large object */
+      /* without the fix lock, so that workers copy in parallel, */
+      /* then claims the object again under the lock.  If another */
+      /* worker forwarded or nailed it meanwhile, this copy is */
+      /* abandoned.  <design/poolamc#.fix.parallel> */
+      if (ss->fixLock != NULL && length >= AMC_COPY_UNLOCKED_SIZE) {
+        LockRelease(ss->fixLock);
+        /* <design/trace#.fix.copy> */
+        (void)AddrCopy(AddrAlias(newBase, toAlias), base,
+                       length);  /* .exposed.seg */
+        LockClaim(ss->fixLock);
+        lost = (*format->isMoved)(ref) != (Addr)0
+          || SegNailed(seg) != nailed;
+      } else {
+        /* <design/trace#.fix.copy> */
+        (void)AddrCopy(AddrAlias(newBase, toAlias), base,
+                       length);  /* .exposed.seg */
+      }
 
-      ShieldCover(arena, toSeg);
+      ShieldCoverAlias(arena, toSeg, toAlias);
+      if (lost) {
+        BufferRetract(buffer, newBase, length);
+        goto claim;
+      }
     } while (!BUFFER_COMMIT(buffer, newBase, length));
 
+    STATISTIC(++ss->forwardedCount);
     STATISTIC(ss->copiedSize += length);
     TRACE_SET_ITER(ti, trace, ss->traces, ss->arena)
       MustBeA(amcSeg, seg)->forwarded[ti] += length;
@@ -1685,11 +1920,19 @@ static Res amcSegFix(Seg seg, ScanState ss, Ref *refIO)
 
     (*format->move)(ref, newRef);  /* .exposed.seg */
   } else {
-    /* reference to broken heart (which should be snapped out -- */
-    /* consider adding to (non-existent) snap-out cache here) */
+    /* reference to broken heart, which is snapped out */
     STATISTIC(++ss->snapCount);
   }
 
+  /* .fix.snap: remember where the object went, so that _mps_fix2 */
+  /* can snap out later references to it without calling us.  See */
+  /* <design/trace#.fix.snap>. */
+  if (ss->snapCache != NULL) {
+    TraceSnapCache snap = ScanStateSnapCache(ss, ref);
+    snap->from = ref;
+    snap->to = newRef;
+  }
+
   /* .fix.update: update the reference to whatever the above code */
   /* decided it should be */
 updateReference:
@@ -1702,9 +1945,40 @@ returnRes:
 }
 
 
-/* amcSegReclaimNailed -- reclaim what you can from a nailed segment */
+/* amcSegPromote -- move a promoted segment to the next generation
+ *
+ * The segment joins the generation that its objects would have been
+ * forwarded to.  <design/poolamc#.promote>
+ */
+
+static void amcSegPromote(Seg seg, Trace trace, Size liveSize)
+{
+  amcSeg amcseg = MustBeA(amcSeg, seg);
+  amcGen gen, nextGen;
+
+  AVERT(Trace, trace);
+  gen = amcSegGen(seg);
+  nextGen = amcBufGen(gen->forward[0]);
+  AVERT(amcGen, nextGen);
+
+  amcseg->liveSize = liveSize;
+  if (nextGen != gen) {
+    AVER(amcseg->old);
+    PoolGenPromote(&nextGen->pgen, &gen->pgen, seg, amcseg->deferred);
+    amcseg->gen = nextGen;
+    amcseg->old = FALSE;
+  }
+  STATISTIC(++trace->promoteCount);
+  STATISTIC(trace->promoteSize += SegSize(seg));
+}
+
+
+/* amcSegReclaimNailed -- reclaim what you can from a nailed segment
+ *
+ * Returns TRUE if the segment was freed.
+ */
 
-static void amcSegReclaimNailed(Pool pool, Trace trace, Seg seg)
+static Bool amcSegReclaimNailed(Pool pool, Trace trace, Seg seg)
 {
   Addr p, limit;
   Arena arena;
@@ -1718,6 +1992,8 @@ static void amcSegReclaimNailed(Pool pool, Trace trace, Seg seg)
   Addr padBase;          /* base of next padding object */
   Size padLength;        /* length of next padding object */
   Buffer buffer;
+  amcSeg amcseg = MustBeA(amcSeg, seg);
+  Bool promote;
 
   /* All arguments AVERed by AMCReclaim */
 
@@ -1777,11 +2053,13 @@ static void amcSegReclaimNailed(Pool pool, Trace trace, Seg seg)
   }
   ShieldCover(arena, seg);
 
+  promote = amcseg->promote;
+  amcseg->promote = FALSE;
   SegSetNailed(seg, TraceSetDel(SegNailed(seg), trace));
   SegSetWhite(seg, TraceSetDel(SegWhite(seg), trace));
   if(SegNailed(seg) == TraceSetEMPTY && amcSegHasNailboard(seg)) {
     NailboardDestroy(amcSegNailboard(seg), arena);
-    MustBeA(amcSeg, seg)->board = NULL;
+    amcseg->board = NULL;
   }
 
   STATISTIC(AVER(bytesReclaimed <= SegSize(seg)));
@@ -1794,7 +2072,7 @@ static void amcSegReclaimNailed(Pool pool, Trace trace, Seg seg)
     GenDescCondemned(pgen->gen, trace,
                      AddrOffset(BufferBase(buffer), BufferLimit(buffer)));
   }
-  GenDescSurvived(pgen->gen, trace, MustBeA(amcSeg, seg)->forwarded[trace->ti],
+  GenDescSurvived(pgen->gen, trace, amcseg->forwarded[trace->ti],
                   preservedInPlaceSize);
 
   /* Free the seg if we can; fixes .nailboard.limitations.middle. */
@@ -1805,8 +2083,12 @@ static void amcSegReclaimNailed(Pool pool, Trace trace, Seg seg)
     /* We may not free a buffered seg. */
     AVER(!SegHasBuffer(seg));
 
-    PoolGenFree(pgen, seg, 0, SegSize(seg), 0, MustBeA(amcSeg, seg)->deferred);
+    PoolGenFree(pgen, seg, 0, SegSize(seg), 0, amcseg->deferred);
+    return TRUE;
   }
+  if (promote)
+    amcSegPromote(seg, trace, preservedInPlaceSize);
+  return FALSE;
 }
 
 
@@ -1814,7 +2096,7 @@ static void amcSegReclaimNailed(Pool pool, Trace trace, Seg seg)
  *
  * <design/poolamc#.reclaim>.
  */
-static void amcSegReclaim(Seg seg, Trace trace)
+static Bool amcSegReclaim(Seg seg, Trace trace)
 {
   amcSeg amcseg = MustBeA_CRITICAL(amcSeg, seg);
   Pool pool = SegPool(seg);
@@ -1825,9 +2107,10 @@ static void amcSegReclaim(Seg seg, Trace trace)
   gen = amcSegGen(seg);
   AVERT_CRITICAL(amcGen, gen);
 
-  /* This switching needs to be more complex for multiple traces. */
-  AVER_CRITICAL(TraceSetIsSingle(PoolArena(pool)->busyTraces));
-  if(amc->rampMode == RampCOLLECTING) {
+  /* Only switch when this is the only trace.  See amcSegWhiten and */
+  /* <design/poolamc#.ramp.multi>. */
+  if (amc->rampMode == RampCOLLECTING
+      && TraceSetIsSingle(PoolArena(pool)->busyTraces)) {
     if(amc->rampCount > 0) {
       /* Entered ramp mode before previous one was cleaned up */
       amc->rampMode = RampBEGIN;
@@ -1836,10 +2119,8 @@ static void amcSegReclaim(Seg seg, Trace trace)
     }
   }
 
-  if(SegNailed(seg) != TraceSetEMPTY) {
-    amcSegReclaimNailed(pool, trace, seg);
-    return;
-  }
+  if(SegNailed(seg) != TraceSetEMPTY)
+    return amcSegReclaimNailed(pool, trace, seg);
 
   /* We may not free a buffered seg.  (But all buffered + condemned */
   /* segs should have been nailed anyway). */
@@ -1849,6 +2130,7 @@ static void amcSegReclaim(Seg seg, Trace trace)
 
   GenDescSurvived(gen->pgen.gen, trace, amcseg->forwarded[trace->ti], 0);
   PoolGenFree(&gen->pgen, seg, 0, SegSize(seg), 0, amcseg->deferred);
+  return TRUE;
 }
 
 
@@ -2124,6 +2406,7 @@ DEFINE_CLASS(Pool, AMCZPool, klass)
 DEFINE_CLASS(Pool, AMCPool, klass)
 {
   INHERIT_CLASS(klass, AMCPool, AMCZPool);
+  klass->attr |= AttrPARSCAN;
   klass->init = AMCInit;
   AVERT(PoolClass, klass);
 }
@@ -0,0 +1,924 @@
+/* poolamr.c: AUTOMATIC MARK-REGION POOL CLASS
+ *
+ * $Id$
+ * Copyright (c) 2026 Ravenbrook Limited.  See end of file for license.
+ *
+ * .design: <design/poolamr>.
+ *
+ * .purpose: AMR is a subclass of AMS that marks objects in place, but
+ * only refills buffers from whole free lines, and evacuates the
+ * objects from its most fragmented segments by copying them, as AMC
+ * does.
+ */
+
+#include "poolams.h"
+#include "mpscamr.h"
+#include "mpm.h"
+
+SRCID(poolamr, "$Id$");
+
+
+#define AMRSig          ((Sig)0x519A3699) /* SIGnature AMR */
+#define AMRSegSig       ((Sig)0x519A3659) /* SIGnature AMR SeG */
+
+
+/* AMRStruct -- AMR pool instance structure
+ *
+ * .promote: Evacuated objects are copied into segments in the
+ * promotion generation, "promoteGen".  This is the generation after
+ * the pool's, or the pool's own generation if there is no later one,
+ * in which case promoteGen is the same as the AMS field pgen.
+ * <design/poolamr#.gen>
+ */
+
+typedef struct AMRStruct {
+  AMSStruct amsStruct;      /* generic AMS structure */
+  Count lineGrains;         /* grains in a line, <design/poolamr#.line> */
+  Buffer forward;           /* forwarding buffer, or NULL if can't move */
+  PoolGenStruct promoteGenStruct; /* .promote */
+  PoolGen promoteGen;       /* .promote */
+  Sig sig;                  /* design.mps.sig.field.end.outer */
+} AMRStruct;
+
+typedef struct AMRStruct *AMR;
+
+#define PoolAMR(pool) PARENT(AMRStruct, amsStruct, PoolAMS(pool))
+#define AMR2AMS(amr)  (&(amr)->amsStruct)
+
+typedef AMR AMRPool;
+#define AMRPoolCheck AMRCheck
+DECLARE_CLASS(Pool, AMRPool, AMSPool);
+
+
+/* AMRSegStruct -- AMR segment instances
+ *
+ * .seg.evacuate: The "evacuate" flag is TRUE if the segment is white
+ * and its objects are being evacuated rather than marked in place.
+ * <design/poolamr#.evacuate>
+ *
+ * .seg.forwarded: The "forwarded" field is the size of the objects
+ * evacuated from the segment so far in the trace for which it is white.
+ *
+ * .seg.pgen: The "pgen" field is the pool generation that the segment
+ * belongs to: either the pool's generation or its promotion
+ * generation (.promote).
+ *
+ * .seg.hole: If "holeFree" is non-zero, then the segment has no range
+ * of whole free lines of "holeGrains" or more, as long as it has no
+ * more than "holeFree" free grains.  <design/poolamr#.line.fail>
+ */
+
+typedef struct AMRSegStruct *AMRSeg;
+
+typedef struct AMRSegStruct {
+  AMSSegStruct amsSegStruct; /* superclass fields must come first */
+  Bool evacuate;             /* .seg.evacuate */
+  Size forwarded;            /* .seg.forwarded */
+  PoolGen pgen;              /* .seg.pgen */
+  Count holeGrains;          /* .seg.hole */
+  Count holeFree;            /* .seg.hole */
+  Sig sig;                   /* design.mps.sig.field.end.outer */
+} AMRSegStruct;
+
+DECLARE_CLASS(Seg, AMRSeg, AMSSeg);
+
+
+/* AMRSegCheck -- check an AMR segment */
+
+ATTRIBUTE_UNUSED
+static Bool AMRSegCheck(AMRSeg amrseg)
+{
+  Seg seg = MustBeA(Seg, amrseg);
+  CHECKS(AMRSeg, amrseg);
+  CHECKD(AMSSeg, &amrseg->amsSegStruct);
+  CHECKL(BoolCheck(amrseg->evacuate));
+  CHECKD(PoolGen, amrseg->pgen);
+  if (amrseg->evacuate) {
+    CHECKL(SegWhite(seg) != TraceSetEMPTY);
+    CHECKL(SegRankSet(seg) == RankSetSingle(RankEXACT));
+  } else {
+    CHECKL(amrseg->forwarded == 0);
+  }
+  return TRUE;
+}
+
+
+/* AMRCheck -- check an AMR pool */
+
+ATTRIBUTE_UNUSED
+static Bool AMRCheck(AMR amr)
+{
+  CHECKS(AMR, amr);
+  CHECKD(AMS, AMR2AMS(amr));
+  CHECKL(amr->lineGrains > 0);
+  CHECKL(!amr->amsStruct.shareAllocTable);
+  if (amr->forward != NULL)
+    CHECKD(Buffer, amr->forward);
+  if (amr->promoteGen != NULL) {
+    CHECKL(amr->promoteGen == &amr->promoteGenStruct
+           || amr->promoteGen == amr->amsStruct.pgen);
+    CHECKD(PoolGen, amr->promoteGen);
+  }
+  return TRUE;
+}
+
+
+/* AMRSegInit -- initialise an AMR segment
+ *
+ * The pool generation is passed in the argument amrKeySegGen.
+ */
+
+ARG_DEFINE_KEY(amr_seg_gen, Pointer);
+#define amrKeySegGen (&_mps_key_amr_seg_gen)
+
+static Res AMRSegInit(Seg seg, Pool pool, Addr base, Size size, ArgList args)
+{
+  AMRSeg amrseg;
+  PoolGen pgen;
+  ArgStruct arg;
+  Res res;
+
+  ArgRequire(&arg, args, amrKeySegGen);
+  pgen = arg.val.p;
+
+  /* Initialize the superclass fields first via next-method call */
+  res = NextMethod(Seg, AMRSeg, init)(seg, pool, base, size, args);
+  if (res != ResOK)
+    return res;
+  amrseg = CouldBeA(AMRSeg, seg);
+
+  amrseg->evacuate = FALSE;
+  amrseg->forwarded = 0;
+  amrseg->pgen = pgen;
+  amrseg->holeGrains = 0;
+  amrseg->holeFree = 0;
+
+  SetClassOfPoly(seg, CLASS(AMRSeg));
+  amrseg->sig = AMRSegSig;
+  AVERC(AMRSeg, amrseg);
+
+  return ResOK;
+}
+
+
+/* AMRSegFinish -- finish an AMR segment */
+
+static void AMRSegFinish(Inst inst)
+{
+  Seg seg = MustBeA(Seg, inst);
+  AMRSeg amrseg = MustBeA(AMRSeg, seg);
+
+  AVERT(AMRSeg, amrseg);
+  amrseg->sig = SigInvalid;
+
+  /* finish the superclass fields last */
+  NextMethod(Inst, AMRSeg, finish)(inst);
+}
+
+
+/* AMRSegMerge -- merge two AMR segments */
+
+static Res AMRSegMerge(Seg seg, Seg segHi, Addr base, Addr mid, Addr limit)
+{
+  AMRSeg amrseg = MustBeA(AMRSeg, seg);
+  AMRSeg amrsegHi = MustBeA(AMRSeg, segHi);
+  Bool evacuate;
+  Size forwarded;
+  Res res;
+
+  /* Segments in different generations can't be merged. */
+  AVER(amrseg->pgen == amrsegHi->pgen);
+
+  evacuate = amrseg->evacuate || amrsegHi->evacuate;
+  forwarded = amrseg->forwarded + amrsegHi->forwarded;
+
+  /* Merge the superclass fields via next-method call */
+  res = NextMethod(Seg, AMRSeg, merge)(seg, segHi, base, mid, limit);
+  if (res != ResOK)
+    return res;
+
+  amrseg->evacuate = evacuate;
+  amrseg->forwarded = forwarded;
+  amrseg->holeFree = 0;
+  amrsegHi->sig = SigInvalid;
+  AVERT(AMRSeg, amrseg);
+  return ResOK;
+}
+
+
+/* AMRSegSplit -- split an AMR segment in two */
+
+static Res AMRSegSplit(Seg seg, Seg segHi, Addr base, Addr mid, Addr limit)
+{
+  AMRSeg amrseg = MustBeA(AMRSeg, seg);
+  AMRSeg amrsegHi;
+  Res res;
+
+  /* Split the superclass fields via next-method call */
+  res = NextMethod(Seg, AMRSeg, split)(seg, segHi, base, mid, limit);
+  if (res != ResOK)
+    return res;
+
+  /* Full initialization for segHi.  The forwarded size stays with */
+  /* the lower segment, as it's only used for accounting. */
+  amrsegHi = (AMRSeg)segHi;
+  amrsegHi->evacuate = amrseg->evacuate;
+  amrsegHi->forwarded = 0;
+  amrsegHi->pgen = amrseg->pgen;
+  amrsegHi->holeGrains = 0;
+  amrsegHi->holeFree = 0;
+  amrseg->holeFree = 0;
+  amrsegHi->sig = AMRSegSig;
+  AVERT(AMRSeg, amrseg);
+  AVERT(AMRSeg, amrsegHi);
+  return ResOK;
+}
+
+
+/* AMRSegDescribe -- describe an AMR segment */
+
+static Res AMRSegDescribe(Inst inst, mps_lib_FILE *stream, Count depth)
+{
+  AMRSeg amrseg = CouldBeA(AMRSeg, inst);
+  Res res;
+
+  if (!TESTC(AMRSeg, amrseg))
+    return ResPARAM;
+  if (stream == NULL)
+    return ResPARAM;
+
+  /* Describe the superclass fields first via next-method call */
+  res = NextMethod(Inst, AMRSeg, describe)(inst, stream, depth);
+  if (res != ResOK)
+    return res;
+
+  return WriteF(stream, depth + 2,
+                "evacuate $S\n", WriteFYesNo(amrseg->evacuate),
+                "forwarded $W\n", (WriteFW)amrseg->forwarded,
+                "pgen $P\n", (WriteFP)amrseg->pgen,
+                "holeGrains $U\n", (WriteFU)amrseg->holeGrains,
+                "holeFree $U\n", (WriteFU)amrseg->holeFree,
+                NULL);
+}
+
+
+/* amrSegBufferFill -- fill a buffer from whole free lines
+ *
+ * If the segment has holes, only the whole lines in a hole can be
+ * used, so that buffers aren't placed in the gaps between surviving
+ * objects.  Otherwise all the free space is in one range, and AMS
+ * finds it.  <design/poolamr#.line>
+ */
+
+static Bool amrSegBufferFill(Addr *baseReturn, Addr *limitReturn,
+                             Seg seg, Size size, RankSet rankSet)
+{
+  AMRSeg amrseg = MustBeA(AMRSeg, seg);
+  AMSSeg amsseg = MustBeA(AMSSeg, seg);
+  Pool pool = SegPool(seg);
+  AMR amr = MustBeA(AMRPool, pool);
+  Count requestedGrains, lineGrains;
+  Index searchBase, baseIndex, limitIndex, lineBase, lineLimit;
+
+  AVER(baseReturn != NULL);
+  AVER(limitReturn != NULL);
+  AVER(SizeIsAligned(size, PoolAlignment(pool)));
+  AVER(size > 0);
+  AVERT(RankSet, rankSet);
+
+  if (!amsseg->allocTableInUse || amsseg->freeGrains == amsseg->grains)
+    return NextMethod(Seg, AMRSeg, bufferFill)(baseReturn, limitReturn,
+                                               seg, size, rankSet);
+
+  /* See amsSegBufferFill for why these segments can't be used. */
+  requestedGrains = PoolSizeGrains(pool, size);
+  if (amsseg->freeGrains < requestedGrains
+      || SegHasBuffer(seg)
+      || TraceSetUnion(SegWhite(seg), SegGrey(seg)) != TraceSetEMPTY
+      || rankSet != SegRankSet(seg))
+    return FALSE;
+  AVER(!amsseg->colourTablesInUse);
+
+  /* Don't search again for a range that wasn't there last time. */
+  if (amsseg->freeGrains <= amrseg->holeFree
+      && requestedGrains >= amrseg->holeGrains)
+    return FALSE;
+
+  lineGrains = amr->lineGrains;
+  searchBase = 0;
+  while (amsseg->grains - searchBase >= requestedGrains
+         && BTFindLongResRange(&baseIndex, &limitIndex, amsseg->allocTable,
+                               searchBase, amsseg->grains, requestedGrains))
+  {
+    /* The segment limit counts as a line boundary. */
+    lineBase = (baseIndex + lineGrains - 1) / lineGrains * lineGrains;
+    if (limitIndex == amsseg->grains)
+      lineLimit = limitIndex;
+    else
+      lineLimit = limitIndex / lineGrains * lineGrains;
+    if (lineBase < lineLimit && lineLimit - lineBase >= requestedGrains) {
+      AMSSegBufferFillRange(baseReturn, limitReturn, seg,
+                            lineBase, lineLimit);
+      return TRUE;
+    }
+    searchBase = limitIndex;
+  }
+  amrseg->holeGrains = requestedGrains;
+  amrseg->holeFree = amsseg->freeGrains;
+  return FALSE;
+}
+
+
+/* amrSegShouldEvacuate -- should a segment's objects be evacuated?
+ *
+ * Only segments with holes are evacuated, and only if enough of them
+ * is free.  <design/poolamr#.evacuate.choose>
+ */
+
+static Bool amrSegShouldEvacuate(Seg seg)
+{
+  AMSSeg amsseg = MustBeA(AMSSeg, seg);
+  AMR amr = MustBeA(AMRPool, SegPool(seg));
+
+  return amr->forward != NULL
+    && !SegHasBuffer(seg)
+    && SegRankSet(seg) == RankSetSingle(RankEXACT)
+    && amsseg->allocTableInUse
+    && (double)amsseg->freeGrains
+       >= (double)amsseg->grains * AMR_EVACUATE_FREE;
+}
+
+
+/* amrSegWhiten -- condemn the segment for the trace
+ *
+ * If the forwarding buffer is on the segment, it is detached, because
+ * objects forwarded into it later would be allocated black.
+ */
+
+static Res amrSegWhiten(Seg seg, Trace trace)
+{
+  AMRSeg amrseg = MustBeA(AMRSeg, seg);
+  Pool pool = SegPool(seg);
+  Buffer buffer;
+  Bool evacuate;
+  Res res;
+
+  AVERT(Trace, trace);
+
+  if (SegBuffer(&buffer, seg) && !BufferIsMutator(buffer)) {
+    AVER(BufferIsReady(buffer));
+    BufferDetach(buffer, pool);
+  }
+
+  /* Decide before whitening changes the use of the alloc table. */
+  evacuate = amrSegShouldEvacuate(seg);
+
+  res = NextMethod(Seg, AMRSeg, whiten)(seg, trace);
+  if (res != ResOK)
+    return res;
+
+  if (TraceSetIsMember(SegWhite(seg), trace)) {
+    amrseg->evacuate = evacuate;
+    amrseg->forwarded = 0;
+  }
+  return ResOK;
+}
+
+
+/* amrSegFix -- fix a reference to the segment
+ *
+ * An exact or final reference to a white object in a segment that is
+ * being evacuated causes the object to be copied, as in amcSegFix.
+ * Pinned objects, and segments that aren't being evacuated, are marked
+ * in place by AMS.  An ambiguous reference stops the segment being
+ * evacuated.  <design/poolamr#.fix>
+ */
+
+static Res amrSegFix(Seg seg, ScanState ss, Ref *refIO)
+{
+  AMRSeg amrseg = MustBeA_CRITICAL(AMRSeg, seg);
+  Pool pool;
+  AMR amr;
+  Arena arena;
+  Format format;
+  Ref ref;             /* reference to be fixed */
+  Addr base;           /* base address of reference */
+  Ref newRef;          /* new location, if moved */
+  Addr newBase;        /* base address of new copy */
+  Size length;         /* length of object to be evacuated */
+  Buffer buffer;       /* buffer to allocate new copy into */
+  Seg toSeg;           /* segment to which object is being evacuated */
+  Size toAlias;        /* offset of toSeg's collector alias, or 0 */
+  TraceSet grey;       /* greyness of object being evacuated */
+  Index i;
+  Res res;
+
+  AVERT_CRITICAL(ScanState, ss);
+  AVER_CRITICAL(refIO != NULL);
+
+  if (ss->rank == RankAMBIG && amrseg->evacuate) {
+    /* It might point into the middle of an object, which can't be */
+    /* found, so nothing in the segment can be moved.  Ambiguous */
+    /* references are only fixed when the trace flips, before any */
+    /* objects have been evacuated.  <design/poolamr#.fix.ambig> */
+    AVER_CRITICAL(amrseg->forwarded == 0);
+    amrseg->evacuate = FALSE;
+  }
+  if (!amrseg->evacuate)
+    return NextMethod(Seg, AMRSeg, fix)(seg, ss, refIO);
+
+  pool = SegPool(seg);
+  amr = MustBeA_CRITICAL(AMRPool, pool);
+  arena = PoolArena(pool);
+  format = pool->format;
+  ref = *refIO;
+  base = AddrSub((Addr)ref, format->headerSize);
+  AVER_CRITICAL(SegBase(seg) <= base);
+  AVER_CRITICAL(ref < SegLimit(seg)); /* see .ref-limit in poolamc.c */
+  AVER_CRITICAL(AddrIsAligned(base, PoolAlignment(pool)));
+  i = PoolIndexOfAddr(SegBase(seg), pool, base);
+  AVER_CRITICAL(AMS_ALLOCED(seg, i));
+
+  /* .exposed.seg: Statements tagged ".exposed.seg" below require */
+  /* that "seg" (that is: the 'from' seg) has been ShieldExposed. */
+  ShieldExpose(arena, seg);
+  newRef = (*format->isMoved)(ref);  /* .exposed.seg */
+  if (newRef == (Ref)0) {
+    /* Already marked in place, because it's pinned. */
+    if (!AMS_IS_WHITE(seg, i)) {
+      ShieldCover(arena, seg);
+      return ResOK;
+    }
+
+    /* A weak reference to an object that hasn't been evacuated is */
+    /* splatted by AMS, and a pinned object is marked in place. */
+    if (ss->rank == RankWEAK || (*format->isPinned)(ref)) {
+      ShieldCover(arena, seg);
+      return NextMethod(Seg, AMRSeg, fix)(seg, ss, refIO);
+    }
+
+    ss->wasMarked = FALSE; /* <design/fix#.was-marked.not> */
+    length = AddrOffset(ref, (*format->skip)(ref));  /* .exposed.seg */
+    buffer = amr->forward;
+    do {
+      res = BUFFER_RESERVE(&newBase, buffer, length);
+      if (res != ResOK)
+        goto returnRes;
+      newRef = AddrAdd(newBase, format->headerSize);
+
+      /* The copy goes through the collector alias of toSeg, as in */
+      /* amcSegFix.  See <design/shield#.alias>. */
+      toSeg = BufferSeg(buffer);
+      toAlias = ShieldExposeAlias(arena, toSeg);
+
+      /* Since we're moving an object from one segment to another, */
+      /* union the greyness and the summaries together. */
+      grey = TraceSetUnion(SegGrey(seg), ss->traces);
+      SegSetSummary(toSeg, RefSetUnion(SegSummary(toSeg), SegSummary(seg)));
+      SegSetGrey(toSeg, TraceSetUnion(SegGrey(toSeg), grey));
+
+      /* <design/trace#.fix.copy> */
+      (void)AddrCopy(AddrAlias(newBase, toAlias), base,
+                     length);  /* .exposed.seg */
+      ShieldCoverAlias(arena, toSeg, toAlias);
+    } while (!BUFFER_COMMIT(buffer, newBase, length));
+
+    STATISTIC(++ss->forwardedCount);
+    STATISTIC(ss->copiedSize += length);
+    amrseg->forwarded += length;
+
+    (*format->move)(ref, newRef);  /* .exposed.seg */
+  } else {
+    /* reference to broken heart, which is snapped out */
+    STATISTIC(++ss->snapCount);
+  }
+
+  *refIO = newRef;
+  res = ResOK;
+
+returnRes:
+  ShieldCover(arena, seg);  /* .exposed.seg */
+  return res;
+}
+
+
+/* amrSegFixEmergency -- fix a reference, without allocating
+ *
+ * References to objects that have already been evacuated are snapped
+ * out, and everything else is marked in place.
+ */
+
+static Res amrSegFixEmergency(Seg seg, ScanState ss, Ref *refIO)
+{
+  AMRSeg amrseg = MustBeA(AMRSeg, seg);
+  Pool pool = SegPool(seg);
+  Arena arena = PoolArena(pool);
+  Ref newRef;
+
+  AVERT(ScanState, ss);
+  AVER(refIO != NULL);
+
+  if (ss->rank == RankAMBIG && amrseg->evacuate) {
+    /* See amrSegFix. */
+    AVER(amrseg->forwarded == 0);
+    amrseg->evacuate = FALSE;
+  }
+  if (amrseg->evacuate) {
+    ShieldExpose(arena, seg);
+    newRef = (*pool->format->isMoved)(*refIO);
+    ShieldCover(arena, seg);
+    if (newRef != (Ref)0) {
+      STATISTIC(++ss->snapCount);
+      *refIO = newRef;
+      return ResOK;
+    }
+  }
+
+  return NextMethod(Seg, AMRSeg, fixEmergency)(seg, ss, refIO);
+}
+
+
+/* amrSegReclaim -- reclaim a segment
+ *
+ * AMS reclaims the evacuated objects along with the dead ones, and
+ * only counts the objects that were marked in place as survivors.  It
+ * may free the segment, so account for the evacuated objects first.
+ */
+
+static Bool amrSegReclaim(Seg seg, Trace trace)
+{
+  AMRSeg amrseg = MustBeA(AMRSeg, seg);
+  Pool pool = SegPool(seg);
+
+  AVERT(Trace, trace);
+
+  if (amrseg->forwarded > 0)
+    GenDescSurvived(PoolSegPoolGen(pool, seg)->gen, trace,
+                    amrseg->forwarded, 0);
+  amrseg->evacuate = FALSE;
+  amrseg->forwarded = 0;
+
+  return NextMethod(Seg, AMRSeg, reclaim)(seg, trace);
+}
+
+
+/* AMRSegClass -- Class definition for AMR segments */
+
+DEFINE_CLASS(Seg, AMRSeg, klass)
+{
+  INHERIT_CLASS(klass, AMRSeg, AMSSeg);
+  klass->instClassStruct.describe = AMRSegDescribe;
+  klass->instClassStruct.finish = AMRSegFinish;
+  klass->size = sizeof(AMRSegStruct);
+  klass->init = AMRSegInit;
+  klass->bufferFill = amrSegBufferFill;
+  klass->merge = AMRSegMerge;
+  klass->split = AMRSegSplit;
+  klass->whiten = amrSegWhiten;
+  klass->fix = amrSegFix;
+  klass->fixEmergency = amrSegFixEmergency;
+  klass->reclaim = amrSegReclaim;
+  AVERT(SegClass, klass);
+}
+
+
+/* AMRSegSizePolicy -- pick a segment size
+ *
+ * Segments are at least AMR_SEG_SIZE, so that they have enough lines
+ * for holes to be worth reusing.  <design/poolamr#.seg>
+ */
+
+static Res AMRSegSizePolicy(Size *sizeReturn,
+                            Pool pool, Size size, RankSet rankSet)
+{
+  AVER(sizeReturn != NULL);
+  AVERT(Pool, pool);
+  AVER(size > 0);
+  AVERT(RankSet, rankSet);
+
+  if (size < AMR_SEG_SIZE)
+    size = AMR_SEG_SIZE;
+  size = SizeArenaGrains(size, PoolArena(pool));
+  if (size == 0) {
+    /* overflow */
+    return ResMEMORY;
+  }
+  *sizeReturn = size;
+  return ResOK;
+}
+
+
+/* amrSegPoolGen -- get pool generation for an AMR segment */
+
+static PoolGen amrSegPoolGen(Pool pool, Seg seg)
+{
+  AMRSeg amrseg = MustBeA(AMRSeg, seg);
+  AVERT(Pool, pool);
+  AVER(pool == SegPool(seg));
+  return amrseg->pgen;
+}
+
+
+/* AMRBufferFill -- the pool class buffer fill method
+ *
+ * As AMSBufferFill, except that the forwarding buffer is only filled
+ * from segments in the promotion generation, and the mutator's buffers
+ * from segments in the pool's generation.  <design/poolamr#.gen>
+ */
+
+static Res AMRBufferFill(Addr *baseReturn, Addr *limitReturn,
+                         Pool pool, Buffer buffer, Size size)
+{
+  AMR amr = MustBeA(AMRPool, pool);
+  PoolGen pgen;
+  Ring node, nextNode;
+  RankSet rankSet;
+  Seg seg;
+  Bool b;
+  Res res;
+
+  AVER(baseReturn != NULL);
+  AVER(limitReturn != NULL);
+  AVERC(Buffer, buffer);
+  AVER(BufferIsReset(buffer));
+  AVER(size > 0);
+  AVER(SizeIsAligned(size, PoolAlignment(pool)));
+
+  /* Check that we're not in the grey mutator phase */
+  /* <design/poolams#.fill.colour>.  The forwarding buffer may be */
+  /* filled while a trace is flipping. */
+  AVER(!BufferIsMutator(buffer)
+       || PoolArena(pool)->busyTraces == PoolArena(pool)->flippedTraces);
+
+  if (BufferIsMutator(buffer))
+    pgen = AMR2AMS(amr)->pgen;
+  else {
+    pgen = amr->promoteGen;
+    /* <design/trace#.multi.policy> */
+    AVER(!PoolGenIsNursery(pgen));
+  }
+
+  /* <design/poolams#.fill.slow> */
+  rankSet = BufferRankSet(buffer);
+  RING_FOR(node, &pool->segRing, nextNode) {
+    seg = SegOfPoolRing(node);
+    /* <design/trace#.reclaim.lazy.fill> */
+    if (MustBeA(AMRSeg, seg)->pgen == pgen
+        && TraceSegReclaim(PoolArena(pool), seg)
+        && SegBufferFill(baseReturn, limitReturn, seg, size, rankSet))
+      return ResOK;
+  }
+
+  /* No segment had enough space, so make a new one. */
+  MPS_ARGS_BEGIN(args) {
+    MPS_ARGS_ADD_FIELD(args, amrKeySegGen, p, pgen);
+    res = AMSSegCreate(&seg, pool, pgen, size, rankSet, args);
+  } MPS_ARGS_END(args);
+  if (res != ResOK)
+    return res;
+  b = SegBufferFill(baseReturn, limitReturn, seg, size, rankSet);
+  AVER(b);
+  return ResOK;
+}
+
+
+/* AMRVarargs -- decode obsolete varargs */
+
+static void AMRVarargs(ArgStruct args[MPS_ARGS_MAX], va_list varargs)
+{
+  args[0].key = MPS_KEY_FORMAT;
+  args[0].val.format = va_arg(varargs, Format);
+  args[1].key = MPS_KEY_CHAIN;
+  args[1].val.chain = va_arg(varargs, Chain);
+  args[2].key = MPS_KEY_ARGS_END;
+  AVERT(ArgList, args);
+}
+
+
+/* amrPromoteGenInit -- initialize the promotion generation
+ *
+ * AMSInit has consumed the chain and generation arguments, so find the
+ * chain from the pool's generation.  If it's the last in its chain (or
+ * the arena's top generation), objects are evacuated within it.
+ * <design/poolamr#.gen>
+ */
+
+static Res amrPromoteGenInit(AMR amr)
+{
+  AMS ams = AMR2AMS(amr);
+  Pool pool = AMSPool(ams);
+  GenDesc gen = ams->pgen->gen;
+  Ring node, nextNode;
+  size_t i;
+  Res res;
+
+  RING_FOR(node, &PoolArena(pool)->chainRing, nextNode) {
+    Chain chain = RING_ELT(Chain, chainRing, node);
+    for (i = 0; i < chain->genCount; ++i)
+      if (&chain->gens[i] == gen) {
+        res = PoolGenInit(&amr->promoteGenStruct, ChainGen(chain, i + 1),
+                          pool);
+        if (res != ResOK)
+          return res;
+        amr->promoteGen = &amr->promoteGenStruct;
+        return ResOK;
+      }
+  }
+  amr->promoteGen = ams->pgen;
+  return ResOK;
+}
+
+
+/* AMRInit -- the pool class initialization method
+ *
+ * Takes the same arguments as AMS, except that AMR always supports
+ * ambiguous references.  <design/poolamr#.init>
+ */
+
+static Res AMRInit(Pool pool, Arena arena, PoolClass klass, ArgList args)
+{
+  AMR amr;
+  AMS ams;
+  Res res;
+
+  res = NextMethod(Pool, AMRPool, init)(pool, arena, klass, args);
+  if (res != ResOK)
+    goto failNextInit;
+  amr = CouldBeA(AMRPool, pool);
+  ams = MustBeA(AMSPool, pool);
+
+  res = amrPromoteGenInit(amr);
+  if (res != ResOK)
+    goto failGenInit;
+
+  /* The alloc table is needed to find objects during a collection. */
+  ams->shareAllocTable = FALSE;
+  ams->segSize = AMRSegSizePolicy;
+  ams->segClass = AMRSegClassGet;
+  amr->lineGrains = PoolSizeGrains(pool, SizeAlignUp(AMR_LINE_SIZE,
+                                                     PoolAlignment(pool)));
+  amr->forward = NULL;
+
+  SetClassOfPoly(pool, CLASS(AMRPool));
+  amr->sig = AMRSig;
+  AVERC(AMRPool, amr);
+
+  /* Objects can only be evacuated if the format can move them. */
+  if (FormatIsMoving(pool->format)) {
+    MPS_ARGS_BEGIN(bufArgs) {
+      MPS_ARGS_ADD_FIELD(bufArgs, MPS_KEY_RANK, rank, RankEXACT);
+      res = BufferCreate(&amr->forward, CLASS(RankBuf), pool, FALSE,
+                         bufArgs);
+    } MPS_ARGS_END(bufArgs);
+    if (res != ResOK)
+      goto failBufferCreate;
+  }
+
+  return ResOK;
+
+failBufferCreate:
+  amr->forward = NULL;
+  if (amr->promoteGen != ams->pgen)
+    PoolGenFinish(amr->promoteGen);
+  amr->promoteGen = NULL;
+failGenInit:
+  NextMethod(Inst, AMRPool, finish)(MustBeA(Inst, pool));
+failNextInit:
+  AVER(res != ResOK);
+  return res;
+}
+
+
+/* AMRFinish -- the pool class finishing method */
+
+static void AMRFinish(Inst inst)
+{
+  Pool pool = MustBeA(AbstractPool, inst);
+  AMR amr = MustBeA(AMRPool, pool);
+  AMS ams = MustBeA(AMSPool, pool);
+
+  AVERT(AMR, amr);
+
+  /* The forwarding buffer must be gone before the segments are. */
+  if (amr->forward != NULL)
+    BufferDestroy(amr->forward);
+
+  /* AMSFinish destroys the segments, but the promotion generation */
+  /* must be finished while the pool is still valid, so destroy them */
+  /* now.  AMSFinish will find none left. */
+  ams->segsDestroy(ams);
+  if (amr->promoteGen != ams->pgen)
+    PoolGenFinish(amr->promoteGen);
+  amr->promoteGen = NULL;
+  amr->sig = SigInvalid;
+
+  NextMethod(Inst, AMRPool, finish)(inst);
+}
+
+
+/* AMRDescribe -- the pool class description method */
+
+static Res AMRDescribe(Inst inst, mps_lib_FILE *stream, Count depth)
+{
+  Pool pool = CouldBeA(AbstractPool, inst);
+  AMR amr = CouldBeA(AMRPool, pool);
+  Res res;
+
+  if (!TESTC(AMRPool, amr))
+    return ResPARAM;
+  if (stream == NULL)
+    return ResPARAM;
+
+  res = WriteF(stream, depth + 2,
+               "lineGrains $W\n", (WriteFW)amr->lineGrains,
+               "forward $P\n", (WriteFP)amr->forward,
+               "promoteGen $P\n", (WriteFP)amr->promoteGen,
+               NULL);
+  if (res != ResOK)
+    return res;
+
+  return NextMethod(Inst, AMRPool, describe)(inst, stream, depth);
+}
+
+
+/* AMRTotalSize -- total memory allocated from the arena */
+
+static Size AMRTotalSize(Pool pool)
+{
+  AMR amr = MustBeA(AMRPool, pool);
+  Size size = NextMethod(Pool, AMRPool, totalSize)(pool);
+
+  if (amr->promoteGen != AMR2AMS(amr)->pgen)
+    size += amr->promoteGen->totalSize;
+  return size;
+}
+
+
+/* AMRFreeSize -- free memory (unused by client program) */
+
+static Size AMRFreeSize(Pool pool)
+{
+  AMR amr = MustBeA(AMRPool, pool);
+  Size size = NextMethod(Pool, AMRPool, freeSize)(pool);
+
+  if (amr->promoteGen != AMR2AMS(amr)->pgen)
+    size += amr->promoteGen->freeSize;
+  return size;
+}
+
+
+/* AMRPoolClass -- the class definition */
+
+DEFINE_CLASS(Pool, AMRPool, klass)
+{
+  INHERIT_CLASS(klass, AMRPool, AMSPool);
+  klass->instClassStruct.describe = AMRDescribe;
+  klass->instClassStruct.finish = AMRFinish;
+  klass->size = sizeof(AMRStruct);
+  klass->attr |= AttrMOVINGGC;
+  klass->varargs = AMRVarargs;
+  klass->init = AMRInit;
+  klass->bufferFill = AMRBufferFill;
+  klass->segPoolGen = amrSegPoolGen;
+  klass->totalSize = AMRTotalSize;
+  klass->freeSize = AMRFreeSize;
+  AVERT(PoolClass, klass);
+}
+
+
+/* mps_class_amr -- return the AMR pool class descriptor */
+
+mps_pool_class_t mps_class_amr(void)
+{
+  return (mps_pool_class_t)CLASS(AMRPool);
+}
+
+
+/* C. COPYRIGHT AND LICENSE
+ *
+ * Copyright (C) 2026 Ravenbrook Limited <https://www.ravenbrook.com/>.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+ * IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
@@ -32,8 +32,10 @@ static void amsSegBufferEmpty(Seg seg, Buffer buffer);
 static void amsSegBlacken(Seg seg, TraceSet traceSet);
 static Res amsSegWhiten(Seg seg, Trace trace);
 static Res amsSegScan(Bool *totalReturn, Seg seg, ScanState ss);
+static Res amsSegScanArea(Addr *baseIO, Addr *limitIO,
+                          Seg seg, ScanState ss);
 static Res amsSegFix(Seg seg, ScanState ss, Ref *refIO);
-static void amsSegReclaim(Seg seg, Trace trace);
+static Bool amsSegReclaim(Seg seg, Trace trace);
 static void amsSegWalk(Seg seg, Format format, FormattedObjectsVisitor f,
                        void *p, size_t s);
 
@@ -267,6 +269,7 @@ static Res AMSSegInit(Seg seg, Pool pool, Addr base, Size size, ArgList args)
   amsseg->firstFree = 0;
   amsseg->colourTablesInUse = FALSE;
   amsseg->ams = ams;
+  SegSetFixFast(seg, SegFixFastMARK, amsseg->nonwhiteTable); /* .fix.fast */
   SetClassOfPoly(seg, CLASS(AMSSeg));
   amsseg->sig = AMSSegSig;
   AVERC(AMSSeg, amsseg);
@@ -390,12 +393,13 @@ static Res AMSSegMerge(Seg seg, Seg segHi,
   amsseg->bufferedGrains = amsseg->bufferedGrains + amssegHi->bufferedGrains;
   amsseg->newGrains = amsseg->newGrains + amssegHi->newGrains;
   amsseg->oldGrains = amsseg->oldGrains + amssegHi->oldGrains;
+  SegSetFixFast(seg, SegFixFastMARK, amsseg->nonwhiteTable); /* .fix.fast */
   /* other fields in amsseg are unaffected */
 
   amssegHi->sig = SigInvalid;
 
   AVERT(AMSSeg, amsseg);
-  PoolGenAccountForSegMerge(ams->pgen);
+  PoolGenAccountForSegMerge(PoolSegPoolGen(SegPool(seg), seg));
   return ResOK;
 
 failSuper:
@@ -492,10 +496,12 @@ static Res AMSSegSplit(Seg seg, Seg segHi,
   /* use colour tables if the segment is white */
   amssegHi->colourTablesInUse = (SegWhite(segHi) != TraceSetEMPTY);
   amssegHi->ams = ams;
+  SegSetFixFast(seg, SegFixFastMARK, amsseg->nonwhiteTable); /* .fix.fast */
+  SegSetFixFast(segHi, SegFixFastMARK, amssegHi->nonwhiteTable);
   amssegHi->sig = AMSSegSig;
   AVERT(AMSSeg, amsseg);
   AVERT(AMSSeg, amssegHi);
-  PoolGenAccountForSegSplit(ams->pgen);
+  PoolGenAccountForSegSplit(PoolSegPoolGen(SegPool(seg), seg));
   return ResOK;
 
 failSuper:
@@ -627,9 +633,11 @@ DEFINE_CLASS(Seg, AMSSeg, klass)
   klass->bufferEmpty = amsSegBufferEmpty;
   klass->merge = AMSSegMerge;
   klass->split = AMSSegSplit;
+  klass->access = SegPageAccess;
   klass->whiten = amsSegWhiten;
   klass->blacken = amsSegBlacken;
   klass->scan = amsSegScan;
+  klass->scanArea = amsSegScanArea;
   klass->fix = amsSegFix;
   klass->fixEmergency = amsSegFix;
   klass->reclaim = amsSegReclaim;
@@ -665,10 +673,14 @@ static Res AMSSegSizePolicy(Size *sizeReturn,
 }
 
 
-/* AMSSegCreate -- create a single AMSSeg */
+/* AMSSegCreate -- create a single AMSSeg in a pool generation
+ *
+ * The arguments are passed to the segment class's init method, so that
+ * a subclass can record the generation.  See <design/poolamr#.gen>.
+ */
 
-static Res AMSSegCreate(Seg *segReturn, Pool pool, Size size,
-                        RankSet rankSet)
+Res AMSSegCreate(Seg *segReturn, Pool pool, PoolGen pgen, Size size,
+                 RankSet rankSet, ArgList args)
 {
   Seg seg;
   AMS ams;
@@ -678,8 +690,10 @@ static Res AMSSegCreate(Seg *segReturn, Pool pool, Size size,
 
   AVER(segReturn != NULL);
   AVERT(Pool, pool);
+  AVERT(PoolGen, pgen);
   AVER(size > 0);
   AVERT(RankSet, rankSet);
+  AVERT(ArgList, args);
 
   ams = PoolAMS(pool);
   AVERT(AMS,ams);
@@ -689,14 +703,12 @@ static Res AMSSegCreate(Seg *segReturn, Pool pool, Size size,
   if (res != ResOK)
     goto failSize;
 
-  res = PoolGenAlloc(&seg, ams->pgen, (*ams->segClass)(), prefSize,
-                     argsNone);
+  res = PoolGenAlloc(&seg, pgen, (*ams->segClass)(), prefSize, args);
   if (res != ResOK) { /* try to allocate one that's just large enough */
     Size minSize = SizeArenaGrains(size, arena);
     if (minSize == prefSize)
       goto failSeg;
-    res = PoolGenAlloc(&seg, ams->pgen, (*ams->segClass)(), prefSize,
-                       argsNone);
+    res = PoolGenAlloc(&seg, pgen, (*ams->segClass)(), minSize, args);
     if (res != ResOK)
       goto failSeg;
   }
@@ -736,7 +748,7 @@ static void AMSSegsDestroy(AMS ams)
     AVER(amsseg->ams == ams);
     AVER(amsseg->bufferedGrains == 0);
     AMSSegFreeCheck(amsseg);
-    PoolGenFree(ams->pgen, seg,
+    PoolGenFree(PoolSegPoolGen(pool, seg), seg,
                 PoolGrainsSize(pool, amsseg->freeGrains),
                 PoolGrainsSize(pool, amsseg->oldGrains),
                 PoolGrainsSize(pool, amsseg->newGrains),
@@ -816,7 +828,10 @@ static Res AMSInit(Pool pool, Arena arena, PoolClass klass, ArgList args)
   pool->alignShift = SizeLog2(pool->alignment);
   /* .ambiguous.noshare: If the pool is required to support ambiguous */
   /* references, the alloc and white tables cannot be shared. */
-  ams->shareAllocTable = !supportAmbiguous;
+  /* .multi.noshare: Nor can they if more than one trace can run, as */
+  /* a segment that is white for one trace may have to be scanned */
+  /* whole for another.  <design/poolams#.init.share> */
+  ams->shareAllocTable = !supportAmbiguous && TraceLIMIT == 1;
   ams->pgen = NULL;
 
   /* The next four might be overridden by a subclass. */
@@ -875,8 +890,7 @@ static Bool amsSegBufferFill(Addr *baseReturn, Addr *limitReturn,
   Index baseIndex, limitIndex;
   AMSSeg amsseg = MustBeA(AMSSeg, seg);
   Pool pool = SegPool(seg);
-  Count requestedGrains, segGrains, allocatedGrains;
-  Addr segBase, base, limit;
+  Count requestedGrains, segGrains;
 
   AVER(baseReturn != NULL);
   AVER(limitReturn != NULL);
@@ -924,14 +938,40 @@ static Bool amsSegBufferFill(Addr *baseReturn, Addr *limitReturn,
   }
 
 found:
+  AVER(requestedGrains <= limitIndex - baseIndex);
+  AMSSegBufferFillRange(baseReturn, limitReturn, seg, baseIndex, limitIndex);
+  return TRUE;
+}
+
+
+/* AMSSegBufferFillRange -- fill buffer from a free range of grains
+ *
+ * Allocates the free grains from baseIndex to limitIndex to a buffer,
+ * returning the addresses of the range.  This is the part of
+ * amsSegBufferFill that doesn't depend on how the range was found, so
+ * that subclasses can search the segment differently.
+ */
+void AMSSegBufferFillRange(Addr *baseReturn, Addr *limitReturn,
+                           Seg seg, Index baseIndex, Index limitIndex)
+{
+  AMSSeg amsseg = MustBeA(AMSSeg, seg);
+  Pool pool = SegPool(seg);
+  Count allocatedGrains;
+  Addr segBase, base, limit;
+
+  AVER(baseReturn != NULL);
+  AVER(limitReturn != NULL);
   AVER(baseIndex < limitIndex);
+  AVER(limitIndex <= amsseg->grains);
+
   if (amsseg->allocTableInUse) {
+    AVER(BTIsResRange(amsseg->allocTable, baseIndex, limitIndex));
     BTSetRange(amsseg->allocTable, baseIndex, limitIndex);
   } else {
+    AVER(amsseg->firstFree <= baseIndex);
     amsseg->firstFree = limitIndex;
   }
   allocatedGrains = limitIndex - baseIndex;
-  AVER(requestedGrains <= allocatedGrains);
   AVER(amsseg->freeGrains >= allocatedGrains);
   amsseg->freeGrains -= allocatedGrains;
   amsseg->bufferedGrains += allocatedGrains;
@@ -944,7 +984,6 @@ found:
 
   *baseReturn = base;
   *limitReturn = limit;
-  return TRUE;
 }
 
 
@@ -970,19 +1009,24 @@ static Res AMSBufferFill(Addr *baseReturn, Addr *limitReturn,
   AVER(SizeIsAligned(size, PoolAlignment(pool)));
 
   /* Check that we're not in the grey mutator phase */
-  /* <design/poolams#.fill.colour>. */
-  AVER(PoolArena(pool)->busyTraces == PoolArena(pool)->flippedTraces);
+  /* <design/poolams#.fill.colour>.  A subclass's forwarding buffer */
+  /* may be filled while a trace is flipping. */
+  AVER(!BufferIsMutator(buffer)
+       || PoolArena(pool)->busyTraces == PoolArena(pool)->flippedTraces);
 
   /* <design/poolams#.fill.slow> */
   rankSet = BufferRankSet(buffer);
   RING_FOR(node, &pool->segRing, nextNode) {
     seg = SegOfPoolRing(node);
-    if (SegBufferFill(baseReturn, limitReturn, seg, size, rankSet))
+    /* <design/trace#.reclaim.lazy.fill> */
+    if (TraceSegReclaim(PoolArena(pool), seg)
+        && SegBufferFill(baseReturn, limitReturn, seg, size, rankSet))
       return ResOK;
   }
 
   /* No segment had enough space, so make a new one. */
-  res = AMSSegCreate(&seg, pool, size, BufferRankSet(buffer));
+  res = AMSSegCreate(&seg, pool, PoolAMS(pool)->pgen, size, rankSet,
+                     argsNone);
   if (res != ResOK)
     return res;
   b = SegBufferFill(baseReturn, limitReturn, seg, size, rankSet);
@@ -1416,7 +1460,134 @@ static Res amsSegScan(Bool *totalReturn, Seg seg, ScanState ss)
 }
 
 
-/* amsSegFix -- the segment fixing method */
+/* amsSegNextBlock -- find the limit of the object or other block at p
+ *
+ * Sets *objectReturn to TRUE if there's an object at p, and FALSE if
+ * it's a free block or the unscannable part of the buffer.  See
+ * semSegIterate, which steps through the segment the same way.
+ */
+
+static Addr amsSegNextBlock(Bool *objectReturn, Seg seg, Addr p)
+{
+  AMSSeg amsseg = Seg2AMSSeg(seg);
+  Pool pool = SegPool(seg);
+  Format format = pool->format;
+  Buffer buffer;
+  Index i;
+  Addr next;
+
+  i = PoolIndexOfAddr(SegBase(seg), pool, p);
+  if (SegBuffer(&buffer, seg) && p == BufferScanLimit(buffer)
+      && p != BufferLimit(buffer)) {
+    /* skip buffer */
+    next = BufferLimit(buffer);
+    *objectReturn = FALSE;
+  } else if (!AMS_ALLOCED(seg, i)) { /* no object here */
+    if (amsseg->allocTableInUse) {
+      Index dummy, nextIndex;
+      Bool more;
+
+      /* Find out how large the free block is. */
+      more = BTFindLongResRange(&dummy, &nextIndex, amsseg->allocTable,
+                                i, amsseg->grains, 1);
+      AVER(more);
+      AVER(dummy == i);
+      next = PoolAddrOfIndex(SegBase(seg), pool, nextIndex);
+    } else {
+      /* If there's no allocTable, this is the free block at the end. */
+      next = SegLimit(seg);
+    }
+    *objectReturn = FALSE;
+  } else { /* there is an object here */
+    if (format->skip != NULL) {
+      next = (*format->skip)(AddrAdd(p, format->headerSize));
+      next = AddrSub(next, format->headerSize);
+    } else {
+      next = AddrAdd(p, PoolAlignment(pool));
+    }
+    AVER(AddrIsAligned(next, PoolAlignment(pool)));
+    *objectReturn = TRUE;
+  }
+  AVER(next > p); /* make sure we make progress */
+  return next;
+}
+
+
+/* amsSegScanArea -- scan the objects that overlap an area
+ *
+ * Walks the segment from its base to find the objects that overlap
+ * the area, and scans them whatever their colour, so that the area
+ * holds no references to the white set.  The objects aren't
+ * blackened, and the segment will still be scanned whole, so if they
+ * are all the objects in the segment, scan nothing, and let the
+ * segment be scanned whole now.  Nor can the objects be found if the
+ * allocation table is in use as the white table.
+ * <design/write-barrier#.page>
+ */
+
+static Res amsSegScanArea(Addr *baseIO, Addr *limitIO,
+                          Seg seg, ScanState ss)
+{
+  AMSSeg amsseg = MustBeA(AMSSeg, seg);
+  Pool pool = SegPool(seg);
+  Format format;
+  Addr base, limit, p, next;
+  Bool object;
+  Index i;
+  Res res;
+
+  AVER(baseIO != NULL);
+  AVER(limitIO != NULL);
+  AVERT(ScanState, ss);
+  format = pool->format;
+  AVERT(Format, format);
+
+  if (amsseg->ams->shareAllocTable && amsseg->colourTablesInUse)
+    return ResUNIMPL;
+
+  /* Find the extent of the objects that overlap the area. */
+  base = *baseIO;
+  p = SegBase(seg);
+  while (p < *limitIO) {
+    next = amsSegNextBlock(&object, seg, p);
+    if (object && next > *baseIO && p < base)
+      base = p;
+    p = next;
+  }
+  limit = p;
+  AVER(limit <= SegLimit(seg));
+
+  i = PoolIndexOfAddr(SegBase(seg), pool, limit);
+  if (base == SegBase(seg)
+      && (i == amsseg->grains
+          || (amsseg->allocTableInUse
+              ? BTIsResRange(amsseg->allocTable, i, amsseg->grains)
+              : amsseg->firstFree <= i)))
+    return ResUNIMPL;
+
+  for (p = base; p < limit; p = next) {
+    next = amsSegNextBlock(&object, seg, p);
+    if (object) {
+      res = TraceScanFormat(ss, AddrAdd(p, format->headerSize),
+                            AddrAdd(next, format->headerSize));
+      if (res != ResOK)
+        return res;
+    }
+  }
+
+  *baseIO = base;
+  *limitIO = limit;
+  return ResOK;
+}
+
+
+/* amsSegFix -- the segment fixing method
+ *
+ * .fix.fast: This does nothing to an exact, final or weak reference
+ * to an object that is not white, so _mps_fix2 tests the nonwhite
+ * table itself and only calls this for white objects.  See
+ * <design/trace#.fix.fast>.
+ */
 
 static Res amsSegFix(Seg seg, ScanState ss, Ref *refIO)
 {
@@ -1556,7 +1727,7 @@ static void amsSegBlacken(Seg seg, TraceSet traceSet)
 
 /* amsSegReclaim -- the segment reclamation method */
 
-static void amsSegReclaim(Seg seg, Trace trace)
+static Bool amsSegReclaim(Seg seg, Trace trace)
 {
   AMSSeg amsseg = MustBeA(AMSSeg, seg);
   Pool pool = SegPool(seg);
@@ -1625,7 +1796,9 @@ static void amsSegReclaim(Seg seg, Trace trace)
                 PoolGrainsSize(pool, amsseg->oldGrains),
                 PoolGrainsSize(pool, amsseg->newGrains),
                 FALSE);
+    return TRUE;
   }
+  return FALSE;
 }
 
 
@@ -1776,6 +1949,7 @@ DEFINE_CLASS(Pool, AMSPool, klass)
   klass->instClassStruct.describe = AMSDescribe;
   klass->instClassStruct.finish = AMSFinish;
   klass->size = sizeof(AMSStruct);
+  klass->attr |= AttrPARSCAN;
   klass->varargs = AMSVarargs;
   klass->init = AMSInit;
   klass->bufferClass = RankBufClassGet;
@@ -157,6 +157,12 @@ extern Bool AMSCheck(AMS ams);
 
 #define AMSChain(ams) ((ams)->chain)
 
+extern Res AMSSegCreate(Seg *segReturn, Pool pool, PoolGen pgen,
+                        Size size, RankSet rankSet, ArgList args);
+extern void AMSSegBufferFillRange(Addr *baseReturn, Addr *limitReturn,
+                                  Seg seg, Index baseIndex,
+                                  Index limitIndex);
+
 extern void AMSSegFreeWalk(AMSSeg amsseg, FreeBlockVisitor f, void *p);
 
 extern void AMSSegFreeCheck(AMSSeg amsseg);
@@ -58,7 +58,7 @@ static void awlSegGreyen(Seg seg, Trace trace);
 static void awlSegBlacken(Seg seg, TraceSet traceSet);
 static Res awlSegScan(Bool *totalReturn, Seg seg, ScanState ss);
 static Res awlSegFix(Seg seg, ScanState ss, Ref *refIO);
-static void awlSegReclaim(Seg seg, Trace trace);
+static Bool awlSegReclaim(Seg seg, Trace trace);
 static void awlSegWalk(Seg seg, Format format, FormattedObjectsVisitor f,
                        void *p, size_t s);
 
@@ -229,6 +229,7 @@ static Res AWLSegInit(Seg seg, Pool pool, Addr base, Size size, ArgList args)
   awlseg->oldGrains = (Count)0;
   awlseg->singleAccesses = 0;
   awlStatSegInit(awlseg);
+  SegSetFixFast(seg, SegFixFastMARK, awlseg->mark); /* see awlSegFix */
 
   SetClassOfPoly(seg, CLASS(AWLSeg));
   awlseg->sig = AWLSegSig;
@@ -340,10 +341,20 @@ static Bool awlSegCanTrySingleAccess(Arena arena, Seg seg, Addr addr)
     return FALSE;
   }
 
-  /* The trace is already in the weak band, so we can scan the whole
+  /* The traces are already in the weak band, so we can scan the whole
      segment without retention anyway.  Go for it. */
-  if (TraceRankForAccess(arena, seg) == RankWEAK)
-    return FALSE;
+  {
+    TraceSet grey = TraceSetInter(SegGrey(seg), arena->flippedTraces);
+    Bool allWeak = TRUE;
+    TraceId ti;
+    Trace trace;
+    TRACE_SET_ITER(ti, trace, grey, arena)
+      if (TraceRankForAccess(trace, seg) != RankWEAK)
+        allWeak = FALSE;
+    TRACE_SET_ITER_END(ti, trace, grey, arena);
+    if (allWeak)
+      return FALSE;
+  }
 
   awlseg = MustBeA(AWLSeg, seg);
   awl = MustBeA(AWLPool, SegPool(seg));
@@ -652,7 +663,9 @@ static Res awlBufferFill(Addr *baseReturn, Addr *limitReturn,
   rankSet = BufferRankSet(buffer);
   RING_FOR(node, &pool->segRing, nextNode) {
     seg = SegOfPoolRing(node);
-    if (SegBufferFill(baseReturn, limitReturn, seg, size, rankSet))
+    /* <design/trace#.reclaim.lazy.fill> */
+    if (TraceSegReclaim(PoolArena(pool), seg)
+        && SegBufferFill(baseReturn, limitReturn, seg, size, rankSet))
       return ResOK;
   }
 
@@ -820,7 +833,11 @@ static void awlSegGreyen(Seg seg, Trace trace)
     AWLSeg awlseg = MustBeA(AWLSeg, seg);
 
     SegSetGrey(seg, TraceSetAdd(SegGrey(seg), trace));
-    if (SegBuffer(&buffer, seg)) {
+    if (SegWhite(seg) != TraceSetEMPTY) {
+      /* The colour tables belong to the trace for which the segment */
+      /* is white: leave them alone.  Scanning for this trace scans */
+      /* all the objects.  <design/trace#.multi.disjoint> */
+    } else if (SegBuffer(&buffer, seg)) {
       Addr base = SegBase(seg);
 
       awlSegRangeGreyen(awlseg,
@@ -844,7 +861,9 @@ static void awlSegBlacken(Seg seg, TraceSet traceSet)
 
   AVERT(TraceSet, traceSet);
 
-  BTSetRange(awlseg->scanned, 0, awlseg->grains);
+  /* Don't blacken objects that are grey for another trace. */
+  if (TraceSetSub(SegWhite(seg), traceSet))
+    BTSetRange(awlseg->scanned, 0, awlseg->grains);
 }
 
 
@@ -899,10 +918,16 @@ static Res awlSegScanSinglePass(Bool *anyScannedReturn, ScanState ss,
   Addr bufferScanLimit;
   Addr p;
   Addr hp;
+  Bool blacken;
 
   AVERT(ScanState, ss);
   AVERT(Bool, scanAllObjects);
 
+  /* If the segment is white for a trace we're not scanning for, its */
+  /* colour tables belong to that trace, and scanning the objects */
+  /* doesn't make them black for it.  <design/trace#.multi.disjoint> */
+  blacken = TraceSetSub(SegWhite(seg), ss->traces);
+
   *anyScannedReturn = FALSE;
   p = base;
   if (SegBuffer(&buffer, seg) && BufferScanLimit(buffer) != BufferLimit(buffer))
@@ -935,7 +960,8 @@ static Res awlSegScanSinglePass(Bool *anyScannedReturn, ScanState ss,
       if (res != ResOK)
         return res;
       *anyScannedReturn = TRUE;
-      BTSet(awlseg->scanned, i);
+      if (blacken)
+        BTSet(awlseg->scanned, i);
     }
     objectLimit = AddrSub(objectLimit, format->headerSize);
     AVER(p < objectLimit);
@@ -991,7 +1017,11 @@ static Res awlSegScan(Bool *totalReturn, Seg seg, ScanState ss)
 }
 
 
-/* awlSegFix -- Fix method for AWL segments */
+/* awlSegFix -- Fix method for AWL segments
+ *
+ * This does nothing to a reference to a marked object, so _mps_fix2
+ * tests the mark table itself.  See <design/trace#.fix.fast>.
+ */
 
 static Res awlSegFix(Seg seg, ScanState ss, Ref *refIO)
 {
@@ -1047,7 +1077,7 @@ static Res awlSegFix(Seg seg, ScanState ss, Ref *refIO)
 
 /* awlSegReclaim -- reclaim dead objects in an AWL segment */
 
-static void awlSegReclaim(Seg seg, Trace trace)
+static Bool awlSegReclaim(Seg seg, Trace trace)
 {
   AWLSeg awlseg = MustBeA(AWLSeg, seg);
   Pool pool = SegPool(seg);
@@ -1058,11 +1088,13 @@ static void awlSegReclaim(Seg seg, Trace trace)
   Format format = pool->format;
   Count reclaimedGrains = (Count)0;
   STATISTIC_DECL(Count preservedInPlaceCount = (Count)0)
-  Size preservedInPlaceSize = (Size)0;
+  Size preservedInPlaceSize;
   Index i;
 
   AVERT(Trace, trace);
 
+  /* The segment may be protected if it's grey for another trace. */
+  ShieldExpose(PoolArena(pool), seg);
   i = 0;
   while(i < awlseg->grains) {
     Addr p, q;
@@ -1090,7 +1122,6 @@ static void awlSegReclaim(Seg seg, Trace trace)
       BTSetRange(awlseg->mark, i, j);
       BTSetRange(awlseg->scanned, i, j);
       STATISTIC(++preservedInPlaceCount);
-      preservedInPlaceSize += AddrOffset(p, q);
     } else {
       BTResRange(awlseg->mark, i, j);
       BTSetRange(awlseg->scanned, i, j);
@@ -1100,6 +1131,7 @@ static void awlSegReclaim(Seg seg, Trace trace)
     i = j;
   }
   AVER(i == awlseg->grains);
+  ShieldCover(PoolArena(pool), seg);
 
   AVER(reclaimedGrains <= awlseg->grains);
   AVER(awlseg->oldGrains >= reclaimedGrains);
@@ -1109,6 +1141,10 @@ static void awlSegReclaim(Seg seg, Trace trace)
 
   STATISTIC(trace->reclaimSize += PoolGrainsSize(pool, reclaimedGrains));
   STATISTIC(trace->preservedInPlaceCount += preservedInPlaceCount);
+  /* Objects allocated since the segment was condemned are marked, but */
+  /* they weren't condemned, so they don't count as survivors: only */
+  /* the old grains do, as in <code/poolams.c>. */
+  preservedInPlaceSize = PoolGrainsSize(pool, awlseg->oldGrains);
   GenDescSurvived(pgen->gen, trace, 0, preservedInPlaceSize);
   SegSetWhite(seg, TraceSetDel(SegWhite(seg), trace));
 
@@ -1120,7 +1156,9 @@ static void awlSegReclaim(Seg seg, Trace trace)
                 PoolGrainsSize(pool, awlseg->oldGrains),
                 PoolGrainsSize(pool, awlseg->newGrains),
                 FALSE);
+    return TRUE;
   }
+  return FALSE;
 }
 
 
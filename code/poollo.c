@@ -59,6 +59,7 @@ typedef struct LOSegStruct {
   Count bufferedGrains;     /* grains in buffers */
   Count newGrains;          /* grains allocated since last collection */
   Count oldGrains;          /* grains allocated prior to last collection */
+  Bool ambiguousFixes;      /* marked by an ambiguous reference? */
   Sig sig;                  /* design.mps.sig.field.end.outer */
 } LOSegStruct;
 
@@ -73,7 +74,7 @@ static void loSegBufferEmpty(Seg seg, Buffer buffer);
 static Res loSegWhiten(Seg seg, Trace trace);
 static Res loSegScan(Bool *totalReturn, Seg seg, ScanState ss);
 static Res loSegFix(Seg seg, ScanState ss, Ref *refIO);
-static void loSegReclaim(Seg seg, Trace trace);
+static Bool loSegReclaim(Seg seg, Trace trace);
 static void loSegWalk(Seg seg, Format format, FormattedObjectsVisitor f,
                       void *p, size_t s);
 
@@ -110,6 +111,7 @@ static Bool LOSegCheck(LOSeg loseg)
   CHECKD(GCSeg, &loseg->gcSegStruct);
   CHECKL(loseg->mark != NULL);
   CHECKL(loseg->alloc != NULL);
+  CHECKL(BoolCheck(loseg->ambiguousFixes));
   /* Could check exactly how many bits are set in the alloc table. */
   CHECKL(loseg->freeGrains + loseg->bufferedGrains + loseg->newGrains
          + loseg->oldGrains
@@ -150,6 +152,8 @@ static Res loSegInit(Seg seg, Pool pool, Addr base, Size size, ArgList args)
   loseg->bufferedGrains = (Count)0;
   loseg->newGrains = (Count)0;
   loseg->oldGrains = (Count)0;
+  loseg->ambiguousFixes = FALSE;
+  SegSetFixFast(seg, SegFixFastMARK, loseg->mark); /* see loSegFix */
 
   SetClassOfPoly(seg, CLASS(LOSeg));
   loseg->sig = LOSegSig;
@@ -300,72 +304,85 @@ static void loSegBufferEmpty(Seg seg, Buffer buffer)
 
 /* loSegReclaim -- reclaim white objects in an LO segment
  *
- * Could consider implementing this using Walk.
+ * Free grains are skipped, and dead objects freed, a word of the bit
+ * tables at a time.  The format is only needed to find the end of
+ * each preserved object.  <design/poollo#.fun.segreclaim>
  */
 
-static void loSegReclaim(Seg seg, Trace trace)
+static Bool loSegReclaim(Seg seg, Trace trace)
 {
   LOSeg loseg = MustBeA(LOSeg, seg);
   Pool pool = SegPool(seg);
   PoolGen pgen = PoolSegPoolGen(pool, seg);
-  Addr p, base, limit;
+  Addr base;
   Buffer buffer;
   Bool hasBuffer = SegBuffer(&buffer, seg);
-  Count reclaimedGrains = (Count)0;
+  Count grains, reclaimedGrains = (Count)0;
+  Index i, bufferBase, bufferLimit;
   Format format = NULL; /* suppress "may be used uninitialized" warning */
   STATISTIC_DECL(Count preservedInPlaceCount = (Count)0)
-  Size preservedInPlaceSize = (Size)0;
+  Size preservedInPlaceSize;
   Bool b;
 
   AVERT(Trace, trace);
 
   base = SegBase(seg);
-  limit = SegLimit(seg);
+  grains = loSegGrains(loseg);
 
   b = PoolFormat(&format, pool);
   AVER(b);
 
-  /* i is the index of the current pointer,
-   * p is the actual address that is being considered.
-   * j and q act similarly for a pointer which is used to
-   * point at the end of the current object.
-   */
-  p = base;
-  while(p < limit) {
-    Addr q;
-    Index i;
+  /* The unused part of the buffer, if any, isn't objects. */
+  if (hasBuffer && BufferScanLimit(buffer) != BufferLimit(buffer)) {
+    bufferBase = PoolIndexOfAddr(base, pool, BufferScanLimit(buffer));
+    bufferLimit = PoolIndexOfAddr(base, pool, BufferLimit(buffer));
+  } else {
+    bufferBase = bufferLimit = grains;
+  }
 
-    if (hasBuffer) {
-      if (p == BufferScanLimit(buffer)
-          && BufferScanLimit(buffer) != BufferLimit(buffer)) {
-        /* skip over buffered area */
-        p = BufferLimit(buffer);
-        continue;
-      }
-      /* since we skip over the buffered area we are always */
-      /* either before the buffer, or after it, never in it */
-      AVER(p < BufferGetInit(buffer) || BufferLimit(buffer) <= p);
+  /* i is always the index of an object or a free grain. */
+  i = 0;
+  while (i < grains) {
+    Index j, searchLimit;
+
+    if (i == bufferBase) {
+      /* skip over buffered area */
+      i = bufferLimit;
+      continue;
     }
-    i = PoolIndexOfAddr(base, pool, p);
-    if(!BTGet(loseg->alloc, i)) {
-      /* This grain is free */
-      p = AddrAdd(p, pool->alignment);
+    searchLimit = i < bufferBase ? bufferBase : grains;
+
+    if (!BTFindSetBit(&i, loseg->alloc, i, searchLimit)) {
+      /* The rest of the range is free */
+      i = searchLimit;
       continue;
     }
-    q = (*format->skip)(AddrAdd(p, format->headerSize));
-    q = AddrSub(q, format->headerSize);
-    if(BTGet(loseg->mark, i)) {
-      STATISTIC(++preservedInPlaceCount);
-      preservedInPlaceSize += AddrOffset(p, q);
+
+    if (BTGet(loseg->mark, i) || loseg->ambiguousFixes) {
+      Addr p = PoolAddrOfIndex(base, pool, i);
+      Addr q = (*format->skip)(AddrAdd(p, format->headerSize));
+      q = AddrSub(q, format->headerSize);
+      j = PoolIndexOfAddr(base, pool, q);
+      AVER(j <= searchLimit);
+      if (BTGet(loseg->mark, i)) {
+        STATISTIC(++preservedInPlaceCount);
+      } else {
+        /* An ambiguous reference may have marked a grain inside a */
+        /* dead object, so dead objects are freed one at a time. */
+        BTResRange(loseg->alloc, i, j);
+        reclaimedGrains += j - i;
+      }
     } else {
-      Index j = PoolIndexOfAddr(base, pool, q);
-      /* This object is not marked, so free it */
+      /* Marks are only at the start of preserved objects and on free */
+      /* grains, so everything allocated up to the next mark is dead. */
+      if (!BTFindSetBit(&j, loseg->mark, i, searchLimit))
+        j = searchLimit;
+      reclaimedGrains += (j - i) - BTCountResRange(loseg->alloc, i, j);
       BTResRange(loseg->alloc, i, j);
-      reclaimedGrains += j - i;
     }
-    p = q;
+    i = j;
   }
-  AVER(p == limit);
+  AVER(i == grains);
 
   AVER(reclaimedGrains <= loSegGrains(loseg));
   AVER(loseg->oldGrains >= reclaimedGrains);
@@ -375,6 +392,10 @@ static void loSegReclaim(Seg seg, Trace trace)
 
   STATISTIC(trace->reclaimSize += PoolGrainsSize(pool, reclaimedGrains));
   STATISTIC(trace->preservedInPlaceCount += preservedInPlaceCount);
+  /* Objects allocated since the segment was condemned are marked, but */
+  /* they weren't condemned, so they don't count as survivors: only */
+  /* the old grains do, as in <code/poolawl.c>. */
+  preservedInPlaceSize = PoolGrainsSize(pool, loseg->oldGrains);
   GenDescSurvived(pgen->gen, trace, 0, preservedInPlaceSize);
   SegSetWhite(seg, TraceSetDel(SegWhite(seg), trace));
 
@@ -385,7 +406,9 @@ static void loSegReclaim(Seg seg, Trace trace)
                 PoolGrainsSize(pool, loseg->oldGrains),
                 PoolGrainsSize(pool, loseg->newGrains),
                 FALSE);
+    return TRUE;
   }
+  return FALSE;
 }
 
 /* Walks over _all_ objects in the segnent: whether they are black or
@@ -570,7 +593,9 @@ static Res LOBufferFill(Addr *baseReturn, Addr *limitReturn,
   rankSet = BufferRankSet(buffer);
   RING_FOR(node, PoolSegRing(pool), nextNode) {
     seg = SegOfPoolRing(node);
-    if (SegBufferFill(baseReturn, limitReturn, seg, size, rankSet))
+    /* <design/trace#.reclaim.lazy.fill> */
+    if (TraceSegReclaim(PoolArena(pool), seg)
+        && SegBufferFill(baseReturn, limitReturn, seg, size, rankSet))
       return ResOK;
   }
 
@@ -637,6 +662,7 @@ static Res loSegWhiten(Seg seg, Trace trace)
   loseg->oldGrains += agedGrains + loseg->newGrains;
   loseg->bufferedGrains = uncondemnedGrains;
   loseg->newGrains = 0;
+  loseg->ambiguousFixes = FALSE;
 
   if (loseg->oldGrains > 0) {
     GenDescCondemned(pgen->gen, trace,
@@ -704,6 +730,12 @@ static Res loSegScan(Bool *totalReturn, Seg seg, ScanState ss)
 }
 
 
+/* loSegFix -- fix method for LO segments
+ *
+ * This does nothing to a reference to a marked object, so _mps_fix2
+ * tests the mark table itself.  See <design/trace#.fix.fast>.
+ */
+
 static Res loSegFix(Seg seg, ScanState ss, Ref *refIO)
 {
   LOSeg loseg = MustBeA_CRITICAL(LOSeg, seg);
@@ -746,6 +778,9 @@ static Res loSegFix(Seg seg, ScanState ss, Ref *refIO)
     if(ss->rank == RankWEAK) {
       *refIO = (Addr)0;
     } else {
+      /* An ambiguous reference may mark a grain inside an object. */
+      if (ss->rank == RankAMBIG)
+        loseg->ambiguousFixes = TRUE;
       BTSet(loseg->mark, i);
     }
   }
@@ -28,6 +28,20 @@ Addr MutatorContextSP(MutatorContext context)
 }
 
 
+/* MutatorContextFaultMode -- kind of access that caused a fault
+ *
+ * The page fault error code isn't decoded
+ * on FreeBSD, so the access is assumed to be a read and a write.
+ */
+
+AccessSet MutatorContextFaultMode(MutatorContext context)
+{
+  AVERT(MutatorContext, context);
+  AVER(context->var == MutatorContextFAULT);
+  return AccessREAD | AccessWRITE;
+}
+
+
 /* C. COPYRIGHT AND LICENSE
  *
  * Copyright (C) 2001-2020 Ravenbrook Limited <https://www.ravenbrook.com/>.
@@ -24,6 +24,7 @@ typedef struct MutatorContextStruct {
 
 extern void MutatorContextInitFault(MutatorContext context, siginfo_t *info, ucontext_t *ucontext);
 extern void MutatorContextInitThread(MutatorContext context, ucontext_t *ucontext);
+extern AccessSet MutatorContextFaultMode(MutatorContext context);
 
 #endif /* prmcix_h */
 
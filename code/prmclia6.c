@@ -23,6 +23,21 @@ Addr MutatorContextSP(MutatorContext context)
 }
 
 
+/* MutatorContextFaultMode -- kind of access that caused a fault
+ *
+ * The fault status is in an ESR record in the
+ * reserved area of the context, which isn't decoded yet, so the
+ * access is assumed to be a read and a write.
+ */
+
+AccessSet MutatorContextFaultMode(MutatorContext context)
+{
+  AVERT(MutatorContext, context);
+  AVER(context->var == MutatorContextFAULT);
+  return AccessREAD | AccessWRITE;
+}
+
+
 /* C. COPYRIGHT AND LICENSE
  *
  * Copyright (C) 2001-2021 Ravenbrook Limited <https://www.ravenbrook.com/>.
@@ -109,6 +109,26 @@ Addr MutatorContextSP(MutatorContext context)
 }
 
 
+/* MutatorContextFaultMode -- kind of access that caused a fault
+ *
+ * .fault.mode: The kernel stores the page fault error code in
+ * REG_ERR, and bit 1 of the error code is set if the access was a
+ * write (.source.linux.kernel: arch/x86/include/asm/trap_pf.h).
+ */
+
+#define PF_WRITE ((greg_t)1 << 1)
+
+AccessSet MutatorContextFaultMode(MutatorContext context)
+{
+  AVERT(MutatorContext, context);
+  AVER(context->var == MutatorContextFAULT);
+
+  if ((context->ucontext->uc_mcontext.gregs[REG_ERR] & PF_WRITE) != 0)
+    return AccessWRITE;
+  return AccessREAD;
+}
+
+
 /* C. COPYRIGHT AND LICENSE
  *
  * Copyright (C) 2001-2020 Ravenbrook Limited <https://www.ravenbrook.com/>.
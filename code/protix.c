@@ -41,6 +41,10 @@
 
 #include "vm.h"
 
+#if defined(MPS_OS_LI)
+#include "protli.h"
+#endif
+
 #include <errno.h>
 #include <limits.h>
 #include <signal.h> /* sig_atomic_t */
@@ -62,7 +66,8 @@ static sig_atomic_t prot_all = PROT_READ | PROT_WRITE | PROT_EXEC;
 
 /* ProtSet -- set protection
  *
- * This is just a thin veneer on top of mprotect(2).
+ * This is just a thin veneer on top of mprotect(2), except on Linux,
+ * where the write barrier may be set with userfaultfd(2).
  */
 
 void ProtSet(Addr base, Addr limit, AccessSet mode)
@@ -75,6 +80,12 @@ void ProtSet(Addr base, Addr limit, AccessSet mode)
   AVER(AddrOffset(base, limit) <= INT_MAX);     /* should be redundant */
   AVERT(AccessSet, mode);
 
+#if defined(MPS_OS_LI)
+  /* Leave the write barrier to userfaultfd, if the range is registered.
+     See <design/protix#.uffd>. */
+  mode = ProtUffdSet(base, limit, mode);
+#endif
+
   /* .convert.access: Convert between MPS AccessSet and UNIX PROT thingies.
      In this function, AccessREAD means protect against read accesses
      (disallow them).  PROT_READ means allow read accesses.  Notice that
@@ -0,0 +1,353 @@
+/* protli.c: PROTECTION FOR LINUX (USERFAULTFD)
+ *
+ *  $Id$
+ *  Copyright (c) 2026 Ravenbrook Limited.  See end of file for license.
+ *
+ *  This implements the write barrier with userfaultfd(2) for arenas
+ *  created with MPS_KEY_VMIX_UFFD. Read protection, and all protection
+ *  of memory that was not registered, is still done by mprotect(2) in
+ *  protix.c. See <design/protix#.uffd>.
+ *
+ *
+ *  SOURCES
+ *
+ *  .source.uffd: userfaultfd(2), ioctl_userfaultfd(2), and "Userfaultfd"
+ *  in the Linux kernel documentation
+ *  <https://docs.kernel.org/admin-guide/mm/userfaultfd.html>
+ *
+ *  ASSUMPTIONS
+ *
+ *  .assume.sigbus: With UFFD_FEATURE_SIGBUS, a write to a page that is
+ *    write-protected with UFFDIO_WRITEPROTECT raises SIGBUS with si_code
+ *    BUS_ADRERR and si_addr the fault address, in the faulting thread,
+ *    and no event is queued on the file descriptor. So there's no
+ *    thread reading the descriptor.
+ *
+ *  .assume.unpopulated: Without UFFD_FEATURE_WP_UNPOPULATED, write
+ *    protection has no effect on a page that has never been touched,
+ *    which would make the barrier unsound. So we insist on the feature
+ *    (Linux 6.4), and fall back to mprotect(2) if it is missing.
+ *
+ *  .assume.enoent: UFFDIO_WRITEPROTECT fails with ENOENT, without
+ *    changing anything, if the range is not registered. Arenas register
+ *    all their memory or none of it, so a range that ProtSet is given
+ *    is either registered or not.
+ *
+ *  .assume.fork: A child process created by fork(2) doesn't inherit the
+ *    registration, and the kernel clears the write protection in its
+ *    copy of the pages. The descriptor it inherits still refers to the
+ *    parent's memory. See protUffdAtForkChild.
+ */
+
+#include "mpm.h"
+
+#if !defined(MPS_OS_LI)
+#error "protli.c is specific to MPS_OS_LI"
+#endif
+
+#include "prmcix.h"
+#include "protli.h"
+
+#include <errno.h> /* errno, EINVAL, ENOENT */
+#include <fcntl.h> /* O_CLOEXEC, O_NONBLOCK */
+#include <linux/userfaultfd.h>
+#include <pthread.h> /* pthread_once */
+#include <signal.h> /* sigaction etc. */
+#include <sys/ioctl.h> /* ioctl */
+#include <sys/syscall.h> /* __NR_userfaultfd */
+#include <unistd.h> /* close, getpid, syscall -- see .feature.li */
+
+SRCID(protli, "$Id$");
+
+
+/* Write protection arrived in Linux 5.7, and the headers may be older
+ * than the kernel, so define the later constants if they are missing. */
+
+#if defined(__NR_userfaultfd) && defined(UFFDIO_WRITEPROTECT)
+#define PROTLI_UFFD
+#endif
+
+#if !defined(UFFD_USER_MODE_ONLY)
+#define UFFD_USER_MODE_ONLY 1
+#endif
+
+#if !defined(UFFD_FEATURE_WP_UNPOPULATED)
+#define UFFD_FEATURE_WP_UNPOPULATED ((__u64)1 << 13)
+#endif
+
+
+#if defined(PROTLI_UFFD)
+
+#define PROTLI_FEATURES (UFFD_FEATURE_SIGBUS \
+                         | UFFD_FEATURE_PAGEFAULT_FLAG_WP \
+                         | UFFD_FEATURE_WP_UNPOPULATED)
+
+
+/* The userfaultfd for the process, or -1 if it couldn't be opened
+ * with the features we need. See ProtUffdSetup. */
+
+static int protUffd = -1;
+
+static pthread_once_t protUffdOnce = PTHREAD_ONCE_INIT;
+
+
+/* The previously-installed SIGBUS action. See uffdSetup. */
+
+static struct sigaction sigbusNext;
+
+
+/* sigbusHandle -- write barrier signal handler
+ *
+ * Like sigHandle in protsgix.c, but for SIGBUS. See .assume.sigbus.
+ * The fault can only be a write, because the page must be readable
+ * for the fault to get past mprotect(2) to userfaultfd.
+ */
+
+static void sigbusHandle(int sig, siginfo_t *info, void *uap)
+{
+  ERRNO_SAVE {
+    int e;
+    sigset_t asigset, oldset;
+    struct sigaction sa;
+
+    AVER(sig == SIGBUS);
+
+    if (info->si_code == BUS_ADRERR) {
+      MutatorContextStruct context;
+
+      MutatorContextInitFault(&context, info, (ucontext_t *)uap);
+      if (ArenaAccess((Addr)info->si_addr, AccessWRITE, &context))
+        goto done;
+    }
+
+    /* Not ours: throw it to the previous handler, as sigHandle does. */
+    e = sigaction(SIGBUS, &sigbusNext, &sa);
+    AVER(e == 0);
+    e = sigemptyset(&asigset);
+    AVER(e == 0);
+    e = sigaddset(&asigset, SIGBUS);
+    AVER(e == 0);
+    e = sigprocmask(SIG_UNBLOCK, &asigset, &oldset);
+    AVER(e == 0);
+    e = kill(getpid(), SIGBUS);
+    AVER(e == 0);
+    e = sigprocmask(SIG_SETMASK, &oldset, NULL);
+    AVER(e == 0);
+    e = sigaction(SIGBUS, &sa, NULL);
+    AVER(e == 0);
+
+  done:
+    ;
+  } ERRNO_RESTORE;
+}
+
+
+/* protUffdAtForkChild -- support for fork()
+ *
+ * See .assume.fork. The child closes the descriptor, so ProtSet uses
+ * mprotect(2) from now on, and sets the protection of every protected
+ * segment again, so that the write barrier is back in place. Child
+ * handlers run in the order they were installed, so the locks have
+ * been reinitialized and the shield left (see GlobalsReinitializeAll)
+ * before this runs.
+ */
+
+static void protUffdArenaForkChild(Arena arena)
+{
+  Seg seg;
+
+  AVERT(Arena, arena);
+  if (SegFirst(&seg, arena))
+    do {
+      AVER(SegSM(seg) == SegPM(seg)); /* shield left by the lock handler */
+      if (SegPM(seg) != AccessSetEMPTY)
+        ProtSet(SegBase(seg), SegLimit(seg), SegPM(seg));
+    } while (SegNext(&seg, arena, seg));
+}
+
+static void protUffdAtForkChild(void)
+{
+  int r;
+
+  if (protUffd < 0)
+    return;
+  r = close(protUffd);
+  AVER(r == 0);
+  protUffd = -1;
+  GlobalsArenaMap(protUffdArenaForkChild);
+}
+
+
+/* uffdSetup -- open the userfaultfd and install the SIGBUS handler
+ *
+ * UFFD_USER_MODE_ONLY lets unprivileged processes open a userfaultfd
+ * when the vm.unprivileged_userfaultfd sysctl is 0, as it is by
+ * default; kernels before 5.11 reject it with EINVAL. Faults in the
+ * kernel (for example, read(2) into a protected buffer) then fail with
+ * EFAULT, just as they do with mprotect(2).
+ */
+
+static void uffdSetup(void)
+{
+  struct uffdio_api api;
+  struct sigaction sa;
+  int fd, r;
+
+  fd = (int)syscall(__NR_userfaultfd,
+                    O_CLOEXEC | O_NONBLOCK | UFFD_USER_MODE_ONLY);
+  if (fd < 0 && errno == EINVAL)
+    fd = (int)syscall(__NR_userfaultfd, O_CLOEXEC | O_NONBLOCK);
+  if (fd < 0)
+    return;
+
+  /* Fails with EINVAL if the kernel doesn't know one of the features. */
+  api.api = UFFD_API;
+  api.features = PROTLI_FEATURES;
+  api.ioctls = 0;
+  r = ioctl(fd, UFFDIO_API, &api);
+  if (r != 0 || (api.features & PROTLI_FEATURES) != PROTLI_FEATURES) {
+    r = close(fd);
+    AVER(r == 0);
+    return;
+  }
+
+  sa.sa_sigaction = sigbusHandle;
+  r = sigemptyset(&sa.sa_mask);
+  AVER(r == 0);
+  sa.sa_flags = SA_SIGINFO | SA_RESTART;
+  r = sigaction(SIGBUS, &sa, &sigbusNext);
+  AVER(r == 0);
+
+  /* Install fork handlers <design/thread-safety#.sol.fork.atfork>. */
+  r = pthread_atfork(NULL, NULL, protUffdAtForkChild);
+  AVER(r == 0);
+
+  protUffd = fd;
+}
+
+
+/* ProtUffdSetup -- can the write barrier use userfaultfd?
+ *
+ * Opens the userfaultfd the first time it is called, so that only
+ * processes with an arena that asked for it get the descriptor and the
+ * SIGBUS handler.
+ */
+
+Bool ProtUffdSetup(void)
+{
+  int r = pthread_once(&protUffdOnce, uffdSetup);
+  AVER(r == 0);
+  return protUffd >= 0;
+}
+
+
+/* ProtUffdRegister -- register a newly mapped range for write protection
+ *
+ * Does nothing in a child process, which uses mprotect(2) instead. See
+ * protUffdAtForkChild.
+ */
+
+Res ProtUffdRegister(Addr base, Addr limit)
+{
+  struct uffdio_register reg;
+  int r;
+
+  AVER(base < limit);
+  if (protUffd < 0)
+    return ResOK;
+
+  reg.range.start = (__u64)(Word)base;
+  reg.range.len = (__u64)AddrOffset(base, limit);
+  reg.mode = UFFDIO_REGISTER_MODE_WP;
+  reg.ioctls = 0;
+  r = ioctl(protUffd, UFFDIO_REGISTER, &reg);
+  if (r != 0)
+    return ResMEMORY;
+  AVER((reg.ioctls & ((__u64)1 << _UFFDIO_WRITEPROTECT)) != 0);
+  return ResOK;
+}
+
+
+/* ProtUffdSet -- set write protection on a registered range
+ *
+ * Returns the protection that ProtSet must still set with mprotect(2).
+ * Read protection needs mprotect(2), which forbids writes too (see
+ * .assume.write-only in protix.c), so the userfaultfd state can be
+ * left alone until the read protection is removed. Otherwise the
+ * write protection is set here, and ProtSet makes sure the pages are
+ * accessible, which costs little if they already are.
+ */
+
+AccessSet ProtUffdSet(Addr base, Addr limit, AccessSet mode)
+{
+  struct uffdio_writeprotect wp;
+  int r;
+
+  if (protUffd < 0 || BS_INTER(mode, AccessREAD) != AccessSetEMPTY)
+    return mode;
+
+  wp.range.start = (__u64)(Word)base;
+  wp.range.len = (__u64)AddrOffset(base, limit);
+  wp.mode = mode == AccessWRITE ? UFFDIO_WRITEPROTECT_MODE_WP : 0;
+  r = ioctl(protUffd, UFFDIO_WRITEPROTECT, &wp);
+  if (r != 0) {
+    AVER(errno == ENOENT); /* .assume.enoent */
+    return mode;
+  }
+  return AccessSetEMPTY;
+}
+
+
+#else /* !defined(PROTLI_UFFD) */
+
+Bool ProtUffdSetup(void)
+{
+  return FALSE;
+}
+
+Res ProtUffdRegister(Addr base, Addr limit)
+{
+  UNUSED(base);
+  UNUSED(limit);
+  NOTREACHED;
+  return ResUNIMPL;
+}
+
+AccessSet ProtUffdSet(Addr base, Addr limit, AccessSet mode)
+{
+  UNUSED(base);
+  UNUSED(limit);
+  return mode;
+}
+
+#endif /* PROTLI_UFFD */
+
+
+/* C. COPYRIGHT AND LICENSE
+ *
+ * Copyright (C) 2026 Ravenbrook Limited <https://www.ravenbrook.com/>.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+ * IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
@@ -64,8 +64,16 @@ static struct sigaction sigNext;
  *
  * .sign.addr: If so, we assume info->si_addr is the fault address.
  *
- * .sigh.mode: The fault type (read/write) does not appear to be
- * available to the signal handler (see mail archive).
+ * .sigh.mode: The fault type (read/write) is decoded from the context
+ * by MutatorContextFaultMode, on platforms where it is available, so
+ * that a read from a segment that is protected against both reads
+ * and writes leaves the write barrier in place.
+ *
+ * .sigh.mode.write: A write needs read access too, since a page
+ * can't be made writable without also being made readable (see
+ * <code/protix.c>).  Without this, a write to a segment protected
+ * against both would remove only the write protection, and fault
+ * again.
  */
 
 #define PROT_SIGNAL SIGSEGV
@@ -87,7 +95,9 @@ static void sigHandle(int sig, siginfo_t *info, void *uap)  /* .sigh.args */
 
       MutatorContextInitFault(&context, info, (ucontext_t *)uap);
 
-      mode = AccessREAD | AccessWRITE; /* .sigh.mode */
+      mode = MutatorContextFaultMode(&context); /* .sigh.mode */
+      if (BS_INTER(mode, AccessWRITE) != AccessSetEMPTY)
+        mode = BS_UNION(mode, AccessREAD); /* .sigh.mode.write */
 
       /* We assume that the access is for one word at the address. */
       base = (Addr)info->si_addr;   /* .sigh.addr */
@@ -52,10 +52,24 @@ static Bool pthreadextModuleInitialized = FALSE;
  * <design/pthreadext#.impl.global>
  */
 
-static PThreadext suspendingVictim = NULL;  /* current victim */
+static RingStruct victimRing;               /* PThreadexts being suspended */
 static RingStruct suspendedRing;            /* PThreadext suspend ring */
 
 
+/* pthreadextFind -- find a pthreadext for a thread on a ring of threadRings */
+
+static PThreadext pthreadextFind(Ring ring, pthread_t id)
+{
+  Ring node, next;
+  RING_FOR(node, ring, next) {
+    PThreadext pthreadext = RING_ELT(PThreadext, threadRing, node);
+    if (pthread_equal(pthreadext->id, id))
+      return pthreadext;
+  }
+  return NULL;
+}
+
+
 /* suspendSignalHandler -- signal handler called when suspending a thread
  *
  * <design/pthreadext#.impl.suspend-handler>
@@ -77,18 +91,22 @@ static void suspendSignalHandler(int sig,
     sigset_t signal_set;
     ucontext_t ucontext;
     MutatorContextStruct context;
+    PThreadext victim;
     int status;
 
     AVER(sig == PTHREADEXT_SIGSUSPEND);
     UNUSED(sig);
     UNUSED(info);
 
-    AVER(suspendingVictim != NULL);
+    /* Find our own victim.  The controlling thread doesn't change the
+       victim ring until every victim has posted the semaphore. */
+    victim = pthreadextFind(&victimRing, pthread_self());
+    AVER(victim != NULL);
     /* copy the ucontext structure so we definitely have it on our stack,
      * not (e.g.) shared with other threads. */
     ucontext = *(ucontext_t *)uap;
     MutatorContextInitThread(&context, &ucontext);
-    suspendingVictim->context = &context;
+    victim->context = &context;
     /* Block all signals except PTHREADEXT_SIGRESUME while suspended. */
     status = sigfillset(&signal_set);
     AVER(status == 0);
@@ -132,8 +150,9 @@ static void PThreadextModuleInit(void)
 
     AVER(pthreadextModuleInitialized == FALSE);
 
-    /* Initialize the ring of suspended threads */
+    /* Initialize the rings of suspended threads and victims */
     RingInit(&suspendedRing);
+    RingInit(&victimRing);
 
     /* Initialize the semaphore */
     status = sem_init(&pthreadextSem, 0, 0);
@@ -181,6 +200,7 @@ Bool PThreadextCheck(PThreadext pthreadext)
   /* can't check ID */
   CHECKD_NOSIG(Ring, &pthreadext->threadRing);
   CHECKD_NOSIG(Ring, &pthreadext->idRing);
+  CHECKD_NOSIG(Ring, &pthreadext->batchRing);
   if (pthreadext->context == NULL) {
     /* not suspended */
     CHECKL(RingIsSingle(&pthreadext->threadRing));
@@ -216,6 +236,7 @@ void PThreadextInit(PThreadext pthreadext, pthread_t id)
   pthreadext->context = NULL;
   RingInit(&pthreadext->threadRing);
   RingInit(&pthreadext->idRing);
+  RingInit(&pthreadext->batchRing);
   pthreadext->sig = PThreadextSig;
   AVERT(PThreadext, pthreadext);
 }
@@ -251,117 +272,142 @@ void PThreadextFinish(PThreadext pthreadext)
 
   RingFinish(&pthreadext->threadRing);
   RingFinish(&pthreadext->idRing);
+  RingFinish(&pthreadext->batchRing);
   pthreadext->sig = SigInvalid;
 }
 
 
-/* PThreadextSuspend -- suspend a thread
+/* PThreadextSuspend -- suspend the pthreadexts on a ring
  *
  * <design/pthreadext#.impl.suspend>
+ *
+ * The pthreadexts can't be checked here, because PThreadextCheck
+ * claims the mutex: the caller must check them.
  */
 
-Res PThreadextSuspend(PThreadext target, MutatorContext *contextReturn)
+void PThreadextSuspend(Ring batchRing)
 {
   Ring node, next;
-  Res res;
+  Count signalled = 0;
   int status;
 
-  AVERT(PThreadext, target);
-  AVER(contextReturn != NULL);
-  AVER(target->context == NULL); /* multiple suspends illegal */
+  AVERT(Ring, batchRing);
 
   /* Serialize access to suspend, makes life easier */
   status = pthread_mutex_lock(&pthreadextMut);
   AVER(status == 0);
-  AVER(suspendingVictim == NULL);
-
-  /* Threads are added to the suspended ring on suspension */
-  /* If the same thread Id has already been suspended, then */
-  /* don't signal the thread, just add the target onto the id ring */
-  RING_FOR(node, &suspendedRing, next) {
-    PThreadext alreadySusp = RING_ELT(PThreadext, threadRing, node);
-    if (alreadySusp->id == target->id) {
-      RingAppend(&alreadySusp->idRing, &target->idRing);
-      target->context = alreadySusp->context;
-      goto noteSuspended;
+  AVER(RingIsSingle(&victimRing));
+
+  /* Threads are added to the suspended ring on suspension.  If the */
+  /* same thread Id has already been suspended, or is about to be, */
+  /* then don't signal the thread, just add the target onto the id */
+  /* ring.  <design/pthreadext#.impl.suspend.already-suspended> */
+  RING_FOR(node, batchRing, next) {
+    PThreadext target = RING_ELT(PThreadext, batchRing, node);
+    PThreadext other;
+    AVER(TESTT(PThreadext, target));
+    AVER(target->context == NULL); /* multiple suspends illegal */
+    other = pthreadextFind(&suspendedRing, target->id);
+    if (other != NULL) {
+      RingAppend(&other->idRing, &target->idRing);
+      target->context = other->context;
+      RingAppend(&suspendedRing, &target->threadRing);
+      continue;
     }
+    other = pthreadextFind(&victimRing, target->id);
+    if (other != NULL) {
+      RingAppend(&other->idRing, &target->idRing);
+      continue;
+    }
+    RingAppend(&victimRing, &target->threadRing);
   }
 
-  /* Ok, we really need to suspend this thread. */
-  suspendingVictim = target;
-  status = pthread_kill(target->id, PTHREADEXT_SIGSUSPEND);
-  if (status != 0) {
-    res = ResFAIL;
-    goto unlock;
+  /* Signal every victim before waiting for any of them, so that the */
+  /* time taken is that of the slowest victim rather than the sum. */
+  /* <design/pthreadext#.impl.suspend.not-suspended> */
+  RING_FOR(node, &victimRing, next) {
+    PThreadext victim = RING_ELT(PThreadext, threadRing, node);
+    status = pthread_kill(victim->id, PTHREADEXT_SIGSUSPEND);
+    if (status == 0)
+      ++signalled;
   }
 
-  /* Wait for the victim to acknowledge suspension. */
-  while (sem_wait(&pthreadextSem) != 0) {
-    if (errno != EINTR) {
-      res = ResFAIL;
-      goto unlock;
-    }
+  /* Wait for the victims to acknowledge suspension.  We must wait */
+  /* for all of them even if the semaphore fails, because they use */
+  /* the victim ring. */
+  while (signalled > 0) {
+    if (sem_wait(&pthreadextSem) == 0)
+      --signalled;
+    else
+      AVER(errno == EINTR);
   }
 
-noteSuspended:
-  AVER(target->context != NULL);
-  RingAppend(&suspendedRing, &target->threadRing);
-  *contextReturn = target->context;
-  res = ResOK;
+  /* A victim without a context couldn't be signalled (for example, */
+  /* because it has terminated), and nor can its duplicates. */
+  /* <design/pthreadext#.impl.suspend.update> */
+  RING_FOR(node, &victimRing, next) {
+    PThreadext victim = RING_ELT(PThreadext, threadRing, node);
+    Ring idNode, idNext;
+    RingRemove(&victim->threadRing);
+    RING_FOR(idNode, &victim->idRing, idNext) {
+      PThreadext dup = RING_ELT(PThreadext, idRing, idNode);
+      if (victim->context == NULL) {
+        RingRemove(&dup->idRing);
+      } else {
+        dup->context = victim->context;
+        RingAppend(&suspendedRing, &dup->threadRing);
+      }
+    }
+    if (victim->context != NULL)
+      RingAppend(&suspendedRing, &victim->threadRing);
+  }
 
-unlock:
-  suspendingVictim = NULL;
   status = pthread_mutex_unlock(&pthreadextMut);
   AVER(status == 0);
-  return res;
 }
 
 
-/* PThreadextResume -- resume a suspended thread
+/* PThreadextResume -- resume the suspended pthreadexts on a ring
  *
  * <design/pthreadext#.impl.resume>
  */
 
-Res PThreadextResume(PThreadext target)
+void PThreadextResume(Ring batchRing)
 {
-  Res res;
+  Ring node, next;
   int status;
 
-  AVERT(PThreadext, target);
+  AVERT(Ring, batchRing);
   AVER(pthreadextModuleInitialized);  /* must have been a prior suspend */
-  AVER(target->context != NULL);
 
   /* Serialize access to suspend, makes life easier. */
   status = pthread_mutex_lock(&pthreadextMut);
   AVER(status == 0);
 
-  if (RingIsSingle(&target->idRing)) {
-    /* Really want to resume the thread. Signal it to continue. */
-    status = pthread_kill(target->id, PTHREADEXT_SIGRESUME);
-    if (status == 0) {
-      goto noteResumed;
+  RING_FOR(node, batchRing, next) {
+    PThreadext target = RING_ELT(PThreadext, batchRing, node);
+    AVER(TESTT(PThreadext, target));
+    AVER(target->context != NULL);
+
+    if (RingIsSingle(&target->idRing)) {
+      /* Really want to resume the thread. Signal it to continue. */
+      /* If this fails, leave the target suspended. */
+      status = pthread_kill(target->id, PTHREADEXT_SIGRESUME);
+      if (status != 0)
+        continue;
     } else {
-      res = ResFAIL;
-      goto unlock;
+      /* Leave thread suspended on behalf of another PThreadext. */
+      /* Remove it from the id ring */
+      RingRemove(&target->idRing);
     }
 
-  } else {
-    /* Leave thread suspended on behalf of another PThreadext. */
-    /* Remove it from the id ring */
-    RingRemove(&target->idRing);
-    goto noteResumed;
+    /* Remove the thread from the suspended ring */
+    RingRemove(&target->threadRing);
+    target->context = NULL;
   }
 
-noteResumed:
-  /* Remove the thread from the suspended ring */
-  RingRemove(&target->threadRing);
-  target->context = NULL;
-  res = ResOK;
-
-unlock:
   status = pthread_mutex_unlock(&pthreadextMut);
   AVER(status == 0);
-  return res;
 }
 
 
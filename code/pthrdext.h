@@ -35,9 +35,15 @@ typedef struct PThreadextStruct {
   MutatorContext context;          /* context if suspended */
   RingStruct threadRing;           /* ring of suspended threads */
   RingStruct idRing;               /* duplicate suspensions for id */
+  RingStruct batchRing;            /* caller's ring, see .if.suspend */
 } PThreadextStruct;
 
 
+/* PThreadextContext -- context of a suspended pthreadext, or NULL */
+
+#define PThreadextContext(pthreadext) ((pthreadext)->context)
+
+
 
 /*  PThreadextCheck -- Check a pthreadext */
 
@@ -54,15 +60,22 @@ extern void PThreadextInit(PThreadext pthreadext, pthread_t id);
 extern void PThreadextFinish(PThreadext pthreadext);
 
 
-/*  PThreadextSuspend -- Suspend a pthreadext and return its context. */
+/*  PThreadextSuspend -- Suspend the pthreadexts on a ring
+ *
+ * The ring links the batchRing fields of the pthreadexts.  Those
+ * that were suspended have a context on return.
+ */
 
-extern Res PThreadextSuspend(PThreadext pthreadext,
-                             MutatorContext *contextReturn);
+extern void PThreadextSuspend(Ring batchRing);
 
 
-/*  PThreadextResume --  Resume a suspended pthreadext */
+/*  PThreadextResume -- Resume the suspended pthreadexts on a ring
+ *
+ * The ring links the batchRing fields of the pthreadexts.  Those
+ * that were resumed have no context on return.
+ */
 
-extern Res PThreadextResume(PThreadext pthreadext);
+extern void PThreadextResume(Ring batchRing);
 
 
 #endif /* pthreadext_h */
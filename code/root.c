@@ -35,6 +35,9 @@ typedef struct RootStruct {
   Addr protBase;                /* base of protectable area */
   Addr protLimit;               /* limit of protectable area */
   AccessSet pm;                 /* Protection Mode */
+  STATISTIC_DECL(Count ambigWordCount) /* ambiguous words scanned */
+  STATISTIC_DECL(Count ambigRangeCount) /* ... in a chunk range */
+  STATISTIC_DECL(Count ambigZoneCount) /* ... and in a white zone */
   RootVar var;                  /* union discriminator */
   union RootUnion {
     struct {
@@ -209,6 +212,9 @@ static Res rootCreate(Root *rootReturn, Arena arena,
   root->protectable = FALSE;
   root->protBase = (Addr)0;
   root->protLimit = (Addr)0;
+  STATISTIC(root->ambigWordCount = (Count)0);
+  STATISTIC(root->ambigRangeCount = (Count)0);
+  STATISTIC(root->ambigZoneCount = (Count)0);
 
   /* <design/arena#.root-ring> */
   RingInit(&root->arenaRing);
@@ -251,6 +257,8 @@ static Res rootCreateProtectable(Root *rootReturn, Arena arena,
       root->protBase = AddrArenaGrainDown(base, arena);
       root->protLimit = AddrArenaGrainUp(limit, arena);
     }
+    if (root->protectable) /* <design/arena#.access.map> */
+      ArenaAccessMapAdd(arena, root, root->protBase, root->protLimit);
   }
 
   /* Check that this root doesn't intersect with any other root */
@@ -441,6 +449,9 @@ void RootDestroy(Root root)
 
   AVERT(Arena, arena);
 
+  if (root->protectable)
+    ArenaAccessMapRemove(arena, root, root->protBase, root->protLimit);
+
   RingRemove(&root->arenaRing);
   RingFinish(&root->arenaRing);
 
@@ -600,6 +611,17 @@ Res RootScan(ScanState ss, Root root)
   rootSetSummary(root, ScanStateSummary(ss));
   EVENT3(RootScan, root, ss->traces, ScanStateSummary(ss));
 
+  /* Per-root (and so, for thread roots, per-thread) counts of the
+     words that survived each filter in AmbigScanArea.  The scan
+     state is fresh for each root, see traceScanRootRes. */
+  if (root->rank == RankAMBIG) {
+    STATISTIC(root->ambigWordCount += ss->ambigWordCount);
+    STATISTIC(root->ambigRangeCount += ss->ambigRangeCount);
+    STATISTIC(root->ambigZoneCount += ss->ambigZoneCount);
+    STATISTIC(EVENT4(RootStatAmbig, root, ss->ambigWordCount,
+                     ss->ambigRangeCount, ss->ambigZoneCount));
+  }
+
 failScan:
   if (root->pm != AccessSetEMPTY) {
     ProtSet(root->protBase, root->protLimit, root->pm);
@@ -701,6 +723,13 @@ Res RootDescribe(Root root, mps_lib_FILE *stream, Count depth)
                root->pm == AccessSetEMPTY ? " EMPTY" : "",
                root->pm & AccessREAD ? " READ" : "",
                root->pm & AccessWRITE ? " WRITE" : "",
+               "\n",
+               STATISTIC_WRITE("  ambigWordCount $U\n",
+                               (WriteFU)root->ambigWordCount)
+               STATISTIC_WRITE("  ambigRangeCount $U\n",
+                               (WriteFU)root->ambigRangeCount)
+               STATISTIC_WRITE("  ambigZoneCount $U\n",
+                               (WriteFU)root->ambigZoneCount)
                NULL);
   if (res != ResOK)
     return res;
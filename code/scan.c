@@ -9,6 +9,9 @@
  * are invited to read this code and use it as a basis for their own
  * scanners.  See topic "Area Scanners" in the MPS manual.
  *
+ * .simd: On some platforms the scanners use vector instructions to
+ * test several words at once.  See "Vector kernels" below.
+ *
  * TODO: Design document.
  */
 
@@ -23,21 +26,32 @@
 #endif
 
 
+/* MPS_SCAN_AREA_WORD -- scan the word at p if it passes test
+ *
+ * This must be used between MPS_SCAN_BEGIN and MPS_SCAN_END, and
+ * expects mask to be in scope.
+ */
+
+#define MPS_SCAN_AREA_WORD(ss, p, test)                 \
+  MPS_BEGIN                                             \
+    mps_word_t word = *(p);                             \
+    mps_word_t tag_bits = word & mask;                  \
+    if (test) {                                         \
+      mps_addr_t ref = (mps_addr_t)(word ^ tag_bits);   \
+      if (MPS_FIX1(ss, ref)) {                          \
+        mps_res_t res = MPS_FIX2(ss, &ref);             \
+        if (res != MPS_RES_OK)                          \
+          return res;                                   \
+        *(p) = (mps_word_t)ref | tag_bits;              \
+      }                                                 \
+    }                                                   \
+  MPS_END
+
 #define MPS_SCAN_AREA(test) \
   MPS_SCAN_BEGIN(ss) {                                  \
     mps_word_t *p = base;                               \
     while (p < (mps_word_t *)limit) {                   \
-      mps_word_t word = *p;                             \
-      mps_word_t tag_bits = word & mask;                \
-      if (test) {                                       \
-        mps_addr_t ref = (mps_addr_t)(word ^ tag_bits); \
-        if (MPS_FIX1(ss, ref)) {                        \
-          mps_res_t res = MPS_FIX2(ss, &ref);           \
-          if (res != MPS_RES_OK)                        \
-            return res;                                 \
-          *p = (mps_word_t)ref | tag_bits;              \
-        }                                               \
-      }                                                 \
+      MPS_SCAN_AREA_WORD(ss, p, test);                  \
       ++p;                                              \
     }                                                   \
   } MPS_SCAN_END(ss);
@@ -129,6 +143,283 @@
 # endif
 #endif /* !MPS_GC_ATTR_NO_SANITIZE_THREAD */
 
+
+/* Vector kernels
+ *
+ * .simd: On x86-64 with GCC or Clang, the area scanners test several
+ * words at once using SSE2 (two words) or AVX2 (four words)
+ * instructions.  For each vector of words, the kernel masks off the
+ * tag bits, computes the zone bit of each reference, accumulates the
+ * zone bits of the words that pass the tag test into the unfixed
+ * summary (exactly as MPS_FIX1 would), and compares them with the
+ * white set.  Only words that would pass MPS_FIX1 are passed to
+ * MPS_FIX2, one at a time, by MPS_SCAN_AREA_WORD.
+ *
+ * .simd.dispatch: SSE2 is part of the x86-64 architecture, so the
+ * SSE2 kernels are always available.  The AVX2 kernels are compiled
+ * with the "target" function attribute and are only used if CPUID
+ * reports that the processor and operating system support AVX2.  The
+ * choice is made once, on the first scan, and stored in
+ * scan_area_kernel.  Because the choice is the same whichever thread
+ * makes it, the race to store it is harmless.
+ *
+ * .simd.sse2.tagged: SSE2 has no 64-bit comparison, so the tag tests
+ * of the tagged scanners each take three instructions, and measurement
+ * with scanbench showed the SSE2 kernels to be slower than the scalar
+ * loop for those scanners.  So only mps_scan_area and
+ * mps_scan_area_masked have SSE2 kernels.
+ *
+ * .simd.short: Areas shorter than SCAN_AREA_SIMD_MIN words are
+ * scanned by the scalar loop, because the set-up cost of the vector
+ * kernel isn't repaid.  This is typical of formatted objects.
+ */
+
+#define SCAN_AREA_KERNEL_UNKNOWN 0
+#define SCAN_AREA_KERNEL_SCALAR  1
+#define SCAN_AREA_KERNEL_SSE2    2
+#define SCAN_AREA_KERNEL_AVX2    3
+
+#if defined(MPS_ARCH_I6) && !defined(CONFIG_PF_ANSI) \
+    && (MPS_GC_GNUC_PREREQ(4, 9) || MPS_GC_CLANG_PREREQ(3, 8))
+
+#define SCAN_AREA_SIMD
+#define SCAN_AREA_SIMD_MIN 8
+
+#include <cpuid.h>
+#include <immintrin.h>
+
+/* The intrinsics take signed 64-bit integers. */
+__extension__ typedef long long scan_area_int64_t;
+
+static int scan_area_kernel = SCAN_AREA_KERNEL_UNKNOWN;
+
+
+/* scan_area_kernel_choose -- choose the best kernel for this processor */
+
+static int scan_area_kernel_choose(void)
+{
+  unsigned eax, ebx, ecx, edx;
+
+  /* AVX2 needs CPUID.1:ECX.OSXSAVE and AVX, the operating system to
+     save the YMM registers (XCR0 bits 1 and 2), and CPUID.7.0:EBX.AVX2. */
+  if (__get_cpuid(1, &eax, &ebx, &ecx, &edx)
+      && (ecx & bit_OSXSAVE) != 0 && (ecx & bit_AVX) != 0)
+  {
+    unsigned xcr0_lo, xcr0_hi;
+    __asm__ __volatile__ ("xgetbv" : "=a" (xcr0_lo), "=d" (xcr0_hi) : "c" (0));
+    (void)xcr0_hi;
+    if ((xcr0_lo & 6) == 6
+        && __get_cpuid_max(0, NULL) >= 7)
+    {
+      __cpuid_count(7, 0, eax, ebx, ecx, edx);
+      if ((ebx & bit_AVX2) != 0)
+        return SCAN_AREA_KERNEL_AVX2;
+    }
+  }
+  return SCAN_AREA_KERNEL_SSE2;
+}
+
+#define SCAN_AREA_KERNEL() \
+  (scan_area_kernel != SCAN_AREA_KERNEL_UNKNOWN \
+   ? scan_area_kernel \
+   : (scan_area_kernel = scan_area_kernel_choose()))
+
+
+/* SCAN_AREA_SSE2 -- scan area two words at a time
+ *
+ * vtest is a vector expression in tags (the masked tag bits of the
+ * words) with all bits set in each lane that passes test.  SSE2
+ * lacks 64-bit variable shifts and comparisons, so each is made from
+ * two operations.
+ */
+
+static __m128i scan_area_sse2_cmpeq(__m128i a, __m128i b)
+{
+  __m128i cmp = _mm_cmpeq_epi32(a, b);
+  return _mm_and_si128(cmp, _mm_shuffle_epi32(cmp, _MM_SHUFFLE(2, 3, 0, 1)));
+}
+
+#define SCAN_AREA_SSE2(vtest, test)                                        \
+  MPS_SCAN_BEGIN(ss) {                                                     \
+    mps_word_t *p = base;                                                  \
+    mps_word_t *vlimit = p + (((mps_word_t *)limit - p) & ~(ptrdiff_t)1);  \
+    __m128i vmask = _mm_set1_epi64x((scan_area_int64_t)mask);              \
+    __m128i vwhite = _mm_set1_epi64x((scan_area_int64_t)_mps_w);           \
+    __m128i vzero = _mm_setzero_si128();                                   \
+    __m128i vone = _mm_set1_epi64x(1);                                     \
+    __m128i vzonemask = _mm_set1_epi64x(sizeof(mps_word_t) * CHAR_BIT - 1); \
+    __m128i vzs = _mm_cvtsi64_si128((scan_area_int64_t)_mps_zs);           \
+    __m128i vufs = vzero;                                                  \
+    mps_word_t ufs[2];                                                     \
+    while (p < vlimit) {                                                   \
+      __m128i words = _mm_loadu_si128((const __m128i *)p);                 \
+      __m128i tags = _mm_and_si128(words, vmask);                          \
+      __m128i refs = _mm_xor_si128(words, tags);                           \
+      __m128i zones = _mm_and_si128(_mm_srl_epi64(refs, vzs), vzonemask);  \
+      __m128i bits0 = _mm_sll_epi64(vone, zones);                          \
+      __m128i bits1 = _mm_sll_epi64(vone, _mm_unpackhi_epi64(zones, zones)); \
+      __m128i bits = _mm_castpd_si128(_mm_move_sd(_mm_castsi128_pd(bits1), \
+                                                  _mm_castsi128_pd(bits0))); \
+      int white;                                                           \
+      bits = _mm_and_si128(bits, vtest);                                   \
+      vufs = _mm_or_si128(vufs, bits);                                     \
+      white = _mm_movemask_pd(_mm_castsi128_pd(                            \
+        scan_area_sse2_cmpeq(_mm_and_si128(bits, vwhite), vzero))) ^ 3;    \
+      if (white != 0) {                                                    \
+        if (white & 1)                                                     \
+          MPS_SCAN_AREA_WORD(ss, p, test);                                 \
+        if (white & 2)                                                     \
+          MPS_SCAN_AREA_WORD(ss, p + 1, test);                             \
+      }                                                                    \
+      p += 2;                                                              \
+    }                                                                      \
+    _mm_storeu_si128((__m128i *)ufs, vufs);                                \
+    _mps_ufs |= ufs[0] | ufs[1];                                           \
+    while (p < (mps_word_t *)limit) {                                      \
+      MPS_SCAN_AREA_WORD(ss, p, test);                                     \
+      ++p;                                                                 \
+    }                                                                      \
+  } MPS_SCAN_END(ss);
+
+
+/* SCAN_AREA_AVX2 -- scan area four words at a time
+ *
+ * Like SCAN_AREA_SSE2, but using AVX2 instructions.  This must only
+ * be expanded in functions with the attribute SCAN_AREA_ATTR_AVX2.
+ */
+
+#define SCAN_AREA_ATTR_AVX2 __attribute__((target("avx2")))
+
+#define SCAN_AREA_AVX2(vtest, test)                                        \
+  MPS_SCAN_BEGIN(ss) {                                                     \
+    mps_word_t *p = base;                                                  \
+    mps_word_t *vlimit = p + (((mps_word_t *)limit - p) & ~(ptrdiff_t)3);  \
+    __m256i vmask = _mm256_set1_epi64x((scan_area_int64_t)mask);           \
+    __m256i vpattern = _mm256_set1_epi64x((scan_area_int64_t)pattern);     \
+    __m256i vwhite = _mm256_set1_epi64x((scan_area_int64_t)_mps_w);        \
+    __m256i vzero = _mm256_setzero_si256();                                \
+    __m256i vone = _mm256_set1_epi64x(1);                                  \
+    __m256i vzonemask = _mm256_set1_epi64x(sizeof(mps_word_t) * CHAR_BIT - 1); \
+    __m128i vzs = _mm_cvtsi64_si128((scan_area_int64_t)_mps_zs);           \
+    __m256i vufs = vzero;                                                  \
+    mps_word_t ufs[4];                                                     \
+    (void)vpattern;                                                        \
+    while (p < vlimit) {                                                   \
+      __m256i words = _mm256_loadu_si256((const __m256i *)p);              \
+      __m256i tags = _mm256_and_si256(words, vmask);                       \
+      __m256i refs = _mm256_xor_si256(words, tags);                        \
+      __m256i zones = _mm256_and_si256(_mm256_srl_epi64(refs, vzs),        \
+                                       vzonemask);                         \
+      __m256i bits = _mm256_and_si256(_mm256_sllv_epi64(vone, zones), vtest); \
+      int white;                                                           \
+      vufs = _mm256_or_si256(vufs, bits);                                  \
+      white = _mm256_movemask_pd(_mm256_castsi256_pd(                      \
+        _mm256_cmpeq_epi64(_mm256_and_si256(bits, vwhite), vzero))) ^ 15;  \
+      if (white != 0) {                                                    \
+        int i;                                                             \
+        for (i = 0; i < 4; ++i)                                            \
+          if (white & (1 << i))                                            \
+            MPS_SCAN_AREA_WORD(ss, p + i, test);                           \
+      }                                                                    \
+      p += 4;                                                              \
+    }                                                                      \
+    _mm256_storeu_si256((__m256i *)ufs, vufs);                             \
+    _mps_ufs |= ufs[0] | ufs[1] | ufs[2] | ufs[3];                         \
+    while (p < (mps_word_t *)limit) {                                      \
+      MPS_SCAN_AREA_WORD(ss, p, test);                                     \
+      ++p;                                                                 \
+    }                                                                      \
+  } MPS_SCAN_END(ss);
+
+
+/* Kernels for each area scanner.
+ *
+ * The "all" variants fix every word (after masking); the "tagged"
+ * variants only words whose tag matches the pattern; and the
+ * "tagged_or_zero" variants also words whose tag is zero.
+ */
+
+#define SCAN_AREA_KERNEL_ATTRS \
+  MPS_GC_ATTR_NO_SANITIZE_ADDR \
+  MPS_GC_ATTR_NO_SANITIZE_MEMORY \
+  MPS_GC_ATTR_NO_SANITIZE_THREAD
+
+SCAN_AREA_KERNEL_ATTRS
+static mps_res_t scan_area_all_sse2(mps_ss_t ss, void *base, void *limit,
+                                    mps_word_t mask, mps_word_t pattern)
+{
+  (void)pattern; /* unused */
+  SCAN_AREA_SSE2(_mm_cmpeq_epi32(tags, tags), 1);
+  return MPS_RES_OK;
+}
+
+SCAN_AREA_KERNEL_ATTRS SCAN_AREA_ATTR_AVX2
+static mps_res_t scan_area_all_avx2(mps_ss_t ss, void *base, void *limit,
+                                    mps_word_t mask, mps_word_t pattern)
+{
+  SCAN_AREA_AVX2(_mm256_cmpeq_epi64(tags, tags), 1);
+  return MPS_RES_OK;
+}
+
+SCAN_AREA_KERNEL_ATTRS SCAN_AREA_ATTR_AVX2
+static mps_res_t scan_area_tagged_avx2(mps_ss_t ss, void *base, void *limit,
+                                       mps_word_t mask, mps_word_t pattern)
+{
+  SCAN_AREA_AVX2(_mm256_cmpeq_epi64(tags, vpattern),
+                 tag_bits == pattern);
+  return MPS_RES_OK;
+}
+
+SCAN_AREA_KERNEL_ATTRS SCAN_AREA_ATTR_AVX2
+static mps_res_t scan_area_tagged_or_zero_avx2(mps_ss_t ss,
+                                               void *base, void *limit,
+                                               mps_word_t mask,
+                                               mps_word_t pattern)
+{
+  SCAN_AREA_AVX2(_mm256_or_si256(_mm256_cmpeq_epi64(tags, vzero),
+                                 _mm256_cmpeq_epi64(tags, vpattern)),
+                 tag_bits == 0 || tag_bits == pattern);
+  return MPS_RES_OK;
+}
+
+
+/* SCAN_AREA_DISPATCH -- scan with a vector kernel if worthwhile
+ *
+ * Returns from the calling function if a vector kernel scanned the
+ * area, otherwise falls through to the scalar loop.
+ * SCAN_AREA_DISPATCH_AVX2 only uses the AVX2 kernel: see
+ * .simd.sse2.tagged.
+ */
+
+#define SCAN_AREA_DISPATCH(name) \
+  MPS_BEGIN \
+    if ((mps_word_t *)limit - (mps_word_t *)base >= SCAN_AREA_SIMD_MIN) { \
+      switch (SCAN_AREA_KERNEL()) { \
+      case SCAN_AREA_KERNEL_AVX2: \
+        return scan_area_##name##_avx2(ss, base, limit, mask, pattern); \
+      case SCAN_AREA_KERNEL_SSE2: \
+        return scan_area_##name##_sse2(ss, base, limit, mask, pattern); \
+      default: \
+        break; \
+      } \
+    } \
+  MPS_END
+
+#define SCAN_AREA_DISPATCH_AVX2(name) \
+  MPS_BEGIN \
+    if ((mps_word_t *)limit - (mps_word_t *)base >= SCAN_AREA_SIMD_MIN \
+        && SCAN_AREA_KERNEL() == SCAN_AREA_KERNEL_AVX2) \
+      return scan_area_##name##_avx2(ss, base, limit, mask, pattern); \
+  MPS_END
+
+#else /* not SCAN_AREA_SIMD */
+
+#define SCAN_AREA_DISPATCH(name) MPS_BEGIN MPS_END
+#define SCAN_AREA_DISPATCH_AVX2(name) MPS_BEGIN MPS_END
+
+#endif /* SCAN_AREA_SIMD */
+
+
 /* mps_scan_area -- scan contiguous area of references
  *
  * This is a convenience function for scanning the contiguous area
@@ -147,9 +438,12 @@ mps_res_t mps_scan_area(mps_ss_t ss,
                         void *closure)
 {
   mps_word_t mask = 0;
+  mps_word_t pattern = 0;
 
   (void)closure; /* unused */
+  (void)pattern; /* only used by SCAN_AREA_DISPATCH */
 
+  SCAN_AREA_DISPATCH(all);
   MPS_SCAN_AREA(1);
 
   return MPS_RES_OK;
@@ -177,7 +471,11 @@ mps_res_t mps_scan_area_masked(mps_ss_t ss,
 {
   mps_scan_tag_t tag = closure;
   mps_word_t mask = tag->mask;
+  mps_word_t pattern = 0;
+
+  (void)pattern; /* only used by SCAN_AREA_DISPATCH */
 
+  SCAN_AREA_DISPATCH(all);
   MPS_SCAN_AREA(1);
 
   return MPS_RES_OK;
@@ -204,6 +502,7 @@ mps_res_t mps_scan_area_tagged(mps_ss_t ss,
   mps_word_t mask = tag->mask;
   mps_word_t pattern = tag->pattern;
 
+  SCAN_AREA_DISPATCH_AVX2(tagged);
   MPS_SCAN_AREA(tag_bits == pattern);
 
   return MPS_RES_OK;
@@ -236,6 +535,7 @@ mps_res_t mps_scan_area_tagged_or_zero(mps_ss_t ss,
   mps_word_t mask = tag->mask;
   mps_word_t pattern = tag->pattern;
 
+  SCAN_AREA_DISPATCH_AVX2(tagged_or_zero);
   MPS_SCAN_AREA(tag_bits == 0 || tag_bits == pattern);
 
   return MPS_RES_OK;
@@ -0,0 +1,254 @@
+/* scanbench.c -- Benchmark for the area scanners
+ *
+ * $Id$
+ * Copyright (c) 2026 Ravenbrook Limited.  See end of file for license.
+ *
+ * This measures the throughput of mps_scan_area, mps_scan_area_masked,
+ * mps_scan_area_tagged and mps_scan_area_tagged_or_zero with each of
+ * the kernels that are available on this platform (see
+ * <code/scan.c#.simd>), and checks that they all compute the same
+ * unfixed summary.
+ *
+ * The scan state is a fake: its white set contains only zones that
+ * none of the words in the area fall into, so the scanners never call
+ * MPS_FIX2.  This measures the cost of the MPS_FIX1 test, which is
+ * what dominates ambiguous scanning of stacks and roots.
+ */
+
+#include "mps.c"
+
+#include "testlib.h"
+
+#ifdef MPS_OS_W3
+#include "getopt.h"
+#else
+#include <getopt.h>
+#endif
+
+#include <stdio.h> /* fprintf, printf, stderr */
+#include <stdlib.h> /* exit, free, malloc, EXIT_SUCCESS, EXIT_FAILURE */
+#include <time.h> /* CLOCKS_PER_SEC, clock */
+
+
+static rnd_state_t seed = 0;      /* random number seed */
+static size_t nwords = 4096;      /* words in the area */
+static unsigned niter = 100000;   /* iterations */
+static unsigned zone_shift = 20;  /* zone shift of the fake scan state */
+
+
+/* Kernels that can be selected by setting scan_area_kernel. */
+
+static struct {
+  const char *name;
+  int kernel;
+} kernels[] = {
+  {"scalar", SCAN_AREA_KERNEL_SCALAR},
+#ifdef SCAN_AREA_SIMD
+  {"sse2",   SCAN_AREA_KERNEL_SSE2},   /* area and masked only */
+  {"avx2",   SCAN_AREA_KERNEL_AVX2},
+#endif
+};
+
+
+static struct {
+  const char *name;
+  mps_area_scan_t scan;
+} scanners[] = {
+  {"area",           mps_scan_area},
+  {"masked",         mps_scan_area_masked},
+  {"tagged",         mps_scan_area_tagged},
+  {"tagged_or_zero", mps_scan_area_tagged_or_zero},
+};
+
+
+/* kernel_available -- can this kernel run on this processor? */
+
+static mps_bool_t kernel_available(int kernel)
+{
+#ifdef SCAN_AREA_SIMD
+  if (kernel == SCAN_AREA_KERNEL_AVX2)
+    return scan_area_kernel_choose() == SCAN_AREA_KERNEL_AVX2;
+#endif
+  return kernel != SCAN_AREA_KERNEL_UNKNOWN;
+}
+
+
+/* kernel_set -- make the scanners use a kernel */
+
+static void kernel_set(int kernel)
+{
+#ifdef SCAN_AREA_SIMD
+  scan_area_kernel = kernel;
+#else
+  UNUSED(kernel);
+#endif
+}
+
+
+/* bench -- time one scanner with one kernel
+ *
+ * Returns the unfixed summary so that the caller can check the
+ * kernels agree.
+ */
+
+static mps_word_t bench(mps_area_scan_t scan, const char *scan_name,
+                        const char *kernel_name,
+                        mps_word_t *area, mps_scan_tag_t tag)
+{
+  mps_ss_s ss_s;
+  clock_t start, finish;
+  double secs;
+  unsigned i;
+
+  ss_s._zs = zone_shift;
+  ss_s._w = ~(mps_word_t)0 << (MPS_WORD_WIDTH / 2); /* upper half */
+  ss_s._ufs = 0;
+
+  start = clock();
+  for (i = 0; i < niter; ++i) {
+    mps_res_t res = scan(&ss_s, area, area + nwords, tag);
+    Insist(res == MPS_RES_OK);
+  }
+  finish = clock();
+
+  secs = (double)(finish - start) / CLOCKS_PER_SEC;
+  printf("%-15s %-7s %8.3fs %8.2f GB/s\n", scan_name, kernel_name, secs,
+         secs > 0
+         ? (double)nwords * sizeof(mps_word_t) * niter / secs / 1e9
+         : 0.0);
+  return ss_s._ufs;
+}
+
+
+/* Command-line option definitions.  See getopt_long(3). */
+
+static struct option longopts[] = {
+  {"help",       no_argument,       NULL, 'h'},
+  {"nwords",     required_argument, NULL, 'n'},
+  {"niter",      required_argument, NULL, 'i'},
+  {"zone-shift", required_argument, NULL, 'z'},
+  {"seed",       required_argument, NULL, 'x'},
+  {NULL,         0,                 NULL, 0  }
+};
+
+
+int main(int argc, char *argv[])
+{
+  int ch;
+  size_t i, j, k;
+  mps_word_t *area;
+  mps_scan_tag_s tag;
+  mps_word_t zone_mask;
+  mps_bool_t seed_specified = FALSE;
+  mps_bool_t ok = TRUE;
+
+  seed = rnd_seed();
+
+  while ((ch = getopt_long(argc, argv, "hn:i:z:x:", longopts, NULL)) != -1)
+    switch (ch) {
+    case 'n':
+      nwords = (size_t)strtoul(optarg, NULL, 10);
+      break;
+    case 'i':
+      niter = (unsigned)strtoul(optarg, NULL, 10);
+      break;
+    case 'z':
+      zone_shift = (unsigned)strtoul(optarg, NULL, 10);
+      break;
+    case 'x':
+      seed = strtoul(optarg, NULL, 10);
+      seed_specified = TRUE;
+      break;
+    default:
+      fprintf(stderr,
+              "Usage: %s [option...]\n"
+              "Options:\n"
+              "  -n n, --nwords=n\n"
+              "    Number of words in the area (default %lu)\n"
+              "  -i n, --niter=n\n"
+              "    Scan the area n times (default %u)\n"
+              "  -z n, --zone-shift=n\n"
+              "    Zone shift of the scan state (default %u)\n"
+              "  -x n, --seed=n\n"
+              "    Random number seed (default from entropy)\n",
+              argv[0],
+              (unsigned long)nwords,
+              niter,
+              zone_shift);
+      return EXIT_FAILURE;
+    }
+
+  if (!seed_specified) {
+    printf("seed: %lu\n", seed);
+    (void)fflush(stdout);
+  }
+  rnd_state_set(seed);
+
+  /* Fill the area with random words with random tags in the lower
+     half of the zones, so that none of them is in the white set. */
+  area = malloc(nwords * sizeof(mps_word_t));
+  if (area == NULL) {
+    fprintf(stderr, "Couldn't allocate %lu words\n", (unsigned long)nwords);
+    return EXIT_FAILURE;
+  }
+  zone_mask = (mps_word_t)(MPS_WORD_WIDTH / 2) << zone_shift;
+  for (i = 0; i < nwords; ++i) {
+    mps_word_t w = ((mps_word_t)rnd() << 16 << 16) ^ (mps_word_t)rnd();
+    area[i] = w & ~zone_mask;
+  }
+  tag.mask = 7;
+  tag.pattern = 1;
+
+  for (j = 0; j < NELEMS(scanners); ++j) {
+    mps_word_t ufs0 = 0;
+    for (k = 0; k < NELEMS(kernels); ++k) {
+      mps_word_t ufs;
+      if (!kernel_available(kernels[k].kernel))
+        continue;
+      kernel_set(kernels[k].kernel);
+      ufs = bench(scanners[j].scan, scanners[j].name, kernels[k].name,
+                  area, &tag);
+      if (k == 0) {
+        ufs0 = ufs;
+      } else if (ufs != ufs0) {
+        fprintf(stderr, "%s: %s kernel summary %lx differs from %lx\n",
+                scanners[j].name, kernels[k].name,
+                (unsigned long)ufs, (unsigned long)ufs0);
+        ok = FALSE;
+      }
+    }
+  }
+
+  free(area);
+  return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+
+/* C. COPYRIGHT AND LICENSE
+ *
+ * Copyright (C) 2026 Ravenbrook Limited <https://www.ravenbrook.com/>.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+ * IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
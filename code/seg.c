@@ -99,6 +99,7 @@ void SegFree(Seg seg)
   SegFinish(seg);
   ControlFree(arena, seg, structSize);
   ArenaFree(base, size, pool);
+  ++arena->segCacheSerial; /* <design/trace#.fix.cache.invalid> */
 
   EVENT2(SegFree, arena, seg);
 }
@@ -129,9 +130,13 @@ static Res segAbsInit(Seg seg, Pool pool, Addr base, Size size, ArgList args)
   seg->grey = TraceSetEMPTY;
   seg->pm = AccessSetEMPTY;
   seg->sm = AccessSetEMPTY;
+  seg->lowered = AccessSetEMPTY;
   seg->defer = WB_DEFER_INIT;
+  seg->accessSerial = arena->flipSerial;
+  seg->accessCount = 0;
   seg->depth = 0;
   seg->queued = FALSE;
+  seg->fixFast = SegFixFastNONE;
   seg->firstTract = NULL;
   RingInit(SegPoolRing(seg));
 
@@ -278,6 +283,7 @@ void SegSetWhite(Seg seg, TraceSet white)
   AVERT(Seg, seg);
   AVERT(TraceSet, white);
   Method(Seg, seg, setWhite)(seg, white);
+  ++PoolArena(SegPool(seg))->segCacheSerial; /* <design/trace#.fix.cache.invalid> */
 }
 
 
@@ -293,6 +299,10 @@ void SegSetRankSet(Seg seg, RankSet rankSet)
   AVERT(Seg, seg);
   AVERT(RankSet, rankSet);
   AVER(rankSet != RankSetEMPTY || SegSummary(seg) == RefSetEMPTY);
+  /* <design/write-barrier#.card.summary.forget> */
+  if (rankSet != RankSetEMPTY && SegRankSet(seg) == RankSetEMPTY
+      && ArenaCardMarking(PoolArena(SegPool(seg))))
+    SegCardsForget(seg, SegBase(seg), SegLimit(seg));
   Method(Seg, seg, setRankSet)(seg, rankSet);
 }
 
@@ -301,6 +311,8 @@ void SegSetRankSet(Seg seg, RankSet rankSet)
 
 void SegSetSummary(Seg seg, RefSet summary)
 {
+  Buffer buffer;
+
   AVERT(Seg, seg);
   AVER(summary == RefSetEMPTY || SegRankSet(seg) != RankSetEMPTY);
 
@@ -310,6 +322,13 @@ void SegSetSummary(Seg seg, RefSet summary)
   summary = RefSetUNIV;
 #endif
 
+  /* With card marking, the client initializes objects in a buffer
+     without the write barrier.  <design/write-barrier#.card.buffer> */
+  if (SegRankSet(seg) != RankSetEMPTY
+      && ArenaCardMarking(PoolArena(SegPool(seg)))
+      && SegBuffer(&buffer, seg))
+    summary = RefSetUNIV;
+
   if (summary != SegSummary(seg))
     Method(Seg, seg, setSummary)(seg, summary);
 }
@@ -319,6 +338,8 @@ void SegSetSummary(Seg seg, RefSet summary)
 
 void SegSetRankAndSummary(Seg seg, RankSet rankSet, RefSet summary)
 {
+  Buffer buffer;
+
   AVERT(Seg, seg);
   AVERT(RankSet, rankSet);
 
@@ -328,10 +349,57 @@ void SegSetRankAndSummary(Seg seg, RankSet rankSet, RefSet summary)
   }
 #endif
 
+  /* <design/write-barrier#.card.buffer> */
+  if (rankSet != RankSetEMPTY
+      && ArenaCardMarking(PoolArena(SegPool(seg)))
+      && SegBuffer(&buffer, seg))
+    summary = RefSetUNIV;
+
+  /* The card summaries of a leaf segment aren't kept.
+     <design/write-barrier#.card.summary.forget> */
+  if (rankSet != RankSetEMPTY && SegRankSet(seg) == RankSetEMPTY
+      && ArenaCardMarking(PoolArena(SegPool(seg))))
+    SegCardsForget(seg, SegBase(seg), SegLimit(seg));
+
   Method(Seg, seg, setRankSummary)(seg, rankSet, summary);
 }
 
 
+/* SegSetFixFast -- say how _mps_fix2 may fix references to a segment
+ *
+ * A pool class whose fix method does nothing for a reference to an
+ * object that is set in a bit table (indexed by grain from the
+ * segment base) passes SegFixFastMARK and that table.  A moving pool
+ * class whose fix method fills the snap-out cache passes
+ * SegFixFastSNAP.  See <design/trace#.fix.fast>.
+ */
+
+void SegSetFixFast(Seg seg, SegFixFast fixFast, BT marks)
+{
+  GCSeg gcseg = MustBeA(GCSeg, seg);
+  AVER(fixFast < SegFixFastLIMIT);
+  AVER((fixFast == SegFixFastMARK) == (marks != NULL));
+
+  seg->fixFast = BITFIELD(unsigned, fixFast, SegFixFastWIDTH);
+  gcseg->fixMarks = marks;
+}
+
+
+/* SegIsHot -- has the mutator hit the segment's barrier repeatedly?
+ *
+ * True if the mutator has hit the segment's barrier at least
+ * SEG_ACCESS_HOT times since the last flip.  See TraceSegAccess and
+ * <design/write-barrier#.hot>.
+ */
+
+Bool SegIsHot(Seg seg)
+{
+  AVERT(Seg, seg);
+  return seg->accessSerial == PoolArena(SegPool(seg))->flipSerial
+    && seg->accessCount >= SEG_ACCESS_HOT;
+}
+
+
 /* SegHasBuffer -- segment has a buffer? */
 
 Bool SegHasBuffer(Seg seg)
@@ -357,6 +425,13 @@ void SegSetBuffer(Seg seg, Buffer buffer)
   AVERT(Seg, seg);
   AVERT(Buffer, buffer);
   Method(Seg, seg, setBuffer)(seg, buffer);
+
+  /* <design/write-barrier#.card.buffer> */
+  if (ArenaCardMarking(PoolArena(SegPool(seg)))
+      && SegRankSet(seg) != RankSetEMPTY) {
+    SegSetSummary(seg, RefSetUNIV);
+    SegCardsForget(seg, BufferBase(buffer), BufferLimit(buffer));
+  }
 }
 
 
@@ -634,6 +709,7 @@ Res SegMerge(Seg *mergedSegReturn, Seg segLo, Seg segHi)
   EVENT2(SegMerge, segLo, segHi);
   /* Deallocate segHi object */
   ControlFree(arena, segHi, klass->size);
+  ++arena->segCacheSerial; /* <design/trace#.fix.cache.invalid> */
   AVERT(Seg, segLo);
   *mergedSegReturn = segLo;
   return ResOK;
@@ -693,6 +769,7 @@ Res SegSplit(Seg *segLoReturn, Seg *segHiReturn, Seg seg, Addr at)
     goto failSplit;
 
   EVENT4(SegSplit, seg, segNew, seg, at);
+  ++arena->segCacheSerial; /* <design/trace#.fix.cache.invalid> */
   AVERT(Seg, seg);
   AVERT(Seg, segNew);
   *segLoReturn = seg;
@@ -707,7 +784,12 @@ failControl:
 }
 
 
-/* SegAccess -- mutator read/write access to a segment */
+/* SegAccess -- mutator read/write access to a segment
+ *
+ * .access.count: Faults are counted by the pool that owns the
+ * segment, once for each kind of access in mode, so that a fault that
+ * removes both read and write protection is counted twice.
+ */
 
 Res SegAccess(Seg seg, Arena arena, Addr addr,
               AccessSet mode, MutatorContext context)
@@ -720,6 +802,11 @@ Res SegAccess(Seg seg, Arena arena, Addr addr,
   AVERT(AccessSet, mode);
   AVERT(MutatorContext, context);
 
+  if (BS_INTER(mode, AccessREAD) != AccessSetEMPTY)
+    STATISTIC(++SegPool(seg)->readFaultCount);
+  if (BS_INTER(mode, AccessWRITE) != AccessSetEMPTY)
+    STATISTIC(++SegPool(seg)->writeFaultCount);
+
   return Method(Seg, seg, access)(seg, arena, addr, mode, context);
 }
 
@@ -776,6 +863,58 @@ Res SegScan(Bool *totalReturn, Seg seg, ScanState ss)
 }
 
 
+/* SegScanArea -- scan the objects in a segment that overlap an area
+ *
+ * Scans every object in seg that overlaps [*baseIO, *limitIO), and
+ * widens the area to the extent of those objects, so that there are
+ * no unscanned objects in it.  The objects keep their colour.  The
+ * area must not overlap the part of the buffer (if any) that can't be
+ * scanned.  Returns ResUNIMPL if the class can't scan part of this
+ * segment, having scanned nothing.
+ * <design/write-barrier#.page>.
+ */
+
+Res SegScanArea(Addr *baseIO, Addr *limitIO, Seg seg, ScanState ss)
+{
+  Buffer buffer;
+
+  AVER(baseIO != NULL);
+  AVER(limitIO != NULL);
+  AVERT(Seg, seg);
+  AVERT(ScanState, ss);
+  AVER(PoolArena(SegPool(seg)) == ss->arena);
+  AVER(SegBase(seg) <= *baseIO);
+  AVER(*baseIO < *limitIO);
+  AVER(*limitIO <= SegLimit(seg));
+  AVER(!SegBuffer(&buffer, seg)
+       || *limitIO <= BufferScanLimit(buffer)
+       || BufferLimit(buffer) <= *baseIO);
+  AVER(ss->rank == RankEXACT || RankSetIsMember(SegRankSet(seg), ss->rank));
+
+  return Method(Seg, seg, scanArea)(baseIO, limitIO, seg, ss);
+}
+
+
+/* SegScanUnlogged -- scan a segment on a collector worker thread
+ *
+ * Like SegScan, but doesn't log the SegScan event, because the event
+ * buffers are not thread-safe.  The caller logs it on the worker's
+ * behalf.  See <design/trace#.parallel.event>.
+ */
+
+Res SegScanUnlogged(Bool *totalReturn, Seg seg, ScanState ss)
+{
+  AVER(totalReturn != NULL);
+  AVERT(Seg, seg);
+  AVERT(ScanState, ss);
+  AVER(PoolArena(SegPool(seg)) == ss->arena);
+  AVER(PoolHasAttr(SegPool(seg), AttrPARSCAN));
+  AVER(ss->rank == RankEXACT || RankSetIsMember(SegRankSet(seg), ss->rank));
+
+  return Method(Seg, seg, scan)(totalReturn, seg, ss);
+}
+
+
 /* SegFix* -- fix a reference to an object in this segment
  *
  * <design/pool#.req.fix>.
@@ -810,9 +949,12 @@ Res SegFixEmergency(Seg seg, ScanState ss, Addr *refIO)
 }
 
 
-/* SegReclaim -- reclaim a segment */
+/* SegReclaim -- reclaim a segment
+ *
+ * Returns TRUE if the segment was freed.
+ */
 
-void SegReclaim(Seg seg, Trace trace)
+Bool SegReclaim(Seg seg, Trace trace)
 {
   AVERT_CRITICAL(Seg, seg);
   AVERT_CRITICAL(Trace, trace);
@@ -824,7 +966,7 @@ void SegReclaim(Seg seg, Trace trace)
   AVER_CRITICAL(TraceSetIsMember(SegWhite(seg), trace));
 
   EVENT4(SegReclaim, trace->arena, SegPool(seg), trace, seg);
-  Method(Seg, seg, reclaim)(seg, trace);
+  return Method(Seg, seg, reclaim)(seg, trace);
 }
 
 
@@ -865,6 +1007,7 @@ Bool SegCheck(Seg seg)
   /* can't assume nailed is subset of white - mightn't be during whiten */
   /* CHECKL(TraceSetSub(seg->nailed, seg->white)); */
   CHECKL(TraceSetCheck(seg->grey));
+  CHECKL(seg->fixFast < SegFixFastLIMIT);
   CHECKD_NOSIG(Tract, seg->firstTract);
   pool = SegPool(seg);
   CHECKU(Pool, pool);
@@ -908,6 +1051,10 @@ Bool SegCheck(Seg seg)
      <design/shield#.inv.prot.shield>. */
   CHECKL(BS_DIFF(seg->pm, seg->sm) == 0);
 
+  /* Only modes in the protection mode can be lowered on some pages
+     <design/shield#.lower.range>. */
+  CHECKL(BS_DIFF(seg->lowered, seg->pm) == 0);
+
   /* All unsynced segments have positive depth or are in the queue
      <design/shield#.inv.unsynced.depth>. */
   CHECKL(seg->sm == seg->pm || seg->depth > 0 || seg->queued);
@@ -1114,6 +1261,7 @@ static Res segTrivMerge(Seg seg, Seg segHi,
   /* no need to update fields which match. See .similar */
 
   seg->limit = limit;
+  seg->lowered = BS_BITFIELD(Access, BS_UNION(seg->lowered, segHi->lowered));
   TRACT_FOR(tract, addr, arena, mid, limit) {
     AVERT(Tract, tract);
     AVER(segHi == TractSeg(tract));
@@ -1185,8 +1333,10 @@ static Res segTrivSplit(Seg seg, Seg segHi,
   segHi->grey = seg->grey;
   segHi->pm = seg->pm;
   segHi->sm = seg->sm;
+  segHi->lowered = seg->lowered;
   segHi->depth = seg->depth;
   segHi->queued = seg->queued;
+  segHi->fixFast = SegFixFastNONE; /* the class may set it again */
   segHi->firstTract = NULL;
   RingInit(SegPoolRing(segHi));
 
@@ -1264,6 +1414,32 @@ Res SegWholeAccess(Seg seg, Arena arena, Addr addr,
 }
 
 
+/* SegPageAccess
+ *
+ * See also SegWholeAccess
+ *
+ * Should be used (for the access method) by segment classes with a
+ * scanArea method, so that a read fault on a large segment can be
+ * handled by scanning only the objects on the faulting page, and
+ * lowering the barrier on that page.  <design/write-barrier#.page>.
+ */
+Res SegPageAccess(Seg seg, Arena arena, Addr addr,
+                  AccessSet mode, MutatorContext context)
+{
+  AVERT(Seg, seg);
+  AVERT(Arena, arena);
+  AVER(arena == PoolArena(SegPool(seg)));
+  AVER(SegBase(seg) <= addr);
+  AVER(addr < SegLimit(seg));
+  AVERT(AccessSet, mode);
+  AVERT(MutatorContext, context);
+
+  UNUSED(context);
+  TraceSegPageAccess(arena, seg, addr, mode);
+  return ResOK;
+}
+
+
 /* SegSingleAccess
  *
  * See also ArenaRead, and SegWhileAccess.
@@ -1307,13 +1483,17 @@ Res SegSingleAccess(Seg seg, Arena arena, Addr addr,
       /* .tagging: Check that the reference is aligned to a word boundary */
       /* (we assume it is not a reference otherwise). */
       if(WordIsAligned((Word)ref, sizeof(Word))) {
-        Rank rank;
+        TraceSet grey = TraceSetInter(SegGrey(seg), arena->flippedTraces);
+        TraceId ti;
+        Trace trace;
         /* See the note in TraceRankForAccess */
         /* <code/trace.c#scan.conservative>. */
 
-        rank = TraceRankForAccess(arena, seg);
-        TraceScanSingleRef(arena->flippedTraces, rank, arena,
-                           seg, (Ref *)addr);
+        TRACE_SET_ITER(ti, trace, grey, arena)
+          Rank rank = TraceRankForAccess(trace, seg);
+          TraceScanSingleRef(TraceSetSingle(trace), rank, arena,
+                             seg, (Ref *)addr);
+        TRACE_SET_ITER_END(ti, trace, grey, arena);
       }
     }
     res = MutatorContextStepInstruction(context);
@@ -1381,6 +1561,19 @@ static Res segNoScan(Bool *totalReturn, Seg seg, ScanState ss)
 }
 
 
+/* segNoScanArea -- scan area method for segs that can't do it */
+
+static Res segNoScanArea(Addr *baseIO, Addr *limitIO,
+                         Seg seg, ScanState ss)
+{
+  AVER(baseIO != NULL);
+  AVER(limitIO != NULL);
+  AVERT(Seg, seg);
+  AVERT(ScanState, ss);
+  return ResUNIMPL;
+}
+
+
 /* segNoFix -- fix method for non-GC segs */
 
 static Res segNoFix(Seg seg, ScanState ss, Ref *refIO)
@@ -1395,12 +1588,13 @@ static Res segNoFix(Seg seg, ScanState ss, Ref *refIO)
 
 /* segNoReclaim -- reclaim method for non-GC segs */
 
-static void segNoReclaim(Seg seg, Trace trace)
+static Bool segNoReclaim(Seg seg, Trace trace)
 {
   AVERT(Seg, seg);
   AVERT(Trace, trace);
   AVER(PoolArena(SegPool(seg)) == trace->arena);
   NOTREACHED;
+  return FALSE;
 }
 
 
@@ -1437,10 +1631,19 @@ Bool GCSegCheck(GCSeg gcseg)
     CHECKL(BufferRankSet(gcseg->buffer) == SegRankSet(seg));
   }
 
-  /* The segment should be on a grey ring if and only if it is grey. */
-  CHECKD_NOSIG(Ring, &gcseg->greyRing);
-  CHECKL((seg->grey == TraceSetEMPTY) ==
-         RingIsSingle(&gcseg->greyRing));
+  /* The segment should be in a trace's grey queue if and only if it
+     is grey for that trace.  <design/trace#.grey.queue.ring> */
+  {
+    TraceId ti;
+    for (ti = 0; ti < TraceLIMIT; ++ti) {
+      GreyLink link = &gcseg->greyLink[ti];
+      CHECKL(link->seg == seg);
+      CHECKD_NOSIG(Ring, &link->ring);
+      CHECKL(BS_IS_MEMBER(seg->grey, ti) != RingIsSingle(&link->ring));
+      CHECKL(!BS_IS_MEMBER(seg->grey, ti)
+             || RankSetIsMember(seg->rankSet, link->rank));
+    }
+  }
 
   if (seg->rankSet == RankSetEMPTY) {
     /* <design/seg#.field.rankSet.empty> */
@@ -1449,10 +1652,42 @@ Bool GCSegCheck(GCSeg gcseg)
 
   CHECKD_NOSIG(Ring, &gcseg->genRing);
 
+  /* <design/trace#.fix.fast> */
+  CHECKL((seg->fixFast == SegFixFastMARK) == (gcseg->fixMarks != NULL));
+
   return TRUE;
 }
 
 
+/* gcSegGreyLinksInit, gcSegGreyLinksFinish -- grey queue links
+ *
+ * Each GC segment has a link for each trace, so that it can be in
+ * the grey queues of several traces.  <design/trace#.grey.queue>
+ */
+
+static void gcSegGreyLinksInit(GCSeg gcseg, Seg seg)
+{
+  TraceId ti;
+  for (ti = 0; ti < TraceLIMIT; ++ti) {
+    GreyLink link = &gcseg->greyLink[ti];
+    RingInit(&link->ring);
+    TreeInit(&link->treeStruct);
+    link->seg = seg;
+    link->rank = RankMIN;
+  }
+}
+
+static void gcSegGreyLinksFinish(GCSeg gcseg)
+{
+  TraceId ti;
+  for (ti = 0; ti < TraceLIMIT; ++ti) {
+    GreyLink link = &gcseg->greyLink[ti];
+    TreeFinish(&link->treeStruct);
+    RingFinish(&link->ring);
+  }
+}
+
+
 /* gcSegInit -- method to initialize a GC segment */
 
 static Res gcSegInit(Seg seg, Pool pool, Addr base, Size size, ArgList args)
@@ -1468,8 +1703,9 @@ static Res gcSegInit(Seg seg, Pool pool, Addr base, Size size, ArgList args)
 
   gcseg->summary = RefSetEMPTY;
   gcseg->buffer = NULL;
-  RingInit(&gcseg->greyRing);
+  gcSegGreyLinksInit(gcseg, seg);
   RingInit(&gcseg->genRing);
+  gcseg->fixMarks = NULL;
 
   SetClassOfPoly(seg, CLASS(GCSeg));
   gcseg->sig = GCSegSig;
@@ -1487,7 +1723,13 @@ static void gcSegFinish(Inst inst)
   GCSeg gcseg = MustBeA(GCSeg, seg);
 
   if (SegGrey(seg) != TraceSetEMPTY) {
-    RingRemove(&gcseg->greyRing);
+    Arena arena = PoolArena(SegPool(seg));
+    TraceSet grey = SegGrey(seg);
+    TraceId ti;
+    Trace trace;
+    TRACE_SET_ITER(ti, trace, grey, arena)
+      TraceGreyRemove(trace, &gcseg->greyLink[ti]);
+    TRACE_SET_ITER_END(ti, trace, grey, arena);
     seg->grey = TraceSetEMPTY;
   }
 
@@ -1501,7 +1743,7 @@ static void gcSegFinish(Inst inst)
   /* Don't leave a dangling buffer allocating into hyperspace. */
   AVER(gcseg->buffer == NULL); /* <design/check/#.common> */
 
-  RingFinish(&gcseg->greyRing);
+  gcSegGreyLinksFinish(gcseg);
   RingFinish(&gcseg->genRing);
 
   /* finish the superclass fields last */
@@ -1522,51 +1764,35 @@ static void gcSegSetGreyInternal(Seg seg, TraceSet oldGrey, TraceSet grey)
   GCSeg gcseg;
   Arena arena;
   Rank rank;
+  TraceId ti;
+  Trace trace;
+  TraceSet diff;
 
   /* Internal method. Parameters are checked by caller */
   gcseg = SegGCSeg(seg);
   arena = PoolArena(SegPool(seg));
   seg->grey = BS_BITFIELD(Trace, grey);
 
-  /* If the segment is now grey and wasn't before, add it to the */
-  /* appropriate grey list so that TraceFindGrey can locate it */
-  /* quickly later.  If it is no longer grey and was before, */
-  /* remove it from the list. */
-  if (oldGrey == TraceSetEMPTY) {
-    if (grey != TraceSetEMPTY) {
-      AVER(RankSetIsSingle(seg->rankSet));
-      for(rank = RankMIN; rank < RankLIMIT; ++rank)
-        if (RankSetIsMember(seg->rankSet, rank)) {
-          /* NOTE: We push the segment onto the front of the queue, so that
-             we preserve some locality of scanning, and so that we tend to
-             forward objects that are closely linked to the same or nearby
-             segments. */
-          RingInsert(ArenaGreyRing(arena, rank), &gcseg->greyRing);
-          break;
-        }
-      AVER(rank != RankLIMIT); /* there should've been a match */
-    }
-  } else {
-    if (grey == TraceSetEMPTY)
-      RingRemove(&gcseg->greyRing);
-  }
-
-  STATISTIC({
-    TraceId ti; Trace trace;
-    TraceSet diff;
-
-    diff = TraceSetDiff(grey, oldGrey);
+  /* For each trace for which the segment is now grey and wasn't */
+  /* before, add it to the trace's grey queue for its rank so that */
+  /* traceFindGrey can locate it quickly later.  For each trace for */
+  /* which it is no longer grey, remove it from the queue. */
+  diff = TraceSetDiff(grey, oldGrey);
+  if (diff != TraceSetEMPTY) {
+    AVER(RankSetIsSingle(seg->rankSet));
+    for(rank = RankMIN; rank < RankLIMIT; ++rank)
+      if (RankSetIsMember(seg->rankSet, rank))
+        break;
+    AVER(rank != RankLIMIT); /* there should've been a match */
     TRACE_SET_ITER(ti, trace, diff, arena)
-      ++trace->greySegCount;
-      if (trace->greySegCount > trace->greySegMax)
-        trace->greySegMax = trace->greySegCount;
+      TraceGreyInsert(trace, &gcseg->greyLink[ti], rank);
     TRACE_SET_ITER_END(ti, trace, diff, arena);
+  }
 
-    diff = TraceSetDiff(oldGrey, grey);
-    TRACE_SET_ITER(ti, trace, diff, arena)
-      --trace->greySegCount;
-    TRACE_SET_ITER_END(ti, trace, diff, arena);
-  });
+  diff = TraceSetDiff(oldGrey, grey);
+  TRACE_SET_ITER(ti, trace, diff, arena)
+    TraceGreyRemove(trace, &gcseg->greyLink[ti]);
+  TRACE_SET_ITER_END(ti, trace, diff, arena);
 }
 
 
@@ -1607,11 +1833,19 @@ static void mutatorSegSetGrey(Seg seg, TraceSet grey)
   arena = PoolArena(SegPool(seg));
   flippedTraces = arena->flippedTraces;
   if (TraceSetInter(oldGrey, flippedTraces) == TraceSetEMPTY) {
-    if (TraceSetInter(grey, flippedTraces) != TraceSetEMPTY)
+    if (TraceSetInter(grey, flippedTraces) != TraceSetEMPTY) {
       ShieldRaise(arena, seg, AccessREAD);
-  } else {
-    if (TraceSetInter(grey, flippedTraces) == TraceSetEMPTY)
-      ShieldLower(arena, seg, AccessREAD);
+      /* <design/write-barrier#.hot.read> */
+      if (SegIsHot(seg))
+        TraceNoteHotGrey(arena, seg);
+    }
+  } else if (TraceSetInter(grey, flippedTraces) == TraceSetEMPTY) {
+    ShieldLower(arena, seg, AccessREAD);
+  } else if (TraceSetDiff(TraceSetInter(grey, flippedTraces), oldGrey)
+             != TraceSetEMPTY) {
+    /* Pages scanned for the other traces may have been lowered.
+       <design/write-barrier#.page.lowered> */
+    ShieldRaise(arena, seg, AccessREAD);
   }
 }
 
@@ -1635,8 +1869,11 @@ static void mutatorSegFlip(Seg seg, Trace trace)
   } else {
     /* If the segment is grey for some currently flipped trace then
        the read barrier must already have been raised, either in this
-       method or in mutatorSegSetGrey. */
+       method or in mutatorSegSetGrey.  But it may have been lowered
+       on pages that were only scanned for those traces.
+       <design/write-barrier#.page.lowered> */
     AVER(SegSM(seg) & AccessREAD);
+    ShieldRaise(arena, seg, AccessREAD);
   }
 }
 
@@ -1688,6 +1925,9 @@ static void gcSegSetRankSet(Seg seg, RankSet rankSet)
  * the write barrier must be imposed on the segment. If the rank set
  * is made empty then there are no longer any references on the
  * segment so the barrier is removed.
+ *
+ * With card marking, the barrier is never raised.
+ * <design/write-barrier#.card>
  */
 
 static void mutatorSegSetRankSet(Seg seg, RankSet rankSet)
@@ -1699,6 +1939,9 @@ static void mutatorSegSetRankSet(Seg seg, RankSet rankSet)
 
   NextMethod(Seg, MutatorSeg, setRankSet)(seg, rankSet);
 
+  if (ArenaCardMarking(PoolArena(SegPool(seg))))
+    return;
+
   if (oldRankSet == RankSetEMPTY) {
     if (rankSet != RankSetEMPTY) {
       AVER_CRITICAL(SegGCSeg(seg)->summary == RefSetEMPTY);
@@ -1720,13 +1963,17 @@ static void mutatorSegSetRankSet(Seg seg, RankSet rankSet)
  * the unprotectable data (that is, the mutator). We don't maintain
  * such a summary, assuming that the mutator can access all
  * references, so its summary is RefSetUNIV.
+ *
+ * With card marking, the client's calls to the write barrier keep the
+ * summary valid instead, so the barrier is never raised.
+ * <design/write-barrier#.card>
  */
 
 static void mutatorSegSyncWriteBarrier(Seg seg)
 {
   Arena arena = PoolArena(SegPool(seg));
   /* Can't check seg -- this function enforces invariants tested by SegCheck. */
-  if (SegSummary(seg) == RefSetUNIV)
+  if (SegSummary(seg) == RefSetUNIV || ArenaCardMarking(arena))
     ShieldLower(arena, seg, AccessWRITE);
   else
     ShieldRaise(arena, seg, AccessWRITE);
@@ -1900,7 +2147,7 @@ static Res gcSegMerge(Seg seg, Seg segHi,
   gcSegSetGreyInternal(segHi, grey, TraceSetEMPTY);
   gcsegHi->summary = RefSetEMPTY;
   gcsegHi->sig = SigInvalid;
-  RingFinish(&gcsegHi->greyRing);
+  gcSegGreyLinksFinish(gcsegHi);
   RingRemove(&gcsegHi->genRing);
   RingFinish(&gcsegHi->genRing);
 
@@ -1961,8 +2208,9 @@ static Res gcSegSplit(Seg seg, Seg segHi,
   gcsegHi = SegGCSeg(segHi);
   gcsegHi->summary = gcseg->summary;
   gcsegHi->buffer = NULL;
-  RingInit(&gcsegHi->greyRing);
+  gcSegGreyLinksInit(gcsegHi, segHi);
   RingInit(&gcsegHi->genRing);
+  gcsegHi->fixMarks = NULL; /* see segTrivSplit */
   RingInsert(&gcseg->genRing, &gcsegHi->genRing);
   gcsegHi->sig = GCSegSig;
   gcSegSetGreyInternal(segHi, TraceSetEMPTY, grey);
@@ -2013,7 +2261,7 @@ static void gcSegGreyen(Seg seg, Trace trace)
   AVER(PoolArena(SegPool(seg)) == trace->arena);
 
   if (!TraceSetIsMember(SegWhite(seg), trace))
-    SegSetGrey(seg, TraceSetSingle(trace));
+    SegSetGrey(seg, TraceSetAdd(SegGrey(seg), trace));
 }
 
 
@@ -2089,6 +2337,7 @@ Bool SegClassCheck(SegClass klass)
   CHECKL(FUNCHECK(klass->greyen));
   CHECKL(FUNCHECK(klass->blacken));
   CHECKL(FUNCHECK(klass->scan));
+  CHECKL(FUNCHECK(klass->scanArea));
   CHECKL(FUNCHECK(klass->fix));
   CHECKL(FUNCHECK(klass->fixEmergency));
   CHECKL(FUNCHECK(klass->reclaim));
@@ -2141,6 +2390,7 @@ DEFINE_CLASS(Seg, Seg, klass)
   klass->greyen = segNoGreyen;
   klass->blacken = segNoBlacken;
   klass->scan = segNoScan;
+  klass->scanArea = segNoScanArea;
   klass->fix = segNoFix;
   klass->fixEmergency = segNoFix;
   klass->reclaim = segNoReclaim;
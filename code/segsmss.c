@@ -828,11 +828,20 @@ int main(int argc, char *argv[])
 {
   mps_arena_t arena;
   mps_thr_t thread;
+  unsigned greyOrder;
 
   testlib_init(argc, argv);
 
-  die(mps_arena_create(&arena, mps_arena_class_vm(), testArenaSIZE),
-      "arena_create");
+  /* Splitting and merging grey segments must keep the grey queues in
+     order.  <design/trace#.grey.queue.split> */
+  greyOrder = rnd() % 2 ? MPS_GREY_ORDER_ADDRESS : MPS_GREY_ORDER_LIFO;
+  printf("Picked greyOrder=%u\n", greyOrder);
+  MPS_ARGS_BEGIN(args) {
+    MPS_ARGS_ADD(args, MPS_KEY_ARENA_SIZE, testArenaSIZE);
+    MPS_ARGS_ADD(args, MPS_KEY_TRACE_GREY_ORDER, greyOrder);
+    die(mps_arena_create_k(&arena, mps_arena_class_vm(), args),
+        "arena_create");
+  } MPS_ARGS_END(args);
   die(mps_thread_reg(&thread, arena), "thread_reg");
   test(arena);
   mps_thread_dereg(thread);
@@ -27,6 +27,8 @@ void ShieldInit(Shield shield)
   shield->depth = 0;
   shield->unsynced = 0;
   shield->holds = 0;
+  STATISTIC(shield->protCount = 0);
+  STATISTIC(shield->aliasCount = 0);
   shield->sig = ShieldSig;
 }
 
@@ -126,6 +128,10 @@ Res ShieldDescribe(Shield shield, mps_lib_FILE *stream, Count depth)
                "  length    $U\n", (WriteFU)shield->length,
                "  unsynced  $U\n", (WriteFU)shield->unsynced,
                "  holds     $U\n", (WriteFU)shield->holds,
+               STATISTIC_WRITE("  protCount  $U\n",
+                               (WriteFU)shield->protCount)
+               STATISTIC_WRITE("  aliasCount $U\n",
+                               (WriteFU)shield->aliasCount)
                "} Shield $P\n",    (WriteFP)shield,
                NULL);
   if (res != ResOK)
@@ -222,6 +228,8 @@ static void shieldSync(Shield shield, Seg seg)
   if (!SegIsSynced(seg)) {
     shieldSetPM(shield, seg, SegSM(seg));
     ProtSet(SegBase(seg), SegLimit(seg), SegPM(seg));
+    seg->lowered = AccessSetEMPTY;
+    STATISTIC(++shield->protCount);
   }
 }
 
@@ -242,8 +250,11 @@ static void shieldSuspend(Arena arena)
   AVER(shield->inside);
 
   if (!shield->suspended) {
+    Clock begin = ClockNow();
     ThreadRingSuspend(ArenaThreadRing(arena), ArenaDeadRing(arena));
     shield->suspended = TRUE;
+    EVENT3(ArenaSuspend, arena, RingLength(ArenaThreadRing(arena)),
+           (ClockNow() - begin));
   }
 }
 
@@ -303,6 +314,8 @@ static void shieldProtLower(Shield shield, Seg seg, AccessSet mode)
   if (BS_INTER(SegPM(seg), mode) != AccessSetEMPTY) {
     shieldSetPM(shield, seg, BS_DIFF(SegPM(seg), mode));
     ProtSet(SegBase(seg), SegLimit(seg), SegPM(seg));
+    seg->lowered = AccessSetEMPTY;
+    STATISTIC(++shield->protCount);
   }
 }
 
@@ -411,10 +424,12 @@ static void shieldFlushEntries(Shield shield)
     Seg seg = shieldDequeue(shield, i);
     if (!SegIsSynced(seg)) {
       shieldSetPM(shield, seg, SegSM(seg));
+      seg->lowered = AccessSetEMPTY; /* protected whole below */
       if (SegSM(seg) != mode || SegBase(seg) != limit) {
         if (base != NULL) {
           AVER(base < limit);
           ProtSet(base, limit, mode);
+          STATISTIC(++shield->protCount);
         }
         base = SegBase(seg);
         mode = SegSM(seg);
@@ -425,6 +440,7 @@ static void shieldFlushEntries(Shield shield)
   if (base != NULL) {
     AVER(base < limit);
     ProtSet(base, limit, mode);
+    STATISTIC(++shield->protCount);
   }
 
   shieldQueueReset(shield);
@@ -545,6 +561,16 @@ void (ShieldRaise)(Arena arena, Seg seg, AccessSet mode)
   /* <design/shield#.inv.prot.shield> preserved */
   shieldSetSM(ArenaShield(arena), seg, BS_UNION(SegSM(seg), mode));
 
+  /* If mode was lowered on some pages, protect them again, as the
+     reason for raising it may not have been true when they were
+     lowered.  An unsynced segment is protected whole when it's
+     synced.  <design/shield#.lower.range> */
+  if (BS_INTER(seg->lowered, mode) != AccessSetEMPTY && SegIsSynced(seg)) {
+    ProtSet(SegBase(seg), SegLimit(seg), SegPM(seg));
+    seg->lowered = AccessSetEMPTY;
+    STATISTIC(++shield->protCount);
+  }
+
   /* Ensure <design/shield#.inv.unsynced.suspended> and
      <design/shield#.inv.unsynced.depth> */
   shieldQueue(arena, seg);
@@ -583,6 +609,46 @@ void (ShieldLower)(Arena arena, Seg seg, AccessSet mode)
 }
 
 
+/* ShieldLowerRange -- let the mutator access part of a segment
+ *
+ * Lowers the protection on [base, limit), which must be a range of
+ * whole grains of the segment, by mode, but leaves the shield mode
+ * and the protection mode of the segment alone.  The MPS must have
+ * made that part of the segment safe for the mutator.  The pages stay
+ * lowered until the segment is protected whole, which ShieldRaise
+ * does for mode.  <design/shield#.lower.range>
+ */
+
+void (ShieldLowerRange)(Arena arena, Seg seg, Addr base, Addr limit,
+                        AccessSet mode)
+{
+  Shield shield;
+
+  AVERT(Arena, arena);
+  shield = ArenaShield(arena);
+  SHIELD_AVERT(Seg, seg);
+  AVER(SegBase(seg) <= base);
+  AVER(base < limit);
+  AVER(limit <= SegLimit(seg));
+  AVER(AddrIsArenaGrain(base, arena));
+  AVER(AddrIsArenaGrain(limit, arena));
+  AVERT(AccessSet, mode);
+  AVER(!SegIsExposed(seg));
+
+  /* The segment may be queued by ShieldCover, and its protection must
+     be up to date before part of it is lowered, or a flush would
+     protect the part again. */
+  shieldSync(shield, seg);
+
+  if (BS_INTER(SegPM(seg), mode) != AccessSetEMPTY) {
+    ProtSet(base, limit, BS_DIFF(SegPM(seg), mode));
+    seg->lowered = BS_BITFIELD(Access, BS_UNION(seg->lowered,
+                                                BS_INTER(SegPM(seg), mode)));
+    STATISTIC(++shield->protCount);
+  }
+}
+
+
 /* ShieldEnter -- enter the shield, allowing exposes */
 
 void (ShieldEnter)(Arena arena)
@@ -760,6 +826,54 @@ void (ShieldCover)(Arena arena, Seg seg)
 }
 
 
+/* ShieldExposeAlias -- allow the MPS access to a segment through its alias
+ *
+ * Returns the offset to add to an address in the segment to get the
+ * address of the same memory in the collector alias, which is never
+ * protected <design/shield#.alias>.  The segment's protection is left
+ * alone, but the mutator is held as for ShieldExpose.  If the segment
+ * is not protected, or its chunk has no alias, this is ShieldExpose
+ * and the offset is zero.
+ */
+
+Size (ShieldExposeAlias)(Arena arena, Seg seg)
+{
+  Chunk chunk;
+  Bool b;
+
+  /* <design/trace#.fix.noaver> */
+  AVERT_CRITICAL(Arena, arena);
+  AVER_CRITICAL(ArenaShield(arena)->inside);
+
+  if (SegPM(seg) != AccessSetEMPTY) {
+    b = ChunkOfAddr(&chunk, arena, SegBase(seg));
+    AVER_CRITICAL(b);
+    if (ChunkAlias(chunk) != 0) {
+      ShieldHold(arena);
+      STATISTIC(++ArenaShield(arena)->aliasCount);
+      return ChunkAlias(chunk);
+    }
+  }
+
+  ShieldExpose(arena, seg);
+  return 0;
+}
+
+
+/* ShieldCoverAlias -- declare MPS no longer needs access through alias
+ *
+ * alias must be the offset returned by the matching ShieldExposeAlias.
+ */
+
+void (ShieldCoverAlias)(Arena arena, Seg seg, Size alias)
+{
+  if (alias != 0)
+    ShieldRelease(arena);
+  else
+    ShieldCover(arena, seg);
+}
+
+
 /* C. COPYRIGHT AND LICENSE
  *
  * Copyright (C) 2001-2020 Ravenbrook Limited <https://www.ravenbrook.com/>.
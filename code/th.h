@@ -38,9 +38,14 @@ extern Res ThreadDescribe(Thread thread, mps_lib_FILE *stream, Count depth);
  *  for deregistration.
  *
  *  Threads must not be multiply registered in the same arena.
+ *
+ *  If cooperative is TRUE, the thread promises to poll its safepoint
+ *  (see below) and is stopped there instead of being suspended
+ *  <design/thread-manager#.coop>.
  */
 
-extern Res ThreadRegister(Thread *threadReturn, Arena arena);
+extern Res ThreadRegister(Thread *threadReturn, Arena arena,
+                          Bool cooperative);
 
 extern void ThreadDeregister(Thread thread, Arena arena);
 
@@ -75,6 +80,28 @@ extern Res ThreadScan(ScanState ss, Thread thread, void *stackCold,
 extern void ThreadSetup(void);
 
 
+/*  Cooperative threads <design/thread-manager#.coop>
+ *
+ *  ThreadSafepoint returns the safepoint that a cooperative thread
+ *  polls.  ThreadPark parks the current thread at its safepoint if it
+ *  has been asked to stop, and returns when it may continue.
+ *
+ *  ThreadNative calls a function that doesn't use the heap.  A
+ *  cooperative thread doesn't need to be stopped while it is running
+ *  that function.
+ *
+ *  ThreadLockClaim and ThreadLockClaimGlobal claim the arena lock and
+ *  the global lock.  A cooperative thread doesn't need to be stopped
+ *  while it waits for either lock.
+ */
+
+extern mps_safepoint_t ThreadSafepoint(Thread thread);
+extern void ThreadPark(mps_safepoint_t safepoint);
+extern void *ThreadNative(Thread thread, mps_native_fn_t fn, void *p);
+extern void ThreadLockClaim(Arena arena, Lock lock);
+extern void ThreadLockClaimGlobal(void);
+
+
 #endif /* th_h */
 
 
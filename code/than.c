@@ -18,6 +18,7 @@ typedef struct mps_thr_s {      /* ANSI fake thread structure */
   Serial serial;                /* from arena->threadSerial */
   Arena arena;                  /* owning arena */
   RingStruct arenaRing;         /* attaches to arena */
+  mps_safepoint_s safepointStruct; /* never stopped, .coop.other */
 } ThreadStruct;
 
 
@@ -38,7 +39,7 @@ Bool ThreadCheckSimple(Thread thread)
 }
 
 
-Res ThreadRegister(Thread *threadReturn, Arena arena)
+Res ThreadRegister(Thread *threadReturn, Arena arena, Bool cooperative)
 {
   Res res;
   Thread thread;
@@ -46,6 +47,8 @@ Res ThreadRegister(Thread *threadReturn, Arena arena)
   void *p;
 
   AVER(threadReturn != NULL);
+  AVERT(Bool, cooperative);
+  UNUSED(cooperative); /* <design/thread-manager#.coop.other> */
 
   res = ControlAlloc(&p, arena, sizeof(ThreadStruct));
   if (res != ResOK)
@@ -54,6 +57,7 @@ Res ThreadRegister(Thread *threadReturn, Arena arena)
 
   thread->arena = arena;
   RingInit(&thread->arenaRing);
+  thread->safepointStruct._stop = 0;
 
   thread->sig = ThreadSig;
   thread->serial = arena->threadSerial;
@@ -116,6 +120,43 @@ Arena ThreadArena(Thread thread)
 }
 
 
+/* There is only one thread on this platform, so it is never asked
+ * to stop at its safepoint.  <design/thread-manager#.coop.other>.
+ */
+
+mps_safepoint_t ThreadSafepoint(Thread thread)
+{
+  AVER(TESTT(Thread, thread));
+  return &thread->safepointStruct;
+}
+
+void ThreadPark(mps_safepoint_t safepoint)
+{
+  AVER(safepoint != NULL);
+  AVER(safepoint->_stop == 0);
+  UNUSED(safepoint);
+}
+
+void *ThreadNative(Thread thread, mps_native_fn_t fn, void *p)
+{
+  AVER(ThreadCheckSimple(thread));
+  AVER(FUNCHECK(fn));
+  UNUSED(thread);
+  return (*fn)(p);
+}
+
+void ThreadLockClaim(Arena arena, Lock lock)
+{
+  UNUSED(arena);
+  LockClaim(lock);
+}
+
+void ThreadLockClaimGlobal(void)
+{
+  LockClaimGlobal();
+}
+
+
 Res ThreadScan(ScanState ss, Thread thread, void *stackCold,
                mps_area_scan_t scan_area,
                void *closure)
@@ -41,11 +41,25 @@
 #include "prmcix.h"
 #include "pthrdext.h"
 
+#include <errno.h> /* ETIMEDOUT */
 #include <pthread.h>
+#include <time.h> /* clock_gettime, CLOCK_REALTIME */
 
 SRCID(thix, "$Id$");
 
 
+/* .coop.state: States of a cooperative thread
+ * <design/thread-manager#.coop.state>.
+ */
+
+enum {
+  ThreadStateRUNNING,           /* may be using the heap */
+  ThreadStatePARKED,            /* stopped at its safepoint */
+  ThreadStateNATIVE,            /* not using the heap */
+  ThreadStateLIMIT
+};
+
+
 /* ThreadStruct -- thread descriptor */
 
 typedef struct mps_thr_s {       /* PThreads thread structure */
@@ -57,9 +71,102 @@ typedef struct mps_thr_s {       /* PThreads thread structure */
   PThreadextStruct thrextStruct; /* PThreads extension */
   pthread_t id;                  /* Pthread object of thread */
   MutatorContext context;        /* Context if suspended, NULL if not */
+  Bool cooperative;              /* stops at its safepoint? */
+  unsigned state;                /* see .coop.state */
+  Bool stopped;                  /* stopped by ThreadRingSuspend? */
+  mps_safepoint_s safepointStruct; /* polled by the thread, .coop.poll */
+  StackContextStruct stackContext; /* registers, unless running */
+  void *stackWarm;               /* hot end of stack, unless running */
 } ThreadStruct;
 
 
+/* .coop.lock: The states of cooperative threads are protected by
+ * threadCoopMut, and threadCoopCond is broadcast when one changes.
+ * The thread manager claims threadCoopMut before suspending or
+ * resuming threads, so no thread that it signals holds it.
+ * threadCoopKey maps the current thread to its cooperative
+ * registration, if any.  It's created when the first cooperative
+ * thread registers, and threadCoopCount counts the registrations, so
+ * that claiming a lock needn't look at the key until there are any.
+ * A thread only reads a non-zero count that matters to it after
+ * registering itself, so the count is read without threadCoopMut.
+ * <design/thread-manager#.coop.lock>.
+ */
+
+static pthread_mutex_t threadCoopMut = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t threadCoopCond = PTHREAD_COND_INITIALIZER;
+static pthread_key_t threadCoopKey;
+static pthread_once_t threadCoopKeyOnce = PTHREAD_ONCE_INIT;
+static Count threadCoopCount = 0;
+
+static void threadCoopKeyCreate(void)
+{
+  int status = pthread_key_create(&threadCoopKey, NULL);
+  AVER(status == 0);
+  UNUSED(status);
+}
+
+static void threadCoopKeyInit(void)
+{
+  int status = pthread_once(&threadCoopKeyOnce, threadCoopKeyCreate);
+  AVER(status == 0);
+  UNUSED(status);
+}
+
+static void threadCoopLock(void)
+{
+  int status = pthread_mutex_lock(&threadCoopMut);
+  AVER(status == 0);
+  UNUSED(status);
+}
+
+static void threadCoopUnlock(void)
+{
+  int status = pthread_mutex_unlock(&threadCoopMut);
+  AVER(status == 0);
+  UNUSED(status);
+}
+
+static void threadCoopBroadcast(void)
+{
+  int status = pthread_cond_broadcast(&threadCoopCond);
+  AVER(status == 0);
+  UNUSED(status);
+}
+
+
+/* THREAD_COOP_SAVE -- save the registers and hot end of the stack
+ *
+ * This must be expanded in a frame that stays live until the thread
+ * is running again, so that the registers of its callers are either
+ * in the saved context or in that frame.
+ */
+
+#define THREAD_COOP_SAVE(thread) \
+  BEGIN \
+    STACK_CONTEXT_SAVE(&(thread)->stackContext); \
+    StackHot(&(thread)->stackWarm); \
+  END
+
+
+/* threadContinue -- wait until a cooperative thread may run
+ *
+ * Must be called by the thread itself, with threadCoopMut held.
+ */
+
+static void threadContinue(Thread thread)
+{
+  AVER(thread->state != ThreadStateRUNNING);
+  while (thread->safepointStruct._stop) {
+    int status = pthread_cond_wait(&threadCoopCond, &threadCoopMut);
+    AVER(status == 0);
+    UNUSED(status);
+  }
+  thread->state = ThreadStateRUNNING;
+  thread->stackWarm = NULL;
+}
+
+
 /* ThreadCheck -- check a thread */
 
 Bool ThreadCheck(Thread thread)
@@ -70,6 +177,11 @@ Bool ThreadCheck(Thread thread)
   CHECKD_NOSIG(Ring, &thread->arenaRing);
   CHECKL(BoolCheck(thread->alive));
   CHECKD(PThreadext, &thread->thrextStruct);
+  CHECKL(BoolCheck(thread->cooperative));
+  CHECKL(thread->state < ThreadStateLIMIT);
+  CHECKL(BoolCheck(thread->stopped));
+  CHECKL(!thread->stopped || thread->cooperative);
+  CHECKL(!thread->stopped || thread->context == NULL);
   return TRUE;
 }
 
@@ -82,7 +194,7 @@ Bool ThreadCheckSimple(Thread thread)
 
 /* ThreadRegister -- register a thread with an arena */
 
-Res ThreadRegister(Thread *threadReturn, Arena arena)
+Res ThreadRegister(Thread *threadReturn, Arena arena, Bool cooperative)
 {
   Res res;
   Thread thread;
@@ -90,12 +202,26 @@ Res ThreadRegister(Thread *threadReturn, Arena arena)
 
   AVER(threadReturn != NULL);
   AVERT(Arena, arena);
+  AVERT(Bool, cooperative);
 
   res = ControlAlloc(&p, arena, sizeof(ThreadStruct));
   if(res != ResOK)
     return res;
   thread = (Thread)p;
 
+  if (cooperative) {
+    int status;
+    threadCoopKeyInit();
+    status = pthread_setspecific(threadCoopKey, thread);
+    if (status != 0) {
+      ControlFree(arena, p, sizeof(ThreadStruct));
+      return ResMEMORY;
+    }
+    threadCoopLock();
+    ++threadCoopCount;
+    threadCoopUnlock();
+  }
+
   thread->id = pthread_self();
 
   RingInit(&thread->arenaRing);
@@ -106,6 +232,11 @@ Res ThreadRegister(Thread *threadReturn, Arena arena)
   thread->arena = arena;
   thread->alive = TRUE;
   thread->context = NULL;
+  thread->cooperative = cooperative;
+  thread->state = ThreadStateRUNNING;
+  thread->stopped = FALSE;
+  thread->safepointStruct._stop = 0;
+  thread->stackWarm = NULL;
 
   PThreadextInit(&thread->thrextStruct, thread->id);
 
@@ -118,13 +249,31 @@ Res ThreadRegister(Thread *threadReturn, Arena arena)
 }
 
 
-/* ThreadDeregister -- deregister a thread from an arena */
+/* ThreadDeregister -- deregister a thread from an arena
+ *
+ * A cooperative thread must deregister itself, so that its
+ * registration can be removed from threadCoopKey.
+ */
 
 void ThreadDeregister(Thread thread, Arena arena)
 {
   AVERT(Thread, thread);
   AVERT(Arena, arena);
 
+  if (thread->cooperative) {
+    AVER(pthread_equal(pthread_self(), thread->id)); /* .thread.id */
+    AVER(thread->state == ThreadStateRUNNING);
+    if (pthread_getspecific(threadCoopKey) == thread) {
+      int status = pthread_setspecific(threadCoopKey, NULL);
+      AVER(status == 0);
+      UNUSED(status);
+    }
+    threadCoopLock();
+    AVER(threadCoopCount > 0);
+    --threadCoopCount;
+    threadCoopUnlock();
+  }
+
   RingRemove(&thread->arenaRing);
 
   thread->sig = SigInvalid;
@@ -145,7 +294,8 @@ void ThreadDeregister(Thread thread, Arena arena)
  * design.thread-manager.sol.thread.term.attempt.
  */
 
-static void mapThreadRing(Ring threadRing, Ring deadRing, Bool (*func)(Thread))
+static void mapThreadRing(Ring threadRing, Ring deadRing,
+                          Bool (*func)(Thread, void *), void *closure)
 {
   Ring node, next;
 
@@ -157,7 +307,7 @@ static void mapThreadRing(Ring threadRing, Ring deadRing, Bool (*func)(Thread))
     Thread thread = RING_ELT(Thread, arenaRing, node);
     AVERT(Thread, thread);
     AVER(thread->alive);
-    if (!(*func)(thread)) {
+    if (!(*func)(thread, closure)) {
       thread->alive = FALSE;
       RingRemove(&thread->arenaRing);
       RingAppend(deadRing, &thread->arenaRing);
@@ -166,60 +316,175 @@ static void mapThreadRing(Ring threadRing, Ring deadRing, Bool (*func)(Thread))
 }
 
 
+/* ThreadBatchStruct -- threads being suspended or resumed together
+ *
+ * .batch: Threads are suspended and resumed in a batch, so that
+ * PThreadextSuspend can signal them all before waiting for any of
+ * them.  See <design/pthreadext#.impl.suspend.not-suspended>.
+ *
+ * .batch.empty: An empty batch isn't passed on, because the
+ * pthreadext module isn't initialized until the first thread is
+ * registered <design/pthreadext#.impl.static.init>.
+ */
+
+typedef struct ThreadBatchStruct {
+  RingStruct ring;               /* pthreadexts to signal */
+  struct timespec deadline;      /* for reaching safepoints */
+} ThreadBatchStruct, *ThreadBatch;
+
+static void threadBatchInit(ThreadBatch batch)
+{
+  int status;
+  RingInit(&batch->ring);
+  /* .coop.timeout: cooperative threads that haven't stopped by the
+     deadline are suspended with a signal instead. */
+  status = clock_gettime(CLOCK_REALTIME, &batch->deadline);
+  AVER(status == 0);
+  UNUSED(status);
+  batch->deadline.tv_nsec += ThreadSafepointTIMEOUT * 1000;
+  if (batch->deadline.tv_nsec >= 1000000000) {
+    batch->deadline.tv_nsec -= 1000000000;
+    ++batch->deadline.tv_sec;
+  }
+}
+
+static void threadBatchFinish(ThreadBatch batch)
+{
+  RingFinish(&batch->ring);
+}
+
+
 /* ThreadRingSuspend -- suspend all threads on a ring, except the
  * current one.
+ *
+ * Cooperative threads are asked to stop at their safepoints while the
+ * other threads are suspended with signals, then waited for.
  */
 
-static Bool threadSuspend(Thread thread)
+static Bool threadStop(Thread thread, void *p)
 {
-  Res res;
+  ThreadBatch batch = p;
   pthread_t self;
   self = pthread_self();
   if (pthread_equal(self, thread->id)) /* .thread.id */
     return TRUE;
 
-  /* .error.suspend: if PThreadextSuspend fails, we assume the thread
-   * has been terminated. */
-  AVER(thread->context == NULL);
-  res = PThreadextSuspend(&thread->thrextStruct, &thread->context);
-  AVER(res == ResOK);
-  AVER(thread->context != NULL);
-  /* design.thread-manager.sol.thread.term.attempt */
-  return res == ResOK;
+  if (thread->cooperative)
+    thread->safepointStruct._stop = 1; /* .coop.poll */
+  else
+    RingAppend(&batch->ring, &thread->thrextStruct.batchRing);
+  return TRUE;
+}
+
+static Bool threadParked(Thread thread, ThreadBatch batch)
+{
+  while (thread->state == ThreadStateRUNNING) {
+    int status = pthread_cond_timedwait(&threadCoopCond, &threadCoopMut,
+                                        &batch->deadline);
+    if (status == ETIMEDOUT)
+      return thread->state != ThreadStateRUNNING;
+    AVER(status == 0);
+  }
+  return TRUE;
 }
 
+static Bool threadSuspended(Thread thread, void *p)
+{
+  ThreadBatch batch = p;
+  pthread_t self;
+  self = pthread_self();
+  if (pthread_equal(self, thread->id)) /* .thread.id */
+    return TRUE;
+
+  if (thread->stopped || thread->context != NULL)
+    return TRUE; /* stopped by an earlier round, see .coop.timeout */
 
+  if (RingIsSingle(&thread->thrextStruct.batchRing)) {
+    AVER(thread->cooperative);
+    if (threadParked(thread, batch))
+      thread->stopped = TRUE;
+    else /* .coop.timeout */
+      RingAppend(&batch->ring, &thread->thrextStruct.batchRing);
+    return TRUE;
+  }
+
+  RingRemove(&thread->thrextStruct.batchRing);
+  /* .error.suspend: if PThreadextSuspend failed to suspend the
+   * thread, we assume the thread has been terminated. */
+  thread->context = PThreadextContext(&thread->thrextStruct);
+  /* design.thread-manager.sol.thread.term.attempt */
+  return thread->context != NULL;
+}
 
 void ThreadRingSuspend(Ring threadRing, Ring deadRing)
 {
-  mapThreadRing(threadRing, deadRing, threadSuspend);
+  ThreadBatchStruct batchStruct;
+  threadCoopLock();
+  threadBatchInit(&batchStruct);
+  mapThreadRing(threadRing, deadRing, threadStop, &batchStruct);
+  if (!RingIsSingle(&batchStruct.ring)) /* .batch.empty */
+    PThreadextSuspend(&batchStruct.ring);
+  mapThreadRing(threadRing, deadRing, threadSuspended, &batchStruct);
+  if (!RingIsSingle(&batchStruct.ring)) { /* .coop.timeout */
+    PThreadextSuspend(&batchStruct.ring);
+    mapThreadRing(threadRing, deadRing, threadSuspended, &batchStruct);
+  }
+  threadBatchFinish(&batchStruct);
+  threadCoopUnlock();
 }
 
 
 /* ThreadRingResume -- resume all threads on a ring (expect the current one) */
 
+static Bool threadSignalled(Thread thread, void *p)
+{
+  ThreadBatch batch = p;
+  pthread_t self;
+  self = pthread_self();
+  if (pthread_equal(self, thread->id)) /* .thread.id */
+    return TRUE;
 
-static Bool threadResume(Thread thread)
+  if (thread->context != NULL)
+    RingAppend(&batch->ring, &thread->thrextStruct.batchRing);
+  return TRUE;
+}
+
+static Bool threadResumed(Thread thread, void *p)
 {
-  Res res;
   pthread_t self;
+  UNUSED(p);
   self = pthread_self();
   if (pthread_equal(self, thread->id)) /* .thread.id */
     return TRUE;
 
-  /* .error.resume: If PThreadextResume fails, we assume the thread
-   * has been terminated. */
+  thread->safepointStruct._stop = 0;
+  if (thread->stopped) {
+    thread->stopped = FALSE;
+    return TRUE;
+  }
+
+  RingRemove(&thread->thrextStruct.batchRing);
+  /* .error.resume: If PThreadextResume failed to resume the thread,
+   * we assume the thread has been terminated. */
   AVER(thread->context != NULL);
-  res = PThreadextResume(&thread->thrextStruct);
-  AVER(res == ResOK);
+  AVER(PThreadextContext(&thread->thrextStruct) == NULL);
   thread->context = NULL;
   /* design.thread-manager.sol.thread.term.attempt */
-  return res == ResOK;
+  return PThreadextContext(&thread->thrextStruct) == NULL;
 }
 
 void ThreadRingResume(Ring threadRing, Ring deadRing)
 {
-  mapThreadRing(threadRing, deadRing, threadResume);
+  ThreadBatchStruct batchStruct;
+  threadCoopLock();
+  threadBatchInit(&batchStruct);
+  mapThreadRing(threadRing, deadRing, threadSignalled, &batchStruct);
+  if (!RingIsSingle(&batchStruct.ring)) /* .batch.empty */
+    PThreadextResume(&batchStruct.ring);
+  mapThreadRing(threadRing, deadRing, threadResumed, &batchStruct);
+  threadBatchFinish(&batchStruct);
+  threadCoopBroadcast();
+  threadCoopUnlock();
 }
 
 
@@ -247,6 +512,142 @@ Arena ThreadArena(Thread thread)
 }
 
 
+/* ThreadSafepoint -- return the safepoint of a thread
+ *
+ * Must be thread-safe. <design/interface-c#.check.testt>.
+ */
+
+mps_safepoint_t ThreadSafepoint(Thread thread)
+{
+  AVER(TESTT(Thread, thread));
+  return &thread->safepointStruct;
+}
+
+
+/* ThreadPark -- park the current thread at its safepoint
+ *
+ * .coop.poll: A cooperative thread polls its safepoint with the
+ * mps_safepoint macro, which calls this if the thread manager has
+ * asked it to stop.  The thread saves its registers and the hot end
+ * of its stack, and waits here until it is resumed, so it can be
+ * scanned like the current thread.  <design/thread-manager#.coop.poll>.
+ */
+
+void ThreadPark(mps_safepoint_t safepoint)
+{
+  Thread thread;
+
+  AVER(safepoint != NULL);
+  thread = PARENT(ThreadStruct, safepointStruct, safepoint);
+  AVER(ThreadCheckSimple(thread));
+  AVER(thread->cooperative);
+  AVER(pthread_equal(pthread_self(), thread->id)); /* .thread.id */
+
+  threadCoopLock();
+  if (thread->safepointStruct._stop) {
+    AVER(thread->state == ThreadStateRUNNING);
+    THREAD_COOP_SAVE(thread);
+    thread->state = ThreadStatePARKED;
+    threadCoopBroadcast();
+    threadContinue(thread);
+  }
+  threadCoopUnlock();
+}
+
+
+/* ThreadNative -- call a function that doesn't use the heap
+ *
+ * .coop.native: A cooperative thread need not be stopped while it is
+ * in the function, because it has saved its registers and the hot
+ * end of its stack.  If it has been asked to stop when the function
+ * returns, it waits here until it is resumed.
+ * <design/thread-manager#.coop.native>.
+ */
+
+void *ThreadNative(Thread thread, mps_native_fn_t fn, void *p)
+{
+  void *result;
+
+  AVER(ThreadCheckSimple(thread));
+  AVER(FUNCHECK(fn));
+  AVER(pthread_equal(pthread_self(), thread->id)); /* .thread.id */
+
+  if (!thread->cooperative)
+    return (*fn)(p);
+
+  threadCoopLock();
+  AVER(thread->state == ThreadStateRUNNING);
+  THREAD_COOP_SAVE(thread);
+  thread->state = ThreadStateNATIVE;
+  threadCoopBroadcast();
+  threadCoopUnlock();
+
+  result = (*fn)(p);
+
+  threadCoopLock();
+  threadContinue(thread);
+  threadCoopUnlock();
+  return result;
+}
+
+
+/* ThreadLockClaim, ThreadLockClaimGlobal -- claim the arena or global lock
+ *
+ * .coop.lock.claim: A cooperative thread is native while it waits for
+ * a lock, so that it need not be stopped by a thread that holds the
+ * lock.  It waits until it is resumed before continuing.
+ * <design/thread-manager#.coop.lock>.
+ */
+
+static void threadLockClaim(Thread thread, Lock lock)
+{
+  threadCoopLock();
+  AVER(thread->state == ThreadStateRUNNING);
+  THREAD_COOP_SAVE(thread);
+  thread->state = ThreadStateNATIVE;
+  threadCoopBroadcast();
+  threadCoopUnlock();
+
+  if (lock == NULL)
+    LockClaimGlobal();
+  else
+    LockClaim(lock);
+
+  threadCoopLock();
+  threadContinue(thread);
+  threadCoopUnlock();
+}
+
+void ThreadLockClaim(Arena arena, Lock lock)
+{
+  Thread thread;
+  AVER(lock != NULL);
+  if (threadCoopCount == 0) {
+    LockClaim(lock);
+    return;
+  }
+  thread = pthread_getspecific(threadCoopKey);
+  if (thread == NULL || thread->arena != arena)
+    LockClaim(lock);
+  else
+    threadLockClaim(thread, lock);
+}
+
+void ThreadLockClaimGlobal(void)
+{
+  Thread thread;
+  if (threadCoopCount == 0) {
+    LockClaimGlobal();
+    return;
+  }
+  thread = pthread_getspecific(threadCoopKey);
+  if (thread == NULL)
+    LockClaimGlobal();
+  else
+    threadLockClaim(thread, NULL);
+}
+
+
 /* ThreadScan -- scan the state of a thread (stack and regs) */
 
 Res ThreadScan(ScanState ss, Thread thread, void *stackCold,
@@ -264,6 +665,24 @@ Res ThreadScan(ScanState ss, Thread thread, void *stackCold,
     res = StackScan(ss, stackCold, scan_area, closure);
     if(res != ResOK)
       return res;
+  } else if (thread->alive && thread->stopped) {
+    /* .coop.scan: scan the registers and stack saved by the thread */
+    /* The saved context is scanned as an area of memory, as the */
+    /* registers spilled onto the stack are by StackScan. */
+    void *contextBase = &thread->stackContext;
+    void *contextLimit = PointerAdd(contextBase, sizeof thread->stackContext);
+
+    AVER(thread->stackWarm != NULL);
+    if (thread->stackWarm < stackCold) { /* .stack.below-bottom */
+      res = TraceScanArea(ss, thread->stackWarm, stackCold,
+                          scan_area, closure);
+      if(res != ResOK)
+        return res;
+    }
+
+    res = TraceScanArea(ss, contextBase, contextLimit, scan_area, closure);
+    if(res != ResOK)
+      return res;
   } else if (thread->alive) {
     MutatorContext context;
     Word *stackBase, *stackLimit;
@@ -309,6 +728,9 @@ Res ThreadDescribe(Thread thread, mps_lib_FILE *stream, Count depth)
                (WriteFP)thread->arena, (WriteFU)thread->arena->serial,
                "  alive $S\n", WriteFYesNo(thread->alive),
                "  id $U\n",          (WriteFU)thread->id,
+               "  cooperative $S\n", WriteFYesNo(thread->cooperative),
+               "  state $U\n",       (WriteFU)thread->state,
+               "  stopped $S\n",     WriteFYesNo(thread->stopped),
                "} Thread $P ($U)\n", (WriteFP)thread, (WriteFU)thread->serial,
                NULL);
   if(res != ResOK)
@@ -322,26 +744,39 @@ Res ThreadDescribe(Thread thread, mps_lib_FILE *stream, Count depth)
  * current thread to the dead ring <design/thread-safety#.sol.fork.thread>.
  */
 
-static Bool threadForkChild(Thread thread)
+static Bool threadForkChild(Thread thread, void *p)
 {
   AVERT(Thread, thread);
+  UNUSED(p);
   return pthread_equal(pthread_self(), thread->id); /* .thread.id */
 }
 
 static void threadRingForkChild(Arena arena)
 {
   AVERT(Arena, arena);
-  mapThreadRing(ArenaThreadRing(arena), ArenaDeadRing(arena), threadForkChild);
+  mapThreadRing(ArenaThreadRing(arena), ArenaDeadRing(arena),
+                threadForkChild, NULL);
+}
+
+static void threadAtForkPrepare(void)
+{
+  threadCoopLock();
+}
+
+static void threadAtForkParent(void)
+{
+  threadCoopUnlock();
 }
 
 static void threadAtForkChild(void)
 {
+  threadCoopUnlock();
   GlobalsArenaMap(threadRingForkChild);
 }
 
 void ThreadSetup(void)
 {
-  pthread_atfork(NULL, NULL, threadAtForkChild);
+  pthread_atfork(threadAtForkPrepare, threadAtForkParent, threadAtForkChild);
 }
 
 
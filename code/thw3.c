@@ -73,6 +73,7 @@ typedef struct mps_thr_s {      /* Win32 thread structure */
   HANDLE handle;                /* Handle of thread, see
                                  * <code/thw3.c#thread.handle> */
   DWORD id;                     /* Thread id of thread */
+  mps_safepoint_s safepointStruct; /* never stopped, .coop.other */
 } ThreadStruct;
 
 
@@ -93,7 +94,7 @@ Bool ThreadCheckSimple(Thread thread)
 }
 
 
-Res ThreadRegister(Thread *threadReturn, Arena arena)
+Res ThreadRegister(Thread *threadReturn, Arena arena, Bool cooperative)
 {
   Res res;
   Thread thread;
@@ -103,6 +104,8 @@ Res ThreadRegister(Thread *threadReturn, Arena arena)
 
   AVER(threadReturn != NULL);
   AVERT(Arena, arena);
+  AVERT(Bool, cooperative);
+  UNUSED(cooperative); /* <design/thread-manager#.coop.other> */
 
   res = ControlAlloc(&p, arena, sizeof(ThreadStruct));
   if(res != ResOK)
@@ -124,6 +127,7 @@ Res ThreadRegister(Thread *threadReturn, Arena arena)
   thread->id = GetCurrentThreadId();
 
   RingInit(&thread->arenaRing);
+  thread->safepointStruct._stop = 0;
 
   thread->sig = ThreadSig;
   thread->serial = arena->threadSerial;
@@ -239,6 +243,44 @@ Arena ThreadArena(Thread thread)
   return thread->arena;
 }
 
+
+/* Cooperative threads are suspended like other threads on this
+ * platform, so they are never asked to stop at their safepoints.
+ * <design/thread-manager#.coop.other>.
+ */
+
+mps_safepoint_t ThreadSafepoint(Thread thread)
+{
+  AVER(TESTT(Thread, thread));
+  return &thread->safepointStruct;
+}
+
+void ThreadPark(mps_safepoint_t safepoint)
+{
+  AVER(safepoint != NULL);
+  AVER(safepoint->_stop == 0);
+  UNUSED(safepoint);
+}
+
+void *ThreadNative(Thread thread, mps_native_fn_t fn, void *p)
+{
+  AVER(ThreadCheckSimple(thread));
+  AVER(FUNCHECK(fn));
+  UNUSED(thread);
+  return (*fn)(p);
+}
+
+void ThreadLockClaim(Arena arena, Lock lock)
+{
+  UNUSED(arena);
+  LockClaim(lock);
+}
+
+void ThreadLockClaimGlobal(void)
+{
+  LockClaimGlobal();
+}
+
 Res ThreadDescribe(Thread thread, mps_lib_FILE *stream, Count depth)
 {
   Res res;
@@ -45,6 +45,7 @@ typedef struct mps_thr_s {      /* macOS thread structure */
   Bool alive;                   /* thread believed to be alive? */
   Bool forking;                 /* thread currently calling fork? */
   thread_port_t port;           /* thread kernel port */
+  mps_safepoint_s safepointStruct; /* never stopped, .coop.other */
 } ThreadStruct;
 
 
@@ -68,7 +69,7 @@ Bool ThreadCheckSimple(Thread thread)
 }
 
 
-Res ThreadRegister(Thread *threadReturn, Arena arena)
+Res ThreadRegister(Thread *threadReturn, Arena arena, Bool cooperative)
 {
   Res res;
   Thread thread;
@@ -76,6 +77,8 @@ Res ThreadRegister(Thread *threadReturn, Arena arena)
   void *p;
 
   AVER(threadReturn != NULL);
+  AVERT(Bool, cooperative);
+  UNUSED(cooperative); /* <design/thread-manager#.coop.other> */
 
   res = ControlAlloc(&p, arena, sizeof(ThreadStruct));
   if (res != ResOK)
@@ -84,6 +87,7 @@ Res ThreadRegister(Thread *threadReturn, Arena arena)
 
   thread->arena = arena;
   RingInit(&thread->arenaRing);
+  thread->safepointStruct._stop = 0;
 
   thread->serial = arena->threadSerial;
   ++arena->threadSerial;
@@ -223,6 +227,44 @@ Arena ThreadArena(Thread thread)
 }
 
 
+/* Cooperative threads are suspended like other threads on this
+ * platform, so they are never asked to stop at their safepoints.
+ * <design/thread-manager#.coop.other>.
+ */
+
+mps_safepoint_t ThreadSafepoint(Thread thread)
+{
+  AVER(TESTT(Thread, thread));
+  return &thread->safepointStruct;
+}
+
+void ThreadPark(mps_safepoint_t safepoint)
+{
+  AVER(safepoint != NULL);
+  AVER(safepoint->_stop == 0);
+  UNUSED(safepoint);
+}
+
+void *ThreadNative(Thread thread, mps_native_fn_t fn, void *p)
+{
+  AVER(ThreadCheckSimple(thread));
+  AVER(FUNCHECK(fn));
+  UNUSED(thread);
+  return (*fn)(p);
+}
+
+void ThreadLockClaim(Arena arena, Lock lock)
+{
+  UNUSED(arena);
+  LockClaim(lock);
+}
+
+void ThreadLockClaimGlobal(void)
+{
+  LockClaimGlobal();
+}
+
+
 /* ThreadScan -- scan the state of a thread (stack and regs) */
 
 #include "prmcxc.h"
@@ -19,6 +19,7 @@ Rank traceBand(Trace);
 Bool traceBandAdvance(Trace);
 Bool traceBandFirstStretch(Trace);
 void traceBandFirstStretchDone(Trace);
+static void traceWorkReport(TraceWork tw, Trace trace);
 
 /* Types */
 
@@ -55,6 +56,12 @@ Bool ScanStateCheck(ScanState ss)
   CHECKL(TraceSetSuper(ss->arena->busyTraces, ss->traces));
   CHECKL(RankCheck(ss->rank));
   CHECKL(BoolCheck(ss->wasMarked));
+  CHECKL(ss->fixLock == NULL || LockCheck(ss->fixLock));
+  CHECKL(ss->worker < ss->arena->traceWorkers);
+  CHECKL(ss->fixLock != NULL || ss->worker == 0);
+  CHECKL(ss->segCacheNext < ScanStateSegCacheSIZE);
+  CHECKL(ss->snapCache == NULL || TraceSetIsSingle(ss->traces));
+  CHECKL(ss->cardSeg == NULL || ss->cardNext <= ss->cardCount);
   /* @@@@ checks for counts missing */
   return TRUE;
 }
@@ -76,6 +83,7 @@ void ScanStateInit(ScanState ss, TraceSet ts, Arena arena,
 {
   TraceId ti;
   Trace trace;
+  Index i;
 
   AVERT(TraceSet, ts);
   AVERT(Arena, arena);
@@ -117,12 +125,37 @@ void ScanStateInit(ScanState ss, TraceSet ts, Arena arena,
   STATISTIC(ss->fixRefCount = (Count)0);
   STATISTIC(ss->segRefCount = (Count)0);
   STATISTIC(ss->whiteSegRefCount = (Count)0);
+  STATISTIC(ss->segCacheHitCount = (Count)0);
   STATISTIC(ss->nailCount = (Count)0);
   STATISTIC(ss->snapCount = (Count)0);
+  STATISTIC(ss->snapCacheHitCount = (Count)0);
   STATISTIC(ss->forwardedCount = (Count)0);
   STATISTIC(ss->preservedInPlaceCount = (Count)0);
   STATISTIC(ss->copiedSize = (Size)0);
+  STATISTIC(ss->ambigWordCount = (Count)0);
+  STATISTIC(ss->ambigRangeCount = (Count)0);
+  STATISTIC(ss->ambigZoneCount = (Count)0);
   ss->scannedSize = (Size)0; /* see .work */
+  ss->cardSeg = NULL;
+  STATISTIC(ss->cardSkipCount = (Count)0);
+  STATISTIC(ss->cardSkipSize = (Size)0);
+  ss->fixLock = NULL;
+  ss->worker = 0;
+  ss->segCacheSerial = arena->segCacheSerial;
+  ss->segCacheNext = 0;
+  for (i = 0; i < ScanStateSegCacheSIZE; ++i) {
+    ss->segCache[i].base = ss->segCache[i].limit = (Addr)0;
+    ss->segCache[i].seg = NULL;
+    ss->segCache[i].white = FALSE;
+  }
+  /* The snap-out cache belongs to a single trace.  See
+     <design/trace#.fix.snap>. */
+  ss->snapCache = NULL;
+  if (TraceSetIsSingle(ts)) {
+    TRACE_SET_ITER(ti, trace, ts, arena)
+      ss->snapCache = trace->snapCache;
+    TRACE_SET_ITER_END(ti, trace, ts, arena);
+  }
   ss->sig = ScanStateSig;
 
   AVERT(ScanState, ss);
@@ -135,12 +168,15 @@ void ScanStateInitSeg(ScanState ss, TraceSet ts, Arena arena,
                       Rank rank, ZoneSet white, Seg seg)
 {
   Format format;
+  Size headerSize = 0;
   AVERT(Seg, seg);
 
   ScanStateInit(ss, ts, arena, rank, white);
   if (PoolFormat(&format, SegPool(seg))) {
     ss->formatScan = format->scan;
+    headerSize = format->headerSize;
   }
+  ScanStateCardsInit(ss, seg, headerSize);
 }
 
 
@@ -184,6 +220,7 @@ Bool TraceCheck(Trace trace)
   CHECKL(TraceSetIsMember(trace->arena->busyTraces, trace));
   CHECKL(ZoneSetSub(trace->mayMove, trace->white));
   CHECKD_NOSIG(Ring, &trace->genRing);
+  CHECKD_NOSIG(Ring, &trace->reclaimCursor);
   /* Use trace->state to check more invariants. */
   switch(trace->state) {
     case TraceINIT:
@@ -206,12 +243,14 @@ Bool TraceCheck(Trace trace)
 
     case TraceRECLAIM:
       CHECKL(!RingIsSingle(&trace->genRing));
+      CHECKL(trace->reclaimGen != NULL || RingIsSingle(&trace->reclaimCursor));
       CHECKL(TraceSetIsMember(trace->arena->flippedTraces, trace));
       /* @@@@ Assert that grey set is empty for trace. */
       break;
 
     case TraceFINISHED:
       CHECKL(TraceSetIsMember(trace->arena->flippedTraces, trace));
+      CHECKL(RingIsSingle(&trace->reclaimCursor));
       /* @@@@ Assert that grey and white sets is empty for trace. */
       break;
 
@@ -224,12 +263,168 @@ Bool TraceCheck(Trace trace)
 
   /* @@@@ checks for counts missing */
 
+  CHECKL(trace->greyOrder < GreyOrderLIMIT);
+  /* Can't cheaply check the grey queues.  See GCSegCheck. */
+
   /* check pre-allocated messages for this traceid */
   CHECKL(TraceIdMessagesCheck(trace->arena, trace->ti));
 
   return TRUE;
 }
 
+
+/* Grey queues
+ *
+ * Each trace keeps a queue of the segments that are grey for it at
+ * each rank, so that traceFindGrey can find work without searching.
+ * The queues are maintained by gcSegSetGreyInternal in <code/seg.c>
+ * via TraceGreyInsert and TraceGreyRemove.  In LIFO order each queue
+ * is a ring and segments are pushed onto the front; in address order
+ * each queue is a splay tree keyed on segment base.
+ * <design/trace#.grey.queue>
+ */
+
+static Compare greyLinkCompare(Tree tree, TreeKey key)
+{
+  GreyLink link = GreyLinkOfTree(tree);
+  Addr base = SegBase(link->seg);
+  Addr addr = AddrOfTreeKey(key);
+
+  if (addr < base)
+    return CompareLESS;
+  else if (addr > base)
+    return CompareGREATER;
+  else
+    return CompareEQUAL;
+}
+
+static TreeKey greyLinkKey(Tree tree)
+{
+  GreyLink link = GreyLinkOfTree(tree);
+  Addr base = SegBase(link->seg);
+  return TreeKeyOfAddrVar(base);
+}
+
+static void traceGreyInit(Trace trace)
+{
+  Rank rank;
+  for (rank = RankMIN; rank < RankLIMIT; ++rank) {
+    RingInit(&trace->greyRing[rank]);
+    SplayTreeInit(&trace->greyTree[rank], greyLinkCompare, greyLinkKey,
+                  SplayTrivUpdate);
+  }
+}
+
+static void traceGreyFinish(Trace trace)
+{
+  Rank rank;
+  for (rank = RankMIN; rank < RankLIMIT; ++rank) {
+    RingFinish(&trace->greyRing[rank]);
+    SplayTreeFinish(&trace->greyTree[rank]);
+  }
+}
+
+
+/* TraceGreyInsert -- add a segment to a trace's grey queue
+ *
+ * The segment owning link has just become grey for trace, and its
+ * rank set is the single rank.
+ */
+
+void TraceGreyInsert(Trace trace, GreyLink link, Rank rank)
+{
+  AVERT(Trace, trace);
+  AVER(link != NULL);
+  AVERT(Rank, rank);
+  AVER(RingIsSingle(&link->ring));
+
+  link->rank = rank;
+  switch (trace->greyOrder) {
+  case GreyOrderLIFO:
+    /* Push the segment onto the front of the queue, so that we
+       preserve some locality of scanning, and so that we tend to
+       forward objects that are closely linked to the same or nearby
+       segments. */
+    RingInsert(&trace->greyRing[rank], &link->ring);
+    break;
+  case GreyOrderADDRESS: {
+    Bool b = SplayTreeInsert(&trace->greyTree[rank], &link->treeStruct);
+    AVER(b);
+    /* Mark the link as queued.  <design/trace#.grey.queue.ring> */
+    RingAppend(&trace->greyRing[rank], &link->ring);
+    break;
+  }
+  default:
+    NOTREACHED;
+    break;
+  }
+
+  STATISTIC({
+    ++trace->greySegCount;
+    if (trace->greySegCount > trace->greySegMax)
+      trace->greySegMax = trace->greySegCount;
+  });
+}
+
+
+/* TraceGreyRemove -- remove a segment from a trace's grey queue */
+
+void TraceGreyRemove(Trace trace, GreyLink link)
+{
+  AVERT(Trace, trace);
+  AVER(link != NULL);
+  AVER(!RingIsSingle(&link->ring));
+
+  if (trace->greyOrder == GreyOrderADDRESS) {
+    Bool b = SplayTreeDelete(&trace->greyTree[link->rank],
+                             &link->treeStruct);
+    AVER(b);
+  }
+  RingRemove(&link->ring);
+
+  STATISTIC(--trace->greySegCount);
+}
+
+
+/* traceGreyFirst, traceGreyNext -- iterate over a grey queue
+ *
+ * Return the first segment in the queue for rank, or the segment
+ * after seg, or NULL if there are no more.  The queue must not be
+ * changed during the iteration.
+ */
+
+static Seg traceGreyFirst(Trace trace, Rank rank)
+{
+  if (trace->greyOrder == GreyOrderADDRESS) {
+    Tree tree = SplayTreeFirst(&trace->greyTree[rank]);
+    if (tree == TreeEMPTY)
+      return NULL;
+    return GreyLinkOfTree(tree)->seg;
+  } else {
+    Ring ring = &trace->greyRing[rank];
+    if (RingIsSingle(ring))
+      return NULL;
+    return GreyLinkOfRing(RingNext(ring))->seg;
+  }
+}
+
+static Seg traceGreyNext(Trace trace, Rank rank, Seg seg)
+{
+  if (trace->greyOrder == GreyOrderADDRESS) {
+    Addr base = SegBase(seg);
+    Tree tree = SplayTreeNext(&trace->greyTree[rank],
+                              TreeKeyOfAddrVar(base));
+    if (tree == TreeEMPTY)
+      return NULL;
+    return GreyLinkOfTree(tree)->seg;
+  } else {
+    Ring next = RingNext(&SegGreyLink(seg, trace->ti)->ring);
+    if (next == &trace->greyRing[rank])
+      return NULL;
+    return GreyLinkOfRing(next)->seg;
+  }
+}
+
 /* traceBand - current band of the trace.
  *
  * The current band is the band currently being discovered.  Each band
@@ -306,6 +501,8 @@ static void traceUpdateCounts(Trace trace, ScanState ss,
       trace->segScanSize += ss->scannedSize; /* see .work */
       STATISTIC(trace->segCopiedSize += ss->copiedSize);
       STATISTIC(++trace->segScanCount);
+      STATISTIC(trace->cardSkipCount += ss->cardSkipCount);
+      STATISTIC(trace->cardSkipSize += ss->cardSkipSize);
       break;
     }
     case traceAccountingPhaseSingleScan: {
@@ -319,8 +516,10 @@ static void traceUpdateCounts(Trace trace, ScanState ss,
   STATISTIC(trace->fixRefCount += ss->fixRefCount);
   STATISTIC(trace->segRefCount += ss->segRefCount);
   STATISTIC(trace->whiteSegRefCount += ss->whiteSegRefCount);
+  STATISTIC(trace->segCacheHitCount += ss->segCacheHitCount);
   STATISTIC(trace->nailCount += ss->nailCount);
   STATISTIC(trace->snapCount += ss->snapCount);
+  STATISTIC(trace->snapCacheHitCount += ss->snapCacheHitCount);
   STATISTIC(trace->forwardedCount += ss->forwardedCount);
   STATISTIC(trace->preservedInPlaceCount += ss->preservedInPlaceCount);
 }
@@ -465,6 +664,10 @@ Res TraceCondemnEnd(double *mortalityReturn, Trace trace)
     RING_FOR(segNode, &gen->segRing, segNext) {
       GCSeg gcseg = RING_ELT(GCSeg, genRing, segNode);
       AVERC(GCSeg, gcseg);
+      /* Don't condemn segments that another trace has condemned. */
+      /* <design/trace#.multi.disjoint> */
+      if (SegWhite(&gcseg->segStruct) != TraceSetEMPTY)
+        continue;
       res = TraceAddWhite(trace, &gcseg->segStruct);
       if (res != ResOK)
         goto failBegin;
@@ -586,6 +789,46 @@ static Res rootFlip(Root root, void *p)
 }
 
 
+/* traceFlipCards -- fold dirty cards into segment summaries at flip
+ *
+ * With card marking, the mutator may have stored references into
+ * segments without the MPS knowing, right up until it was suspended
+ * for the flip.  Fold the dirty cards of each segment that has any
+ * into its summary, and greyen the segments that may now refer to the
+ * white set, before the mutator turns black.  The segments are found
+ * from the card tables, so segments with only clean cards aren't
+ * visited.  <design/write-barrier#.card.flip>
+ */
+
+static void traceFlipCards(Trace trace)
+{
+  Arena arena = trace->arena;
+  Ring node, next;
+
+  RING_FOR(node, ArenaChunkRing(arena), next) {
+    Chunk chunk = RING_ELT(Chunk, arenaRing, node);
+    Index card = 0;
+    Seg seg;
+    while (ChunkCardsNextDirtySeg(&seg, &card, chunk)) {
+      RefSet summary;
+      if (SegRankSet(seg) == RankSetEMPTY) {
+        /* The client may mark cards in leaf objects. */
+        (void)SegCardsClear(seg);
+      } else if (SegCardsSummary(&summary, seg)) {
+        SegSetSummary(seg, RefSetUnion(SegSummary(seg), summary));
+        if (!TraceSetIsMember(SegGrey(seg), trace)
+            && ZoneSetInter(summary, trace->white) != ZoneSetEMPTY)
+        {
+          SegGreyen(seg, trace);
+          if (TraceSetIsMember(SegGrey(seg), trace))
+            trace->foundation += SegSize(seg);
+        }
+      }
+    }
+  }
+}
+
+
 /* traceFlip -- flip the mutator from grey to black w.r.t. a trace
  *
  * The main job of traceFlip is to scan references which can't be protected
@@ -614,7 +857,6 @@ static Res rootFlip(Root root, void *p)
 
 static Res traceFlip(Trace trace)
 {
-  Ring node, nextNode;
   Arena arena;
   Rank rank;
   struct rootFlipClosureStruct rfc;
@@ -632,6 +874,9 @@ static Res traceFlip(Trace trace)
 
   EVENT2(TraceFlipBegin, trace, arena);
 
+  /* Segments are no longer hot.  <design/write-barrier#.hot> */
+  ++arena->flipSerial;
+
   traceFlipBuffers(ArenaGlobals(arena));
 
   /* Update location dependency structures. */
@@ -663,13 +908,17 @@ static Res traceFlip(Trace trace)
   /* (surely we mean "write-barrier" not "read-barrier" above? */
   /* drj 2003-02-19) */
 
+  if (ArenaCardMarking(arena))
+    traceFlipCards(trace);
+
   /* Now that the mutator is black we must prevent it from reading */
   /* grey objects so that it can't obtain white pointers. */
-  for(rank = RankMIN; rank < RankLIMIT; ++rank)
-    RING_FOR(node, ArenaGreyRing(arena, rank), nextNode) {
-      Seg seg = SegOfGreyRing(node);
+  for(rank = RankMIN; rank < RankLIMIT; ++rank) {
+    Seg seg;
+    for (seg = traceGreyFirst(trace, rank); seg != NULL;
+         seg = traceGreyNext(trace, rank, seg))
       SegFlip(seg, trace);
-    }
+  }
 
   /* @@@@ When write barrier collection is implemented, this is where */
   /* write protection should be removed for all segments which are */
@@ -722,10 +971,20 @@ Res TraceCreate(Trace *traceReturn, Arena arena, TraceStartWhy why)
 {
   TraceId ti;
   Trace trace;
+  Index si;
 
   AVER(traceReturn != NULL);
   AVERT(Arena, arena);
 
+  /* The new trace mustn't meet segments that a finished trace has
+   * yet to reclaim.  It may scan any segment, not only those it
+   * condemns, so they must all be reclaimed, which would bring back
+   * the pause that lazy reclaim avoids.  But TracePollStart doesn't
+   * start a trace while another is reclaiming, and the other callers park
+   * the arena or start a trace only when none is busy, so there's
+   * normally nothing to do here.  <design/trace#.reclaim.lazy.create> */
+  (void)TraceReclaimFinish(arena);
+
   /* Find a free trace ID */
   TRACE_SET_ITER(ti, trace, TraceSetComp(arena->busyTraces), arena)
     goto found;
@@ -746,27 +1005,39 @@ found:
   trace->fix = SegFix;
   trace->fixClosure = NULL;
   RingInit(&trace->genRing);
+  trace->reclaimGen = NULL;     /* see .reclaim.lazy */
+  RingInit(&trace->reclaimCursor);
+  trace->reclaimWork = (Size)0;
   STATISTIC(trace->preTraceArenaReserved = ArenaReserved(arena));
   trace->condemned = (Size)0;   /* nothing condemned yet */
   trace->notCondemned = (Size)0;
   trace->foundation = (Size)0;  /* nothing grey yet */
   trace->quantumWork = (Work)0; /* computed in TraceStart */
+  trace->reclaimQuantum = (Size)0; /* computed in TraceStart */
   STATISTIC(trace->greySegCount = (Count)0);
   STATISTIC(trace->greySegMax = (Count)0);
+  trace->greyOrder = arena->greyOrder;
+  traceGreyInit(trace);
+  STATISTIC(trace->greyFindCount = (Count)0);
+  STATISTIC(trace->greyFindClock = (Clock)0);
   STATISTIC(trace->rootScanCount = (Count)0);
   trace->rootScanSize = (Size)0;
   STATISTIC(trace->rootCopiedSize = (Size)0);
   STATISTIC(trace->segScanCount = (Count)0);
   trace->segScanSize = (Size)0; /* see .work */
   STATISTIC(trace->segCopiedSize = (Size)0);
+  STATISTIC(trace->cardSkipCount = (Count)0);
+  STATISTIC(trace->cardSkipSize = (Size)0);
   STATISTIC(trace->singleScanCount = (Count)0);
   STATISTIC(trace->singleScanSize = (Size)0);
   STATISTIC(trace->singleCopiedSize = (Size)0);
   STATISTIC(trace->fixRefCount = (Count)0);
   STATISTIC(trace->segRefCount = (Count)0);
   STATISTIC(trace->whiteSegRefCount = (Count)0);
+  STATISTIC(trace->segCacheHitCount = (Count)0);
   STATISTIC(trace->nailCount = (Count)0);
   STATISTIC(trace->snapCount = (Count)0);
+  STATISTIC(trace->snapCacheHitCount = (Count)0);
   STATISTIC(trace->readBarrierHitCount = (Count)0);
   STATISTIC(trace->pointlessScanCount = (Count)0);
   STATISTIC(trace->forwardedCount = (Count)0);
@@ -775,6 +1046,10 @@ found:
   trace->preservedInPlaceSize = (Size)0;  /* see .message.data */
   STATISTIC(trace->reclaimCount = (Count)0);
   STATISTIC(trace->reclaimSize = (Size)0);
+  STATISTIC(trace->promoteCount = (Count)0);
+  STATISTIC(trace->promoteSize = (Size)0);
+  for (si = 0; si < TraceSnapCacheSIZE; ++si)
+    trace->snapCache[si].from = trace->snapCache[si].to = (Ref)0;
   trace->sig = TraceSig;
   arena->busyTraces = TraceSetAdd(arena->busyTraces, trace);
   AVERT(Trace, trace);
@@ -816,6 +1091,7 @@ static void traceDestroyCommon(Trace trace)
     GenDescEndTrace(gen, trace);
   }
   RingFinish(&trace->genRing);
+  traceGreyFinish(trace);
 
   /* Ensure that address space is returned to the operating system for
    * traces that don't have any condemned objects (there might be
@@ -829,6 +1105,7 @@ static void traceDestroyCommon(Trace trace)
    * violating <code/global.c#emergency.invariant>. */
   ArenaSetEmergency(trace->arena, FALSE);
 
+  RingFinish(&trace->reclaimCursor);
   trace->sig = SigInvalid;
   trace->arena->busyTraces = TraceSetDel(trace->arena->busyTraces, trace);
   trace->arena->flippedTraces = TraceSetDel(trace->arena->flippedTraces, trace);
@@ -871,61 +1148,109 @@ void TraceDestroyFinished(Trace trace)
                     trace->singleCopiedSize,
                     trace->readBarrierHitCount, trace->greySegMax,
                     trace->pointlessScanCount));
-  STATISTIC(EVENT11(TraceStatFix, trace, trace->arena,
+  STATISTIC(EVENT13(TraceStatFix, trace, trace->arena,
                     trace->fixRefCount, trace->segRefCount,
-                    trace->whiteSegRefCount,
+                    trace->whiteSegRefCount, trace->segCacheHitCount,
                     trace->nailCount, trace->snapCount,
+                    trace->snapCacheHitCount,
                     trace->forwardedCount, trace->forwardedSize,
                     trace->preservedInPlaceCount,
                     trace->preservedInPlaceSize));
-  STATISTIC(EVENT4(TraceStatReclaim, trace, trace->arena,
-                   trace->reclaimCount, trace->reclaimSize));
+  STATISTIC(EVENT6(TraceStatReclaim, trace, trace->arena,
+                   trace->reclaimCount, trace->reclaimSize,
+                   trace->promoteCount, trace->promoteSize));
+  STATISTIC(EVENT4(TraceStatGrey, trace, trace->arena,
+                   trace->greyFindCount, trace->greyFindClock));
+  STATISTIC(EVENT4(TraceStatCard, trace, trace->arena,
+                   trace->cardSkipCount, trace->cardSkipSize));
+  STATISTIC(EVENT3(ShieldStat, trace->arena,
+                   ArenaShield(trace->arena)->protCount,
+                   ArenaShield(trace->arena)->aliasCount));
+  STATISTIC(EVENT5(BarrierStat, trace->arena,
+                   trace->arena->hotSegCount, trace->arena->hotScanCount,
+                   trace->arena->hotRaiseCount,
+                   trace->arena->pageScanCount));
+  if (trace->arena->traceWork != NULL)
+    traceWorkReport(trace->arena->traceWork, trace);
 
   traceDestroyCommon(trace);
 }
 
 
-/* traceReclaim -- reclaim the remaining objects white for this trace */
+/* traceReclaimSeg -- reclaim the objects in a segment white for trace
+ *
+ * Returns TRUE if the segment was freed.
+ */
+
+static Bool traceReclaimSeg(Trace trace, Seg seg)
+{
+  Bool freed;
+
+  /* There shouldn't be any grey stuff left for this trace. */
+  AVER_CRITICAL(!TraceSetIsMember(SegGrey(seg), trace));
+  AVER_CRITICAL(TraceSetIsMember(SegWhite(seg), trace));
+  AVER_CRITICAL(PoolHasAttr(SegPool(seg), AttrGC));
+  STATISTIC(++trace->reclaimCount);
+  trace->reclaimWork += SegSize(seg);
+  freed = SegReclaim(seg, trace);
+
+  /* If the segment still exists, it should no longer be white. */
+  /* The code from the class-specific reclaim methods to */
+  /* unwhiten the segment could in fact be moved here.   */
+  AVER_CRITICAL(freed || !TraceSetIsMember(SegWhite(seg), trace));
+
+  return freed;
+}
+
+
+/* traceReclaim -- reclaim some of the objects white for this trace
+ *
+ * Reclaims the next segment that is white for the trace, or finishes
+ * the trace if there are none left.  The segments of each condemned
+ * generation are visited in turn, with trace->reclaimCursor marking
+ * the position in the generation's segment ring, so that segments
+ * that are split, merged, freed or allocated meanwhile are neither
+ * missed nor visited twice.  <design/trace#.reclaim.lazy>
+ */
 
 static void traceReclaim(Trace trace)
 {
   Arena arena;
-  Ring genNode, genNext;
 
   AVER(trace->state == TraceRECLAIM);
 
-
   arena = trace->arena;
-  EVENT2(TraceReclaim, trace, arena);
-  RING_FOR(genNode, &trace->genRing, genNext) {
-    Ring segNode, segNext;
-    GenDesc gen = GenDescOfTraceRing(genNode, trace);
-    AVERT(GenDesc, gen);
-    RING_FOR(segNode, &gen->segRing, segNext) {
-      GCSeg gcseg = RING_ELT(GCSeg, genRing, segNode);
-      Seg seg = &gcseg->segStruct;
+  if (trace->reclaimGen == NULL) {
+    EVENT2(TraceReclaim, trace, arena);
+    trace->reclaimGen = &trace->genRing;
+  }
+
+  for (;;) {
+    Ring segNode;
 
-      /* There shouldn't be any grey stuff left for this trace. */
-      AVER_CRITICAL(!TraceSetIsMember(SegGrey(seg), trace));
+    if (RingIsSingle(&trace->reclaimCursor)) {
+      /* Move on to the next generation, if there is one. */
+      GenDesc gen;
+      trace->reclaimGen = RingNext(trace->reclaimGen);
+      if (trace->reclaimGen == &trace->genRing)
+        break;
+      gen = GenDescOfTraceRing(trace->reclaimGen, trace);
+      AVERT(GenDesc, gen);
+      RingInsert(&gen->segRing, &trace->reclaimCursor);
+    }
+
+    /* Step the cursor past the next segment before reclaiming it, as
+     * reclaiming may free the segment. */
+    segNode = RingNext(&trace->reclaimCursor);
+    RingRemove(&trace->reclaimCursor);
+    if (segNode != &GenDescOfTraceRing(trace->reclaimGen, trace)->segRing) {
+      Seg seg = &RING_ELT(GCSeg, genRing, segNode)->segStruct;
+      RingInsert(segNode, &trace->reclaimCursor);
       if (TraceSetIsMember(SegWhite(seg), trace)) {
-        Addr base = SegBase(seg);
-        AVER_CRITICAL(PoolHasAttr(SegPool(seg), AttrGC));
-        STATISTIC(++trace->reclaimCount);
-        SegReclaim(seg, trace);
-
-        /* If the segment still exists, it should no longer be white. */
-        /* Note that the seg returned by this SegOfAddr may not be */
-        /* the same as the one above, but in that case it's new and */
-        /* still shouldn't be white for this trace. */
-
-        /* The code from the class-specific reclaim methods to */
-        /* unwhiten the segment could in fact be moved here.   */
-        {
-          Seg nonWhiteSeg = NULL;       /* prevents compiler warning */
-          AVER_CRITICAL(!SegOfAddr(&nonWhiteSeg, arena, base)
-                        || !TraceSetIsMember(SegWhite(nonWhiteSeg), trace));
-          UNUSED(nonWhiteSeg); /* <code/mpm.c#check.unused> */
-        }
+        (void)traceReclaimSeg(trace, seg);
+        /* <design/trace#.reclaim.lazy.overlap> */
+        if (arena->busyTraces == TraceSetSingle(trace))
+          return;
       }
     }
   }
@@ -939,10 +1264,90 @@ static void traceReclaim(Trace trace)
   (void)TraceIdMessagesCreate(arena, trace->ti);
 }
 
+
+/* TraceReclaimFinish -- finish reclaiming for all traces
+ *
+ * Reclaims the remaining segments of every trace that is reclaiming,
+ * and destroys those traces.  Returns TRUE if there were any.
+ * <design/trace#.reclaim.lazy.create>
+ */
+
+Bool TraceReclaimFinish(Arena arena)
+{
+  TraceId ti;
+  Trace trace;
+  Bool finished = FALSE;
+
+  AVERT(Arena, arena);
+
+  TRACE_SET_ITER(ti, trace, arena->busyTraces, arena)
+    if (trace->state == TraceRECLAIM) {
+      do {
+        traceReclaim(trace);
+      } while (trace->state == TraceRECLAIM);
+      TraceDestroyFinished(trace);
+      finished = TRUE;
+    }
+  TRACE_SET_ITER_END(ti, trace, arena->busyTraces, arena);
+
+  return finished;
+}
+
+
+/* traceReclaiming -- is any trace waiting to reclaim its segments? */
+
+static Bool traceReclaiming(Arena arena)
+{
+  TraceId ti;
+  Trace trace;
+
+  TRACE_SET_ITER(ti, trace, arena->busyTraces, arena)
+    if (trace->state == TraceRECLAIM)
+      return TRUE;
+  TRACE_SET_ITER_END(ti, trace, arena->busyTraces, arena);
+
+  return FALSE;
+}
+
+
+/* TraceSegReclaim -- reclaim a segment before reusing it
+ *
+ * If seg is white for a trace that is reclaiming, reclaim it now.
+ * Pools call this before filling a buffer from one of their
+ * segments.  Returns FALSE if the segment was freed.
+ * <design/trace#.reclaim.lazy.fill>
+ */
+
+Bool TraceSegReclaim(Arena arena, Seg seg)
+{
+  TraceId ti;
+  Trace trace;
+  TraceSet white;
+
+  AVERT(Arena, arena);
+  AVERT(Seg, seg);
+
+  white = SegWhite(seg);
+  if (white == TraceSetEMPTY)
+    return TRUE;
+
+  /* Only a trace running alone reclaims lazily, so there's at most
+   * one. <design/trace#.reclaim.lazy.overlap> */
+  TRACE_SET_ITER(ti, trace, white, arena)
+    if (trace->state == TraceRECLAIM)
+      return !traceReclaimSeg(trace, seg);
+  TRACE_SET_ITER_END(ti, trace, white, arena);
+
+  return TRUE;
+}
+
 /* TraceRankForAccess -- Returns rank to scan at if we hit a barrier.
  *
- * We assume a single trace as otherwise we need to implement rank
- * filters on scanning.
+ * This is the rank at which to scan seg for trace alone.  Traces may
+ * be in different bands, so when a segment is grey for several
+ * flipped traces, it must be scanned separately for each of them
+ * (otherwise we'd need to implement rank filters on scanning).  See
+ * <design/trace#.multi.barrier>.
  *
  * .scan.conservative: It's safe to scan at EXACT unless the band is
  * WEAK and in that case the segment should be weak.
@@ -966,28 +1371,22 @@ static void traceReclaim(Trace trace)
  * See the message <https://info.ravenbrook.com/mail/2012/08/30/16-46-42/0.txt>
  * for a description of these semantics.
  */
-Rank TraceRankForAccess(Arena arena, Seg seg)
+Rank TraceRankForAccess(Trace trace, Seg seg)
 {
-  TraceSet ts;
-  Trace trace;
-  TraceId ti;
   Rank band;
   RankSet rankSet;
 
-  AVERT(Arena, arena);
+  AVERT(Trace, trace);
   AVERT(Seg, seg);
+  AVER(TraceSetIsMember(trace->arena->flippedTraces, trace));
 
-  band = RankLIMIT; /* initialize with invalid rank */
-  ts = arena->flippedTraces;
-  AVER(TraceSetIsSingle(ts));
-  TRACE_SET_ITER(ti, trace, ts, arena)
-    band = traceBand(trace);
-  TRACE_SET_ITER_END(ti, trace, ts, arena);
+  band = traceBand(trace);
   rankSet = SegRankSet(seg);
   switch(band) {
   case RankAMBIG:
-    NOTREACHED;
-    break;
+    /* The trace has flipped but hasn't yet looked for grey segments, */
+    /* so it hasn't advanced to the exact band.  The ambiguous roots */
+    /* were scanned at the flip, so it's safe to scan at EXACT. */
   case RankEXACT:
     return RankEXACT;
   case RankFINAL:
@@ -1056,17 +1455,10 @@ Rank TraceRankForAccess(Arena arena, Seg seg)
  * <https://info.ravenbrook.com/mail/2007/06/25/11-35-57/0.txt>
  */
 
-static Bool traceFindGrey(Seg *segReturn, Rank *rankReturn,
-                          Arena arena, TraceId ti)
+static Bool traceFindGreyQueue(Seg *segReturn, Rank *rankReturn,
+                               Arena arena, Trace trace)
 {
   Rank rank;
-  Trace trace;
-  Ring node, nextNode;
-
-  AVER(segReturn != NULL);
-  AVERT(TraceId, ti);
-
-  trace = ArenaTrace(arena, ti);
 
   while(1) {
     Rank band = traceBand(trace);
@@ -1076,31 +1468,28 @@ static Bool traceFindGrey(Seg *segReturn, Rank *rankReturn,
     /* expect to find any segments of RankAMBIG, so we use      */
     /* this as a terminating condition for the loop.            */
     for(rank = band; rank > RankAMBIG; --rank) {
-      RING_FOR(node, ArenaGreyRing(arena, rank), nextNode) {
-        Seg seg = SegOfGreyRing(node);
-
+      Seg seg = traceGreyFirst(trace, rank);
+      if (seg != NULL) {
         AVERT(Seg, seg);
-        AVER(SegGrey(seg) != TraceSetEMPTY);
+        AVER(TraceSetIsMember(SegGrey(seg), trace));
         AVER(RankSetIsMember(SegRankSet(seg), rank));
 
-        if(TraceSetIsMember(SegGrey(seg), trace)) {
-          /* .check.band.weak */
-          AVER(band != RankWEAK || rank == band);
-          if(rank != band) {
-            traceBandFirstStretchDone(trace);
-          } else {
-            /* .check.final.one-pass */
-            AVER(traceBandFirstStretch(trace));
-          }
-          *segReturn = seg;
-          *rankReturn = rank;
-          EVENT4(TraceFindGrey, arena, trace, seg, rank);
-          return TRUE;
+        /* .check.band.weak */
+        AVER(band != RankWEAK || rank == band);
+        if(rank != band) {
+          traceBandFirstStretchDone(trace);
+        } else {
+          /* .check.final.one-pass */
+          AVER(traceBandFirstStretch(trace));
         }
+        *segReturn = seg;
+        *rankReturn = rank;
+        EVENT4(TraceFindGrey, arena, trace, seg, rank);
+        return TRUE;
       }
     }
     /* .check.ambig.not */
-    AVER(RingIsSingle(ArenaGreyRing(arena, RankAMBIG)));
+    AVER(traceGreyFirst(trace, RankAMBIG) == NULL);
     if(!traceBandAdvance(trace)) {
       /* No grey segments for this trace. */
       return FALSE;
@@ -1108,6 +1497,28 @@ static Bool traceFindGrey(Seg *segReturn, Rank *rankReturn,
   }
 }
 
+static Bool traceFindGrey(Seg *segReturn, Rank *rankReturn,
+                          Arena arena, TraceId ti)
+{
+  Trace trace;
+  Bool found;
+  STATISTIC_DECL(Clock begin)
+
+  AVER(segReturn != NULL);
+  AVERT(TraceId, ti);
+
+  trace = ArenaTrace(arena, ti);
+
+  /* <design/trace#.grey.event> */
+  STATISTIC(begin = ClockNow());
+  found = traceFindGreyQueue(segReturn, rankReturn, arena, trace);
+  STATISTIC({
+    ++trace->greyFindCount;
+    trace->greyFindClock += ClockNow() - begin;
+  });
+  return found;
+}
+
 
 /* ScanStateSetSummary -- set the summary of scanned references
  *
@@ -1157,8 +1568,18 @@ void ScanStateUpdateSummary(ScanState ss, Seg seg, Bool wasTotal)
   AVERT(Seg, seg);
   AVERT(Bool, wasTotal);
 
-  /* Only apply the write barrier if it is not deferred. */
-  if (seg->defer == 0) {
+  /* Finish the card summaries.  A scan that didn't rebuild them,
+     such as a walk, might have changed the references.
+     <design/write-barrier#.card.summary.scan> */
+  if (ss->cardSeg == seg)
+    ScanStateCardsFinish(ss, wasTotal);
+  else if (ArenaCardMarking(ss->arena))
+    SegCardsForget(seg, SegBase(seg), SegLimit(seg));
+
+  /* Only apply the write barrier if it is not deferred, and not to a
+     hot segment.  With card marking there's no barrier to defer.
+     <design/write-barrier#.card> <design/write-barrier#.hot.write> */
+  if (ArenaCardMarking(ss->arena) || (seg->defer == 0 && !SegIsHot(seg))) {
     /* If we scanned every reference in the segment then we have a
        complete summary we can set. Otherwise, we just have
        information about more zones that the segment refers to. */
@@ -1167,11 +1588,82 @@ void ScanStateUpdateSummary(ScanState ss, Seg seg, Bool wasTotal)
     else
       summary = RefSetUnion(SegSummary(seg), ScanStateSummary(ss));
   } else {
+    /* Count write barriers that only a hot segment left lowered. */
+    STATISTIC({
+      if (seg->defer == 0)
+        ++ss->arena->hotRaiseCount;
+    });
     summary = RefSetUNIV;
   }
   SegSetSummary(seg, summary);
 }
 
+/* traceScanSegDone -- account for the scan of a segment
+ *
+ * Merges the results of scanning seg with ss into the traces, and
+ * updates the segment's summary and write barrier deferral.  This is
+ * called after the segment has been covered, whether or not the scan
+ * succeeded, and finishes ss.
+ */
+
+static void traceScanSegDone(TraceSet ts, Arena arena, Seg seg,
+                             ScanState ss, ZoneSet white,
+                             Res res, Bool wasTotal)
+{
+  traceSetUpdateCounts(ts, arena, ss, traceAccountingPhaseSegScan);
+  /* Count segments scanned pointlessly */
+  STATISTIC({
+    TraceId ti; Trace trace;
+    Count whiteSegRefCount = 0;
+
+    TRACE_SET_ITER(ti, trace, ts, arena)
+      whiteSegRefCount += trace->whiteSegRefCount;
+    TRACE_SET_ITER_END(ti, trace, ts, arena);
+    if(whiteSegRefCount == 0)
+      TRACE_SET_ITER(ti, trace, ts, arena)
+        ++trace->pointlessScanCount;
+      TRACE_SET_ITER_END(ti, trace, ts, arena);
+  });
+
+  /* Following is true whether or not scan was total. */
+  /* <design/scan#.summary.subset>. */
+  /* .verify.segsummary: were the seg contents, as found by this
+   * scan, consistent with the recorded SegSummary?
+   */
+  AVER(RefSetSub(ScanStateUnfixedSummary(ss), SegSummary(seg))); /* <design/check/#.common> */
+
+  /* Write barrier deferral -- see <design/write-barrier#.deferral>. */
+  /* Did the segment refer to the white set? */
+  if (ZoneSetInter(ScanStateUnfixedSummary(ss), white) == ZoneSetEMPTY) {
+    /* Boring scan.  One step closer to raising the write barrier. */
+    if (seg->defer > 0)
+      --seg->defer;
+  } else {
+    /* Interesting scan. Defer raising the write barrier. */
+    if (seg->defer < WB_DEFER_DELAY)
+      seg->defer = WB_DEFER_DELAY;
+  }
+
+  ScanStateUpdateSummary(ss, seg, res == ResOK && wasTotal);
+  ScanStateFinish(ss);
+}
+
+
+/* traceCardsClear -- forget a segment's dirty cards before scanning it
+ *
+ * With card marking, a segment's summary doesn't cover the references
+ * in its dirty cards.  A scan of the whole segment will find them, so
+ * clean the cards, and widen the summary until the scan computes it
+ * afresh.  <design/write-barrier#.card.scan>
+ */
+
+static void traceCardsClear(Arena arena, Seg seg)
+{
+  if (ArenaCardMarking(arena) && SegCardsClear(seg))
+    SegSetSummary(seg, RefSetUNIV);
+}
+
+
 /* traceScanSegRes -- scan a segment to remove greyness
  *
  * @@@@ During scanning, the segment should be write-shielded to prevent
@@ -1192,12 +1684,17 @@ static Res traceScanSegRes(TraceSet ts, Rank rank, Arena arena, Seg seg)
 
   /* Only scan a segment if it refers to the white set. */
   if(ZoneSetInter(white, SegSummary(seg)) == ZoneSetEMPTY) {
+    /* The pool may need to look at the objects in order to blacken */
+    /* them (AMS does), so expose the segment. */
+    ShieldExpose(arena, seg);
     SegBlacken(seg, ts);
+    ShieldCover(arena, seg);
     /* Setup result code to return later. */
     res = ResOK;
   } else {      /* scan it */
     ScanStateStruct ssStruct;
     ScanState ss = &ssStruct;
+    traceCardsClear(arena, seg);
     ScanStateInitSeg(ss, ts, arena, rank, white, seg);
 
     /* Expose the segment to make sure we can scan it. */
@@ -1206,42 +1703,7 @@ static Res traceScanSegRes(TraceSet ts, Rank rank, Arena arena, Seg seg)
     /* Cover, regardless of result */
     ShieldCover(arena, seg);
 
-    traceSetUpdateCounts(ts, arena, ss, traceAccountingPhaseSegScan);
-    /* Count segments scanned pointlessly */
-    STATISTIC({
-      TraceId ti; Trace trace;
-      Count whiteSegRefCount = 0;
-
-      TRACE_SET_ITER(ti, trace, ts, arena)
-        whiteSegRefCount += trace->whiteSegRefCount;
-      TRACE_SET_ITER_END(ti, trace, ts, arena);
-      if(whiteSegRefCount == 0)
-        TRACE_SET_ITER(ti, trace, ts, arena)
-          ++trace->pointlessScanCount;
-        TRACE_SET_ITER_END(ti, trace, ts, arena);
-    });
-
-    /* Following is true whether or not scan was total. */
-    /* <design/scan#.summary.subset>. */
-    /* .verify.segsummary: were the seg contents, as found by this
-     * scan, consistent with the recorded SegSummary?
-     */
-    AVER(RefSetSub(ScanStateUnfixedSummary(ss), SegSummary(seg))); /* <design/check/#.common> */
-
-    /* Write barrier deferral -- see <design/write-barrier#.deferral>. */
-    /* Did the segment refer to the white set? */
-    if (ZoneSetInter(ScanStateUnfixedSummary(ss), white) == ZoneSetEMPTY) {
-      /* Boring scan.  One step closer to raising the write barrier. */
-      if (seg->defer > 0)
-        --seg->defer;
-    } else {
-      /* Interesting scan. Defer raising the write barrier. */
-      if (seg->defer < WB_DEFER_DELAY)
-        seg->defer = WB_DEFER_DELAY;
-    }
-
-    ScanStateUpdateSummary(ss, seg, res == ResOK && wasTotal);
-    ScanStateFinish(ss);
+    traceScanSegDone(ts, arena, seg, ss, white, res, wasTotal);
   }
 
   if(res == ResOK) {
@@ -1276,75 +1738,642 @@ static Res traceScanSeg(TraceSet ts, Rank rank, Arena arena, Seg seg)
 }
 
 
-/* TraceSegAccess -- handle barrier hit on a segment */
+/* Parallel scanning -- see <design/trace#.parallel>
+ *
+ * The TraceWork structure holds the state that the collector shares
+ * with the collector worker threads while they scan a batch of grey
+ * segments.
+ */
 
-void TraceSegAccess(Arena arena, Seg seg, AccessSet mode)
+#define TraceWorkSig ((Sig)0x51924A0C) /* SIGnature TRAce wOrK */
+
+typedef struct TraceJobStruct {
+  Seg seg;                      /* segment to scan */
+  ScanStateStruct ssStruct;     /* scan state for this segment */
+  Res res;                      /* result of scanning the segment */
+  Bool wasTotal;                /* was the scan total? */
+} TraceJobStruct, *TraceJob;
+
+typedef struct TraceWorkerStruct {
+  Count segScanCount;           /* segments scanned */
+  Size segScanSize;             /* bytes scanned */
+  Clock scanClock;              /* time spent scanning */
+} TraceWorkerStruct, *TraceWorker;
+
+typedef struct TraceWorkStruct {
+  Sig sig;                      /* design.mps.sig.field */
+  Arena arena;                  /* owning arena */
+  Workers workers;              /* the collector worker threads */
+  Count workerCount;            /* number of workers */
+  Lock lock;                    /* <design/trace#.parallel.fix> */
+  Count jobLimit;               /* length of jobs array */
+  TraceJob jobs;                /* the batch being scanned */
+  Count jobCount;               /* number of jobs in the batch */
+  Index jobNext;                /* next job to claim, under lock */
+  TraceId ti;                   /* trace that the batch is for */
+  TraceWorker worker;           /* statistics for each trace and worker */
+} TraceWorkStruct;
+
+
+Bool TraceWorkCheck(TraceWork tw)
 {
+  CHECKS(TraceWork, tw);
+  CHECKU(Arena, tw->arena);
+  CHECKD_NOSIG(Workers, tw->workers);
+  CHECKL(tw->workerCount == WorkersCount(tw->workers));
+  CHECKL(tw->workerCount > 1);
+  CHECKD_NOSIG(Lock, tw->lock);
+  CHECKL(tw->jobLimit == tw->workerCount * TraceBatchPerWORKER);
+  CHECKL(tw->jobs != NULL);
+  CHECKL(tw->jobCount <= tw->jobLimit);
+  CHECKL(tw->jobNext <= tw->jobCount);
+  CHECKL(TraceIdCheck(tw->ti));
+  CHECKL(tw->worker != NULL);
+  return TRUE;
+}
+
+
+/* TraceWorkCreate -- create the collector workers for an arena */
+
+Res TraceWorkCreate(TraceWork *traceWorkReturn, Arena arena, Count workers)
+{
+  TraceWork tw;
+  void *p;
   Res res;
-  AccessSet shieldHit;
-  Bool readHit, writeHit;
 
+  AVER(traceWorkReturn != NULL);
   AVERT(Arena, arena);
-  AVERT(Seg, seg);
-  AVERT(AccessSet, mode);
+  AVER(workers > 1);
 
-  shieldHit = BS_INTER(mode, SegSM(seg));
-  readHit = BS_INTER(shieldHit, AccessREAD) != AccessSetEMPTY;
-  writeHit = BS_INTER(shieldHit, AccessWRITE) != AccessSetEMPTY;
+  res = ControlAlloc(&p, arena, sizeof(TraceWorkStruct));
+  if (res != ResOK)
+    goto failAlloc;
+  tw = p;
 
-  /* If it's a read access, then the segment must be grey for a trace */
-  /* which is flipped. */
-  AVER(!readHit ||
-       TraceSetInter(SegGrey(seg), arena->flippedTraces) != TraceSetEMPTY);
+  res = ControlAlloc(&p, arena, LockSize());
+  if (res != ResOK)
+    goto failLockAlloc;
+  tw->lock = p;
+  LockInit(tw->lock);
 
-  /* If it's a write access, then the segment must have a summary that */
-  /* is smaller than the mutator's summary (which is assumed to be */
-  /* RefSetUNIV). */
-  AVER(!writeHit || SegSummary(seg) != RefSetUNIV);
+  tw->jobLimit = workers * TraceBatchPerWORKER;
+  res = ControlAlloc(&p, arena, tw->jobLimit * sizeof(TraceJobStruct));
+  if (res != ResOK)
+    goto failJobsAlloc;
+  tw->jobs = p;
 
-  EVENT3(TraceAccess, arena, seg, mode);
+  res = ControlAlloc(&p, arena,
+                     TraceLIMIT * workers * sizeof(TraceWorkerStruct));
+  if (res != ResOK)
+    goto failWorkerAlloc;
+  tw->worker = p;
+  (void)mps_lib_memset(tw->worker, 0,
+                       TraceLIMIT * workers * sizeof(TraceWorkerStruct));
 
-  /* Write barrier deferral -- see <design/write-barrier#.deferral>. */
-  if (writeHit)
-    seg->defer = WB_DEFER_HIT;
+  res = WorkersCreate(&tw->workers, arena, workers);
+  if (res != ResOK)
+    goto failWorkersCreate;
 
-  if (readHit) {
-    Rank rank;
-    TraceSet traces;
+  tw->arena = arena;
+  tw->workerCount = workers;
+  tw->jobCount = 0;
+  tw->jobNext = 0;
+  tw->ti = 0;
+  tw->sig = TraceWorkSig;
+  AVERT(TraceWork, tw);
+
+  *traceWorkReturn = tw;
+  return ResOK;
+
+failWorkersCreate:
+  ControlFree(arena, tw->worker,
+              TraceLIMIT * workers * sizeof(TraceWorkerStruct));
+failWorkerAlloc:
+  ControlFree(arena, tw->jobs, tw->jobLimit * sizeof(TraceJobStruct));
+failJobsAlloc:
+  LockFinish(tw->lock);
+  ControlFree(arena, tw->lock, LockSize());
+failLockAlloc:
+  ControlFree(arena, tw, sizeof(TraceWorkStruct));
+failAlloc:
+  return res;
+}
+
+
+/* TraceWorkDestroy -- destroy the collector workers for an arena */
+
+void TraceWorkDestroy(TraceWork tw)
+{
+  Arena arena;
+
+  AVERT(TraceWork, tw);
+  AVER(tw->jobCount == 0);
+  arena = tw->arena;
+
+  WorkersDestroy(tw->workers);
+  tw->sig = SigInvalid;
+  ControlFree(arena, tw->worker,
+              TraceLIMIT * tw->workerCount * sizeof(TraceWorkerStruct));
+  ControlFree(arena, tw->jobs, tw->jobLimit * sizeof(TraceJobStruct));
+  LockFinish(tw->lock);
+  ControlFree(arena, tw->lock, LockSize());
+  ControlFree(arena, tw, sizeof(TraceWorkStruct));
+}
+
+
+/* traceWorkReport -- report and reset per-worker statistics for a trace
+ *
+ * <design/trace#.parallel.stats>
+ */
+
+static void traceWorkReport(TraceWork tw, Trace trace)
+{
+  Index i;
+
+  AVERT(TraceWork, tw);
+  AVERT(Trace, trace);
+
+  for (i = 0; i < tw->workerCount; ++i) {
+    TraceWorker worker = &tw->worker[trace->ti * tw->workerCount + i];
+    EVENT6(TraceStatWorker, trace, trace->arena, i, worker->segScanCount,
+           worker->segScanSize, worker->scanClock);
+    worker->segScanCount = 0;
+    worker->segScanSize = 0;
+    worker->scanClock = 0;
+  }
+}
+
+
+/* traceWorkerScan -- scan segments on a collector worker thread
+ *
+ * This is the method that WorkersRun calls on each worker.  It claims
+ * jobs from the batch until there are none left.  It runs without the
+ * arena lock, and so must not log events or update anything other
+ * than the job it has claimed and its own statistics.  References are
+ * fixed under tw->lock: see <design/trace#.parallel.fix>.  The scan
+ * state records the worker, so that a pool can give each worker its
+ * own forwarding buffers: see <design/trace#.parallel.forward>.
+ */
+
+static void traceWorkerScan(void *closure, Index i)
+{
+  TraceWork tw = closure;
+  TraceWorker worker;
 
-    AVER(SegRankSet(seg) != RankSetEMPTY);
+  AVER(tw != NULL);
+  AVER(i < tw->workerCount);
 
-    /* Pick set of traces to scan for: */
-    traces = arena->flippedTraces;
-    rank = TraceRankForAccess(arena, seg);
-    res = traceScanSeg(traces, rank, arena, seg);
+  worker = &tw->worker[tw->ti * tw->workerCount + i];
+  for (;;) {
+    TraceJob job;
+    Clock begin;
 
-    /* Allocation failures should be handled my emergency mode, and we don't
-       expect any other kind of failure in a normal GC that causes access
-       faults. */
-    AVER(res == ResOK);
+    LockClaim(tw->lock);
+    if (tw->jobNext == tw->jobCount) {
+      LockRelease(tw->lock);
+      break;
+    }
+    job = &tw->jobs[tw->jobNext];
+    ++tw->jobNext;
+    LockRelease(tw->lock);
+    job->ssStruct.worker = i; /* <design/trace#.parallel.forward> */
+
+    begin = ClockNow();
+    job->res = SegScanUnlogged(&job->wasTotal, job->seg, &job->ssStruct);
+    worker->scanClock += ClockNow() - begin;
+    ++worker->segScanCount;
+    worker->segScanSize += job->ssStruct.scannedSize;
+  }
+}
+
+
+/* traceSegIsParallel -- can a grey segment be scanned in parallel?
+ *
+ * <design/trace#.parallel.eligible>
+ */
+
+static Bool traceSegIsParallel(Seg seg, Trace trace, ZoneSet white)
+{
+  Buffer buffer;
+
+  return TraceSetIsMember(SegGrey(seg), trace)
+    && SegWhite(seg) == TraceSetEMPTY
+    && SegNailed(seg) == TraceSetEMPTY
+    && PoolHasAttr(SegPool(seg), AttrPARSCAN)
+    && !SegBuffer(&buffer, seg)
+    && ZoneSetInter(white, SegSummary(seg)) != ZoneSetEMPTY;
+}
+
+
+/* traceScanBatch -- scan a batch of grey segments in parallel
+ *
+ * Scans seg, which traceFindGrey has just found at rank, together
+ * with the following segments in the same grey ring that are eligible
+ * for parallel scanning, on the collector worker threads.  Returns
+ * FALSE without scanning anything if there aren't at least two
+ * eligible segments.  <design/trace#.parallel.batch>
+ */
+
+static Bool traceScanBatch(Res *resReturn, Trace trace, Rank rank, Seg seg)
+{
+  Arena arena = trace->arena;
+  TraceWork tw = arena->traceWork;
+  TraceSet ts = TraceSetSingle(trace);
+  ZoneSet white;
+  Seg grey;
+  Index i;
+  Count count = 0;
+  Res res = ResOK;
 
-    /* The pool should've done the job of removing the greyness that */
-    /* was causing the segment to be protected, so that the mutator */
-    /* can go ahead and access it. */
-    AVER(TraceSetInter(SegGrey(seg), traces) == TraceSetEMPTY);
+  AVER(resReturn != NULL);
+  AVERT(TraceWork, tw);
+  AVER(tw->jobCount == 0);
+
+  white = traceSetWhiteUnion(ts, arena);
+  if (!traceSegIsParallel(seg, trace, white))
+    return FALSE;
+
+  for (grey = traceGreyFirst(trace, rank); grey != NULL;
+       grey = traceGreyNext(trace, rank, grey)) {
+    if (traceSegIsParallel(grey, trace, white)) {
+      tw->jobs[count].seg = grey;
+      ++count;
+      if (count == tw->jobLimit)
+        break;
+    }
+  }
+  AVER(count > 0);
+  AVER(tw->jobs[0].seg == seg);
+  if (count == 1)
+    return FALSE;
+
+  /* Suspend the mutator once for the whole batch, so that exposing
+     segments on worker threads never needs to suspend threads.
+     <design/trace#.parallel.shield> */
+  ShieldHold(arena);
+  for (i = 0; i < count; ++i) {
+    TraceJob job = &tw->jobs[i];
+    traceCardsClear(arena, job->seg);
+    ScanStateInitSeg(&job->ssStruct, ts, arena, rank, white, job->seg);
+    job->ssStruct.fixLock = tw->lock;
+    job->res = ResOK;
+    job->wasTotal = FALSE;
+    /* <design/trace#.parallel.event> */
+    EVENT5(SegScan, job->seg, SegPool(job->seg), arena, ts, rank);
+    ShieldExpose(arena, job->seg);
+  }
+
+  tw->ti = trace->ti;
+  tw->jobCount = count;
+  tw->jobNext = 0;
+  WorkersRun(tw->workers, traceWorkerScan, tw);
+  AVER(tw->jobNext == count);
+
+  for (i = 0; i < count; ++i) {
+    TraceJob job = &tw->jobs[i];
+    ShieldCover(arena, job->seg);
+    job->ssStruct.fixLock = NULL;
+    job->ssStruct.worker = 0;
+    traceScanSegDone(ts, arena, job->seg, &job->ssStruct, white,
+                     job->res, job->wasTotal);
+    if (job->res == ResOK)
+      SegSetGrey(job->seg, TraceSetDiff(SegGrey(job->seg), ts));
+  }
+  ShieldRelease(arena);
+
+  /* Segments whose scans failed are still grey, and are scanned again
+     on this thread, in emergency mode if necessary, as traceScanSeg
+     would. */
+  for (i = 0; i < count; ++i) {
+    TraceJob job = &tw->jobs[i];
+    if (job->res != ResOK) {
+      Res segRes;
+      if (ResIsAllocFailure(job->res))
+        ArenaSetEmergency(arena, TRUE);
+      segRes = traceScanSeg(ts, rank, arena, job->seg);
+      if (segRes != ResOK)
+        res = segRes;
+    }
+  }
+
+  tw->jobCount = 0;
+  tw->jobNext = 0;
+  *resReturn = res;
+  return TRUE;
+}
 
+
+/* traceScanFlipped -- scan a segment for the flipped traces it's grey for
+ *
+ * Pick set of traces to scan for, and scan for each separately,
+ * since they may be in different bands.  Scanning for one trace may
+ * make the segment grey again for another (for example, if it's a
+ * to-space segment), so repeat until it's not grey for any flipped
+ * trace.  <design/trace#.multi.barrier>
+ */
+
+static void traceScanFlipped(Arena arena, Seg seg)
+{
+  TraceSet traces;
+  Trace trace;
+  TraceId ti;
+  Res res;
+
+  AVER(SegRankSet(seg) != RankSetEMPTY);
+
+  traces = TraceSetInter(SegGrey(seg), arena->flippedTraces);
+  while (traces != TraceSetEMPTY) {
+    TRACE_SET_ITER(ti, trace, traces, arena)
+      if (TraceSetIsMember(SegGrey(seg), trace)) {
+        Rank rank = TraceRankForAccess(trace, seg);
+        res = traceScanSeg(TraceSetSingle(trace), rank, arena, seg);
+
+        /* Allocation failures should be handled my emergency mode, */
+        /* and we don't expect any other kind of failure in a normal */
+        /* GC that causes access faults. */
+        AVER(res == ResOK);
+      }
+    TRACE_SET_ITER_END(ti, trace, traces, arena);
+    traces = TraceSetInter(SegGrey(seg), arena->flippedTraces);
+  }
+
+  /* The pool should've done the job of removing the greyness that */
+  /* was causing the segment to be protected, so that the mutator */
+  /* can go ahead and access it. */
+  AVER(TraceSetInter(SegGrey(seg), arena->flippedTraces) == TraceSetEMPTY);
+}
+
+
+/* TraceNoteHotGrey -- note that a hot segment has become grey
+ *
+ * Called when the read barrier is raised on a hot segment.  The
+ * segment is scanned eagerly by traceScanHot, before the mutator can
+ * hit the barrier again.  If there's no room to note it, the mutator
+ * may hit the barrier, which is safe.  Segments are noted by base
+ * address, because they might be freed before they're scanned.
+ * <design/write-barrier#.hot.read>
+ */
+
+void TraceNoteHotGrey(Arena arena, Seg seg)
+{
+  AVERT(Arena, arena);
+  AVERT(Seg, seg);
+
+  if (arena->hotGreyCount < ArenaHotGreyLENGTH) {
+    arena->hotGrey[arena->hotGreyCount] = SegBase(seg);
+    ++arena->hotGreyCount;
+  }
+}
+
+
+/* traceScanHot -- eagerly scan the hot segments that have become grey
+ *
+ * <design/write-barrier#.hot.read>
+ */
+
+static void traceScanHot(Arena arena)
+{
+  while (arena->hotGreyCount > 0) {
+    Seg seg;
+    Addr base;
+    --arena->hotGreyCount;
+    base = arena->hotGrey[arena->hotGreyCount];
+    if (SegOfAddr(&seg, arena, base) && SegBase(seg) == base
+        && TraceSetInter(SegGrey(seg), arena->flippedTraces) != TraceSetEMPTY)
+    {
+      STATISTIC(++arena->hotScanCount);
+      traceScanFlipped(arena, seg);
+    }
+  }
+}
+
+
+/* traceSegAccessCount -- count a barrier hit on a segment
+ *
+ * Counts the hits on seg since the last flip.  See
+ * <design/write-barrier#.hot>.
+ */
+
+static void traceSegAccessCount(Arena arena, Seg seg)
+{
+  if (seg->accessSerial != arena->flipSerial) {
+    seg->accessSerial = arena->flipSerial;
+    seg->accessCount = 0;
+  }
+  if (seg->accessCount < SEG_ACCESS_HOT) {
+    ++seg->accessCount;
     STATISTIC({
-      Trace trace;
-      TraceId ti;
-      TRACE_SET_ITER(ti, trace, traces, arena)
-        ++trace->readBarrierHitCount;
-      TRACE_SET_ITER_END(ti, trace, traces, arena);
+      if (seg->accessCount == SEG_ACCESS_HOT)
+        ++arena->hotSegCount;
     });
   }
+}
+
+
+/* traceScanPageRes -- scan the objects on a page of a segment
+ *
+ * Scans the objects in seg that overlap the page containing addr, and
+ * returns the extent of the objects scanned.  See traceScanSegRes.
+ */
+
+static Res traceScanPageRes(Addr *baseReturn, Addr *limitReturn,
+                            TraceSet ts, Rank rank, Arena arena,
+                            Seg seg, Addr addr)
+{
+  ScanStateStruct ssStruct;
+  ScanState ss = &ssStruct;
+  ZoneSet white;
+  Addr base, limit;
+  Res res;
+
+  white = traceSetWhiteUnion(ts, arena);
+  base = AddrAlignDown(addr, ArenaGrainSize(arena));
+  limit = AddrAdd(base, ArenaGrainSize(arena));
+
+  traceCardsClear(arena, seg);
+  ScanStateInitSeg(ss, ts, arena, rank, white, seg);
+
+  ShieldExpose(arena, seg);
+  res = SegScanArea(&base, &limit, seg, ss);
+  ShieldCover(arena, seg);
+
+  if (res == ResUNIMPL) {
+    ScanStateFinish(ss);
+    return res;
+  }
+
+  /* The scan wasn't total, so the segment stays grey. */
+  traceScanSegDone(ts, arena, seg, ss, white, res, FALSE);
+  *baseReturn = base;
+  *limitReturn = limit;
+  return res;
+}
+
+
+/* traceScanPage -- scan the page of a segment that the mutator read
+ *
+ * Scans the objects that overlap the page containing addr, for the
+ * flipped trace for which seg is grey, and lowers the read barrier on
+ * the pages that they cover.  The rest of the segment stays grey and
+ * protected.  Returns FALSE if the segment must be scanned whole.
+ * <design/write-barrier#.page>
+ */
+
+static Bool traceScanPage(Arena arena, Seg seg, Addr addr)
+{
+  TraceSet ts;
+  Trace trace;
+  TraceId ti;
+  Rank rank = RankEXACT;
+  Size grainSize;
+  Buffer buffer;
+  Addr base, limit;
+  Res res;
+
+  grainSize = ArenaGrainSize(arena);
+  if (SegSize(seg) < SEG_PAGE_SCAN_GRAINS * grainSize
+      || SegIsHot(seg)                  /* <design/write-barrier#.page.hot> */
+      || SegNailed(seg) != TraceSetEMPTY)
+    return FALSE;
+
+  /* The page must lie wholly outside the part of the buffer that
+     can't be scanned. <design/write-barrier#.page.buffer> */
+  if (SegBuffer(&buffer, seg)) {
+    base = AddrAlignDown(addr, grainSize);
+    limit = AddrAdd(base, grainSize);
+    if (limit > AddrAlignDown(BufferScanLimit(buffer), grainSize)
+        && base < BufferLimit(buffer))
+      return FALSE;
+  }
+
+  /* <design/write-barrier#.page.trace> */
+  ts = TraceSetInter(SegGrey(seg), arena->flippedTraces);
+  if (!TraceSetIsSingle(ts))
+    return FALSE;
+  TRACE_SET_ITER(ti, trace, ts, arena)
+    rank = TraceRankForAccess(trace, seg);
+  TRACE_SET_ITER_END(ti, trace, ts, arena);
+  if (rank != RankEXACT || SegRankSet(seg) != RankSetSingle(RankEXACT))
+    return FALSE;
+
+  /* A segment that doesn't refer to the white set is blackened
+     without scanning, so leave it to traceScanSeg. */
+  if (ZoneSetInter(traceSetWhiteUnion(ts, arena), SegSummary(seg))
+      == ZoneSetEMPTY)
+    return FALSE;
+
+  res = traceScanPageRes(&base, &limit, ts, rank, arena, seg, addr);
+  if (ResIsAllocFailure(res)) {
+    ArenaSetEmergency(arena, TRUE);
+    res = traceScanPageRes(&base, &limit, ts, rank, arena, seg, addr);
+    /* Should be OK in emergency mode. */
+    AVER(!ResIsAllocFailure(res));
+  }
+  if (res == ResUNIMPL)
+    return FALSE;
+  AVER(res == ResOK);
+
+  /* Lower the barrier on the pages that hold no unscanned objects.
+     These include the page containing addr. */
+  base = AddrAlignUp(base, grainSize);
+  limit = AddrAlignDown(limit, grainSize);
+  AVER(base <= addr);
+  AVER(addr < limit);
+  ShieldLowerRange(arena, seg, base, limit, AccessREAD);
+  STATISTIC(++arena->pageScanCount);
+  return TRUE;
+}
+
+
+/* traceSegAccess -- handle barrier hit on a segment
+ *
+ * If addr is not NULL, it's the address that the mutator accessed,
+ * and a read barrier hit may be handled by scanning just the page it
+ * is on.
+ */
+
+static void traceSegAccess(Arena arena, Seg seg, Addr addr, AccessSet mode)
+{
+  AccessSet shieldHit;
+  Bool readHit, writeHit;
+  Bool pageScanned = FALSE;
+
+  AVERT(Arena, arena);
+  AVERT(Seg, seg);
+  AVERT(AccessSet, mode);
+
+  shieldHit = BS_INTER(mode, SegSM(seg));
+  readHit = BS_INTER(shieldHit, AccessREAD) != AccessSetEMPTY;
+  writeHit = BS_INTER(shieldHit, AccessWRITE) != AccessSetEMPTY;
+
+  /* If it's a read access, then the segment must be grey for a trace */
+  /* which is flipped. */
+  AVER(!readHit ||
+       TraceSetInter(SegGrey(seg), arena->flippedTraces) != TraceSetEMPTY);
+
+  /* If it's a write access, then the segment must have a summary that */
+  /* is smaller than the mutator's summary (which is assumed to be */
+  /* RefSetUNIV). */
+  AVER(!writeHit || SegSummary(seg) != RefSetUNIV);
+
+  EVENT3(TraceAccess, arena, seg, mode);
+
+  /* Hot segment policy -- see <design/write-barrier#.hot>. */
+  traceSegAccessCount(arena, seg);
+
+  /* Write barrier deferral -- see <design/write-barrier#.deferral>. */
+  if (writeHit)
+    seg->defer = WB_DEFER_HIT;
+
+  if (readHit) {
+    Trace trace;
+    TraceId ti;
+    TraceSet traces = TraceSetInter(SegGrey(seg), arena->flippedTraces);
+
+    TRACE_SET_ITER(ti, trace, traces, arena)
+      STATISTIC(++trace->readBarrierHitCount);
+    TRACE_SET_ITER_END(ti, trace, traces, arena);
+    if (addr != NULL && !writeHit)
+      pageScanned = traceScanPage(arena, seg, addr);
+    if (!pageScanned)
+      traceScanFlipped(arena, seg);
+  }
 
   /* The write barrier handling must come after the read barrier, */
   /* because the latter may set the summary and raise the write barrier. */
   if (writeHit)
     SegSetSummary(seg, RefSetUNIV);
 
-  /* The segment must now be accessible. */
-  AVER(BS_INTER(mode, SegSM(seg)) == AccessSetEMPTY);
+  /* The segment must now be accessible, or at least the page that
+     was accessed, if that was scanned alone. */
+  AVER(pageScanned || BS_INTER(mode, SegSM(seg)) == AccessSetEMPTY);
+
+  /* Scanning may have made hot segments grey.  Scanning them may in
+     turn make seg grey again, if it's white, and raise its barrier:
+     the mutator then just hits it again. */
+  traceScanHot(arena);
+}
+
+
+/* TraceSegAccess -- handle barrier hit on a segment */
+
+void TraceSegAccess(Arena arena, Seg seg, AccessSet mode)
+{
+  traceSegAccess(arena, seg, NULL, mode);
+}
+
+
+/* TraceSegPageAccess -- handle barrier hit on a page of a segment
+ *
+ * Like TraceSegAccess, but a read barrier hit on a large segment may
+ * be handled by scanning only the page that the mutator accessed.
+ * <design/write-barrier#.page>
+ */
+
+void TraceSegPageAccess(Arena arena, Seg seg, Addr addr, AccessSet mode)
+{
+  AVER(addr != NULL);
+  traceSegAccess(arena, seg, addr, mode);
 }
 
 
@@ -1369,6 +2398,7 @@ mps_res_t _mps_fix2(mps_ss_t mps_ss, mps_addr_t *mps_ref_io)
   Index i;
   Tract tract;
   Seg seg;
+  Bool white;
   Res res;
 
   /* Special AVER macros are used on the critical path. */
@@ -1378,6 +2408,12 @@ mps_res_t _mps_fix2(mps_ss_t mps_ss, mps_addr_t *mps_ref_io)
 
   ref = (Ref)*mps_ref_io;
 
+  /* Fixes by collector worker threads are serialized by a single
+     lock, so parallel scanning is only a prototype.
+     <design/trace#.parallel.fix.serial> */
+  if (ss->fixLock != NULL)
+    LockClaim(ss->fixLock);
+
   /* The zone test should already have been passed by MPS_FIX1 in mps.h. */
   AVER_CRITICAL(ZoneSetInter(ScanStateWhite(ss),
                              ZoneSetAddAddr(ss->arena, ZoneSetEMPTY, ref)) !=
@@ -1386,16 +2422,34 @@ mps_res_t _mps_fix2(mps_ss_t mps_ss, mps_addr_t *mps_ref_io)
   STATISTIC(++ss->fixRefCount);
   EVENT_CRITICAL4(TraceFix, ss, mps_ref_io, ref, ss->rank);
 
+  /* Consult the cache of recently fixed segments before looking up
+     the reference in the chunk tree and page table.
+     <design/trace#.fix.cache> */
+  if (ss->segCacheSerial == ss->arena->segCacheSerial) {
+    for (i = 0; i < ScanStateSegCacheSIZE; ++i) {
+      ScanStateSegCacheStruct *entry = &ss->segCache[i];
+      if (entry->base <= (Addr)ref && (Addr)ref < entry->limit) {
+        STATISTIC(++ss->segCacheHitCount);
+        seg = entry->seg;
+        white = entry->white;
+        goto found;
+      }
+    }
+  } else {
+    /* <design/trace#.fix.cache.invalid> */
+    for (i = 0; i < ScanStateSegCacheSIZE; ++i)
+      ss->segCache[i].base = ss->segCache[i].limit = (Addr)0;
+    ss->segCacheSerial = ss->arena->segCacheSerial;
+  }
+
   /* This sequence of tests is equivalent to calling TractOfAddr(),
    * but inlined so that we can distinguish between "not pointing to
    * chunk" and "pointing to chunk but not to tract" so that we can
    * check the rank in the latter case. See
    * <design/trace#.fix.tractofaddr.inline>
    *
-   * If compilers fail to do a good job of inlining ChunkOfAddr and
-   * TreeFind then it may become necessary to inline at least the
-   * comparison against the root of the tree. See
-   * <https://info.ravenbrook.com/mail/2014/06/11/13-32-08/0/>
+   * ChunkOfAddr looks up the chunk map, which takes constant time
+   * however many chunks the arena has. See <design/arena#.chunk.map>.
    */
   if (!ChunkOfAddr(&chunk, ss->arena, ref))
     /* Reference points outside MPS-managed address space: ignore. */
@@ -1417,7 +2471,18 @@ mps_res_t _mps_fix2(mps_ss_t mps_ss, mps_addr_t *mps_ref_io)
 
   /* See <walk.c#roots-walk.second-stage> for where we arrange to fool
      this test when walking references in the roots. */
-  if (TraceSetInter(SegWhite(seg), ss->traces) == TraceSetEMPTY) {
+  white = TraceSetInter(SegWhite(seg), ss->traces) != TraceSetEMPTY;
+  {
+    ScanStateSegCacheStruct *entry = &ss->segCache[ss->segCacheNext];
+    entry->base = SegBase(seg);
+    entry->limit = SegLimit(seg);
+    entry->seg = seg;
+    entry->white = white;
+    ss->segCacheNext = (ss->segCacheNext + 1) % ScanStateSegCacheSIZE;
+  }
+
+found:
+  if (!white) {
     /* Reference points to a segment that is not white for any of the
      * active traces. <design/trace#.fix.tractofaddr> */
     STATISTIC({
@@ -1430,6 +2495,34 @@ mps_res_t _mps_fix2(mps_ss_t mps_ss, mps_addr_t *mps_ref_io)
   STATISTIC(++ss->segRefCount);
   STATISTIC(++ss->whiteSegRefCount);
   EVENT_CRITICAL1(TraceFixSeg, seg);
+
+  /* Handle references to objects that have already been preserved
+     without calling the fix method.  <design/trace#.fix.fast> */
+  if (ss->fix == SegFix && ss->rank != RankAMBIG) {
+    switch (SegFixFast(seg)) {
+    case SegFixFastMARK: {
+      Pool pool = SegPool(seg);
+      Addr base = AddrSub((Addr)ref, pool->format->headerSize);
+      if (BTGet(SegFixMarks(seg), PoolIndexOfAddr(SegBase(seg), pool, base)))
+        goto done;
+      break;
+    }
+    case SegFixFastSNAP:
+      if (ss->snapCache != NULL) {
+        TraceSnapCache snap = ScanStateSnapCache(ss, ref);
+        if (snap->from == ref) {
+          STATISTIC(++ss->snapCount);
+          STATISTIC(++ss->snapCacheHitCount);
+          ref = snap->to;
+          goto done;
+        }
+      }
+      break;
+    default:
+      break;
+    }
+  }
+
   res = (*ss->fix)(seg, ss, &ref);
   if (res != ResOK) {
     /* SegFixEmergency must not fail. */
@@ -1442,7 +2535,7 @@ mps_res_t _mps_fix2(mps_ss_t mps_ss, mps_addr_t *mps_ref_io)
      *    updating ss->fixedSummary.  RHSK 2007-03-21.
      */
     AVER_CRITICAL(ref == (Ref)*mps_ref_io);
-    return res;
+    goto release;
   }
 
 done:
@@ -1450,7 +2543,12 @@ done:
   ss->fixedSummary = RefSetAdd(ss->arena, ss->fixedSummary, ref);
 
   *mps_ref_io = (mps_addr_t)ref;
-  return ResOK;
+  res = ResOK;
+
+release:
+  if (ss->fixLock != NULL)
+    LockRelease(ss->fixLock);
+  return res;
 }
 
 
@@ -1463,6 +2561,8 @@ static Res traceScanSingleRefRes(TraceSet ts, Rank rank, Arena arena,
   ZoneSet white;
   Res res;
   ScanStateStruct ss;
+  Size alias;
+  Ref *aliasIO;
 
   EVENT4(TraceScanSingleRef, ts, rank, arena, refIO);
 
@@ -1472,17 +2572,22 @@ static Res traceScanSingleRefRes(TraceSet ts, Rank rank, Arena arena,
   }
 
   ScanStateInit(&ss, ts, arena, rank, white);
-  ShieldExpose(arena, seg);
+  /* The MPS reads and writes the reference itself, so it can use the
+     collector alias <design/shield#.alias>. */
+  alias = ShieldExposeAlias(arena, seg);
+  aliasIO = (Ref *)AddrAlias(refIO, alias);
 
   TRACE_SCAN_BEGIN(&ss) {
-    res = TRACE_FIX12(&ss, refIO);
+    res = TRACE_FIX12(&ss, aliasIO);
   } TRACE_SCAN_END(&ss);
   ss.scannedSize = sizeof *refIO;
 
   summary = SegSummary(seg);
-  summary = RefSetAdd(arena, summary, *refIO);
+  summary = RefSetAdd(arena, summary, *aliasIO);
   SegSetSummary(seg, summary);
-  ShieldCover(arena, seg);
+  if (ArenaCardMarking(arena))
+    SegCardsAdd(seg, (Addr)refIO, *aliasIO);
+  ShieldCoverAlias(arena, seg, alias);
 
   traceSetUpdateCounts(ts, arena, &ss, traceAccountingPhaseSingleScan);
   ScanStateFinish(&ss);
@@ -1534,6 +2639,12 @@ Res TraceScanFormat(ScanState ss, Addr base, Addr limit)
   /* scannedSize is accumulated whether or not ss->formatScan
    * succeeds, so it's safe to accumulate now so that we can tail-call
    * ss->formatScan. */
+  /* With card marking, skip the parts of the segment whose card
+     summaries show they can't refer to the white set.
+     <design/write-barrier#.card.summary.scan> */
+  if (ss->cardSeg != NULL)
+    return ScanStateCardsScan(ss, base, limit);
+
   ss->scannedSize += AddrOffset(base, limit);
 
   return ss->formatScan(&ss->ss_s, base, limit);
@@ -1545,7 +2656,9 @@ Res TraceScanFormat(ScanState ss, Addr base, Addr limit)
  * This is a wrapper for area scanning functions, which should not
  * otherwise be called directly from within the MPS.  This function
  * checks arguments and takes care of accounting for the scanned
- * memory.
+ * memory.  Ambiguous areas are scanned by AmbigScanArea, which
+ * filters out words that can't refer to white objects before fixing.
+ * <design/trace#.scan.ambig>
  */
 Res TraceScanArea(ScanState ss, Word *base, Word *limit,
                   mps_area_scan_t scan_area,
@@ -1563,6 +2676,8 @@ Res TraceScanArea(ScanState ss, Word *base, Word *limit,
      scan_area. */
   ss->scannedSize += AddrOffset(base, limit);
 
+  if (ss->rank == RankAMBIG)
+    return AmbigScanArea(ss, base, limit, scan_area, closure);
   return scan_area(&ss->ss_s, base, limit, closure);
 }
 
@@ -1679,6 +2794,9 @@ Res TraceStart(Trace trace, double mortality, double finishingTime)
      * of polls, plus one to ensure it's not zero. */
     trace->quantumWork
       = (trace->foundation + sSurvivors) / (unsigned long)nPolls + 1;
+    /* Reclaim the condemned set in as many polls, so that reclaim
+     * keeps pace with allocation.  <design/trace#.reclaim.lazy.quantum> */
+    trace->reclaimQuantum = trace->condemned / (unsigned long)nPolls + 1;
   }
 
   /* TODO: compute rate of scanning here. */
@@ -1725,10 +2843,14 @@ void TraceAdvance(Trace trace)
 
     if (traceFindGrey(&seg, &rank, arena, trace->ti)) {
       Res res;
-      res = traceScanSeg(TraceSetSingle(trace), rank, arena, seg);
+      if (arena->traceWork == NULL
+          || !traceScanBatch(&res, trace, rank, seg))
+        res = traceScanSeg(TraceSetSingle(trace), rank, arena, seg);
       /* Allocation failures should be handled by emergency mode, and we
        * don't expect any other error in a normal GC trace. */
       AVER(res == ResOK);
+      /* <design/write-barrier#.hot.read> */
+      traceScanHot(arena);
     } else {
       trace->state = TraceRECLAIM;
     }
@@ -1811,10 +2933,77 @@ failCondemn:
 }
 
 
+/* tracePollTrace -- advance a trace by one quantum
+ *
+ * Return the work done, and destroy the trace if it has finished.
+ * Once a trace has finished scanning, each poll reclaims a quantum of
+ * segments, measured by their size. <design/trace#.reclaim.lazy.quantum>
+ */
+
+static Work tracePollTrace(Trace trace)
+{
+  Work oldWork, newWork, endWork;
+  Size oldReclaim, endReclaim;
+
+  oldWork = traceWork(trace);
+  endWork = oldWork + trace->quantumWork;
+  oldReclaim = trace->reclaimWork;
+  endReclaim = oldReclaim + trace->reclaimQuantum;
+  do {
+    TraceAdvance(trace);
+  } while ((trace->state == TraceFLIPPED && traceWork(trace) < endWork)
+           || (trace->state == TraceRECLAIM
+               && trace->reclaimWork < endReclaim));
+  newWork = traceWork(trace) + (Work)(trace->reclaimWork - oldReclaim);
+  AVER(newWork >= oldWork);
+  if (trace->state == TraceFINISHED)
+    TraceDestroyFinished(trace);
+  return newWork - oldWork;
+}
+
+
+/* TracePollStart -- start a trace if one is due
+ *
+ * Consider starting a trace if none is running, or a collection of a
+ * chain if there is room for another trace.  Return TRUE if a trace
+ * was started.  <design/trace#.multi.policy>
+ *
+ * The collectWorldReturn and collectWorldAllowed arguments are as for
+ * PolicyStartTrace.
+ */
+
+Bool TracePollStart(Bool *collectWorldReturn, Globals globals,
+                    Bool collectWorldAllowed)
+{
+  Trace trace;
+  Arena arena;
+
+  AVERT(Globals, globals);
+  arena = GlobalsArena(globals);
+
+  if (arena->busyTraces == TraceSetEMPTY) {
+    /* No traces are running: consider starting one now. */
+    return PolicyStartTrace(&trace, collectWorldReturn, arena,
+                            collectWorldAllowed);
+  } else if (arena->busyTraces != TraceSetUNIV && !traceReclaiming(arena)) {
+    /* Traces are running but there's room for another: consider */
+    /* collecting a chain that is over capacity, for example the */
+    /* nursery during a long collection of older generations.  Not */
+    /* while a trace is reclaiming, as TraceCreate would have to */
+    /* finish reclaiming it at once.  <design/trace#.reclaim.lazy.create> */
+    return PolicyStartTrace(&trace, collectWorldReturn, arena, FALSE);
+  }
+  return FALSE;
+}
+
+
 /* TracePoll -- Check if there's any tracing work to be done
  *
- * Consider starting a trace if none is running; advance the running
- * trace (if any) by one quantum.
+ * If startAllowed, consider starting a trace (see TracePollStart);
+ * then advance each running trace by one quantum.  The collector
+ * thread doesn't start traces, because starting a trace flips, and
+ * the thread may have interrupted the mutator anywhere.
+ * <design/arena#.poll.background.start>
  *
  * The collectWorldReturn and collectWorldAllowed arguments are as for
  * PolicyStartTrace.
@@ -1824,35 +3013,27 @@ failCondemn:
  */
 
 Bool TracePoll(Work *workReturn, Bool *collectWorldReturn, Globals globals,
-               Bool collectWorldAllowed)
+               Bool collectWorldAllowed, Bool startAllowed)
 {
   Trace trace;
   Arena arena;
-  Work oldWork, newWork, work, endWork;
+  TraceId ti;
+  TraceSet busy;
+  Work work = 0;
 
   AVERT(Globals, globals);
+  AVERT(Bool, startAllowed);
   arena = GlobalsArena(globals);
 
-  if (arena->busyTraces != TraceSetEMPTY) {
-    trace = ArenaTrace(arena, (TraceId)0);
-  } else {
-    /* No traces are running: consider starting one now. */
-    if (!PolicyStartTrace(&trace, collectWorldReturn, arena,
-                          collectWorldAllowed))
-      return FALSE;
-  }
+  if (startAllowed)
+    (void)TracePollStart(collectWorldReturn, globals, collectWorldAllowed);
 
-  AVER(arena->busyTraces == TraceSetSingle(trace));
-  oldWork = traceWork(trace);
-  endWork = oldWork + trace->quantumWork;
-  do {
-    TraceAdvance(trace);
-  } while (trace->state != TraceFINISHED && traceWork(trace) < endWork);
-  newWork = traceWork(trace);
-  AVER(newWork >= oldWork);
-  work = newWork - oldWork;
-  if (trace->state == TraceFINISHED)
-    TraceDestroyFinished(trace);
+  busy = arena->busyTraces;
+  if (busy == TraceSetEMPTY)
+    return FALSE;
+  TRACE_SET_ITER(ti, trace, busy, arena)
+    work += tracePollTrace(trace);
+  TRACE_SET_ITER_END(ti, trace, busy, arena);
   *workReturn = work;
   return TRUE;
 }
@@ -1893,12 +3074,16 @@ Res TraceDescribe(Trace trace, mps_lib_FILE *stream, Count depth)
                "  notCondemned $U\n", (WriteFU)trace->notCondemned,
                "  foundation $U\n", (WriteFU)trace->foundation,
                "  quantumWork $U\n", (WriteFU)trace->quantumWork,
+               "  reclaimQuantum $U\n", (WriteFU)trace->reclaimQuantum,
+               "  reclaimWork $U\n", (WriteFU)trace->reclaimWork,
                "  rootScanSize $U\n", (WriteFU)trace->rootScanSize,
                STATISTIC_WRITE("  rootCopiedSize $U\n",
                                (WriteFU)trace->rootCopiedSize)
                "  segScanSize $U\n", (WriteFU)trace->segScanSize,
                STATISTIC_WRITE("  segCopiedSize $U\n",
                                (WriteFU)trace->segCopiedSize)
+               STATISTIC_WRITE("  cardSkipSize $U\n",
+                               (WriteFU)trace->cardSkipSize)
                "  forwardedSize $U\n", (WriteFU)trace->forwardedSize,
                "  preservedInPlaceSize $U\n", (WriteFU)trace->preservedInPlaceSize,
                NULL);
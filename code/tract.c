@@ -155,6 +155,17 @@ Bool ChunkCheck(Chunk chunk)
   CHECKL(INDEX_OF_ADDR(chunk, AddrSub(chunk->limit, 1)) < chunk->pages);
   CHECKL(chunk->pageTablePages < chunk->pages);
 
+  /* The card table is in the chunk overhead too, if there is one. */
+  CHECKL((chunk->cardTable != NULL) == ArenaCardMarking(chunk->arena));
+  if (chunk->cardTable != NULL) {
+    CHECKL((Addr)chunk->cardTable >= chunk->base);
+    CHECKL(AddrAdd((Addr)chunk->cardTable, ChunkCards(chunk))
+           <= (Addr)chunk->pageTable);
+    CHECKL((Addr)chunk->cardSummary >= chunk->base);
+    CHECKL((Addr)&chunk->cardSummary[ChunkCards(chunk)]
+           <= (Addr)chunk->pageTable);
+  }
+
   /* Could check the consistency of the tables, but not O(1). */
   return TRUE;
 }
@@ -190,6 +201,7 @@ Res ChunkInit(Chunk chunk, Arena arena, Addr base, Addr limit, Size reserved,
   chunk->base = base;
   chunk->limit = limit;
   chunk->reserved = reserved;
+  chunk->alias = 0;
   size = ChunkSize(chunk);
 
   /* .overhead.pages: Chunk overhead for the page allocation table. */
@@ -199,6 +211,25 @@ Res ChunkInit(Chunk chunk, Arena arena, Addr base, Addr limit, Size reserved,
     goto failAllocTable;
   chunk->allocTable = p;
 
+  /* .overhead.cards: Chunk overhead for the card table, if the arena
+     has card marking.  <design/write-barrier#.card.table> */
+  chunk->cardTable = NULL;
+  chunk->cardSummary = NULL;
+  if (ArenaCardMarking(arena)) {
+    res = BootAlloc(&p, boot, (size_t)(size >> ArenaCardShift(arena)),
+                    MPS_PF_ALIGN);
+    if (res != ResOK)
+      goto failCardTable;
+    chunk->cardTable = p;
+    /* .overhead.card-summary: and for the card summaries.
+       <design/write-barrier#.card.summary> */
+    res = BootAlloc(&p, boot, (size_t)(size >> ArenaCardShift(arena))
+                    * sizeof(RefSet), MPS_PF_ALIGN);
+    if (res != ResOK)
+      goto failCardTable;
+    chunk->cardSummary = p;
+  }
+
   pageTableSize = SizeAlignUp(pages * sizeof(PageUnion), chunk->pageSize);
   chunk->pageTablePages = pageTableSize >> pageShift;
 
@@ -215,6 +246,13 @@ Res ChunkInit(Chunk chunk, Arena arena, Addr base, Addr limit, Size reserved,
 
   /* Init allocTable after class init, because it might be mapped there. */
   BTResRange(chunk->allocTable, 0, pages);
+  if (chunk->cardTable != NULL) {
+    Index i;
+    (void)mps_lib_memset(chunk->cardTable, CardCLEAN,
+                         (size_t)ChunkCards(chunk));
+    for (i = 0; i < ChunkCards(chunk); ++i)
+      chunk->cardSummary[i] = RefSetUNIV;
+  }
 
   /* Check that there is some usable address space remaining in the chunk. */
   allocBase = PageIndexBase(chunk, chunk->allocBase);
@@ -242,6 +280,7 @@ failLandInsert:
   /* .no-clean: No clean-ups needed past this point for boot, as we will
      discard the chunk. */
 failClassInit:
+failCardTable:
 failAllocTable:
   return res;
 }
@@ -321,17 +360,39 @@ TreeKey ChunkKey(Tree tree)
 
 Bool ChunkOfAddr(Chunk *chunkReturn, Arena arena, Addr addr)
 {
+  Word i;
+  ChunkMapEntryStruct *entry;
+  Chunk chunk;
   Tree tree;
 
   AVER_CRITICAL(chunkReturn != NULL);
   AVERT_CRITICAL(Arena, arena);
   /* addr is arbitrary */
 
+  /* Look up the address in the chunk map.  If addr is below
+     chunkMapBase the subtraction wraps, giving an index out of range.
+     <design/arena#.chunk.map.lookup> */
+  i = ((Word)addr - (Word)arena->chunkMapBase) >> arena->chunkMapShift;
+  if (i >= arena->chunkMapCount)
+    return FALSE;
+  entry = &arena->chunkMap[i];
+  chunk = entry->hi;
+  if (chunk == NULL || addr < chunk->base)
+    chunk = entry->lo;
+  if (chunk != NULL && chunk->base <= addr && addr < chunk->limit) {
+    *chunkReturn = chunk;
+    return TRUE;
+  }
+  if (!entry->ambiguous)
+    return FALSE;
+
+  /* More than two chunks overlap this map entry, so search the tree.
+     <design/arena#.chunk.map.ambiguous> */
   if (TreeFind(&tree, ArenaChunkTree(arena), TreeKeyOfAddrVar(addr),
                ChunkCompare)
       == CompareEQUAL)
   {
-    Chunk chunk = ChunkOfTree(tree);
+    chunk = ChunkOfTree(tree);
     AVER_CRITICAL(chunk->base <= addr);
     AVER_CRITICAL(addr < chunk->limit);
     *chunkReturn = chunk;
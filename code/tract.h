@@ -100,12 +100,19 @@ typedef struct ChunkStruct {
   Size reserved;        /* reserved address space for chunk (including overhead
                            such as losses due to alignment): must not change
                            (or arena reserved calculation will break) */
+  Size alias;           /* offset of collector alias, or 0 <design/vm#.alias> */
+  Byte *cardTable;      /* card table, or NULL <design/write-barrier#.card.table> */
+  RefSet *cardSummary;  /* card summaries, or NULL <design/write-barrier#.card.summary> */
 } ChunkStruct;
 
 
 #define ChunkArena(chunk) RVALUE((chunk)->arena)
 #define ChunkSize(chunk) AddrOffset((chunk)->base, (chunk)->limit)
 #define ChunkPageSize(chunk) RVALUE((chunk)->pageSize)
+#define ChunkAlias(chunk) RVALUE((chunk)->alias)
+#define ChunkCardTable(chunk) RVALUE((chunk)->cardTable)
+#define ChunkCards(chunk) \
+  ((Count)(ChunkSize(chunk) >> ArenaCardShift(ChunkArena(chunk))))
 #define ChunkPageShift(chunk) RVALUE((chunk)->pageShift)
 #define ChunkPagesToSize(chunk, pages) ((Size)(pages) << (chunk)->pageShift)
 #define ChunkSizeToPages(chunk, size) ((Count)((size) >> (chunk)->pageShift))
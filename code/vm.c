@@ -26,6 +26,10 @@ Bool VMCheck(VM vm)
   CHECKL(vm->block != NULL);
   CHECKL((Addr)vm->block <= vm->base);
   CHECKL(vm->mapped <= vm->reserved);
+  CHECKL(AddrIsAligned((Addr)vm->alias, vm->pageSize));
+  CHECKL(vm->alias == 0 || vm->fd >= 0);
+  CHECKL(BoolCheck(vm->uffd));
+  CHECKL(!vm->uffd || vm->alias == 0);
   return TRUE;
 }
 
@@ -80,6 +84,19 @@ Size (VMMapped)(VM vm)
 }
 
 
+/* VMAlias -- return the offset of the collector alias
+ *
+ * <design/vm#.alias>
+ */
+
+Size (VMAlias)(VM vm)
+{
+  AVERT(VM, vm);
+
+  return VMAlias(vm);
+}
+
+
 /* VMCopy -- copy VM descriptor */
 
 void VMCopy(VM dest, VM src)
@@ -26,6 +26,9 @@ typedef struct VMStruct {
   Addr base, limit;             /* aligned boundaries of reserved space */
   Size reserved;                /* total reserved address space */
   Size mapped;                  /* total mapped memory */
+  Size alias;                   /* offset of collector alias, or 0 */
+  int fd;                       /* file backing the alias, or -1 */
+  Bool uffd;                    /* mapped ranges registered with userfaultfd */
 } VMStruct;
 
 
@@ -34,6 +37,7 @@ typedef struct VMStruct {
 #define VMLimit(vm) RVALUE((vm)->limit)
 #define VMReserved(vm) RVALUE((vm)->reserved)
 #define VMMapped(vm) RVALUE((vm)->mapped)
+#define VMAlias(vm) RVALUE((vm)->alias)
 
 extern Size PageSize(void);
 extern Size (VMPageSize)(VM vm);
@@ -47,6 +51,7 @@ extern Res VMMap(VM vm, Addr base, Addr limit);
 extern void VMUnmap(VM vm, Addr base, Addr limit);
 extern Size (VMReserved)(VM vm);
 extern Size (VMMapped)(VM vm);
+extern Size (VMAlias)(VM vm);
 extern void VMCopy(VM dest, VM src);
 
 
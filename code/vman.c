@@ -71,6 +71,9 @@ Res VMInit(VM vm, Size size, Size grainSize, void *params)
   AVER(vm->limit < AddrAdd((Addr)vm->block, reserved));
   vm->reserved = reserved;
   vm->mapped = (Size)0;
+  vm->alias = 0;
+  vm->fd = -1;
+  vm->uffd = FALSE;
 
   vm->sig = VMSig;
   AVERT(VM, vm);
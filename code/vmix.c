@@ -36,6 +36,20 @@
  * .remap: Possibly this should use mremap to reduce the number of
  * distinct mappings.  According to our current testing, it doesn't
  * seem to be a problem.
+ *
+ * .alias: If MPS_KEY_VMIX_ALIAS is true, the reserved space is backed
+ * by an anonymous file from memfd_create(2), and every mapped page is
+ * mapped twice with MAP_SHARED: once at its address, where the shield
+ * sets protection, and once in a second reservation that is always
+ * readable and writable, for the collector.  See <design/vm#.alias>.
+ * memfd_create(2) is specific to Linux, so elsewhere the key has no
+ * effect.  If the file or the second reservation can't be created, the
+ * VM silently goes without the alias.
+ *
+ * .uffd: If MPS_KEY_VMIX_UFFD is true, every mapped range is registered
+ * with userfaultfd(2) so that the write barrier can be set without
+ * mprotect(2).  See <design/protix#.uffd>.  If the kernel lacks the
+ * features, or the alias is in use, the VM silently goes without.
  */
 
 #include "mpm.h"
@@ -46,15 +60,32 @@
 
 #include "vm.h"
 
+#if defined(MPS_OS_LI)
+#include "protli.h"
+#endif
+
 #include <errno.h> /* errno */
 #include <signal.h> /* sig_atomic_t */
 #include <sys/mman.h> /* see .feature.li in config.h */
 #include <sys/types.h> /* mmap, munmap */
-#include <unistd.h> /* sysconf, _SC_PAGESIZE */
+#include <unistd.h> /* close, ftruncate, sysconf, _SC_PAGESIZE */
 
 SRCID(vmix, "$Id$");
 
 
+/* See .alias. MFD_CLOEXEC is defined iff memfd_create is declared. */
+
+#if defined(MPS_OS_LI) && defined(MFD_CLOEXEC)
+#define VMIX_ALIAS
+#endif
+
+/* See .uffd. */
+
+#if defined(MPS_OS_LI)
+#define VMIX_UFFD
+#endif
+
+
 /* PageSize -- return operating system page size */
 
 Size PageSize(void)
@@ -72,21 +103,125 @@ Size PageSize(void)
 }
 
 
+typedef struct VMParamsStruct {
+  Bool alias;
+  Bool uffd;
+} VMParamsStruct, *VMParams;
+
+static const VMParamsStruct vmParamsDefaults = {
+  /* .alias = */ FALSE,
+  /* .uffd = */ FALSE,
+};
+
 Res VMParamFromArgs(void *params, size_t paramSize, ArgList args)
 {
+  VMParams vmParams;
+  ArgStruct arg;
   AVER(params != NULL);
   AVERT(ArgList, args);
+  AVER(paramSize >= sizeof(VMParamsStruct));
   UNUSED(paramSize);
+  vmParams = (VMParams)params;
+  (void)mps_lib_memcpy(vmParams, &vmParamsDefaults, sizeof(VMParamsStruct));
+  if (ArgPick(&arg, args, MPS_KEY_VMIX_ALIAS))
+    vmParams->alias = arg.val.b;
+  if (ArgPick(&arg, args, MPS_KEY_VMIX_UFFD))
+    vmParams->uffd = arg.val.b;
   return ResOK;
 }
 
 
+#if defined(VMIX_ALIAS)
+
+/* vmAliasCreate -- create the file and reserve the collector alias
+ *
+ * See .alias.
+ */
+
+static void vmAliasCreate(VM vm)
+{
+  Size size = AddrOffset(vm->base, vm->limit);
+  void *abase;
+  int fd, r;
+
+  fd = memfd_create("MPS", MFD_CLOEXEC);
+  if (fd < 0)
+    goto failCreate;
+  r = ftruncate(fd, (off_t)size);
+  if (r != 0)
+    goto failTruncate;
+  abase = mmap(0, size, PROT_NONE, MAP_ANON | MAP_PRIVATE, -1, 0);
+  if (abase == MAP_FAILED)
+    goto failReserve;
+
+  /* The offset may wrap: see AddrAlias. */
+  vm->alias = (Size)((Word)abase - (Word)vm->base);
+  vm->fd = fd;
+  AVER(vm->alias != 0);
+  return;
+
+failReserve:
+failTruncate:
+  r = close(fd);
+  AVER(r == 0);
+failCreate:
+  return;
+}
+
+
+/* vmAliasMap -- map a range into both views */
+
+static void *vmAliasMap(VM vm, Addr base, Size size)
+{
+  off_t offset = (off_t)AddrOffset(vm->base, base);
+  void *result, *addr;
+
+  /* Not vm_prot: a file mapping may not allow PROT_EXEC. */
+  result = mmap((void *)base, (size_t)size, PROT_READ | PROT_WRITE,
+                MAP_SHARED | MAP_FIXED, vm->fd, offset);
+  if (result == MAP_FAILED)
+    return result;
+  result = mmap((void *)AddrAlias(base, vm->alias), (size_t)size,
+                PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED,
+                vm->fd, offset);
+  if (result == MAP_FAILED) {
+    addr = mmap((void *)base, (size_t)size,
+                PROT_NONE, MAP_ANON | MAP_PRIVATE | MAP_FIXED, -1, 0);
+    AVER(addr == (void *)base);
+    errno = ENOMEM;
+    return MAP_FAILED;
+  }
+  return (void *)base;
+}
+
+
+/* vmAliasUnmap -- release a range and unmap it from the alias
+ *
+ * MADV_REMOVE frees the pages in the file, which munmap would not.
+ */
+
+static void vmAliasUnmap(VM vm, Addr base, Size size)
+{
+  void *addr;
+  int r;
+
+  r = madvise((void *)base, (size_t)size, MADV_REMOVE);
+  AVER(r == 0);
+  addr = mmap((void *)AddrAlias(base, vm->alias), (size_t)size,
+              PROT_NONE, MAP_ANON | MAP_PRIVATE | MAP_FIXED, -1, 0);
+  AVER(addr == (void *)AddrAlias(base, vm->alias));
+}
+
+#endif /* VMIX_ALIAS */
+
+
 /* VMInit -- reserve some virtual address space, and create a VM structure */
 
 Res VMInit(VM vm, Size size, Size grainSize, void *params)
 {
   Size pageSize, reserved;
   void *vbase;
+  VMParams vmParams = params;
 
   AVER(vm != NULL);
   AVERT(ArenaGrainSize, grainSize);
@@ -127,6 +262,21 @@ Res VMInit(VM vm, Size size, Size grainSize, void *params)
   AVER(vm->limit <= AddrAdd((Addr)vm->block, reserved));
   vm->reserved = reserved;
   vm->mapped = 0;
+  vm->alias = 0;
+  vm->fd = -1;
+  vm->uffd = FALSE;
+#if defined(VMIX_ALIAS)
+  if (vmParams->alias)
+    vmAliasCreate(vm);
+#endif
+#if defined(VMIX_UFFD)
+  /* Write protection of shared memory needs another feature; see .uffd. */
+  if (vmParams->uffd && vm->alias == 0)
+    vm->uffd = ProtUffdSetup();
+#endif
+#if !defined(VMIX_ALIAS) && !defined(VMIX_UFFD)
+  UNUSED(vmParams);
+#endif
 
   vm->sig = VMSig;
   AVERT(VM, vm);
@@ -155,6 +305,13 @@ void VMFinish(VM vm)
 
   r = munmap(vm->block, vm->reserved);
   AVER(r == 0);
+  if (vm->alias != 0) {
+    r = munmap((void *)AddrAlias(vm->base, vm->alias),
+               AddrOffset(vm->base, vm->limit));
+    AVER(r == 0);
+    r = close(vm->fd);
+    AVER(r == 0);
+  }
 }
 
 
@@ -183,6 +340,11 @@ Res VMMap(VM vm, Addr base, Addr limit)
 
   size = AddrOffset(base, limit);
 
+#if defined(VMIX_ALIAS)
+  if (vm->alias != 0)
+    result = vmAliasMap(vm, base, size);
+  else
+#endif
   result = mmap((void *)base, (size_t)size, (int)vm_prot,
                 MAP_ANON | MAP_PRIVATE | MAP_FIXED,
                 -1, 0);
@@ -203,6 +365,19 @@ Res VMMap(VM vm, Addr base, Addr limit)
     return ResMEMORY;
   }
 
+#if defined(VMIX_UFFD)
+  if (vm->uffd) {
+    Res res = ProtUffdRegister(base, limit);
+    if (res != ResOK) {
+      result = mmap((void *)base, (size_t)size,
+                    PROT_NONE, MAP_ANON | MAP_PRIVATE | MAP_FIXED,
+                    -1, 0);
+      AVER(result == (void *)base);
+      return res;
+    }
+  }
+#endif
+
   vm->mapped += size;
   AVER(VMMapped(vm) <= VMReserved(vm));
 
@@ -228,6 +403,11 @@ void VMUnmap(VM vm, Addr base, Addr limit)
   size = AddrOffset(base, limit);
   AVER(size <= VMMapped(vm));
 
+#if defined(VMIX_ALIAS)
+  if (vm->alias != 0)
+    vmAliasUnmap(vm, base, size);
+#endif
+
   /* see <design/vmo1#.fun.unmap.offset> */
   addr = mmap((void *)base, (size_t)size,
               PROT_NONE, MAP_ANON | MAP_PRIVATE | MAP_FIXED,
@@ -0,0 +1,88 @@
+/* wk.h: COLLECTOR WORKER THREADS
+ *
+ * $Id$
+ * Copyright (c) 2026 Ravenbrook Limited.  See end of file for license.
+ *
+ * .purpose: Provides a team of threads owned by the MPS, which the
+ * tracer uses to scan segments in parallel.  See
+ * <design/trace#.parallel>.
+ *
+ * .caller: The team always includes the thread that calls
+ * WorkersRun, as worker 0, so a team of one worker has no threads of
+ * its own.
+ */
+
+#ifndef wk_h
+#define wk_h
+
+#include "mpmtypes.h"
+
+
+#define WorkersSig      ((Sig)0x51930E45) /* SIGnature WORKErS */
+
+
+/* WorkersCreate -- create a team of workers
+ *
+ * Creates a team of count workers (including the caller: see
+ * .caller) for the arena.  Returns ResRESOURCE if the operating
+ * system could not create the threads.
+ */
+
+extern Res WorkersCreate(Workers *workersReturn, Arena arena, Count count);
+
+
+/* WorkersDestroy -- stop the threads and destroy the team */
+
+extern void WorkersDestroy(Workers workers);
+
+
+extern Bool WorkersCheck(Workers workers);
+
+
+/* WorkersCount -- return the number of workers in the team */
+
+extern Count WorkersCount(Workers workers);
+
+
+/* WorkersRun -- run a method on all the workers
+ *
+ * Calls method(closure, i) for each worker index i in [0, count),
+ * in parallel where the platform allows, and returns when all the
+ * calls have returned.  The method is called on the caller's thread
+ * with index 0.  The method must not enter the arena or log events.
+ */
+
+extern void WorkersRun(Workers workers, WorkersMethod method, void *closure);
+
+
+#endif /* wk_h */
+
+
+/* C. COPYRIGHT AND LICENSE
+ *
+ * Copyright (C) 2026 Ravenbrook Limited <https://www.ravenbrook.com/>.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+ * IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
@@ -0,0 +1,113 @@
+/* wkan.c: ANSI COLLECTOR WORKER THREADS
+ *
+ * $Id$
+ * Copyright (c) 2026 Ravenbrook Limited.  See end of file for license.
+ *
+ * .purpose: This is a trivial implementation of the worker team for
+ * platforms without a worker thread implementation.  It has no
+ * threads: WorkersRun runs every worker in turn on the calling
+ * thread.  See <design/trace#.parallel>.
+ */
+
+#include "mpm.h"
+
+SRCID(wkan, "$Id$");
+
+
+typedef struct WorkersStruct {  /* ANSI fake worker team */
+  Sig sig;                      /* design.mps.sig.field */
+  Arena arena;                  /* owning arena */
+  Count count;                  /* number of workers */
+} WorkersStruct;
+
+
+Bool WorkersCheck(Workers workers)
+{
+  CHECKS(Workers, workers);
+  CHECKU(Arena, workers->arena);
+  CHECKL(workers->count >= 1);
+  return TRUE;
+}
+
+
+Count WorkersCount(Workers workers)
+{
+  AVERT(Workers, workers);
+  return workers->count;
+}
+
+
+Res WorkersCreate(Workers *workersReturn, Arena arena, Count count)
+{
+  Workers workers;
+  void *p;
+  Res res;
+
+  AVER(workersReturn != NULL);
+  AVERT(Arena, arena);
+  AVER(count >= 1);
+
+  res = ControlAlloc(&p, arena, sizeof(WorkersStruct));
+  if (res != ResOK)
+    return res;
+  workers = p;
+
+  workers->arena = arena;
+  workers->count = count;
+  workers->sig = WorkersSig;
+  AVERT(Workers, workers);
+
+  *workersReturn = workers;
+  return ResOK;
+}
+
+
+void WorkersDestroy(Workers workers)
+{
+  AVERT(Workers, workers);
+  workers->sig = SigInvalid;
+  ControlFree(workers->arena, workers, sizeof(WorkersStruct));
+}
+
+
+void WorkersRun(Workers workers, WorkersMethod method, void *closure)
+{
+  Index i;
+
+  AVERT(Workers, workers);
+  AVER(FUNCHECK(method));
+  /* closure is arbitrary and can't be checked */
+
+  for (i = 0; i < workers->count; ++i)
+    (*method)(closure, i);
+}
+
+
+/* C. COPYRIGHT AND LICENSE
+ *
+ * Copyright (C) 2026 Ravenbrook Limited <https://www.ravenbrook.com/>.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+ * IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
@@ -0,0 +1,334 @@
+/* wkix.c: COLLECTOR WORKER THREADS FOR POSIX SYSTEMS
+ *
+ * $Id$
+ * Copyright (c) 2026 Ravenbrook Limited.  See end of file for license.
+ *
+ * .purpose: A team of POSIX threads that the tracer uses to scan
+ * segments in parallel.  See <design/trace#.parallel>.
+ *
+ * .design: The threads wait on a condition variable for the team's
+ * generation count to change.  WorkersRun stores the method and
+ * closure, increments the generation, broadcasts, runs worker 0 on
+ * the calling thread, and then waits for the running count to drop
+ * to zero.  All fields below the mutex in WorkersStruct are only
+ * accessed while holding the mutex.
+ *
+ * .signals: The threads are created with all asynchronous signals
+ * blocked, so that signals directed at the process are delivered to
+ * the client's threads.  The threads are not registered with any
+ * arena, so the thread manager never tries to suspend them.
+ *
+ * .fork: After fork() only the forking thread exists in the child,
+ * so a team created in the parent has no threads.  WorkersRun
+ * detects this by comparing process ids and runs all the workers
+ * sequentially on the calling thread.
+ */
+
+#include "mpm.h"
+
+#if !defined(MPS_OS_FR) && !defined(MPS_OS_LI) && !defined(MPS_OS_XC)
+#error "wkix.c is specific to MPS_OS_FR, MPS_OS_LI or MPS_OS_XC"
+#endif
+
+#include <pthread.h>
+#include <signal.h> /* see .feature.li in config.h */
+#include <sys/types.h> /* pid_t */
+#include <unistd.h> /* getpid */
+
+SRCID(wkix, "$Id$");
+
+
+/* WorkerStruct -- the per-thread structure */
+
+typedef struct WorkerStruct {
+  Workers workers;              /* the team */
+  Index index;                  /* worker index passed to the method */
+  pthread_t id;                 /* the thread running this worker */
+} WorkerStruct, *Worker;
+
+
+/* WorkersStruct -- the team structure */
+
+typedef struct WorkersStruct {
+  Sig sig;                      /* design.mps.sig.field */
+  Arena arena;                  /* owning arena */
+  Count count;                  /* number of workers, including caller */
+  Worker worker;                /* array of count - 1 threads */
+  pid_t pid;                    /* process that created the threads */
+  pthread_mutex_t mut;          /* protects the fields below */
+  pthread_cond_t start;         /* signalled when generation changes */
+  pthread_cond_t done;          /* signalled when running drops to 0 */
+  Serial generation;            /* incremented by each WorkersRun */
+  Count running;                /* threads still running the method */
+  Bool stopping;                /* threads should exit */
+  WorkersMethod method;         /* method to run */
+  void *closure;                /* closure argument for method */
+} WorkersStruct;
+
+
+Bool WorkersCheck(Workers workers)
+{
+  CHECKS(Workers, workers);
+  CHECKU(Arena, workers->arena);
+  CHECKL(workers->count >= 1);
+  CHECKL((workers->count == 1) == (workers->worker == NULL));
+  return TRUE;
+}
+
+
+Count WorkersCount(Workers workers)
+{
+  AVERT(Workers, workers);
+  return workers->count;
+}
+
+
+/* workerMain -- thread start routine */
+
+static void *workerMain(void *p)
+{
+  Worker worker = p;
+  Workers workers = worker->workers;
+  Serial seen = 0;
+  int status;
+
+  status = pthread_mutex_lock(&workers->mut);
+  AVER(status == 0);
+  for (;;) {
+    WorkersMethod method;
+    void *closure;
+
+    while (workers->generation == seen && !workers->stopping) {
+      status = pthread_cond_wait(&workers->start, &workers->mut);
+      AVER(status == 0);
+    }
+    if (workers->stopping)
+      break;
+    seen = workers->generation;
+    method = workers->method;
+    closure = workers->closure;
+    status = pthread_mutex_unlock(&workers->mut);
+    AVER(status == 0);
+
+    (*method)(closure, worker->index);
+
+    status = pthread_mutex_lock(&workers->mut);
+    AVER(status == 0);
+    AVER(workers->running > 0);
+    --workers->running;
+    if (workers->running == 0) {
+      status = pthread_cond_signal(&workers->done);
+      AVER(status == 0);
+    }
+  }
+  status = pthread_mutex_unlock(&workers->mut);
+  AVER(status == 0);
+  return NULL;
+}
+
+
+/* workersStop -- stop and join the first count threads */
+
+static void workersStop(Workers workers, Count count)
+{
+  Index i;
+  int status;
+
+  status = pthread_mutex_lock(&workers->mut);
+  AVER(status == 0);
+  workers->stopping = TRUE;
+  status = pthread_cond_broadcast(&workers->start);
+  AVER(status == 0);
+  status = pthread_mutex_unlock(&workers->mut);
+  AVER(status == 0);
+
+  for (i = 0; i < count; ++i) {
+    status = pthread_join(workers->worker[i].id, NULL);
+    AVER(status == 0);
+  }
+}
+
+
+Res WorkersCreate(Workers *workersReturn, Arena arena, Count count)
+{
+  Workers workers;
+  sigset_t blocked, old;
+  Index i;
+  void *p;
+  Res res;
+  int status;
+
+  AVER(workersReturn != NULL);
+  AVERT(Arena, arena);
+  AVER(count >= 1);
+
+  res = ControlAlloc(&p, arena, sizeof(WorkersStruct));
+  if (res != ResOK)
+    goto failAlloc;
+  workers = p;
+
+  workers->worker = NULL;
+  if (count > 1) {
+    res = ControlAlloc(&p, arena, (count - 1) * sizeof(WorkerStruct));
+    if (res != ResOK)
+      goto failWorkerAlloc;
+    workers->worker = p;
+  }
+
+  workers->arena = arena;
+  workers->count = count;
+  workers->pid = getpid();
+  workers->generation = 0;
+  workers->running = 0;
+  workers->stopping = FALSE;
+  workers->method = NULL;
+  workers->closure = NULL;
+  status = pthread_mutex_init(&workers->mut, NULL);
+  AVER(status == 0);
+  status = pthread_cond_init(&workers->start, NULL);
+  AVER(status == 0);
+  status = pthread_cond_init(&workers->done, NULL);
+  AVER(status == 0);
+
+  workers->sig = WorkersSig;
+  AVERT(Workers, workers);
+
+  /* .signals */
+  status = sigfillset(&blocked);
+  AVER(status == 0);
+  status = sigdelset(&blocked, SIGSEGV);
+  AVER(status == 0);
+  status = sigdelset(&blocked, SIGBUS);
+  AVER(status == 0);
+  status = sigdelset(&blocked, SIGILL);
+  AVER(status == 0);
+  status = sigdelset(&blocked, SIGFPE);
+  AVER(status == 0);
+  status = pthread_sigmask(SIG_SETMASK, &blocked, &old);
+  AVER(status == 0);
+  for (i = 0; i < count - 1; ++i) {
+    Worker worker = &workers->worker[i];
+    worker->workers = workers;
+    worker->index = i + 1;
+    status = pthread_create(&worker->id, NULL, workerMain, worker);
+    if (status != 0)
+      break;
+  }
+  status = pthread_sigmask(SIG_SETMASK, &old, NULL);
+  AVER(status == 0);
+  if (i < count - 1) {
+    res = ResRESOURCE;
+    goto failCreate;
+  }
+
+  *workersReturn = workers;
+  return ResOK;
+
+failCreate:
+  workersStop(workers, i);
+  workers->sig = SigInvalid;
+  (void)pthread_cond_destroy(&workers->done);
+  (void)pthread_cond_destroy(&workers->start);
+  (void)pthread_mutex_destroy(&workers->mut);
+  ControlFree(arena, workers->worker, (count - 1) * sizeof(WorkerStruct));
+failWorkerAlloc:
+  ControlFree(arena, workers, sizeof(WorkersStruct));
+failAlloc:
+  return res;
+}
+
+
+void WorkersDestroy(Workers workers)
+{
+  Arena arena;
+  Count count;
+
+  AVERT(Workers, workers);
+  AVER(workers->running == 0);
+  arena = workers->arena;
+  count = workers->count;
+
+  /* .fork: In a child process there are no threads to stop, and the
+     mutex and condition variables can't be relied upon. */
+  if (workers->pid == getpid()) {
+    workersStop(workers, count - 1);
+    (void)pthread_cond_destroy(&workers->done);
+    (void)pthread_cond_destroy(&workers->start);
+    (void)pthread_mutex_destroy(&workers->mut);
+  }
+
+  workers->sig = SigInvalid;
+  if (count > 1)
+    ControlFree(arena, workers->worker, (count - 1) * sizeof(WorkerStruct));
+  ControlFree(arena, workers, sizeof(WorkersStruct));
+}
+
+
+void WorkersRun(Workers workers, WorkersMethod method, void *closure)
+{
+  int status;
+
+  AVERT(Workers, workers);
+  AVER(FUNCHECK(method));
+  /* closure is arbitrary and can't be checked */
+
+  if (workers->count == 1 || workers->pid != getpid()) { /* .fork */
+    Index i;
+    for (i = 0; i < workers->count; ++i)
+      (*method)(closure, i);
+    return;
+  }
+
+  status = pthread_mutex_lock(&workers->mut);
+  AVER(status == 0);
+  AVER(workers->running == 0);
+  workers->method = method;
+  workers->closure = closure;
+  workers->running = workers->count - 1;
+  ++workers->generation;
+  status = pthread_cond_broadcast(&workers->start);
+  AVER(status == 0);
+  status = pthread_mutex_unlock(&workers->mut);
+  AVER(status == 0);
+
+  (*method)(closure, 0);
+
+  status = pthread_mutex_lock(&workers->mut);
+  AVER(status == 0);
+  while (workers->running > 0) {
+    status = pthread_cond_wait(&workers->done, &workers->mut);
+    AVER(status == 0);
+  }
+  status = pthread_mutex_unlock(&workers->mut);
+  AVER(status == 0);
+}
+
+
+/* C. COPYRIGHT AND LICENSE
+ *
+ * Copyright (C) 2026 Ravenbrook Limited <https://www.ravenbrook.com/>.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+ * IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
@@ -0,0 +1,287 @@
+/* wpbench.c: WRITE BARRIER BENCHMARK
+ *
+ * $Id$
+ * Copyright (c) 2026 Ravenbrook Limited.  See end of file for license.
+ *
+ * Measures the cost of raising the write barrier, of a write barrier
+ * hit, and of a flip, first with the write barrier set by mprotect(2)
+ * and then with MPS_KEY_VMIX_UFFD, which on Linux sets it with
+ * userfaultfd(2). See <design/protix#.uffd>.
+ *
+ * The objects are leaves in an AMS pool, so they stay put and an empty
+ * summary is true of their segments. Each round starts a collection
+ * and times it as far as the flip, finishes the collection, sets the
+ * summary of every segment to empty (which raises the write barrier),
+ * and then stores into one object in each segment, timing each store.
+ * Each of these stores hits the barrier. The same stores are then timed
+ * again, without the barrier, for comparison.
+ *
+ * On Linux, the first round also checks that the barrier still works
+ * in a child process, which doesn't inherit the registration with
+ * userfaultfd. See <design/protix#.uffd.fork>.
+ */
+
+#include "mpm.h"
+#include "fmtdy.h"
+#include "fmtdytst.h"
+#include "testlib.h"
+#include "mpslib.h"
+#include "mpscams.h"
+#include "mpsavm.h"
+
+#if defined(MPS_OS_LI)
+#include "protli.h"
+#include <sys/wait.h> /* waitpid */
+#include <unistd.h> /* fork, _exit */
+#endif
+
+#include <stdio.h> /* fflush, printf */
+#include <time.h> /* clock_gettime, CLOCK_MONOTONIC */
+
+
+#define testArenaSIZE     ((size_t)64<<20)
+#define objCOUNT          20000
+#define objSLOTS          6
+#define roundsCOUNT       20
+#define segLIMIT          objCOUNT
+
+
+static mps_gen_param_s testChain[1] = {{ 1 << 20, 0.5 }};
+
+static mps_addr_t objs[objCOUNT];
+static mps_addr_t segObjs[segLIMIT];
+
+
+/* now -- elapsed time in seconds */
+
+static double now(void)
+{
+#ifdef MPS_OS_W3
+  LARGE_INTEGER count, frequency;
+  QueryPerformanceCounter(&count);
+  QueryPerformanceFrequency(&frequency);
+  return (double)count.QuadPart / (double)frequency.QuadPart;
+#else
+  struct timespec ts;
+  int status = clock_gettime(CLOCK_MONOTONIC, &ts);
+  Insist(status == 0);
+  return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+#endif
+}
+
+
+/* findSegs -- find the first object in each segment
+ *
+ * Records them in segObjs, and returns the number of segments.
+ */
+
+static size_t findSegs(Arena arena)
+{
+  Seg seg, last = NULL;
+  size_t i, segs = 0;
+
+  ArenaEnter(arena);
+  for (i = 0; i < objCOUNT; ++i) {
+    Bool b = SegOfAddr(&seg, arena, (Addr)objs[i]);
+    Insist(b);
+    if (seg != last) {
+      Insist(segs < segLIMIT);
+      segObjs[segs] = objs[i];
+      ++segs;
+      last = seg;
+    }
+  }
+  ArenaLeave(arena);
+  return segs;
+}
+
+
+/* raiseBarrier -- raise the write barrier on the segments in segObjs
+ *
+ * The shield flushes the protection changes when the arena is left.
+ */
+
+static void raiseBarrier(Arena arena, size_t segs)
+{
+  Seg seg;
+  size_t i;
+
+  ArenaEnter(arena);
+  for (i = 0; i < segs; ++i) {
+    Bool b = SegOfAddr(&seg, arena, (Addr)segObjs[i]);
+    Insist(b);
+    SegSetSummary(seg, RefSetEMPTY);
+  }
+  ArenaLeave(arena);
+}
+
+
+/* forkCheck -- check that the stores hit the barrier in a child process */
+
+#if defined(MPS_OS_LI)
+static void forkCheck(Arena arena, size_t segs)
+{
+  pid_t pid;
+  int status;
+
+  (void)fflush(stdout);
+  pid = fork();
+  Insist(pid >= 0);
+  if (pid == 0) {
+    size_t i;
+    for (i = 0; i < segs; ++i) {
+      volatile mps_word_t *p = segObjs[i];
+      Seg seg;
+      Bool b;
+      p[2] = p[2];
+      b = SegOfAddr(&seg, arena, (Addr)segObjs[i]);
+      Insist(b);
+      Insist(SegSummary(seg) == RefSetUNIV);
+    }
+    _exit(0);
+  }
+  Insist(waitpid(pid, &status, 0) == pid);
+  Insist(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+}
+#endif
+
+
+/* store -- store into the first slot of an object, timing the store */
+
+static double store(mps_addr_t obj)
+{
+  volatile mps_word_t *p = obj;
+  double begin = now();
+  p[2] = p[2];
+  return now() - begin;
+}
+
+
+/* test -- run the rounds with or without userfaultfd */
+
+static void test(mps_bool_t uffd)
+{
+  mps_arena_t arena;
+  mps_fmt_t format;
+  mps_chain_t chain;
+  mps_pool_t pool;
+  mps_root_t root;
+  mps_ap_t ap;
+  double flip = 0.0, raised = 0.0, hit = 0.0, plain = 0.0, begin;
+  size_t i, round, segs, hits = 0;
+
+  MPS_ARGS_BEGIN(args) {
+    MPS_ARGS_ADD(args, MPS_KEY_ARENA_SIZE, testArenaSIZE);
+    MPS_ARGS_ADD(args, MPS_KEY_VMIX_UFFD, uffd);
+    die(mps_arena_create_k(&arena, mps_arena_class_vm(), args), "arena_create");
+  } MPS_ARGS_END(args);
+  die(dylan_fmt(&format, arena), "fmt_create");
+  die(mps_chain_create(&chain, arena, 1, testChain), "chain_create");
+  MPS_ARGS_BEGIN(args) {
+    MPS_ARGS_ADD(args, MPS_KEY_FORMAT, format);
+    MPS_ARGS_ADD(args, MPS_KEY_CHAIN, chain);
+    die(mps_pool_create_k(&pool, arena, mps_class_ams(), args),
+        "pool_create(ams)");
+  } MPS_ARGS_END(args);
+  die(mps_root_create_table(&root, arena, mps_rank_exact(), (mps_rm_t)0,
+                            objs, objCOUNT),
+      "root_create_table");
+
+  mps_arena_park(arena);
+  die(mps_ap_create(&ap, pool, mps_rank_exact()), "ap_create");
+  for (i = 0; i < objCOUNT; ++i) {
+    size_t size = (objSLOTS + 2) * sizeof(mps_word_t);
+    mps_addr_t p;
+    do {
+      die(mps_reserve(&p, ap, size), "reserve");
+      die(dylan_init(p, size, NULL, 0), "dylan_init");
+    } while (!mps_commit(ap, p, size));
+    objs[i] = p;
+  }
+  mps_ap_destroy(ap);
+  segs = findSegs((Arena)arena);
+
+  for (round = 0; round < roundsCOUNT; ++round) {
+    begin = now();
+    die(mps_arena_start_collect(arena), "start_collect");
+    flip += now() - begin;
+    mps_arena_park(arena);
+
+    begin = now();
+    raiseBarrier((Arena)arena, segs);
+    raised += now() - begin;
+
+#if defined(MPS_OS_LI)
+    if (round == 0)
+      forkCheck((Arena)arena, segs);
+#endif
+
+    for (i = 0; i < segs; ++i)
+      hit += store(segObjs[i]);
+    hits += segs;
+    for (i = 0; i < segs; ++i)
+      plain += store(segObjs[i]);
+  }
+
+  for (i = 0; i < objCOUNT; ++i)
+    cdie(dylan_check(objs[i]), "object check");
+
+  printf("%s: %lu segments, flip %.1fus, raise %.2fus/segment,"
+         " hit %.2fus, store %.3fus\n",
+         uffd ? "uffd" : "mprotect", (unsigned long)segs,
+         flip / roundsCOUNT * 1e6, raised / (double)hits * 1e6,
+         hit / (double)hits * 1e6, plain / (double)hits * 1e6);
+
+  mps_root_destroy(root);
+  mps_pool_destroy(pool);
+  mps_chain_destroy(chain);
+  mps_fmt_destroy(format);
+  mps_arena_destroy(arena);
+}
+
+
+int main(int argc, char *argv[])
+{
+  testlib_init(argc, argv);
+
+#if defined(MPS_OS_LI)
+  if (!ProtUffdSetup())
+    printf("%s: userfaultfd is not available\n", argv[0]);
+#endif
+
+  test(FALSE);
+  test(TRUE);
+
+  printf("%s: Conclusion: Failed to find any defects.\n", argv[0]);
+  return 0;
+}
+
+
+/* C. COPYRIGHT AND LICENSE
+ *
+ * Copyright (C) 2026 Ravenbrook Limited <https://www.ravenbrook.com/>.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+ * IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */